@@ -73,6 +73,10 @@
 #if defined(HAVE_LINUX_SENDFILE) || defined(HAVE_SOLARIS_SENDFILE)
 #define MHD_LINUX_SOLARIS_SENDFILE 1
 #endif /* HAVE_LINUX_SENDFILE || HAVE_SOLARIS_SENDFILE */
+#if defined(HAVE_SPLICE) && defined(HAVE_LINUX_SENDFILE)
+/* Have Linux splice() function, could be used for pipe-backed responses. */
+#define _MHD_HAVE_SPLICE 1
+#endif /* HAVE_SPLICE && HAVE_LINUX_SENDFILE */
 
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
 #  ifndef MHD_USE_THREADS
@@ -96,7 +96,7 @@ extern "C"
  * they are parsed as decimal numbers.
  * Example: 0x01093001 = 1.9.30-1.
  */
-#define MHD_VERSION 0x00097527
+#define MHD_VERSION 0x00097528
 
 /* If generic headers don't work on your platform, include headers
    which define 'va_list', 'size_t', 'ssize_t', 'intptr_t', 'off_t',
@@ -1919,7 +1919,133 @@ enum MHD_OPTION
    * This option should be followed by an `int` argument.
    * @note Available since #MHD_VERSION 0x00097207
    */
-  MHD_OPTION_TLS_NO_ALPN = 34
+  MHD_OPTION_TLS_NO_ALPN = 34,
+
+  /**
+   * Maximum number of released per-connection memory pools kept by the
+   * daemon for re-use by new connections.
+   * Re-used pools avoid memory allocation (and mmap()/munmap() system calls
+   * for large pools) for every new connection, at the cost of keeping
+   * the memory allocated while connections are not active.
+   * With a thread pool each worker thread keeps its own cache of this size.
+   * Ignored with #MHD_USE_THREAD_PER_CONNECTION.
+   * Default is zero (the cache is not used).
+   * This option should be followed by an `unsigned int` argument.
+   * @sa #MHD_DAEMON_INFO_POOL_CACHE_HITS, #MHD_DAEMON_INFO_POOL_CACHE_MISSES
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE = 35,
+
+  /**
+   * Use a separate listen socket for each worker thread of the thread pool.
+   * If set to '1', every worker opens its own listen socket bound to the
+   * same address:port with SO_REUSEPORT, so the kernel distributes incoming
+   * connections between workers instead of waking all workers for every
+   * new connection.
+   * If set to '2', additionally steer every new connection to the worker
+   * with the number equal to the number of the CPU that handled
+   * the connection (modulo the number of workers); this is useful only
+   * when application binds worker threads to CPUs (Linux only).
+   * Valid only with #MHD_OPTION_THREAD_POOL_SIZE larger than one, ignored
+   * otherwise. Cannot be used with #MHD_OPTION_LISTEN_SOCKET,
+   * #MHD_USE_NO_LISTEN_SOCKET or with disallowed address reuse.
+   * Connections queued on the worker's socket are reset when the daemon is
+   * stopped or quiesced.
+   * Default is zero (all workers share the same listen socket).
+   * This option should be followed by an `unsigned int` argument.
+   * @sa #MHD_DAEMON_INFO_WORKER_CONNECTIONS_ACCEPTED
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_OPTION_LISTEN_SOCKET_PER_WORKER = 36,
+
+  /**
+   * The maximum number of connections accepted when the listen socket
+   * becomes ready. The rest of the pending connections are accepted on
+   * the next round of the event loop.
+   * Larger values make daemon more responsive to connection storms,
+   * smaller values give more priority to already established connections.
+   * Used only with #MHD_USE_EPOLL.
+   * Default is 10, zero resets the value to the default.
+   * This option should be followed by an `unsigned int` argument.
+   * @sa #MHD_DAEMON_INFO_ACCEPT_WAKEUPS, #MHD_DAEMON_INFO_ACCEPT_BATCH_MAX
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_OPTION_ACCEPT_BATCH_SIZE = 37,
+
+  /**
+   * If followed by 'int' with value '1' enables usage of the kernel TLS
+   * offload (kTLS) for sending the data over TLS connections.
+   * When GnuTLS has enabled kTLS for the connection (this must be
+   * allowed in the GnuTLS configuration and supported by the kernel),
+   * the responses are sent by plain socket functions, including
+   * sendfile() for file-backed responses, and encrypted by the kernel.
+   * If kTLS is not enabled by GnuTLS for the connection, the data is
+   * encrypted by GnuTLS as usual.
+   * Valid only for daemons with #MHD_USE_TLS.
+   * This option should be followed by an `int` argument.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_OPTION_TLS_KTLS = 38,
+
+  /**
+   * The minimal size of the response body sent by MSG_ZEROCOPY.
+   * The body data of the responses created by
+   * #MHD_create_response_from_buffer_static(),
+   * #MHD_create_response_from_buffer_with_free_callback() and
+   * #MHD_create_response_from_iovec() is not copied to the kernel
+   * socket buffers if the total size of the body is not less than
+   * this value.  The response (and its free callback) is kept until
+   * the kernel reports that the data is not used anymore, even after
+   * the connection is closed: the socket of the closed connection is
+   * kept open until the notifications are received (in
+   * thread-per-connection mode the thread of the connection waits for
+   * them).  Only when the daemon is stopped the responses are released
+   * without waiting for the kernel.
+   * Not used for daemons with #MHD_USE_TLS (including connections with
+   * kernel TLS) and used only on platforms with MSG_ZEROCOPY support
+   * (Linux), the data is copied as usual otherwise.  Small values are
+   * not recommended as the zerocopy sending has its own overhead.
+   * The kernel notifications are reported as the socket errors, with
+   * `select()` they are checked every few milliseconds while some
+   * data is not released by the kernel, suspended connections are not
+   * checked until resumed.
+   * Default is zero: zerocopy sending is not used.
+   * This option should be followed by a `size_t` argument.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_OPTION_ZEROCOPY_THRESHOLD = 39,
+
+  /**
+   * The number of threads in the pool for the blocking tasks of
+   * the requests, see #MHD_offload_connection().
+   * The connections are handled by the usual daemon's threads, only
+   * the tasks passed to #MHD_offload_connection() are processed by
+   * the threads of this pool.  Implies #MHD_ALLOW_SUSPEND_RESUME.
+   * Requires #MHD_USE_INTERNAL_POLLING_THREAD, cannot be used with
+   * #MHD_USE_THREAD_PER_CONNECTION.
+   * Default is zero: the pool is not used.
+   * This option should be followed by an `unsigned int` argument.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_OPTION_OFFLOAD_POOL_SIZE = 40,
+
+  /**
+   * If followed by 'int' with non-zero value, the memory pool of the
+   * keep-alive connection is released when the request is completed
+   * and no data of the next request is received yet.  The pool is
+   * allocated again when the data of the next request arrives.
+   * The initial size of the read buffer is chosen based on the size
+   * of the previous requests of the connection instead of half of
+   * the pool.
+   * This reduces the memory used by many idle keep-alive connections.
+   * Should be combined with #MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE
+   * so the released pools are re-used instead of being allocated for
+   * every request.
+   * Ignored with #MHD_USE_THREAD_PER_CONNECTION.
+   * This option should be followed by an `int` argument.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_OPTION_CONNECTION_MEMORY_RELEASE_IDLE = 41
 } _MHD_FIXED_ENUM;
 
 
@@ -2340,7 +2466,78 @@ enum MHD_DaemonInfoType
    * Note: if port '0' was specified for #MHD_start_daemon(), returned
    * value will be real port number.
    */
-  MHD_DAEMON_INFO_BIND_PORT
+  MHD_DAEMON_INFO_BIND_PORT,
+
+  /**
+   * Request the number of new connections that have got the memory pool
+   * from the daemon's pool cache (summed over all worker threads).
+   * No extra arguments should be passed.
+   * The same limitations as for #MHD_DAEMON_INFO_CURRENT_CONNECTIONS apply.
+   * @sa #MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_DAEMON_INFO_POOL_CACHE_HITS,
+
+  /**
+   * Request the number of new connections that have got newly allocated
+   * memory pool as the daemon's pool cache was empty (summed over all worker
+   * threads).
+   * Not counted if the pool cache is not used.
+   * No extra arguments should be passed.
+   * The same limitations as for #MHD_DAEMON_INFO_CURRENT_CONNECTIONS apply.
+   * @sa #MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_DAEMON_INFO_POOL_CACHE_MISSES,
+
+  /**
+   * Request the number of connections accepted by the worker thread.
+   * Should be followed by an `unsigned int` argument with the number of
+   * the worker in the thread pool (zero-based). For the daemon without
+   * thread pool the only valid number is zero.
+   * Returns NULL if the number of the worker is not valid.
+   * The value may be slightly outdated as it is updated by the worker
+   * thread without locking.
+   * @sa #MHD_OPTION_LISTEN_SOCKET_PER_WORKER
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_DAEMON_INFO_WORKER_CONNECTIONS_ACCEPTED,
+
+  /**
+   * Request the number of times the daemon woke up with the listen socket
+   * ready for accepting new connections (summed over all worker threads).
+   * Together with the number of accepted connections it gives the average
+   * number of connections accepted per wake up.
+   * Counted only with #MHD_USE_EPOLL.
+   * No extra arguments should be passed.
+   * The same limitations as for #MHD_DAEMON_INFO_CURRENT_CONNECTIONS apply.
+   * @sa #MHD_OPTION_ACCEPT_BATCH_SIZE
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_DAEMON_INFO_ACCEPT_WAKEUPS,
+
+  /**
+   * Request the maximum number of connections accepted in a single wake up
+   * (the maximum over all worker threads).
+   * Counted only with #MHD_USE_EPOLL.
+   * No extra arguments should be passed.
+   * The same limitations as for #MHD_DAEMON_INFO_CURRENT_CONNECTIONS apply.
+   * @sa #MHD_OPTION_ACCEPT_BATCH_SIZE
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_DAEMON_INFO_ACCEPT_BATCH_MAX,
+
+  /**
+   * Request the performance counters of the daemon (summed over all
+   * worker threads), see struct #MHD_DaemonStats.
+   * No extra arguments should be passed.
+   * The counters are updated without locking by the threads that own
+   * them, the values may be slightly outdated.  With
+   * #MHD_USE_THREAD_PER_CONNECTION the counters of the connection are
+   * added when the closed connection is cleaned up.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_DAEMON_INFO_STATS
 } _MHD_FIXED_ENUM;
 
 
@@ -3444,6 +3641,92 @@ _MHD_EXTERN void
 MHD_resume_connection (struct MHD_Connection *connection);
 
 
+/**
+ * Blocking task of the request, processed by the thread of the pool
+ * configured by #MHD_OPTION_OFFLOAD_POOL_SIZE.
+ *
+ * The task must not use any MHD functions for the @a connection,
+ * the results of the task should be kept in the request context
+ * and used by the #MHD_AccessHandlerCallback.
+ *
+ * @param cls the closure passed to #MHD_offload_connection()
+ * @param connection the connection of the request
+ * @note Available since #MHD_VERSION 0x00097528
+ */
+typedef void
+(*MHD_OffloadCallback)(void *cls,
+                       struct MHD_Connection *connection);
+
+
+/**
+ * Process the blocking task of the request (like the database query)
+ * in the thread of the pool instead of the daemon's thread.
+ *
+ * The connection is suspended and the @a task is queued to the pool
+ * configured by #MHD_OPTION_OFFLOAD_POOL_SIZE.  When the @a task is
+ * finished the connection is resumed automatically and the
+ * #MHD_AccessHandlerCallback is called again, so the response can be
+ * created from the results of the @a task.  The daemon's thread
+ * is not blocked and can process other connections meanwhile.
+ *
+ * The only safe way to call this function is to call it from the
+ * #MHD_AccessHandlerCallback.
+ *
+ * @param connection the connection to offload
+ * @param task the task to run in the thread of the pool
+ * @param task_cls the closure for the @a task
+ * @return #MHD_YES if the @a task is queued and the connection is
+ *         suspended,
+ *         #MHD_NO if the pool is not used by the daemon, the daemon is
+ *         being stopped, the pool is stopped after an internal error
+ *         or the connection cannot be suspended
+ * @note Available since #MHD_VERSION 0x00097528
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_offload_connection (struct MHD_Connection *connection,
+                        MHD_OffloadCallback task,
+                        void *task_cls);
+
+
+/**
+ * Receive the body of the request directly to the buffer of the
+ * application instead of the connection's memory pool.
+ *
+ * The data of the body is received from the network to the @a buffer
+ * without intermediate copying and is passed to the
+ * #MHD_AccessHandlerCallback only when the @a buffer is full or the
+ * whole body is received, so the large uploads are processed with
+ * much fewer calls of the #MHD_AccessHandlerCallback.  The
+ * @a upload_data argument of the #MHD_AccessHandlerCallback points to
+ * the start of the @a buffer in this case.  The data left unprocessed
+ * by the #MHD_AccessHandlerCallback is moved to the start of the
+ * @a buffer and the buffer is filled again.
+ *
+ * The @a buffer must be valid until the request is completed (see
+ * #MHD_OPTION_NOTIFY_COMPLETED).  The data received together with
+ * the request header is copied to the @a buffer.
+ *
+ * The buffer can be set only for the requests with the body of the
+ * known size ("Content-Length:" header) and only when the
+ * #MHD_AccessHandlerCallback is called for the first time for the
+ * request (with zero @a upload_data_size).
+ *
+ * @param connection the connection to use
+ * @param buffer the buffer for the body of the request
+ * @param buffer_size the size of the @a buffer, must not be zero
+ * @return #MHD_YES if the @a buffer will be used,
+ *         #MHD_NO if the request has no body, the body is sent with
+ *         chunked encoding, the response is already queued or
+ *         the function is called not from the first call of the
+ *         #MHD_AccessHandlerCallback
+ * @note Available since #MHD_VERSION 0x00097528
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_set_connection_upload_buffer (struct MHD_Connection *connection,
+                                  void *buffer,
+                                  size_t buffer_size);
+
+
 /* **************** Response manipulation functions ***************** */
 
 
@@ -3530,7 +3813,48 @@ enum MHD_ResponseFlags
    * header is undesirable in response to HEAD requests.
    * @note Available since #MHD_VERSION 0x00097502
    */
-  MHD_RF_HEAD_ONLY_RESPONSE = 1 << 4
+  MHD_RF_HEAD_ONLY_RESPONSE = 1 << 4,
+
+  /**
+   * Use the direct mode for the "upgraded" connection.
+   * In the direct mode, MHD does not forward the data between the
+   * connection and the socket given to the application.  Instead, the
+   * socket of the client connection is given to the #MHD_UpgradeHandler
+   * (only to wait for the readiness of the socket) and the application
+   * must use #MHD_upgrade_recv() and #MHD_upgrade_send() to exchange the
+   * data.  For TLS connections this avoids the socketpair and two extra
+   * copies of all data.
+   * This flag is used only with responses created by
+   * #MHD_create_response_for_upgrade().
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_RF_UPGRADE_DIRECT = 1 << 5,
+
+  /**
+   * Compress the body of the reply automatically if the client accepts
+   * the compressed data (see the "Accept-Encoding" request header).
+   * The "gzip" and "deflate" codings are supported, the "br" coding is
+   * supported if MHD is built with the brotli library.
+   * For responses with the data in memory (created by
+   * #MHD_create_response_from_buffer() and similar functions or by
+   * #MHD_create_response_from_iovec()) the data is compressed only once
+   * for each coding and the compressed data is kept with the response,
+   * so the shared response is compressed only on the first use.
+   * The bodies of other responses are compressed on-the-fly.
+   * Responses with the "Content-Encoding" header or with the
+   * "Cache-Control: no-transform" header are not compressed.
+   * The "Accept-Encoding" token is added to the "Vary" header of the
+   * response when this flag is set (the header is created if missing)
+   * and removed again when the flag is cleared.
+   * The compressed replies use the "ETag" header of the response with
+   * the name of the coding added to the entity tag.
+   * If the data does not compress well with the preferred coding, the
+   * next coding accepted by the client is used.
+   * The flag is ignored if MHD is built without compression support,
+   * see #MHD_FEATURE_COMPRESSION.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_RF_COMPRESS = 1 << 6
 } _MHD_FIXED_FLAGS_ENUM;
 
 
@@ -3927,6 +4251,97 @@ MHD_create_response_from_fd_at_offset64 (uint64_t size,
                                          uint64_t offset);
 
 
+/**
+ * Handle for the cache of the responses for the files.
+ * @see #MHD_file_cache_create()
+ */
+struct MHD_FileCache;
+
+
+/**
+ * Create the cache of the responses for the files.
+ *
+ * The cache keeps the responses created by #MHD_create_response_from_fd()
+ * for the recently requested files, so the file is opened only once and
+ * the same file descriptor is shared by all replies with the file.
+ * The least recently used responses are removed from the cache when
+ * the number of the cached files reaches @a max_entries.
+ *
+ * The cached response is checked against the file (by the modification
+ * time, the size and the inode) when the response is requested and the
+ * previous check was done more than @a check_interval milliseconds ago.
+ * If the file has been changed, the file is opened again.  The file
+ * modified without change of the size within one second after the
+ * previous modification may be not detected.
+ *
+ * The cache can be used by any number of daemons and threads.
+ *
+ * @param max_entries the maximum number of the cached files, must
+ *                    not be zero
+ * @param check_interval the interval between the checks of the file,
+ *                       in milliseconds, zero to check on every request
+ * @return the new cache, NULL on error
+ * @note Available since #MHD_VERSION 0x00097528
+ * @ingroup response
+ */
+_MHD_EXTERN struct MHD_FileCache *
+MHD_file_cache_create (size_t max_entries,
+                       unsigned int check_interval);
+
+
+/**
+ * Get the response for the file from the cache.
+ *
+ * If the file is not in the cache, the file is opened and the new
+ * response is created and added to the cache.  The response has
+ * "ETag" and "Last-Modified" headers based on the file metadata, the
+ * application may use them to answer the conditional requests (see
+ * #MHD_get_response_header()).
+ *
+ * The response is shared and must not be modified by the application.
+ * The returned response must be released by #MHD_destroy_response()
+ * when not needed anymore (usually right after #MHD_queue_response()).
+ *
+ * @param cache the cache to use
+ * @param path the path of the file
+ * @return the response, NULL if the file cannot be opened or it is
+ *         not a regular file, or on error
+ * @note Available since #MHD_VERSION 0x00097528
+ * @ingroup response
+ */
+_MHD_EXTERN struct MHD_Response *
+MHD_file_cache_get_response (struct MHD_FileCache *cache,
+                             const char *path);
+
+
+/**
+ * Remove the file from the cache.
+ * Can be used when the application knows that the file has been
+ * changed.  The responses in use by the connections are not affected.
+ *
+ * @param cache the cache to use
+ * @param path the path of the file
+ * @note Available since #MHD_VERSION 0x00097528
+ * @ingroup response
+ */
+_MHD_EXTERN void
+MHD_file_cache_invalidate (struct MHD_FileCache *cache,
+                           const char *path);
+
+
+/**
+ * Destroy the cache.
+ * The responses in use by the connections are released when they are
+ * not used anymore.
+ *
+ * @param cache the cache to destroy
+ * @note Available since #MHD_VERSION 0x00097528
+ * @ingroup response
+ */
+_MHD_EXTERN void
+MHD_file_cache_destroy (struct MHD_FileCache *cache);
+
+
 /**
  * Create a response object with an array of memory buffers
  * used as the response body.
@@ -4029,6 +4444,83 @@ MHD_upgrade_action (struct MHD_UpgradeResponseHandle *urh,
                     ...);
 
 
+/**
+ * Returned by #MHD_upgrade_recv() and #MHD_upgrade_send() when
+ * the operation would block; wait for the socket readiness and retry.
+ * @note Available since #MHD_VERSION 0x00097528
+ */
+#define MHD_UPGRADE_IO_AGAIN ((ssize_t) -1)
+
+/**
+ * Returned by #MHD_upgrade_recv() and #MHD_upgrade_send() on
+ * the hard error; the connection should be closed by
+ * #MHD_UPGRADE_ACTION_CLOSE.
+ * @note Available since #MHD_VERSION 0x00097528
+ */
+#define MHD_UPGRADE_IO_ERROR ((ssize_t) -2)
+
+
+/**
+ * Receive data from the "upgraded" connection in the direct mode
+ * (see #MHD_RF_UPGRADE_DIRECT).
+ * For TLS connections the data is decrypted in place, without any
+ * intermediate buffers.
+ *
+ * The TLS layer could have some data already received, so this function
+ * should be called until it returns #MHD_UPGRADE_IO_AGAIN before waiting
+ * for the socket to become readable.
+ *
+ * This function could be called from any thread, but must not be called
+ * simultaneously for the same connection from several threads.  It is
+ * safe to call #MHD_upgrade_recv() and #MHD_upgrade_send() for the same
+ * connection simultaneously from two threads.
+ *
+ * @param urh the handle of the "upgraded" connection
+ * @param[out] buf the buffer for the received data
+ * @param buf_size the size of the @a buf
+ * @return the number of bytes received,
+ *         zero if the remote side closed the connection,
+ *         #MHD_UPGRADE_IO_AGAIN if no data available,
+ *         #MHD_UPGRADE_IO_ERROR on error or if the connection is not
+ *         in the direct mode
+ * @note Available since #MHD_VERSION 0x00097528
+ * @ingroup response
+ */
+_MHD_EXTERN ssize_t
+MHD_upgrade_recv (struct MHD_UpgradeResponseHandle *urh,
+                  void *buf,
+                  size_t buf_size);
+
+
+/**
+ * Send data over the "upgraded" connection in the direct mode
+ * (see #MHD_RF_UPGRADE_DIRECT).
+ * For TLS connections the data is encrypted and sent directly to
+ * the client.
+ *
+ * If the function returns #MHD_UPGRADE_IO_AGAIN for TLS connection, it
+ * must be called again with the same data when the socket becomes
+ * writable.
+ *
+ * This function could be called from any thread, but must not be called
+ * simultaneously for the same connection from several threads.
+ *
+ * @param urh the handle of the "upgraded" connection
+ * @param buf the data to send
+ * @param buf_size the size of the data in the @a buf
+ * @return the number of bytes sent (could be less than @a buf_size),
+ *         #MHD_UPGRADE_IO_AGAIN if the data cannot be sent now,
+ *         #MHD_UPGRADE_IO_ERROR on error or if the connection is not
+ *         in the direct mode
+ * @note Available since #MHD_VERSION 0x00097528
+ * @ingroup response
+ */
+_MHD_EXTERN ssize_t
+MHD_upgrade_send (struct MHD_UpgradeResponseHandle *urh,
+                  const void *buf,
+                  size_t buf_size);
+
+
 /**
  * Function called after a protocol "upgrade" response was sent
  * successfully and the socket should now be controlled by some
@@ -4072,6 +4564,10 @@ MHD_upgrade_action (struct MHD_UpgradeResponseHandle *urh,
  *        to perform read()/recv() and write()/send() calls on the socket.
  *        The application may also call shutdown(), but must not call
  *        close() directly.
+ *        If the response has #MHD_RF_UPGRADE_DIRECT flag, this is
+ *        the socket of the client connection, which must be used only
+ *        to wait for the readiness; the data must be exchanged by
+ *        #MHD_upgrade_recv() and #MHD_upgrade_send().
  * @param urh argument for #MHD_upgrade_action()s on this @a connection.
  *        Applications must eventually use this callback to (indirectly)
  *        perform the close() action on the @a sock.
@@ -5455,6 +5951,122 @@ MHD_set_connection_option (struct MHD_Connection *connection,
                            ...);
 
 
+/**
+ * Performance counters of the daemon, returned for #MHD_DAEMON_INFO_STATS.
+ * All counters start at zero when the daemon is started and are never
+ * reset.
+ * The layout of the structure is stable: new members may be added only
+ * at the end of the structure.
+ * @note Available since #MHD_VERSION 0x00097528
+ */
+struct MHD_DaemonStats
+{
+  /**
+   * The number of connections accepted from the listen socket.
+   */
+  uint64_t connections_accepted;
+
+  /**
+   * The number of new connections rejected because of the total or
+   * the per-IP connection limit.
+   */
+  uint64_t connections_rejected;
+
+  /**
+   * The number of connections closed by the timeout.
+   */
+  uint64_t connections_timed_out;
+
+  /**
+   * The number of requests with fully parsed request line and headers.
+   */
+  uint64_t requests_parsed;
+
+  /**
+   * The number of bytes received from the clients.
+   */
+  uint64_t bytes_received;
+
+  /**
+   * The number of bytes sent to the clients.
+   */
+  uint64_t bytes_sent;
+
+  /**
+   * The number of successful calls of send() (or the TLS send function)
+   * with a single buffer.
+   */
+  uint64_t send_calls;
+
+  /**
+   * The number of successful calls of sendmsg() or writev() with
+   * several buffers (including the header and the body sent together).
+   */
+  uint64_t iovec_calls;
+
+  /**
+   * The number of successful calls of sendfile().
+   */
+  uint64_t sendfile_calls;
+
+  /**
+   * The number of successful calls of splice().
+   */
+  uint64_t splice_calls;
+
+  /**
+   * The number of connections suspended by #MHD_suspend_connection().
+   */
+  uint64_t connections_suspended;
+
+  /**
+   * The number of connections resumed after #MHD_resume_connection().
+   */
+  uint64_t connections_resumed;
+
+  /**
+   * The number of failed allocations from the connection memory pool.
+   */
+  uint64_t pool_exhausted;
+
+  /**
+   * The number of times epoll_wait() returned with ready events.
+   * Counted only with #MHD_USE_EPOLL.
+   */
+  uint64_t epoll_wakeups;
+
+  /**
+   * The number of events returned by epoll_wait().  Together with
+   * @a epoll_wakeups it gives the average number of events per wake up.
+   * Counted only with #MHD_USE_EPOLL.
+   */
+  uint64_t epoll_events;
+
+  /**
+   * The number of successful sends of the response data with
+   * MSG_ZEROCOPY.
+   * Counted only with #MHD_OPTION_ZEROCOPY_THRESHOLD.
+   */
+  uint64_t zerocopy_calls;
+
+  /**
+   * The number of sends with MSG_ZEROCOPY for which the kernel has
+   * reported that the data has been copied anyway (for example, for
+   * the loopback connections).
+   * Counted only with #MHD_OPTION_ZEROCOPY_THRESHOLD.
+   */
+  uint64_t zerocopy_copied;
+
+  /**
+   * The number of sends of the response data larger than the
+   * threshold made by the usual copying because zerocopy sending
+   * was not possible.
+   * Counted only with #MHD_OPTION_ZEROCOPY_THRESHOLD.
+   */
+  uint64_t zerocopy_fallbacks;
+};
+
+
 /**
  * Information about an MHD daemon.
  */
@@ -5499,6 +6111,38 @@ union MHD_DaemonInfo
    * daemon, especially if #MHD_USE_AUTO was set.
    */
   enum MHD_FLAG flags;
+
+  /**
+   * Number of memory pools, for #MHD_DAEMON_INFO_POOL_CACHE_HITS and
+   * #MHD_DAEMON_INFO_POOL_CACHE_MISSES.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  uint64_t num_pools;
+
+  /**
+   * Number of accepted connections,
+   * for #MHD_DAEMON_INFO_WORKER_CONNECTIONS_ACCEPTED.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  uint64_t num_accepted;
+
+  /**
+   * Number of wake ups, for #MHD_DAEMON_INFO_ACCEPT_WAKEUPS.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  uint64_t num_wakeups;
+
+  /**
+   * Number of connections, for #MHD_DAEMON_INFO_ACCEPT_BATCH_MAX.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  unsigned int max_accept_batch;
+
+  /**
+   * Performance counters, for #MHD_DAEMON_INFO_STATS.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  const struct MHD_DaemonStats *stats;
 };
 
 
@@ -5757,7 +6401,14 @@ enum MHD_FEATURE
    * module is built.
    * @note Available since #MHD_VERSION 0x00097527
    */
-  MHD_FEATURE_DIGEST_AUTH_USERHASH = 30
+  MHD_FEATURE_DIGEST_AUTH_USERHASH = 30,
+
+  /**
+   * Get whether the automatic compression of the responses is supported.
+   * If supported then #MHD_RF_COMPRESS flag can be used.
+   * @note Available since #MHD_VERSION 0x00097528
+   */
+  MHD_FEATURE_COMPRESSION = 31
 };
 
 
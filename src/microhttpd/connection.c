@@ -55,6 +55,9 @@
 #endif /* HAVE_SYS_PARAM_H */
 #include "mhd_send.h"
 #include "mhd_assert.h"
+#ifdef COMPRESSION_SUPPORT
+#include "mhd_compress.h"
+#endif /* COMPRESSION_SUPPORT */
 
 /**
  * Message to transmit when http 1.1 request is received
@@ -273,7 +276,10 @@ MHD_connection_alloc_memory_ (struct MHD_Connection *connection,
         c->write_buffer = buf;
       }
       else
+      {
+        c->stats->pool_exhausted++;
         return NULL;
+      }
     }
     else if (NULL != c->read_buffer)
     {
@@ -292,10 +298,16 @@ MHD_connection_alloc_memory_ (struct MHD_Connection *connection,
         c->read_buffer = buf;
       }
       else
+      {
+        c->stats->pool_exhausted++;
         return NULL;
+      }
     }
     else
+    {
+      c->stats->pool_exhausted++;
       return NULL;
+    }
     res = MHD_pool_allocate (pool, size, true);
     mhd_assert (NULL != res); /* It has been checked that pool has enough space */
   }
@@ -455,6 +467,339 @@ MHD_get_connection_values_n (struct MHD_Connection *connection,
 }
 
 
+/**
+ * The names of the well-known request headers, in the order of
+ * #MHD_ReqHeaderWK values.
+ */
+static const struct _MHD_cstr_w_len wk_req_headers[MHD_REQ_HDR_WK_COUNT] = {
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_HOST),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_CONNECTION),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_CONTENT_LENGTH),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_TRANSFER_ENCODING),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_CONTENT_TYPE),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_COOKIE),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_AUTHORIZATION),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_EXPECT)
+};
+
+
+/**
+ * Find the well-known request header.
+ *
+ * @param key the name of the header
+ * @param key_size the size of the @a key
+ * @return the #MHD_ReqHeaderWK value of the header,
+ *         #MHD_REQ_HDR_WK_COUNT if header is not well-known
+ */
+static unsigned int
+req_hdr_find_wk (const char *key,
+                 size_t key_size)
+{
+  unsigned int i;
+
+  for (i = 0; i < MHD_REQ_HDR_WK_COUNT; i++)
+  {
+    if ( (wk_req_headers[i].len == key_size) &&
+         (MHD_str_equal_caseless_bin_n_ (wk_req_headers[i].str,
+                                         key,
+                                         key_size)) )
+      break;
+  }
+  return i;
+}
+
+
+/**
+ * Get the number of the hash index for the kind of the values.
+ *
+ * @param kind the kind of the values
+ * @return the number of the index,
+ *         #MHD_REQ_HDR_INDEX_KINDS if @a kind has no index
+ */
+static unsigned int
+req_hdr_kind_index (enum MHD_ValueKind kind)
+{
+  switch (kind)
+  {
+  case MHD_HEADER_KIND:
+    return 0;
+  case MHD_COOKIE_KIND:
+    return 1;
+  case MHD_POSTDATA_KIND:
+    return 2;
+  case MHD_GET_ARGUMENT_KIND:
+    return 3;
+  case MHD_FOOTER_KIND:
+    return 4;
+  default:
+    break;
+  }
+  return MHD_REQ_HDR_INDEX_KINDS;
+}
+
+
+/**
+ * Calculate caseless hash of the key (FNV-1a of lowercased bytes).
+ *
+ * @param key the key to hash
+ * @param key_size the size of the @a key
+ * @return the hash value
+ */
+static size_t
+req_hdr_hash (const char *key,
+              size_t key_size)
+{
+  uint32_t h;
+  size_t i;
+
+  h = 2166136261U;
+  for (i = 0; i < key_size; i++)
+  {
+    uint8_t c = (uint8_t) key[i];
+
+    if ( ('A' <= c) && ('Z' >= c) )
+      c = (uint8_t) (c - 'A' + 'a');
+    h ^= c;
+    h *= 16777619U;
+  }
+  return (size_t) h;
+}
+
+
+/**
+ * Find the slot for the key in the hash index.
+ *
+ * @param idx the index to use, must be built
+ * @param key the key to find
+ * @param key_size the size of the @a key
+ * @return the pointer to the slot with the value of the @a key or
+ *         to the empty slot where the value of the @a key could be put
+ */
+static struct MHD_HTTP_Req_Header **
+req_hdr_index_slot (struct MHD_ReqHeaderIndex *idx,
+                    const char *key,
+                    size_t key_size)
+{
+  const size_t mask = idx->size - 1;
+  size_t i;
+
+  mhd_assert (NULL != idx->slots);
+  mhd_assert (idx->used < idx->size);
+  i = req_hdr_hash (key, key_size) & mask;
+  while (NULL != idx->slots[i])
+  {
+    const struct MHD_HTTP_Req_Header *const pos = idx->slots[i];
+
+    if ( (key_size == pos->header_size) &&
+         ( (key == pos->header) ||
+           (MHD_str_equal_caseless_bin_n_ (key,
+                                           pos->header,
+                                           key_size)) ) )
+      break;
+    i = (i + 1) & mask;
+  }
+  return idx->slots + i;
+}
+
+
+/**
+ * Build (or re-build with the new size) the hash index of values of
+ * one kind.  All values of the kind, which are already in the list of
+ * values, are indexed.
+ *
+ * @param connection the connection to use
+ * @param kind_idx the number of the index, see #req_hdr_kind_index()
+ * @return true if succeed, false if memory allocation failed (the index
+ *         is marked as failed in this case)
+ */
+static bool
+req_hdr_index_build (struct MHD_Connection *connection,
+                     unsigned int kind_idx)
+{
+  struct MHD_ReqHeaderIndex *const idx = connection->rq_hdr_idx + kind_idx;
+  const enum MHD_ValueKind kind = (enum MHD_ValueKind) (1 << kind_idx);
+  struct MHD_HTTP_Req_Header *pos;
+  size_t size;
+
+  mhd_assert (MHD_REQ_HDR_INDEX_KINDS > kind_idx);
+  /* Keep the load factor not higher than 1/2 */
+  size = 2 * MHD_REQ_HDR_INDEX_MIN;
+  while (size < 2 * (idx->count + 1))
+    size *= 2;
+  if ( (NULL != idx->slots) &&
+       (connection->rq_hdr_spare_size <
+        idx->size * sizeof (struct MHD_HTTP_Req_Header *)) )
+  {
+    /* The memory of previous (smaller) index cannot be returned to the
+       pool, use it for the new values instead. */
+    connection->rq_hdr_spare = (char *) idx->slots;
+    connection->rq_hdr_spare_size =
+      idx->size * sizeof (struct MHD_HTTP_Req_Header *);
+  }
+  idx->slots = (struct MHD_HTTP_Req_Header **)
+               MHD_pool_allocate (connection->pool,
+                                  size * sizeof (struct MHD_HTTP_Req_Header *),
+                                  true);
+  if (NULL == idx->slots)
+  {
+    idx->failed = true;
+    return false;
+  }
+  memset (idx->slots, 0, size * sizeof (struct MHD_HTTP_Req_Header *));
+  idx->size = size;
+  idx->used = 0;
+  for (pos = connection->headers_received; NULL != pos; pos = pos->next)
+  {
+    struct MHD_HTTP_Req_Header **slot;
+
+    if ( (kind != pos->kind) ||
+         (NULL == pos->header) )
+      continue;
+    slot = req_hdr_index_slot (idx,
+                               pos->header,
+                               pos->header_size);
+    if (NULL == *slot)
+    {
+      *slot = pos;
+      idx->used++;
+    }
+  }
+  return true;
+}
+
+
+/**
+ * Update the well-known headers and the hash indices with the new value,
+ * which has been added to the end of the list of values.
+ *
+ * @param connection the connection to use
+ * @param pos the added value
+ */
+static void
+req_hdr_index_add (struct MHD_Connection *connection,
+                   struct MHD_HTTP_Req_Header *pos)
+{
+  struct MHD_ReqHeaderIndex *idx;
+  struct MHD_HTTP_Req_Header **slot;
+  unsigned int kind_idx;
+
+  kind_idx = req_hdr_kind_index (pos->kind);
+  if (MHD_REQ_HDR_INDEX_KINDS <= kind_idx)
+  {
+    connection->rq_hdr_no_index = true;
+    return;
+  }
+  idx = connection->rq_hdr_idx + kind_idx;
+  idx->count++;
+  if (NULL == pos->header)
+    return;
+  if (MHD_HEADER_KIND == pos->kind)
+  {
+    const unsigned int wk = req_hdr_find_wk (pos->header,
+                                             pos->header_size);
+
+    if ( (MHD_REQ_HDR_WK_COUNT > wk) &&
+         (NULL == connection->rq_hdr_wk[wk]) )
+      connection->rq_hdr_wk[wk] = pos;
+  }
+  if (NULL == idx->slots)
+    return;
+  if (idx->size < 2 * (idx->used + 1))
+  {
+    (void) req_hdr_index_build (connection,
+                                kind_idx);
+    return; /* The new value has been indexed by re-building */
+  }
+  slot = req_hdr_index_slot (idx,
+                             pos->header,
+                             pos->header_size);
+  if (NULL == *slot)
+  {
+    *slot = pos;
+    idx->used++;
+  }
+}
+
+
+/**
+ * Reset the well-known headers and the hash indices of the values.
+ * Must be called when the list of values is reset.
+ *
+ * @param connection the connection to use
+ */
+static void
+req_hdr_index_reset (struct MHD_Connection *connection)
+{
+  memset (connection->rq_hdr_wk,
+          0,
+          sizeof (connection->rq_hdr_wk));
+  memset (connection->rq_hdr_idx,
+          0,
+          sizeof (connection->rq_hdr_idx));
+  connection->rq_hdr_no_index = false;
+  connection->rq_hdr_spare = NULL;
+  connection->rq_hdr_spare_size = 0;
+}
+
+
+/**
+ * Find the first value with the @a key and the @a kind.
+ *
+ * @param connection the connection to use
+ * @param kind the kind of the value, could be a bitmask
+ * @param key the key to look for, must not be NULL
+ * @param key_size the size of the @a key
+ * @return the first matching value in the list of values,
+ *         NULL if not found
+ */
+static struct MHD_HTTP_Req_Header *
+req_hdr_find_first (struct MHD_Connection *connection,
+                    enum MHD_ValueKind kind,
+                    const char *key,
+                    size_t key_size)
+{
+  struct MHD_HTTP_Req_Header *pos;
+  const unsigned int kind_idx = req_hdr_kind_index (kind);
+
+  mhd_assert (NULL != key);
+  if ( (MHD_REQ_HDR_INDEX_KINDS > kind_idx) &&
+       (! connection->rq_hdr_no_index) )
+  {
+    struct MHD_ReqHeaderIndex *const idx = connection->rq_hdr_idx + kind_idx;
+
+    if (MHD_HEADER_KIND == kind)
+    {
+      const unsigned int wk = req_hdr_find_wk (key,
+                                               key_size);
+
+      if (MHD_REQ_HDR_WK_COUNT > wk)
+        return connection->rq_hdr_wk[wk];
+    }
+    if ( (NULL == idx->slots) &&
+         (! idx->failed) &&
+         (MHD_REQ_HDR_INDEX_MIN <= idx->count) )
+      (void) req_hdr_index_build (connection,
+                                  kind_idx);
+    if (NULL != idx->slots)
+      return *req_hdr_index_slot (idx,
+                                  key,
+                                  key_size);
+  }
+
+  for (pos = connection->headers_received; NULL != pos; pos = pos->next)
+  {
+    if ( (0 != (kind & pos->kind)) &&
+         (key_size == pos->header_size) &&
+         ( (key == pos->header) ||
+           (MHD_str_equal_caseless_bin_n_ (key,
+                                           pos->header,
+                                           key_size) ) ) )
+      break;
+  }
+  return pos;
+}
+
+
 /**
  * This function can be used to add an arbitrary entry to connection.
  * Internal version of #MHD_set_connection_value_n() without checking
@@ -482,10 +827,20 @@ MHD_set_connection_value_n_nocheck_ (struct MHD_Connection *connection,
 {
   struct MHD_HTTP_Req_Header *pos;
 
-  pos = MHD_connection_alloc_memory_ (connection,
-                                      sizeof (struct MHD_HTTP_Res_Header));
-  if (NULL == pos)
-    return MHD_NO;
+  if (sizeof (struct MHD_HTTP_Req_Header) <= connection->rq_hdr_spare_size)
+  {
+    /* Use the memory of the replaced hash index */
+    pos = (struct MHD_HTTP_Req_Header *) connection->rq_hdr_spare;
+    connection->rq_hdr_spare += sizeof (struct MHD_HTTP_Req_Header);
+    connection->rq_hdr_spare_size -= sizeof (struct MHD_HTTP_Req_Header);
+  }
+  else
+  {
+    pos = MHD_connection_alloc_memory_ (connection,
+                                        sizeof (struct MHD_HTTP_Res_Header));
+    if (NULL == pos)
+      return MHD_NO;
+  }
   pos->header = key;
   pos->header_size = key_size;
   pos->value = value;
@@ -503,6 +858,8 @@ MHD_set_connection_value_n_nocheck_ (struct MHD_Connection *connection,
     connection->headers_received_tail->next = pos;
     connection->headers_received_tail = pos;
   }
+  req_hdr_index_add (connection,
+                     pos);
   return MHD_YES;
 }
 
@@ -668,18 +1025,10 @@ MHD_lookup_connection_value_n (struct MHD_Connection *connection,
     }
   }
   else
-  {
-    for (pos = connection->headers_received; NULL != pos; pos = pos->next)
-    {
-      if ( (0 != (kind & pos->kind)) &&
-           (key_size == pos->header_size) &&
-           ( (key == pos->header) ||
-             (MHD_str_equal_caseless_bin_n_ (key,
-                                             pos->header,
-                                             key_size) ) ) )
-        break;
-    }
-  }
+    pos = req_hdr_find_first (connection,
+                              kind,
+                              key,
+                              key_size);
 
   if (NULL == pos)
     return MHD_NO;
@@ -710,7 +1059,7 @@ MHD_lookup_connection_value_n (struct MHD_Connection *connection,
  *         false otherwise
  */
 static bool
-MHD_lookup_header_token_ci (const struct MHD_Connection *connection,
+MHD_lookup_header_token_ci (struct MHD_Connection *connection,
                             const char *header,
                             size_t header_len,
                             const char *token,
@@ -722,7 +1071,14 @@ MHD_lookup_header_token_ci (const struct MHD_Connection *connection,
       (NULL == token) || (0 == token[0]))
     return false;
 
-  for (pos = connection->headers_received; NULL != pos; pos = pos->next)
+  /* Start from the first header with the name, the same header could be
+     repeated in the request */
+  for (pos = req_hdr_find_first (connection,
+                                 MHD_HEADER_KIND,
+                                 header,
+                                 header_len);
+       NULL != pos;
+       pos = pos->next)
   {
     if ((0 != (pos->kind & MHD_HEADER_KIND)) &&
         (header_len == pos->header_size) &&
@@ -847,7 +1203,8 @@ MHD_connection_close_ (struct MHD_Connection *connection,
   }
   if (NULL != connection->pool)
   {
-    MHD_pool_destroy (connection->pool);
+    MHD_pool_cache_release (&daemon->pool_cache,
+                            connection->pool);
     connection->pool = NULL;
   }
 
@@ -880,6 +1237,8 @@ MHD_connection_finish_forward_ (struct MHD_Connection *connection)
 
   if (0 == (daemon->options & MHD_USE_TLS))
     return; /* Nothing to do with non-TLS connection. */
+  if (urh->direct)
+    return; /* The data is not forwarded in the direct mode. */
 
   if (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
     DLL_remove (daemon->urh_head,
@@ -1001,6 +1360,36 @@ connection_close_error_check (struct MHD_Connection *connection,
 #endif
 
 
+/**
+ * Make the copy of the iov elements of the response for tracking
+ * of the sent data, if not made yet.
+ *
+ * @param connection the connection
+ * @return true on success, false if not enough memory
+ */
+static bool
+connection_prepare_resp_iov (struct MHD_Connection *connection)
+{
+  struct MHD_Response *const response = connection->response;
+  size_t copy_size;
+
+  mhd_assert (NULL != response->data_iov);
+  if (NULL != connection->resp_iov.iov)
+    return true;
+  copy_size = response->data_iovcnt * sizeof(MHD_iovec_);
+  connection->resp_iov.iov = MHD_connection_alloc_memory_ (connection,
+                                                           copy_size);
+  if (NULL == connection->resp_iov.iov)
+    return false;
+  memcpy (connection->resp_iov.iov,
+          response->data_iov,
+          copy_size);
+  connection->resp_iov.cnt = response->data_iovcnt;
+  connection->resp_iov.sent = 0;
+  return true;
+}
+
+
 /**
  * Prepare the response buffer of this connection for
  * sending.  Assumes that the response mutex is
@@ -1028,27 +1417,13 @@ try_ready_normal_body (struct MHD_Connection *connection)
     return MHD_YES;  /* 0-byte response is always ready */
   if (NULL != response->data_iov)
   {
-    size_t copy_size;
-
-    if (NULL != connection->resp_iov.iov)
+    if (connection_prepare_resp_iov (connection))
       return MHD_YES;
-    copy_size = response->data_iovcnt * sizeof(MHD_iovec_);
-    connection->resp_iov.iov = MHD_connection_alloc_memory_ (connection,
-                                                             copy_size);
-    if (NULL == connection->resp_iov.iov)
-    {
-      MHD_mutex_unlock_chk_ (&response->mutex);
-      /* not enough memory */
-      CONNECTION_CLOSE_ERROR (connection,
-                              _ ("Closing connection (out of memory)."));
-      return MHD_NO;
-    }
-    memcpy (connection->resp_iov.iov,
-            response->data_iov,
-            copy_size);
-    connection->resp_iov.cnt = response->data_iovcnt;
-    connection->resp_iov.sent = 0;
-    return MHD_YES;
+    MHD_mutex_unlock_chk_ (&response->mutex);
+    /* not enough memory */
+    CONNECTION_CLOSE_ERROR (connection,
+                            _ ("Closing connection (out of memory)."));
+    return MHD_NO;
   }
   if (NULL == response->crc)
     return MHD_YES;
@@ -1064,6 +1439,13 @@ try_ready_normal_body (struct MHD_Connection *connection)
     return MHD_YES;
   }
 #endif /* _MHD_HAVE_SENDFILE */
+#if defined(_MHD_HAVE_SPLICE)
+  if (MHD_resp_sender_splice == connection->resp_sender)
+  {
+    /* will use splice, no need to bother response crc */
+    return MHD_YES;
+  }
+#endif /* _MHD_HAVE_SPLICE */
 
   ret = response->crc (response->crc_cls,
                        connection->response_write_position,
@@ -1354,16 +1736,19 @@ keepalive_possible (struct MHD_Connection *connection)
 
 
 /**
- * Produce time stamp.
+ * Produce time stamp for the given time.
  *
  * Result is NOT null-terminated.
  * Result is always 29 bytes long.
  *
+ * @param t the time to use
  * @param[out] date where to write the time stamp, with
  *             at least 29 bytes available space.
+ * @return true on success, false if the time cannot be converted
  */
-static bool
-get_date_str (char *date)
+bool
+MHD_time_to_http_date_ (time_t t,
+                        char *date)
 {
   static const char *const days[] = {
     "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
@@ -1374,15 +1759,12 @@ get_date_str (char *date)
   };
   static const size_t buf_len = 29;
   struct tm now;
-  time_t t;
   const char *src;
 #if ! defined(HAVE_C11_GMTIME_S) && ! defined(HAVE_W32_GMTIME_S) && \
   ! defined(HAVE_GMTIME_R)
   struct tm *pNow;
 #endif
 
-  if ((time_t) -1 == time (&t))
-    return false;
 #if defined(HAVE_C11_GMTIME_S)
   if (NULL == gmtime_s (&t,
                         &now))
@@ -1440,6 +1822,26 @@ get_date_str (char *date)
 }
 
 
+/**
+ * Produce time stamp.
+ *
+ * Result is NOT null-terminated.
+ * Result is always 29 bytes long.
+ *
+ * @param[out] date where to write the time stamp, with
+ *             at least 29 bytes available space.
+ */
+static bool
+get_date_str (char *date)
+{
+  time_t t;
+
+  if ((time_t) -1 == time (&t))
+    return false;
+  return MHD_time_to_http_date_ (t, date);
+}
+
+
 /**
  * Produce HTTP DATE header.
  * Result is always 37 bytes long (plus one terminating null).
@@ -1468,12 +1870,88 @@ get_date_header (char *header)
 }
 
 
+/**
+ * Produce HTTP DATE header, using the cached value when possible.
+ * The cached value is formatted again only when the monotonic seconds
+ * counter is changed.
+ * Result is always 37 bytes long (plus one terminating null).
+ *
+ * @param c the connection to produce the header for
+ * @param[out] header where to write the header, with
+ *             at least 38 bytes available space.
+ */
+static bool
+get_date_header_cached (struct MHD_Connection *c,
+                        char *header)
+{
+  struct MHD_DateCache *cache;
+  time_t now;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  if (0 != (c->daemon->options & MHD_USE_THREAD_PER_CONNECTION))
+    cache = &c->date_cache;
+  else
+#endif /* MHD_USE_POSIX_THREADS || MHD_USE_W32_THREADS */
+  cache = &c->daemon->date_cache;
+
+  now = MHD_monotonic_sec_counter ();
+  if ( (! cache->valid) ||
+       (now != cache->mono_sec) )
+  {
+    cache->valid = get_date_header (cache->header);
+    if (! cache->valid)
+    {
+      header[0] = 0;
+      return false;
+    }
+    cache->mono_sec = now;
+  }
+  memcpy (header,
+          cache->header,
+          sizeof (cache->header));
+  return true;
+}
+
+
+/**
+ * Get the initial size of the read buffer.
+ * Half of the available space is used by default.  If the daemon
+ * releases the pools of the idle connections, the size is limited
+ * by the expected size of the request with some reserve, so the
+ * space is left for the data allocated later in the pool.
+ *
+ * @param connection the connection
+ * @param avail_size the free space in the pool
+ * @return the size of the read buffer
+ */
+static size_t
+get_initial_read_buffer_size (struct MHD_Connection *connection,
+                              size_t avail_size)
+{
+  size_t size;
+  size_t expected;
+
+  size = avail_size / 2;
+  if ( (! connection->daemon->pool_release_idle) ||
+       (0 == connection->read_buffer_hint) )
+    return size;
+  expected = connection->read_buffer_hint
+             + connection->read_buffer_hint / 2;
+  if (expected < connection->daemon->pool_increment)
+    expected = connection->daemon->pool_increment;
+  if (expected < size)
+    size = expected;
+  return size;
+}
+
+
 /**
  * Try growing the read buffer.  We initially claim half the available
  * buffer space for the read buffer (the other half being left for
  * management data structures; the write buffer can in the end take
  * virtually everything as the read buffer can be reduced to the
- * minimum necessary at that point.
+ * minimum necessary at that point), or less, see
+ * get_initial_read_buffer_size().
  *
  * @param connection the connection
  * @param required set to 'true' if grow is required, i.e. connection
@@ -1492,7 +1970,8 @@ try_grow_read_buffer (struct MHD_Connection *connection,
   if (0 == avail_size)
     return false;               /* No more space available */
   if (0 == connection->read_buffer_size)
-    new_size = avail_size / 2;  /* Use half of available buffer for reading */
+    new_size = get_initial_read_buffer_size (connection,
+                                             avail_size);
   else
   {
     size_t grow_size;
@@ -1822,6 +2301,12 @@ setup_reply_properties (struct MHD_Connection *connection)
 
   c->rp_props.chunked = use_chunked;
   c->rp_props.set = true;
+#if defined(_MHD_HAVE_SPLICE)
+  /* splice() moves the data without chunk framing */
+  if ( (use_chunked) &&
+       (MHD_resp_sender_splice == c->resp_sender) )
+    c->resp_sender = MHD_resp_sender_std;
+#endif /* _MHD_HAVE_SPLICE */
 }
 
 
@@ -1909,6 +2394,9 @@ buffer_append (char *buf,
  * @param ppos the pointer to the position in the @a buf
  * @param buf_size the size of the @a buf
  * @param response the response
+ * @param hdrs_cache the serialised user headers of the @a response,
+ *                   NULL if not available
+ * @param hdrs_cache_size the size of the @a hdrs_cache
  * @param filter_transf_enc skip "Transfer-Encoding" header if any
  * @param filter_content_len skip "Content-Length" header if any
  * @param add_close add "close" token to the
@@ -1925,6 +2413,8 @@ add_user_headers (char *buf,
                   size_t *ppos,
                   size_t buf_size,
                   struct MHD_Response *response,
+                  const char *hdrs_cache,
+                  size_t hdrs_cache_size,
                   bool filter_transf_enc,
                   bool filter_content_len,
                   bool add_close,
@@ -1948,6 +2438,19 @@ add_user_headers (char *buf,
   else if (0 != (r->flags_auto & MHD_RAF_HAS_CONNECTION_CLOSE))
     add_close = false;          /* "close" token was already set */
 
+  if ( (NULL != hdrs_cache) &&
+       (! filter_transf_enc) &&
+       (! filter_content_len) &&
+       (! add_close) &&
+       (! add_keep_alive) )
+  { /* All user headers are used as is, copy the serialised headers */
+    if (buf_size < *ppos + hdrs_cache_size)
+      return false;
+    memcpy (buf + *ppos, hdrs_cache, hdrs_cache_size);
+    *ppos += hdrs_cache_size;
+    return true;
+  }
+
   for (hdr = r->first_header; NULL != hdr; hdr = hdr->next)
   {
     size_t initial_pos = *ppos;
@@ -2172,7 +2675,7 @@ build_header_response (struct MHD_Connection *connection)
     /* Additional byte for unused zero-termination */
     if (buf_size < pos + 38)
       return MHD_NO;
-    if (get_date_header (buf + pos))
+    if (get_date_header_cached (c, buf + pos))
       pos += 37;
   }
   /* The "Connection:" header */
@@ -2197,6 +2700,7 @@ build_header_response (struct MHD_Connection *connection)
   /* User-defined headers */
 
   if (! add_user_headers (buf, &pos, buf_size, r,
+                          c->rp_hdrs_cache, c->rp_hdrs_cache_size,
                           ! c->rp_props.chunked,
                           (! c->rp_props.use_reply_body_headers) &&
                           (0 ==
@@ -2386,6 +2890,7 @@ transmit_error_response_len (struct MHD_Connection *connection,
                                                    0);
     connection->read_buffer_size = 0;
     connection->read_buffer_offset = 0;
+    connection->read_buffer_scan_pos = 0;
   }
   if (NULL != connection->response)
   {
@@ -2432,6 +2937,7 @@ transmit_error_response_len (struct MHD_Connection *connection,
     connection->colon = NULL;
     connection->headers_received = NULL;
     connection->headers_received_tail = NULL;
+    req_hdr_index_reset (connection);
     connection->write_buffer = NULL;
     connection->write_buffer_size = 0;
     connection->write_buffer_send_offset = 0;
@@ -2521,8 +3027,11 @@ MHD_connection_update_event_loop_info (struct MHD_Connection *connection)
     case MHD_CONNECTION_URL_RECEIVED:
     case MHD_CONNECTION_HEADER_PART_RECEIVED:
       /* while reading headers, we always grow the
-         read buffer if needed, no size-check required */
-      if ( (connection->read_buffer_offset == connection->read_buffer_size) &&
+         read buffer if needed, no size-check required.
+         The released pool of the idle connection is not
+         allocated until the data is received. */
+      if ( (NULL != connection->pool) &&
+           (connection->read_buffer_offset == connection->read_buffer_size) &&
            (! try_grow_read_buffer (connection, true)) )
       {
         if (connection->url != NULL)
@@ -2550,6 +3059,30 @@ MHD_connection_update_event_loop_info (struct MHD_Connection *connection)
       connection->event_loop_info = MHD_EVENT_LOOP_INFO_WRITE;
       break;
     case MHD_CONNECTION_CONTINUE_SENT:
+      if (NULL != connection->upload_buffer)
+      {
+        /* The body is received to the application's buffer */
+        if ( (connection->upload_buffer_offset ==
+              connection->upload_buffer_size) &&
+             (0 != (connection->daemon->options
+                    & MHD_USE_INTERNAL_POLLING_THREAD)) )
+        {
+          /* The application did not process the data in the full buffer
+             and did not suspend the connection, see the comment below */
+          transmit_error_response_static (connection,
+                                          MHD_HTTP_INTERNAL_SERVER_ERROR,
+                                          INTERNAL_ERROR);
+          continue;
+        }
+        if ( (0 == connection->read_buffer_offset) &&
+             (connection->upload_buffer_offset <
+              connection->upload_buffer_size) &&
+             (! connection->discard_request) )
+          connection->event_loop_info = MHD_EVENT_LOOP_INFO_READ;
+        else
+          connection->event_loop_info = MHD_EVENT_LOOP_INFO_BLOCK;
+        break;
+      }
       if (connection->read_buffer_offset == connection->read_buffer_size)
       {
         const bool internal_poll = (0 != (connection->daemon->options
@@ -2665,43 +3198,44 @@ get_next_header_line (struct MHD_Connection *connection,
                       size_t *line_len)
 {
   char *rbuf;
+  char *lf;
   size_t pos;
 
   if (0 == connection->read_buffer_offset)
     return NULL;
-  pos = 0;
   rbuf = connection->read_buffer;
   mhd_assert (NULL != rbuf);
-
-  do
+  /* Do not re-scan the data already checked by the previous call,
+     otherwise slowly received long line is processed in quadratic time */
+  pos = connection->read_buffer_scan_pos;
+  if (pos > connection->read_buffer_offset)
+    pos = 0;
+
+  lf = memchr (rbuf + pos,
+               '\n',
+               connection->read_buffer_offset - pos);
+  if (NULL != lf)
   {
-    const char c = rbuf[pos];
-    bool found;
-    found = false;
-    if ( ('\r' == c) && (pos < connection->read_buffer_offset - 1) &&
-         ('\n' == rbuf[pos + 1]) )
+    pos = (size_t) (lf - rbuf);
+    if ( (0 != pos) && ('\r' == rbuf[pos - 1]) )
     { /* Found CRLF */
-      found = true;
       if (line_len)
-        *line_len = pos;
-      rbuf[pos++] = 0; /* Replace CR with zero */
-      rbuf[pos++] = 0; /* Replace LF with zero */
+        *line_len = pos - 1;
+      rbuf[pos - 1] = 0; /* Replace CR with zero */
     }
-    else if ('\n' == c) /* TODO: Add MHD option to disallow */
+    else /* TODO: Add MHD option to disallow */
     { /* Found bare LF */
-      found = true;
       if (line_len)
         *line_len = pos;
-      rbuf[pos++] = 0; /* Replace LF with zero */
-    }
-    if (found)
-    {
-      connection->read_buffer += pos;
-      connection->read_buffer_size -= pos;
-      connection->read_buffer_offset -= pos;
-      return rbuf;
     }
-  } while (++pos < connection->read_buffer_offset);
+    rbuf[pos++] = 0; /* Replace LF with zero */
+    connection->read_buffer += pos;
+    connection->read_buffer_size -= pos;
+    connection->read_buffer_offset -= pos;
+    connection->read_buffer_scan_pos = 0;
+    return rbuf;
+  }
+  connection->read_buffer_scan_pos = connection->read_buffer_offset;
 
   /* not found, consider growing... */
   if ( (connection->read_buffer_offset == connection->read_buffer_size) &&
@@ -3418,64 +3952,156 @@ call_connection_handler (struct MHD_Connection *connection)
 
 
 /**
- * Call the handler of the application for this
- * connection.  Handles chunking of the upload
- * as well as normal uploads.
+ * Call the handler of the application with the data of the request
+ * body.
  *
  * @param connection connection we're processing
+ * @param data the body data
+ * @param size the size of the @a data, must not be zero
+ * @param[out] processed_size set to the number of bytes processed by
+ *                            the application
+ * @return true if succeed,
+ *         false if the connection is being closed
  */
-static void
-process_request_body (struct MHD_Connection *connection)
+static bool
+deliver_request_body (struct MHD_Connection *connection,
+                      const char *data,
+                      size_t size,
+                      size_t *processed_size)
 {
   struct MHD_Daemon *daemon = connection->daemon;
-  size_t available;
-  bool instant_retry;
-  char *buffer_head;
+  size_t left_unprocessed;
 
-  if (NULL != connection->response)
+  mhd_assert (0 != size);
+  left_unprocessed = size;
+  connection->client_aware = true;
+  if (MHD_NO ==
+      daemon->default_handler (daemon->default_handler_cls,
+                               connection,
+                               connection->url,
+                               connection->method,
+                               connection->version,
+                               data,
+                               &left_unprocessed,
+                               &connection->client_context))
   {
-    /* TODO: discard all read buffer as early response
-     * means that connection have to be closed. */
-    /* already queued a response, discard remaining upload
-       (but not more, there might be another request after it) */
-    size_t purge;
+    /* serious internal error, close connection */
+    CONNECTION_CLOSE_ERROR (connection,
+                            _ ("Application reported internal error, " \
+                               "closing connection."));
+    return false;
+  }
+  if (left_unprocessed > size)
+    MHD_PANIC (_ ("libmicrohttpd API violation.\n"));
+#ifdef HAVE_MESSAGES
+  /* client did not process all upload data, complain if
+     the setup was incorrect, which may prevent us from
+     handling the rest of the request */
+  if ( (0 != left_unprocessed) &&
+       (0 != (daemon->options & MHD_USE_INTERNAL_POLLING_THREAD)) &&
+       (! connection->suspended) )
+    MHD_DLOG (daemon,
+              _ ("WARNING: incomplete upload processing and connection " \
+                 "not suspended may result in hung connection.\n"));
+#endif
+  *processed_size = size - left_unprocessed;
+  return true;
+}
 
-    purge = (size_t) MHD_MIN (connection->remaining_upload_size,
-                              (uint64_t) connection->read_buffer_offset);
-    connection->remaining_upload_size -= purge;
-    if (connection->read_buffer_offset > purge)
-      memmove (connection->read_buffer,
-               &connection->read_buffer[purge],
-               connection->read_buffer_offset - purge);
-    connection->read_buffer_offset -= purge;
-    return;
+
+/**
+ * Find the end of the chunk size line and the length of the
+ * chunk size number in the line.
+ *
+ * @param line the start of the line
+ * @param available the number of bytes available at @a line
+ * @param[out] line_len set to the length of the line without the
+ *                      terminating LF, or to @a available if the end
+ *                      of the line is not received yet
+ * @param[out] size_len set to the length of the chunk size number
+ * @return true if the end of the chunk size number is found (the end
+ *         of the line or the start of the chunk extension),
+ *         false if more data is needed to find it
+ */
+static bool
+find_chunk_size_str (const char *line,
+                     size_t available,
+                     size_t *line_len,
+                     size_t *size_len)
+{
+  const char *lf;
+  const char *ext;
+
+  /* memchr() is usually vectorised by the C library, much faster than
+     checking char by char */
+  lf = memchr (line, '\n', available);
+  *line_len = (NULL != lf) ? (size_t) (lf - line) : available;
+  ext = memchr (line, ';', *line_len);
+  if (NULL != ext)
+  { /* Found chunk extension */
+    *size_len = (size_t) (ext - line);
+    return true;
   }
+  *size_len = *line_len;
+  /* TODO: Add an option to disallow bare LF */
+  if ( (0 != *size_len) &&
+       ('\r' == line[*size_len - 1]) )
+    (*size_len)--;
+  return (NULL != lf);
+}
+
+
+/**
+ * Decode the body of the request with chunked encoding and give the
+ * data to the application.
+ * The payload of all chunks available in the read buffer is moved
+ * together (over the chunk size lines), so the data of many small
+ * chunks is processed by the application in a single call.  The first
+ * chunk is not moved, a single large chunk is never copied.
+ * The decoded data not processed by the application is kept at the
+ * start of the read buffer, see @a chunked_decoded_size.
+ *
+ * @param connection connection we're processing
+ */
+static void
+process_request_body_chunked (struct MHD_Connection *connection)
+{
+  char *const buf = connection->read_buffer;
+  size_t src;       /**< the position of the next undecoded byte */
+  size_t dst_start; /**< the start of the decoded data */
+  size_t dst;       /**< the end of the decoded data */
+  size_t processed_size;
+  size_t left_unprocessed;
+  size_t raw_left;
+  bool final_chunk;
+  bool final_chunk_delayed;
 
-  buffer_head = connection->read_buffer;
-  available = connection->read_buffer_offset;
   do
   {
-    size_t to_be_processed;
-    size_t left_unprocessed;
-    size_t processed_size;
-
-    instant_retry = false;
-    if (connection->have_chunked_upload)
+    mhd_assert (MHD_SIZE_UNKNOWN == connection->remaining_upload_size);
+    mhd_assert (connection->chunked_decoded_size <= \
+                connection->read_buffer_offset);
+    dst_start = 0;
+    dst = connection->chunked_decoded_size;
+    src = dst;
+    final_chunk = false;
+    final_chunk_delayed = false;
+    while (src < connection->read_buffer_offset)
     {
-      mhd_assert (MHD_SIZE_UNKNOWN == connection->remaining_upload_size);
+      const size_t available = connection->read_buffer_offset - src;
+
       if ( (connection->current_chunk_offset ==
             connection->current_chunk_size) &&
            (0 != connection->current_chunk_size) )
       {
         size_t i;
-        mhd_assert (0 != available);
         /* skip new line at the *end* of a chunk */
         i = 0;
         if ( (2 <= available) &&
-             ('\r' == buffer_head[0]) &&
-             ('\n' == buffer_head[1]) )
+             ('\r' == buf[src]) &&
+             ('\n' == buf[src + 1]) )
           i += 2;                        /* skip CRLF */
-        else if ('\n' == buffer_head[0]) /* TODO: Add MHD option to disallow */
+        else if ('\n' == buf[src])       /* TODO: Add MHD option to disallow */
           i++;                           /* skip bare LF */
         else if (2 > available)
           break;                         /* need more upload data */
@@ -3487,132 +4113,89 @@ process_request_body (struct MHD_Connection *connection)
                                           REQUEST_CHUNKED_MALFORMED);
           return;
         }
-        available -= i;
-        buffer_head += i;
+        src += i;
         connection->current_chunk_offset = 0;
         connection->current_chunk_size = 0;
-        if (0 == available)
-          break;
       }
-      if (0 != connection->current_chunk_size)
+      else if (0 != connection->current_chunk_size)
       {
+        /* we are in the middle of a chunk, decode as much as possible */
         uint64_t cur_chunk_left;
+        size_t payload_size;
+
         mhd_assert (connection->current_chunk_offset < \
                     connection->current_chunk_size);
-        /* we are in the middle of a chunk, give
-           as much as possible to the client (without
-           crossing chunk boundaries) */
         cur_chunk_left
           = connection->current_chunk_size - connection->current_chunk_offset;
-        if (cur_chunk_left > available)
-          to_be_processed = available;
+        if (cur_chunk_left < available)
+          payload_size = (size_t) cur_chunk_left;
         else
-        {         /* cur_chunk_left <= (size_t)available */
-          to_be_processed = (size_t) cur_chunk_left;
-          if (available > to_be_processed)
-            instant_retry = true;
-        }
+          payload_size = available;
+        if (dst == dst_start)
+          dst_start = dst = src; /* No decoded data yet, do not move */
+        else if (dst != src)
+          memmove (buf + dst,
+                   buf + src,
+                   payload_size);
+        dst += payload_size;
+        src += payload_size;
+        connection->current_chunk_offset += payload_size;
       }
       else
       {
-        size_t i;
-        /** The length of the string with the number of the chunk size */
+        size_t line_len;
         size_t chunk_size_len;
+        size_t num_dig;
+        uint64_t chunk_size;
         bool found_chunk_size_str;
         bool malformed;
 
         /* we need to read chunk boundaries */
-        i = 0;
-        found_chunk_size_str = false;
-        chunk_size_len = 0;
-        mhd_assert (0 != available);
-        do
+        found_chunk_size_str = find_chunk_size_str (buf + src,
+                                                    available,
+                                                    &line_len,
+                                                    &chunk_size_len);
+        malformed = (0 == chunk_size_len) &&
+                    (found_chunk_size_str || (0 != line_len));
+        /* Check whether size is valid hexadecimal number
+         * even if end of the string is not found yet. */
+        num_dig = MHD_strx_to_uint64_n_ (buf + src,
+                                         chunk_size_len,
+                                         &chunk_size);
+        malformed = malformed || (chunk_size_len != num_dig);
+        if ( (available != line_len) && ! malformed)
         {
-          if ('\n' == buffer_head[i])
-          {
-            if ((0 < i) && ('\r' == buffer_head[i - 1]))
-            { /* CRLF */
-              if (! found_chunk_size_str)
-                chunk_size_len = i - 1;
-            }
-            else
-            { /* bare LF */
-              /* TODO: Add an option to disallow bare LF */
-              if (! found_chunk_size_str)
-                chunk_size_len = i;
-            }
-            found_chunk_size_str = true;
-            break; /* Found the end of the string */
-          }
-          else if (! found_chunk_size_str && (';' == buffer_head[i]))
-          { /* Found chunk extension */
-            chunk_size_len = i;
-            found_chunk_size_str = true;
-          }
-        } while (available > ++i);
-        mhd_assert ((i == available) || found_chunk_size_str);
-        mhd_assert ((0 == chunk_size_len) || found_chunk_size_str);
-        malformed = ((0 == chunk_size_len) && found_chunk_size_str);
-        if (! malformed)
-        {
-          /* Check whether size is valid hexadecimal number
-           * even if end of the string is not found yet. */
-          size_t num_dig;
-          uint64_t chunk_size;
-          mhd_assert (0 < i);
-          if (! found_chunk_size_str)
-          {
-            mhd_assert (i == available);
-            /* Check already available part of the size string for valid
-             * hexadecimal digits. */
-            chunk_size_len = i;
-            if ('\r' == buffer_head[i - 1])
+          /* Found end of the string and the size of the chunk is valid */
+          if (0 == chunk_size)
+          { /* The final (termination) chunk */
+            if (dst != dst_start)
             {
-              chunk_size_len--;
-              malformed = (0 == chunk_size_len);
-            }
-          }
-          num_dig = MHD_strx_to_uint64_n_ (buffer_head,
-                                           chunk_size_len,
-                                           &chunk_size);
-          malformed = malformed || (chunk_size_len != num_dig);
-
-          if ((available != i) && ! malformed)
-          {
-            /* Found end of the string and the size of the chunk is valid */
-
-            mhd_assert (found_chunk_size_str);
-            /* Start reading payload data of the chunk */
-            connection->current_chunk_offset = 0;
-            connection->current_chunk_size = chunk_size;
-            i++; /* Consume the last checked char */
-            available -= i;
-            buffer_head += i;
-
-            if (0 == connection->current_chunk_size)
-            { /* The final (termination) chunk */
-              connection->remaining_upload_size = 0;
+              /* Give the decoded data to the application first,
+                 the data after the final chunk is the footer */
+              final_chunk_delayed = true;
               break;
             }
-            if (available > 0)
-              instant_retry = true;
-            continue;
+            final_chunk = true;
+            src += line_len + 1;
+            break;
           }
-
-          if ((0 == num_dig) && (0 != chunk_size_len))
-          { /* Check whether result is invalid due to uint64_t overflow */
-            /* At least one byte is always available
-             * in the input buffer here. */
-            const char d = buffer_head[0]; /**< first digit */
-            if ((('0' <= d) && ('9' >= d)) ||
-                (('A' <= d) && ('F' >= d)) ||
-                (('a' <= d) && ('f' >= d)))
-            { /* The first char is a valid hexadecimal digit */
-              transmit_error_response_static (connection,
-                                              MHD_HTTP_CONTENT_TOO_LARGE,
-                                              REQUEST_CHUNK_TOO_LARGE);
-              return;
-            }
+          /* Start reading payload data of the chunk */
+          connection->current_chunk_offset = 0;
+          connection->current_chunk_size = chunk_size;
+          src += line_len + 1;
+          continue;
+        }
+        if ((0 == num_dig) && (0 != chunk_size_len))
+        { /* Check whether result is invalid due to uint64_t overflow */
+          const char d = buf[src]; /**< first digit */
+          if ((('0' <= d) && ('9' >= d)) ||
+              (('A' <= d) && ('F' >= d)) ||
+              (('a' <= d) && ('f' >= d)))
+          { /* The first char is a valid hexadecimal digit */
+            transmit_error_response_static (connection,
+                                            MHD_HTTP_CONTENT_TOO_LARGE,
+                                            REQUEST_CHUNK_TOO_LARGE);
+            return;
           }
         }
         if (malformed)
@@ -3622,78 +4205,176 @@ process_request_body (struct MHD_Connection *connection)
                                           REQUEST_CHUNKED_MALFORMED);
           return;
         }
-        mhd_assert (available == i);
         break; /* The end of the string not found, need more upload data */
       }
     }
-    else
-    {
-      /* no chunked encoding, give all to the client */
-      mhd_assert (MHD_SIZE_UNKNOWN != connection->remaining_upload_size);
-      mhd_assert (0 != connection->remaining_upload_size);
-      if (connection->remaining_upload_size < available)
-        to_be_processed = (size_t) connection->remaining_upload_size;
-      else
-        to_be_processed = available;
-    }
-    left_unprocessed = to_be_processed;
-    connection->client_aware = true;
-    if (MHD_NO ==
-        daemon->default_handler (daemon->default_handler_cls,
-                                 connection,
-                                 connection->url,
-                                 connection->method,
-                                 connection->version,
-                                 buffer_head,
-                                 &left_unprocessed,
-                                 &connection->client_context))
-    {
-      /* serious internal error, close connection */
-      CONNECTION_CLOSE_ERROR (connection,
-                              _ ("Application reported internal error, " \
-                                 "closing connection."));
-      return;
-    }
-    if (left_unprocessed > to_be_processed)
-      MHD_PANIC (_ ("libmicrohttpd API violation.\n"));
-    if (0 != left_unprocessed)
+
+    processed_size = 0;
+    if (dst != dst_start)
     {
-      instant_retry = false; /* client did not process everything */
-#ifdef HAVE_MESSAGES
-      /* client did not process all upload data, complain if
-         the setup was incorrect, which may prevent us from
-         handling the rest of the request */
-      if ( (0 != (daemon->options & MHD_USE_INTERNAL_POLLING_THREAD)) &&
-           (! connection->suspended) )
-        MHD_DLOG (daemon,
-                  _ ("WARNING: incomplete upload processing and connection " \
-                     "not suspended may result in hung connection.\n"));
-#endif
+      if (! deliver_request_body (connection,
+                                  buf + dst_start,
+                                  dst - dst_start,
+                                  &processed_size))
+        return;
     }
-    processed_size = to_be_processed - left_unprocessed;
-    if (connection->have_chunked_upload)
-      connection->current_chunk_offset += processed_size;
-    /* dh left "processed" bytes in buffer for next time... */
-    buffer_head += processed_size;
-    available -= processed_size;
-    if (! connection->have_chunked_upload)
+    /* Keep the unprocessed decoded data and the undecoded data
+       at the start of the buffer */
+    left_unprocessed = dst - dst_start - processed_size;
+    if ( (0 != left_unprocessed) &&
+         (0 != dst_start + processed_size) )
+      memmove (buf,
+               buf + dst_start + processed_size,
+               left_unprocessed);
+    raw_left = connection->read_buffer_offset - src;
+    if ( (0 != raw_left) &&
+         (left_unprocessed != src) )
+      memmove (buf + left_unprocessed,
+               buf + src,
+               raw_left);
+    connection->read_buffer_offset = left_unprocessed + raw_left;
+    connection->chunked_decoded_size = left_unprocessed;
+    if (final_chunk)
+      connection->remaining_upload_size = 0;
+  } while (final_chunk_delayed &&
+           (0 == left_unprocessed));
+}
+
+
+/**
+ * Call the handler of the application for the body data in the
+ * buffer set by #MHD_set_connection_upload_buffer().  The handler is
+ * called only when the buffer is full or the whole body is received.
+ *
+ * @param connection connection we're processing
+ */
+static void
+process_upload_buffer (struct MHD_Connection *connection)
+{
+  size_t left_unprocessed;
+  size_t processed_size;
+
+  mhd_assert (! connection->have_chunked_upload);
+  mhd_assert (connection->upload_buffer_offset <= \
+              connection->remaining_upload_size);
+  if (0 != connection->read_buffer_offset)
+  {
+    /* Move the data received before the buffer was set */
+    uint64_t copy_size;
+
+    copy_size = connection->remaining_upload_size
+                - connection->upload_buffer_offset;
+    if (copy_size > connection->upload_buffer_size
+        - connection->upload_buffer_offset)
+      copy_size = connection->upload_buffer_size
+                  - connection->upload_buffer_offset;
+    if (copy_size > connection->read_buffer_offset)
+      copy_size = connection->read_buffer_offset;
+    memcpy (connection->upload_buffer + connection->upload_buffer_offset,
+            connection->read_buffer,
+            (size_t) copy_size);
+    connection->upload_buffer_offset += (size_t) copy_size;
+    connection->read_buffer_offset -= (size_t) copy_size;
+    if (0 != connection->read_buffer_offset)
+      memmove (connection->read_buffer,
+               connection->read_buffer + copy_size,
+               connection->read_buffer_offset);
+  }
+  if ( (0 == connection->upload_buffer_offset) ||
+       ( (connection->upload_buffer_offset !=
+          connection->upload_buffer_size) &&
+         (connection->upload_buffer_offset !=
+          connection->remaining_upload_size) ) )
+    return; /* Need more upload data */
+
+  if (! deliver_request_body (connection,
+                              connection->upload_buffer,
+                              connection->upload_buffer_offset,
+                              &processed_size))
+    return;
+  left_unprocessed = connection->upload_buffer_offset - processed_size;
+  if ( (0 != left_unprocessed) &&
+       (0 != processed_size) )
+    memmove (connection->upload_buffer,
+             connection->upload_buffer + processed_size,
+             left_unprocessed);
+  connection->upload_buffer_offset = left_unprocessed;
+  connection->remaining_upload_size -= processed_size;
+}
+
+
+/**
+ * Call the handler of the application for this
+ * connection.  Handles chunking of the upload
+ * as well as normal uploads.
+ *
+ * @param connection connection we're processing
+ */
+static void
+process_request_body (struct MHD_Connection *connection)
+{
+  size_t available;
+  size_t processed_size;
+
+  if (NULL != connection->response)
+  {
+    /* TODO: discard all read buffer as early response
+     * means that connection have to be closed. */
+    /* already queued a response, discard remaining upload
+       (but not more, there might be another request after it) */
+    size_t purge;
+
+    if (NULL != connection->upload_buffer)
     {
-      mhd_assert (MHD_SIZE_UNKNOWN != connection->remaining_upload_size);
-      connection->remaining_upload_size -= processed_size;
+      /* Discard the data in the application's buffer, the rest is
+         received to the read buffer */
+      connection->remaining_upload_size -= connection->upload_buffer_offset;
+      connection->upload_buffer = NULL;
+      connection->upload_buffer_size = 0;
+      connection->upload_buffer_offset = 0;
     }
-    else
-      mhd_assert (MHD_SIZE_UNKNOWN == connection->remaining_upload_size);
-  } while (instant_retry);
+    purge = (size_t) MHD_MIN (connection->remaining_upload_size,
+                              (uint64_t) connection->read_buffer_offset);
+    connection->remaining_upload_size -= purge;
+    if (connection->read_buffer_offset > purge)
+      memmove (connection->read_buffer,
+               &connection->read_buffer[purge],
+               connection->read_buffer_offset - purge);
+    connection->read_buffer_offset -= purge;
+    connection->chunked_decoded_size = 0;
+    return;
+  }
+  if (NULL != connection->upload_buffer)
+  {
+    process_upload_buffer (connection);
+    return;
+  }
+
+  if (connection->have_chunked_upload)
+  {
+    process_request_body_chunked (connection);
+    return;
+  }
+
+  /* no chunked encoding, give all to the client */
+  mhd_assert (MHD_SIZE_UNKNOWN != connection->remaining_upload_size);
+  mhd_assert (0 != connection->remaining_upload_size);
+  available = connection->read_buffer_offset;
+  if (connection->remaining_upload_size < available)
+    available = (size_t) connection->remaining_upload_size;
+  if (! deliver_request_body (connection,
+                              connection->read_buffer,
+                              available,
+                              &processed_size))
+    return;
+  connection->remaining_upload_size -= processed_size;
+  /* dh left "processed" bytes in buffer for next time... */
   /* TODO: zero out reused memory region */
-  if ( (available > 0) &&
-       (buffer_head != connection->read_buffer) )
+  if (connection->read_buffer_offset > processed_size)
     memmove (connection->read_buffer,
-             buffer_head,
-             available);
-  else
-    mhd_assert ((0 == available) || \
-                (connection->read_buffer_offset == available));
-  connection->read_buffer_offset = available;
+             connection->read_buffer + processed_size,
+             connection->read_buffer_offset - processed_size);
+  connection->read_buffer_offset -= processed_size;
 }
 
 
@@ -3997,18 +4678,18 @@ parse_connection_headers (struct MHD_Connection *connection)
 
 
 /**
- * Update the 'last_activity' field of the connection to the current time
- * and move the connection to the head of the 'normal_timeout' list if
- * the timeout for the connection uses the default value.
+ * Update the 'last_activity' field of the connection to the current time.
+ * The timer of the connection in the daemon's timer wheel is not moved
+ * here: when the timer expires, the connection is checked and the timer
+ * is re-armed according to the 'last_activity'.
  *
  * @param connection the connection that saw some activity
  */
 void
 MHD_update_last_activity_ (struct MHD_Connection *connection)
 {
-  struct MHD_Daemon *daemon = connection->daemon;
 #if defined(MHD_USE_THREADS)
-  mhd_assert (NULL == daemon->worker_pool);
+  mhd_assert (NULL == connection->daemon->worker_pool);
 #endif /* MHD_USE_THREADS */
 
   if (0 == connection->connection_timeout_ms)
@@ -4018,24 +4699,37 @@ MHD_update_last_activity_ (struct MHD_Connection *connection)
     return;  /* no activity on suspended connections */
 
   connection->last_activity = MHD_monotonic_msec_counter ();
-  if (0 != (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
-    return; /* each connection has personal timeout */
+}
 
-  if (connection->connection_timeout_ms != daemon->connection_timeout_ms)
-    return; /* custom timeout, no need to move it in "normal" DLL */
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
-#endif
-  /* move connection to head of timeout list (by remove + add operation) */
-  XDLL_remove (daemon->normal_timeout_head,
-               daemon->normal_timeout_tail,
-               connection);
-  XDLL_insert (daemon->normal_timeout_head,
-               daemon->normal_timeout_tail,
-               connection);
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
-#endif
+
+/**
+ * Arm (or re-arm) the timer of the connection in the daemon's timer
+ * wheel according to the connection's timeout and the last activity.
+ * Disarm the timer if the connection has no timeout.
+ * Must be called with daemon's cleanup_connection_mutex locked.
+ * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
+ *
+ * @param connection the connection to arm the timer for
+ */
+void
+MHD_connection_arm_timeout_ (struct MHD_Connection *connection)
+{
+  struct MHD_Daemon *const daemon = connection->daemon;
+
+  mhd_assert (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION));
+  if (0 == connection->connection_timeout_ms)
+  {
+    MHD_timer_wheel_disarm (&daemon->timers,
+                            &connection->timer);
+    return;
+  }
+  connection->timer.cls = connection;
+  /* Expire at the first millisecond when #connection_check_timedout()
+   * reports the timeout. */
+  MHD_timer_wheel_arm (&daemon->timers,
+                       &connection->timer,
+                       connection->last_activity
+                       + connection->connection_timeout_ms + 1);
 }
 
 
@@ -4053,6 +4747,9 @@ MHD_connection_handle_read (struct MHD_Connection *connection,
                             bool socket_error)
 {
   ssize_t bytes_read;
+  char *buf;
+  size_t buf_size;
+  size_t *buf_offset;
 
   if ( (MHD_CONNECTION_CLOSED == connection->state) ||
        (connection->suspended) )
@@ -4068,21 +4765,60 @@ MHD_connection_handle_read (struct MHD_Connection *connection,
   }
 #endif /* HTTPS_SUPPORT */
 
-  /* make sure "read" has a reasonable number of bytes
-     in buffer to use per system call (if possible) */
-  if (connection->read_buffer_offset + connection->daemon->pool_increment >
-      connection->read_buffer_size)
-    try_grow_read_buffer (connection,
-                          (connection->read_buffer_size ==
-                           connection->read_buffer_offset));
+  if (NULL == connection->pool)
+  {
+    /* The pool was released while the connection was idle */
+    mhd_assert (MHD_CONNECTION_INIT == connection->state);
+    mhd_assert (0 == connection->read_buffer_size);
+    connection->pool = MHD_pool_cache_create (&connection->daemon->pool_cache,
+                                              connection->daemon->pool_size);
+    if (NULL == connection->pool)
+    {
+      CONNECTION_CLOSE_ERROR (connection,
+                              _ ("Failed to allocate memory for " \
+                                 "the connection.\n"));
+      return;
+    }
+  }
 
-  if (connection->read_buffer_size == connection->read_buffer_offset)
+  if ( (NULL != connection->upload_buffer) &&
+       (MHD_CONNECTION_CONTINUE_SENT == connection->state) &&
+       (0 == connection->read_buffer_offset) )
+  {
+    /* Receive the body directly to the application's buffer,
+       but not more than the body: the next request may follow */
+    uint64_t left;
+
+    mhd_assert (connection->upload_buffer_offset <= \
+                connection->remaining_upload_size);
+    left = connection->remaining_upload_size
+           - connection->upload_buffer_offset;
+    buf = connection->upload_buffer + connection->upload_buffer_offset;
+    buf_size = connection->upload_buffer_size
+               - connection->upload_buffer_offset;
+    if (buf_size > left)
+      buf_size = (size_t) left;
+    buf_offset = &connection->upload_buffer_offset;
+  }
+  else
+  {
+    /* make sure "read" has a reasonable number of bytes
+       in buffer to use per system call (if possible) */
+    if (connection->read_buffer_offset + connection->daemon->pool_increment >
+        connection->read_buffer_size)
+      try_grow_read_buffer (connection,
+                            (connection->read_buffer_size ==
+                             connection->read_buffer_offset));
+    buf = connection->read_buffer + connection->read_buffer_offset;
+    buf_size = connection->read_buffer_size - connection->read_buffer_offset;
+    buf_offset = &connection->read_buffer_offset;
+  }
+
+  if (0 == buf_size)
     return; /* No space for receiving data. */
   bytes_read = connection->recv_cls (connection,
-                                     &connection->read_buffer
-                                     [connection->read_buffer_offset],
-                                     connection->read_buffer_size
-                                     - connection->read_buffer_offset);
+                                     buf,
+                                     buf_size);
   if ((bytes_read < 0) || socket_error)
   {
     if ((MHD_ERR_AGAIN_ == bytes_read) && ! socket_error)
@@ -4146,7 +4882,8 @@ MHD_connection_handle_read (struct MHD_Connection *connection,
                              MHD_REQUEST_TERMINATED_WITH_ERROR);
     return;
   }
-  connection->read_buffer_offset += (size_t) bytes_read;
+  *buf_offset += (size_t) bytes_read;
+  connection->stats->bytes_received += (size_t) bytes_read;
   MHD_update_last_activity_ (connection);
 #if DEBUG_STATES
   MHD_DLOG (connection->daemon,
@@ -4333,6 +5070,23 @@ MHD_connection_handle_write (struct MHD_Connection *connection)
                                       resp->data_size,
                                       (resp->total_size == resp->data_size));
       }
+      else if ( (connection->rp_props.send_reply_body) &&
+                (NULL != resp->data_iov) &&
+                (0 != resp->data_iovcnt) &&
+                (0 == connection->response_write_position) &&
+                (! connection->rp_props.chunked) &&
+                (0 != wb_ready) &&
+                connection_prepare_resp_iov (connection) )
+      {
+        /* Send response headers alongside the response body by
+         * the single vector-send call. */
+        ret = MHD_send_hdr_and_iovec_ (connection,
+                                       &connection->write_buffer
+                                       [connection->write_buffer_send_offset],
+                                       wb_ready,
+                                       &connection->resp_iov,
+                                       true);
+      }
       else
       {
         /* This is response for HEAD request or reply body is not allowed
@@ -4411,6 +5165,14 @@ MHD_connection_handle_write (struct MHD_Connection *connection)
       }
       else /* combined with the next 'if' */
 #endif /* _MHD_HAVE_SENDFILE */
+#if defined(_MHD_HAVE_SPLICE)
+      if (MHD_resp_sender_splice == connection->resp_sender)
+      {
+        mhd_assert (NULL == response->data_iov);
+        ret = MHD_send_splice_ (connection);
+      }
+      else /* combined with the next 'if' */
+#endif /* _MHD_HAVE_SPLICE */
       if (NULL != response->data_iov)
       {
         ret = MHD_send_iovec_ (connection,
@@ -4423,12 +5185,12 @@ MHD_connection_handle_write (struct MHD_Connection *connection)
                             - response->data_start;
         if (data_write_offset > (uint64_t) SIZE_MAX)
           MHD_PANIC (_ ("Data offset exceeds limit.\n"));
-        ret = MHD_send_data_ (connection,
-                              &response->data
-                              [(size_t) data_write_offset],
-                              response->data_size
-                              - (size_t) data_write_offset,
-                              true);
+        ret = MHD_send_resp_data_ (connection,
+                                   &response->data
+                                   [(size_t) data_write_offset],
+                                   response->data_size
+                                   - (size_t) data_write_offset,
+                                   true);
 #if _MHD_DEBUG_SEND_DATA
         if (ret > 0)
           fprintf (stderr,
@@ -4458,6 +5220,16 @@ MHD_connection_handle_write (struct MHD_Connection *connection)
                                 NULL);
         return;
       }
+#if defined(_MHD_HAVE_SPLICE)
+      if ( (0 == ret) &&
+           (MHD_resp_sender_splice == connection->resp_sender) )
+      {
+        /* The writer closed the pipe, the end of the stream. */
+        MHD_connection_close_ (connection,
+                               MHD_REQUEST_TERMINATED_COMPLETED_OK);
+        return;
+      }
+#endif /* _MHD_HAVE_SPLICE */
       connection->response_write_position += (size_t) ret;
       MHD_update_last_activity_ (connection);
     }
@@ -4629,6 +5401,12 @@ cleanup_connection (struct MHD_Connection *connection)
     MHD_destroy_response (connection->response);
     connection->response = NULL;
   }
+#ifdef MHD_USE_MSG_ZEROCOPY
+  /* The thread of the connection waits for the kernel to release the
+     data, the daemon's thread would be blocked when joining it. */
+  if (0 != (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
+    MHD_zerocopy_wait_ (connection);
+#endif /* MHD_USE_MSG_ZEROCOPY */
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
@@ -4642,20 +5420,19 @@ cleanup_connection (struct MHD_Connection *connection)
   else
   {
     if (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
-    {
-      if (connection->connection_timeout_ms == daemon->connection_timeout_ms)
-        XDLL_remove (daemon->normal_timeout_head,
-                     daemon->normal_timeout_tail,
-                     connection);
-      else
-        XDLL_remove (daemon->manual_timeout_head,
-                     daemon->manual_timeout_tail,
-                     connection);
-    }
+      MHD_timer_wheel_disarm (&daemon->timers,
+                              &connection->timer);
     DLL_remove (daemon->connections_head,
                 daemon->connections_tail,
                 connection);
   }
+  if (connection->in_resume_queue)
+  {
+    RDLL_remove (daemon->resume_head,
+                 daemon->resume_tail,
+                 connection);
+    connection->in_resume_queue = false;
+  }
   DLL_insert (daemon->cleanup_head,
               daemon->cleanup_tail,
               connection);
@@ -4706,6 +5483,7 @@ connection_reset (struct MHD_Connection *connection,
     c->read_buffer = NULL;
     c->read_buffer_size = 0;
     c->read_buffer_offset = 0;
+    c->read_buffer_scan_pos = 0;
     c->write_buffer = NULL;
     c->write_buffer_size = 0;
     c->write_buffer_send_offset = 0;
@@ -4733,29 +5511,58 @@ connection_reset (struct MHD_Connection *connection,
     c->http_ver = MHD_HTTP_VER_UNKNOWN;
     c->last = NULL;
     c->colon = NULL;
-    c->header_size = 0;
+    c->upload_buffer = NULL;
+    c->upload_buffer_size = 0;
+    c->upload_buffer_offset = 0;
 #if defined(BAUTH_SUPPORT) || defined(DAUTH_SUPPORT)
     c->rq_auth = NULL;
 #endif
     c->keepalive = MHD_CONN_KEEPALIVE_UNKOWN;
-    /* Reset the read buffer to the starting size,
-       preserving the bytes we have already read. */
-    new_read_buf_size = c->daemon->pool_size / 2;
-    if (c->read_buffer_offset > new_read_buf_size)
-      new_read_buf_size = c->read_buffer_offset;
-
-    connection->read_buffer
-      = MHD_pool_reset (c->pool,
-                        c->read_buffer,
-                        c->read_buffer_offset,
-                        new_read_buf_size);
-    c->read_buffer_size = new_read_buf_size;
+    if (d->pool_release_idle)
+    {
+      /* Follow the larger requests immediately, the smaller slowly */
+      if (c->read_buffer_hint < c->header_size)
+        c->read_buffer_hint = c->header_size;
+      else
+        c->read_buffer_hint -= (c->read_buffer_hint - c->header_size) / 4;
+    }
+    c->header_size = 0;
+    if (d->pool_release_idle &&
+        (0 == c->read_buffer_offset))
+    {
+      /* No data of the next request, release the pool while the
+         connection is idle */
+      MHD_pool_cache_release (&d->pool_cache,
+                              c->pool);
+      c->pool = NULL;
+      c->read_buffer = NULL;
+      c->read_buffer_size = 0;
+    }
+    else
+    {
+      /* Reset the read buffer to the starting size,
+         preserving the bytes we have already read. */
+      new_read_buf_size = get_initial_read_buffer_size (c,
+                                                        d->pool_size);
+      if (c->read_buffer_offset > new_read_buf_size)
+        new_read_buf_size = c->read_buffer_offset;
+
+      connection->read_buffer
+        = MHD_pool_reset (c->pool,
+                          c->read_buffer,
+                          c->read_buffer_offset,
+                          new_read_buf_size);
+      c->read_buffer_size = new_read_buf_size;
+    }
+    c->read_buffer_scan_pos = 0;
     c->continue_message_write_offset = 0;
     c->headers_received = NULL;
     c->headers_received_tail = NULL;
+    req_hdr_index_reset (c);
     c->have_chunked_upload = false;
     c->current_chunk_size = 0;
     c->current_chunk_offset = 0;
+    c->chunked_decoded_size = 0;
     c->responseCode = 0;
     c->responseIcy = false;
     c->response_write_position = 0;
@@ -4920,6 +5727,7 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
       parse_connection_headers (connection);
       if (MHD_CONNECTION_CLOSED == connection->state)
         continue;
+      connection->stats->requests_parsed++;
       connection->state = MHD_CONNECTION_HEADERS_PROCESSED;
       if (connection->suspended)
         break;
@@ -4959,7 +5767,8 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
       }
       break;
     case MHD_CONNECTION_CONTINUE_SENT:
-      if (0 != connection->read_buffer_offset)
+      if ( (0 != connection->read_buffer_offset) ||
+           (NULL != connection->upload_buffer) )
       {
         process_request_body (connection);           /* loop call */
         if (connection->discard_request)
@@ -5232,6 +6041,7 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
   }
   if (connection_check_timedout (connection))
   {
+    connection->stats->connections_timed_out++;
     MHD_connection_close_ (connection,
                            MHD_REQUEST_TERMINATED_TIMEOUT_REACHED);
     connection->in_idle = false;
@@ -5465,23 +6275,8 @@ MHD_set_connection_option (struct MHD_Connection *connection,
 #endif
       if (! connection->suspended)
       {
-        if (connection->connection_timeout_ms == daemon->connection_timeout_ms)
-          XDLL_remove (daemon->normal_timeout_head,
-                       daemon->normal_timeout_tail,
-                       connection);
-        else
-          XDLL_remove (daemon->manual_timeout_head,
-                       daemon->manual_timeout_tail,
-                       connection);
         connection->connection_timeout_ms = ui_val * 1000;
-        if (connection->connection_timeout_ms == daemon->connection_timeout_ms)
-          XDLL_insert (daemon->normal_timeout_head,
-                       daemon->normal_timeout_tail,
-                       connection);
-        else
-          XDLL_insert (daemon->manual_timeout_head,
-                       daemon->manual_timeout_tail,
-                       connection);
+        MHD_connection_arm_timeout_ (connection);
       }
 #if defined(MHD_USE_THREADS)
       MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
@@ -5494,6 +6289,40 @@ MHD_set_connection_option (struct MHD_Connection *connection,
 }
 
 
+/**
+ * Receive the body of the request directly to the buffer of the
+ * application instead of the connection's memory pool.
+ *
+ * @param connection the connection to use
+ * @param buffer the buffer for the body of the request
+ * @param buffer_size the size of the @a buffer, must not be zero
+ * @return #MHD_YES if the @a buffer will be used,
+ *         #MHD_NO if the buffer cannot be used for this request
+ * @note Available since #MHD_VERSION 0x00097528
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_set_connection_upload_buffer (struct MHD_Connection *connection,
+                                  void *buffer,
+                                  size_t buffer_size)
+{
+  if ( (NULL == buffer) ||
+       (0 == buffer_size) )
+    return MHD_NO;
+  if ( (MHD_CONNECTION_HEADERS_PROCESSED != connection->state) ||
+       (NULL != connection->response) ||
+       (NULL != connection->upload_buffer) )
+    return MHD_NO;
+  if ( (connection->have_chunked_upload) ||
+       (0 == connection->remaining_upload_size) )
+    return MHD_NO;
+  mhd_assert (MHD_SIZE_UNKNOWN != connection->remaining_upload_size);
+  connection->upload_buffer = (char *) buffer;
+  connection->upload_buffer_size = buffer_size;
+  connection->upload_buffer_offset = 0;
+  return MHD_YES;
+}
+
+
 /**
  * Queue a response to be transmitted to the client (as soon as
  * possible but after #MHD_AccessHandlerCallback returns).
@@ -5715,14 +6544,24 @@ MHD_queue_response (struct MHD_Connection *connection,
   }
 #endif
 
+#ifdef COMPRESSION_SUPPORT
+  if ( (0 != (MHD_RF_COMPRESS & response->flags)) &&
+       (RP_BODY_NONE != is_reply_body_needed (connection, status_code)) )
+    response = MHD_compress_select_response_ (connection, response);
+  else
+    MHD_increment_response_rc (response);
+#else  /* ! COMPRESSION_SUPPORT */
   MHD_increment_response_rc (response);
+#endif /* ! COMPRESSION_SUPPORT */
+  MHD_response_queued_ (response,
+                        &connection->rp_hdrs_cache,
+                        &connection->rp_hdrs_cache_size);
   connection->response = response;
   connection->responseCode = status_code;
   connection->responseIcy = reply_icy;
 #if defined(_MHD_HAVE_SENDFILE)
   if ( (response->fd == -1) ||
-       (response->is_pipe) ||
-       (0 != (connection->daemon->options & MHD_USE_TLS))
+       MHD_C_USES_TLS_SEND_ (connection)
 #if defined(MHD_SEND_SPIPE_SUPPRESS_NEEDED) && \
        defined(MHD_SEND_SPIPE_SUPPRESS_POSSIBLE)
        || (! daemon->sigpipe_blocked && ! connection->sk_spipe_suppress)
@@ -5730,11 +6569,19 @@ MHD_queue_response (struct MHD_Connection *connection,
           MHD_SEND_SPIPE_SUPPRESS_POSSIBLE */
        )
     connection->resp_sender = MHD_resp_sender_std;
+  else if (response->is_pipe)
+  {
+#if defined(_MHD_HAVE_SPLICE)
+    /* Reset to the standard sender if chunked encoding will be used,
+     * see setup_reply_properties() */
+    connection->resp_sender = MHD_resp_sender_splice;
+#else  /* ! _MHD_HAVE_SPLICE */
+    connection->resp_sender = MHD_resp_sender_std;
+#endif /* ! _MHD_HAVE_SPLICE */
+  }
   else
     connection->resp_sender = MHD_resp_sender_sendfile;
 #endif /* _MHD_HAVE_SENDFILE */
-  /* FIXME: if 'is_pipe' is set, TLS is off, and we have *splice*, we could use splice()
-     to avoid two user-space copies... */
 
   if ( (MHD_HTTP_MTHD_HEAD == connection->http_mthd) ||
        (MHD_HTTP_OK > status_code) ||
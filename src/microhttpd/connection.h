@@ -181,9 +181,10 @@ MHD_connection_epoll_update_ (struct MHD_Connection *connection);
 #endif
 
 /**
- * Update the 'last_activity' field of the connection to the current time
- * and move the connection to the head of the 'normal_timeout' list if
- * the timeout for the connection uses the default value.
+ * Update the 'last_activity' field of the connection to the current time.
+ * The timer of the connection in the daemon's timer wheel is not moved
+ * here: when the timer expires, the connection is checked and the timer
+ * is re-armed according to the 'last_activity'.
  *
  * @param connection the connection that saw some activity
  */
@@ -191,6 +192,19 @@ void
 MHD_update_last_activity_ (struct MHD_Connection *connection);
 
 
+/**
+ * Arm (or re-arm) the timer of the connection in the daemon's timer
+ * wheel according to the connection's timeout and the last activity.
+ * Disarm the timer if the connection has no timeout.
+ * Must be called with daemon's cleanup_connection_mutex locked.
+ * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
+ *
+ * @param connection the connection to arm the timer for
+ */
+void
+MHD_connection_arm_timeout_ (struct MHD_Connection *connection);
+
+
 /**
  * Allocate memory from connection's memory pool.
  * If memory pool doesn't have enough free memory but read or write buffer
@@ -204,4 +218,21 @@ void *
 MHD_connection_alloc_memory_ (struct MHD_Connection *connection,
                               size_t size);
 
+
+/**
+ * Produce time stamp for the given time in the format used by
+ * the HTTP "Date" and "Last-Modified" headers.
+ *
+ * Result is NOT null-terminated.
+ * Result is always 29 bytes long.
+ *
+ * @param t the time to use
+ * @param[out] date where to write the time stamp, with
+ *             at least 29 bytes available space.
+ * @return true on success, false if the time cannot be converted
+ */
+bool
+MHD_time_to_http_date_ (time_t t,
+                        char *date);
+
 #endif
@@ -35,6 +35,9 @@
 #include "response.h"
 #include "mhd_mono_clock.h"
 #include <gnutls/gnutls.h>
+#ifdef HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED
+#include <gnutls/socket.h>
+#endif /* HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED */
 #include "mhd_send.h"
 
 
@@ -118,6 +121,30 @@ recv_tls_adapter (struct MHD_Connection *connection,
 }
 
 
+/**
+ * Check whether the kernel TLS offload has been enabled by GnuTLS for
+ * the sending direction of the connection and switch the connection
+ * to the plain socket send functions if so.
+ * The kernel TLS must be enabled in the GnuTLS configuration, MHD only
+ * detects it.
+ *
+ * @param connection the connection with completed handshake
+ */
+static void
+tls_detect_ktls (struct MHD_Connection *connection)
+{
+#ifdef HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED
+  if (! connection->daemon->use_ktls)
+    return;
+  if (0 != (GNUTLS_KTLS_SEND
+            & gnutls_transport_is_ktls_enabled (connection->tls_session)))
+    connection->tls_ktls_send = true;
+#else  /* ! HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED */
+  (void) connection; /* Mute compiler warning */
+#endif /* ! HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED */
+}
+
+
 /**
  * Give gnuTLS chance to work on the TLS handshake.
  *
@@ -150,6 +177,7 @@ MHD_run_tls_handshake_ (struct MHD_Connection *connection)
     {
       /* set connection TLS state to enable HTTP processing */
       connection->tls_state = MHD_TLS_CONN_CONNECTED;
+      tls_detect_ktls (connection);
       MHD_update_last_activity_ (connection);
       return true;
     }
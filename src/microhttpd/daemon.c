@@ -46,12 +46,8 @@
 #include "mhd_send.h"
 #include "mhd_align.h"
 #include "mhd_str.h"
-
-#ifdef HAVE_SEARCH_H
-#include <search.h>
-#else
-#include "tsearch.h"
-#endif
+#include "mhd_ipcount.h"
+#include "mhd_offload.h"
 
 #ifdef HTTPS_SUPPORT
 #include "connection_https.h"
@@ -73,6 +69,18 @@
 #endif /* HAVE_SIGNAL_H */
 #endif /* MHD_USE_POSIX_THREADS */
 
+#ifdef HAVE_LINUX_FILTER_H
+#include <linux/filter.h>
+#endif /* HAVE_LINUX_FILTER_H */
+
+#if defined(MHD_USE_THREADS) && defined(SO_REUSEPORT) && \
+  defined(HAVE_GETSOCKNAME) && ! defined(MHD_WINSOCK_SOCKETS)
+/**
+ * Separate listen sockets for worker daemons are supported.
+ */
+#define MHD_LISTEN_PER_WORKER_ 1
+#endif
+
 /**
  * Default connection limit.
  */
@@ -87,6 +95,12 @@
  */
 #define MHD_POOL_SIZE_DEFAULT (32 * 1024)
 
+/**
+ * Default maximum number of connections accepted per single
+ * wake up of epoll loop.
+ */
+#define MHD_ACCEPT_BATCH_SIZE_DEFAULT 10
+
 
 /* Forward declarations. */
 
@@ -224,146 +238,6 @@ MHD_free (void *ptr)
 }
 
 
-/**
- * Maintain connection count for single address.
- */
-struct MHD_IPCount
-{
-  /**
-   * Address family. AF_INET or AF_INET6 for now.
-   */
-  int family;
-
-  /**
-   * Actual address.
-   */
-  union
-  {
-    /**
-     * IPv4 address.
-     */
-    struct in_addr ipv4;
-#ifdef HAVE_INET6
-    /**
-     * IPv6 address.
-     */
-    struct in6_addr ipv6;
-#endif
-  } addr;
-
-  /**
-   * Counter.
-   */
-  unsigned int count;
-};
-
-
-/**
- * Lock shared structure for IP connection counts and connection DLLs.
- *
- * @param daemon handle to daemon where lock is
- */
-static void
-MHD_ip_count_lock (struct MHD_Daemon *daemon)
-{
-  mhd_assert (NULL == daemon->master);
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  MHD_mutex_lock_chk_ (&daemon->per_ip_connection_mutex);
-#else
-  (void) daemon;
-#endif
-}
-
-
-/**
- * Unlock shared structure for IP connection counts and connection DLLs.
- *
- * @param daemon handle to daemon where lock is
- */
-static void
-MHD_ip_count_unlock (struct MHD_Daemon *daemon)
-{
-  mhd_assert (NULL == daemon->master);
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  MHD_mutex_unlock_chk_ (&daemon->per_ip_connection_mutex);
-#else
-  (void) daemon;
-#endif
-}
-
-
-/**
- * Tree comparison function for IP addresses (supplied to tsearch() family).
- * We compare everything in the struct up through the beginning of the
- * 'count' field.
- *
- * @param a1 first address to compare
- * @param a2 second address to compare
- * @return -1, 0 or 1 depending on result of compare
- */
-static int
-MHD_ip_addr_compare (const void *a1,
-                     const void *a2)
-{
-  return memcmp (a1,
-                 a2,
-                 offsetof (struct MHD_IPCount,
-                           count));
-}
-
-
-/**
- * Parse address and initialize @a key using the address.
- *
- * @param addr address to parse
- * @param addrlen number of bytes in @a addr
- * @param key where to store the parsed address
- * @return #MHD_YES on success and #MHD_NO otherwise (e.g., invalid address type)
- */
-static enum MHD_Result
-MHD_ip_addr_to_key (const struct sockaddr *addr,
-                    socklen_t addrlen,
-                    struct MHD_IPCount *key)
-{
-  memset (key,
-          0,
-          sizeof(*key));
-
-  /* IPv4 addresses */
-  if (sizeof (struct sockaddr_in) <= (size_t) addrlen)
-  {
-    if (AF_INET == addr->sa_family)
-    {
-      key->family = AF_INET;
-      memcpy (&key->addr.ipv4,
-              ((const uint8_t *) addr)
-              + _MHD_OFFSETOF (struct sockaddr_in, sin_addr),
-              sizeof(((struct sockaddr_in *) NULL)->sin_addr));
-      return MHD_YES;
-    }
-  }
-
-#ifdef HAVE_INET6
-  if (sizeof (struct sockaddr_in6) <= (size_t) addrlen)
-  {
-    /* IPv6 addresses */
-    if (AF_INET6 == addr->sa_family)
-    {
-      key->family = AF_INET6;
-      memcpy (&key->addr.ipv6,
-              ((const uint8_t *) addr)
-              + _MHD_OFFSETOF (struct sockaddr_in6, sin6_addr),
-              sizeof(((struct sockaddr_in6 *) NULL)->sin6_addr));
-      return MHD_YES;
-    }
-  }
-#endif
-
-  /* Some other address */
-  return MHD_NO;
-}
-
-
 /**
  * Check if IP address is over its limit in terms of the number
  * of allowed concurrent connections.  If the IP is still allowed,
@@ -373,65 +247,40 @@ MHD_ip_addr_to_key (const struct sockaddr *addr,
  * @param addr address to add (or increment counter)
  * @param addrlen number of bytes in @a addr
  * @return Return #MHD_YES if IP below limit, #MHD_NO if IP has surpassed limit.
- *   Also returns #MHD_NO if fails to allocate memory.
+ *   Also returns #MHD_NO if the table of addresses is full.
  */
 static enum MHD_Result
 MHD_ip_limit_add (struct MHD_Daemon *daemon,
                   const struct sockaddr *addr,
                   socklen_t addrlen)
 {
-  struct MHD_IPCount *newkeyp;
-  struct MHD_IPCount *keyp;
-  struct MHD_IPCount **nodep;
-  enum MHD_Result result;
+  struct MHD_IPCount key;
+  enum MHD_IPCountResult res;
 
   daemon = MHD_get_master (daemon);
   /* Ignore if no connection limit assigned */
   if (0 == daemon->per_ip_connection_limit)
     return MHD_YES;
 
-  newkeyp = (struct MHD_IPCount *) malloc (sizeof(struct MHD_IPCount));
-  if (NULL == newkeyp)
-    return MHD_NO;
-
   /* Initialize key */
-  if (MHD_NO == MHD_ip_addr_to_key (addr,
-                                    addrlen,
-                                    newkeyp))
-  {
-    free (newkeyp);
+  if (! MHD_ip_addr_to_key (addr,
+                            addrlen,
+                            &key))
     return MHD_YES; /* Allow unhandled address types through */
-  }
 
-  MHD_ip_count_lock (daemon);
-
-  /* Search for the IP address */
-  nodep = (struct MHD_IPCount **) tsearch (newkeyp,
-                                           &daemon->per_ip_connection_count,
-                                           &MHD_ip_addr_compare);
-  if (NULL == nodep)
+  res = MHD_ipcount_add (daemon->per_ip_table,
+                         &key,
+                         daemon->per_ip_connection_limit);
+  if (MHD_IPCOUNT_FULL == res)
   {
-    MHD_ip_count_unlock (daemon);
-    free (newkeyp);
 #ifdef HAVE_MESSAGES
     MHD_DLOG (daemon,
-              _ ("Failed to add IP connection count node.\n"));
+              _ ("Failed to allocate memory for per-IP connection " \
+                 "counter.\n"));
 #endif
     return MHD_NO;
   }
-  keyp = *nodep;
-  /* Test if there is room for another connection; if so,
-   * increment count */
-  result = (keyp->count < daemon->per_ip_connection_limit) ? MHD_YES : MHD_NO;
-  if (MHD_NO != result)
-    ++keyp->count;
-  MHD_ip_count_unlock (daemon);
-
-  /* If we got an existing node back, free the one we created */
-  if (keyp != newkeyp)
-    free (newkeyp);
-
-  return result;
+  return (MHD_IPCOUNT_OK == res) ? MHD_YES : MHD_NO;
 }
 
 
@@ -448,47 +297,25 @@ MHD_ip_limit_del (struct MHD_Daemon *daemon,
                   const struct sockaddr *addr,
                   socklen_t addrlen)
 {
-  struct MHD_IPCount search_key;
-  struct MHD_IPCount *found_key;
-  void **nodep;
+  struct MHD_IPCount key;
 
   daemon = MHD_get_master (daemon);
   /* Ignore if no connection limit assigned */
   if (0 == daemon->per_ip_connection_limit)
     return;
   /* Initialize search key */
-  if (MHD_NO == MHD_ip_addr_to_key (addr,
-                                    addrlen,
-                                    &search_key))
+  if (! MHD_ip_addr_to_key (addr,
+                            addrlen,
+                            &key))
     return;
 
-  MHD_ip_count_lock (daemon);
-
-  /* Search for the IP address */
-  if (NULL == (nodep = tfind (&search_key,
-                              &daemon->per_ip_connection_count,
-                              &MHD_ip_addr_compare)))
+  if (! MHD_ipcount_del (daemon->per_ip_table,
+                         &key))
   {
     /* Something's wrong if we couldn't find an IP address
      * that was previously added */
     MHD_PANIC (_ ("Failed to find previously-added IP address.\n"));
   }
-  found_key = (struct MHD_IPCount *) *nodep;
-  /* Validate existing count for IP address */
-  if (0 == found_key->count)
-  {
-    MHD_PANIC (_ ("Previously-added IP address had counter of zero.\n"));
-  }
-  /* Remove the node entirely if count reduces to 0 */
-  if (0 == --found_key->count)
-  {
-    tdelete (found_key,
-             &daemon->per_ip_connection_count,
-             &MHD_ip_addr_compare);
-    free (found_key);
-  }
-
-  MHD_ip_count_unlock (daemon);
 }
 
 
@@ -1183,6 +1010,39 @@ call_handlers (struct MHD_Connection *con,
   if (con->tls_read_ready)
     read_ready = true;
 #endif /* HTTPS_SUPPORT */
+#ifdef MHD_USE_MSG_ZEROCOPY
+  if ( (_MHD_ON == con->sk_zerocopy) &&
+       (force_close || (con->zc_done != con->zc_sent)) )
+  {
+    /* The queued zerocopy notifications are reported as the socket
+     * error by the polling functions. */
+    MHD_zerocopy_complete_ (con);
+    if (force_close)
+    {
+      int err = 0;
+      socklen_t err_len = sizeof (err);
+
+      if ( (0 == getsockopt (con->socket_fd,
+                             SOL_SOCKET,
+                             SO_ERROR,
+                             (void *) &err,
+                             &err_len)) &&
+           (0 == err) )
+      {
+        /* Not a real error, the readiness of the socket is unknown.
+         * The socket is non-blocking, just try both directions. */
+        force_close = false;
+        read_ready = true;
+        write_ready = true;
+#ifdef EPOLL_SUPPORT
+        con->epoll_state &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_ERROR);
+        con->epoll_state |= MHD_EPOLL_STATE_READ_READY
+                            | MHD_EPOLL_STATE_WRITE_READY;
+#endif /* EPOLL_SUPPORT */
+      }
+    }
+  }
+#endif /* MHD_USE_MSG_ZEROCOPY */
   if ( (MHD_EVENT_LOOP_INFO_READ == con->event_loop_info) &&
        (read_ready || (force_close && con->sk_nonblck)) )
   {
@@ -2027,6 +1887,20 @@ thread_main_handle_connection (void *data)
       }
       else
         tvp = NULL;
+#ifdef MHD_USE_MSG_ZEROCOPY
+      if ( (NULL != con->zc_response) &&
+           ( (NULL == tvp) ||
+             (0 != tv.tv_sec) ||
+             (MHD_ZEROCOPY_POLL_MS * 1000 < tv.tv_usec) ) )
+      {
+        /* Check the zerocopy notifications periodically, select() does
+           not report them when the socket is not in the read or
+           write set. */
+        tv.tv_sec = 0;
+        tv.tv_usec = MHD_ZEROCOPY_POLL_MS * 1000;
+        tvp = &tv;
+      }
+#endif /* MHD_USE_MSG_ZEROCOPY */
 
       FD_ZERO (&rs);
       FD_ZERO (&ws);
@@ -2403,6 +2277,8 @@ psk_gnutls_adapter (gnutls_session_t session,
  *
  * This function do all preparation that is possible outside main daemon
  * thread.
+ * The connection must be already counted in per-IP connection counts,
+ * the count is released if the connection cannot be prepared.
  * @remark Could be called from any thread.
  *
  * @param daemon daemon that manages the connection
@@ -2440,24 +2316,6 @@ new_connection_prepare_ (struct MHD_Daemon *daemon,
             client_socket);
 #endif
 #endif
-  if ( (daemon->connections == daemon->connection_limit) ||
-       (MHD_NO == MHD_ip_limit_add (daemon,
-                                    addr,
-                                    addrlen)) )
-  {
-    /* above connection limit - reject */
-#ifdef HAVE_MESSAGES
-    MHD_DLOG (daemon,
-              _ (
-                "Server reached connection limit. Closing inbound connection.\n"));
-#endif
-    MHD_socket_close_chk_ (client_socket);
-#if defined(ENFILE) && (ENFILE + 0 != 0)
-    errno = ENFILE;
-#endif
-    return NULL;
-  }
-
   /* apply connection acceptance policy if present */
   if ( (NULL != daemon->apc) &&
        (MHD_NO == daemon->apc (daemon->apc_cls,
@@ -2506,6 +2364,10 @@ new_connection_prepare_ (struct MHD_Daemon *daemon,
     connection->sk_corked = _MHD_UNKNOWN;
     connection->sk_nodelay = _MHD_UNKNOWN;
   }
+#ifdef MHD_USE_MSG_ZEROCOPY
+  /* SO_ZEROCOPY is set only when needed */
+  connection->sk_zerocopy = _MHD_UNKNOWN;
+#endif /* MHD_USE_MSG_ZEROCOPY */
 
   if (0 < addrlen)
   {
@@ -2537,6 +2399,10 @@ new_connection_prepare_ (struct MHD_Daemon *daemon,
   connection->is_nonip = sk_is_nonip;
   connection->sk_spipe_suppress = sk_spipe_supprs;
   connection->daemon = daemon;
+  if (0 != (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
+    connection->stats = &connection->own_stats;
+  else
+    connection->stats = &daemon->stats;
   connection->connection_timeout_ms = daemon->connection_timeout_ms;
   if (0 != connection->connection_timeout_ms)
     connection->last_activity = MHD_monotonic_msec_counter ();
@@ -2707,7 +2573,7 @@ new_connection_close_ (struct MHD_Daemon *daemon,
   mhd_assert (connection->daemon == daemon);
   mhd_assert (! connection->in_cleanup);
   mhd_assert (NULL == connection->next);
-  mhd_assert (NULL == connection->nextX);
+  mhd_assert (! MHD_timer_entry_is_armed (&connection->timer));
 #ifdef EPOLL_SUPPORT
   mhd_assert (NULL == connection->nextE);
 #endif /* EPOLL_SUPPORT */
@@ -2762,7 +2628,8 @@ new_connection_process_ (struct MHD_Daemon *daemon,
    * intensively used memory area is allocated in "good"
    * (for the thread) memory region. It is important with
    * NUMA and/or complex cache hierarchy. */
-  connection->pool = MHD_pool_create (daemon->pool_size);
+  connection->pool = MHD_pool_cache_create (&daemon->pool_cache,
+                                           daemon->pool_size);
   if (NULL == connection->pool)
   { /* 'pool' creation failed */
 #ifdef HAVE_MESSAGES
@@ -2781,6 +2648,7 @@ new_connection_process_ (struct MHD_Daemon *daemon,
     /* Firm check under lock. */
     if (daemon->connections >= daemon->connection_limit)
     { /* Connections limit */
+      daemon->stats.connections_rejected++;
 #ifdef HAVE_MESSAGES
       MHD_DLOG (daemon,
                 _ ("Server reached connection limit. "
@@ -2798,11 +2666,7 @@ new_connection_process_ (struct MHD_Daemon *daemon,
                   daemon->connections_tail,
                   connection);
       if (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
-      {
-        XDLL_insert (daemon->normal_timeout_head,
-                     daemon->normal_timeout_tail,
-                     connection);
-      }
+        MHD_connection_arm_timeout_ (connection);
       MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
       if (NULL != daemon->notify_connection)
         daemon->notify_connection (daemon->notify_connection_cls,
@@ -2898,18 +2762,16 @@ new_connection_process_ (struct MHD_Daemon *daemon,
                                    MHD_CONNECTION_NOTIFY_CLOSED);
       MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
       if (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
-      {
-        XDLL_remove (daemon->normal_timeout_head,
-                     daemon->normal_timeout_tail,
-                     connection);
-      }
+        MHD_timer_wheel_disarm (&daemon->timers,
+                                &connection->timer);
       DLL_remove (daemon->connections_head,
                   daemon->connections_tail,
                   connection);
       daemon->connections--;
       MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
     }
-    MHD_pool_destroy (connection->pool);
+    MHD_pool_cache_release (&daemon->pool_cache,
+                            connection->pool);
   }
   /* Free resources allocated before the call of this functions */
 #ifdef HTTPS_SUPPORT
@@ -2933,6 +2795,32 @@ new_connection_process_ (struct MHD_Daemon *daemon,
 }
 
 
+/**
+ * Count the connection rejected by MHD_add_connection().
+ * The function may be called by any application thread, with the
+ * internal threads the counter is updated under the mutex and added to
+ * the statistics of the daemon when they are read.
+ *
+ * @param daemon the daemon (worker) to count the connection for
+ */
+static void
+count_ext_rejected (struct MHD_Daemon *daemon)
+{
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  if (0 != (daemon->options & MHD_USE_INTERNAL_POLLING_THREAD))
+  {
+    MHD_mutex_lock_chk_ (&daemon->new_connections_mutex);
+    daemon->connections_rejected_ext++;
+    MHD_mutex_unlock_chk_ (&daemon->new_connections_mutex);
+    return;
+  }
+#endif
+  /* Assume that MHD_run() in not called in other thread
+   * at the same time. */
+  daemon->stats.connections_rejected++;
+}
+
+
 /**
  * Add another client connection to the set of connections
  * managed by MHD.  This API is usually not needed (since
@@ -3009,6 +2897,28 @@ internal_add_connection (struct MHD_Daemon *daemon,
     return MHD_NO;
   }
 
+  if ( (daemon->connections == daemon->connection_limit) ||
+       (MHD_NO == MHD_ip_limit_add (daemon,
+                                    addr,
+                                    addrlen)) )
+  {
+    /* above connection limit - reject */
+    if (external_add)
+      count_ext_rejected (daemon);
+    else
+      daemon->stats.connections_rejected++;
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ (
+                "Server reached connection limit. Closing inbound connection.\n"));
+#endif
+    MHD_socket_close_chk_ (client_socket);
+#if defined(ENFILE) && (ENFILE + 0 != 0)
+    errno = ENFILE;
+#endif
+    return MHD_NO;
+  }
+
   connection = new_connection_prepare_ (daemon,
                                         client_socket,
                                         addr, addrlen,
@@ -3122,16 +3032,8 @@ internal_suspend_connection_ (struct MHD_Connection *connection)
     return;
   }
   if (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION))
-  {
-    if (connection->connection_timeout_ms == daemon->connection_timeout_ms)
-      XDLL_remove (daemon->normal_timeout_head,
-                   daemon->normal_timeout_tail,
-                   connection);
-    else
-      XDLL_remove (daemon->manual_timeout_head,
-                   daemon->manual_timeout_tail,
-                   connection);
-  }
+    MHD_timer_wheel_disarm (&daemon->timers,
+                            &connection->timer);
   DLL_remove (daemon->connections_head,
               daemon->connections_tail,
               connection);
@@ -3140,6 +3042,7 @@ internal_suspend_connection_ (struct MHD_Connection *connection)
               daemon->suspended_connections_tail,
               connection);
   connection->suspended = true;
+  connection->stats->connections_suspended++;
 #ifdef EPOLL_SUPPORT
   if (0 != (daemon->options & MHD_USE_EPOLL))
   {
@@ -3231,6 +3134,30 @@ MHD_suspend_connection (struct MHD_Connection *connection)
 }
 
 
+/**
+ * Mark the connection as resuming and add it to the daemon's list
+ * of connections to be processed by resume_suspended_connections().
+ * The connection is added only once, even if resumed several times.
+ * @remark To be called with @e cleanup_connection_mutex locked.
+ *
+ * @param daemon the daemon of the @a connection
+ * @param connection the connection to resume
+ */
+static void
+queue_resume_connection (struct MHD_Daemon *daemon,
+                         struct MHD_Connection *connection)
+{
+  connection->resuming = true;
+  daemon->resuming = true;
+  if (connection->in_resume_queue)
+    return;
+  RDLL_insert (daemon->resume_head,
+               daemon->resume_tail,
+               connection);
+  connection->in_resume_queue = true;
+}
+
+
 /**
  * Resume handling of network data for suspended connection.  It is
  * safe to resume a suspended connection at any time.  Calling this
@@ -3259,8 +3186,7 @@ MHD_resume_connection (struct MHD_Connection *connection)
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
-  connection->resuming = true;
-  daemon->resuming = true;
+  queue_resume_connection (daemon, connection);
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
@@ -3276,6 +3202,69 @@ MHD_resume_connection (struct MHD_Connection *connection)
 }
 
 
+/**
+ * Process the blocking task of the request (like the database query)
+ * in the thread of the pool instead of the daemon's thread.
+ *
+ * The connection is suspended and the @a task is queued to the pool
+ * configured by #MHD_OPTION_OFFLOAD_POOL_SIZE.  When the @a task is
+ * finished the connection is resumed automatically and the
+ * #MHD_AccessHandlerCallback is called again, so the response can be
+ * created from the results of the @a task.
+ *
+ * @param connection the connection to offload
+ * @param task the task to run in the thread of the pool
+ * @param task_cls the closure for the @a task
+ * @return #MHD_YES if the @a task is queued and the connection is
+ *         suspended,
+ *         #MHD_NO if the pool is not used by the daemon, the daemon is
+ *         being stopped or the connection cannot be suspended
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_offload_connection (struct MHD_Connection *connection,
+                        MHD_OffloadCallback task,
+                        void *task_cls)
+{
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  struct MHD_Daemon *const daemon = connection->daemon;
+
+  mhd_assert (MHD_thread_ID_match_current_ (daemon->pid));
+  mhd_assert (NULL != task);
+  if (NULL == daemon->offload_pool)
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Cannot offload the connection without " \
+                 "MHD_OPTION_OFFLOAD_POOL_SIZE.\n"));
+#endif /* HAVE_MESSAGES */
+    return MHD_NO;
+  }
+#ifdef UPGRADE_SUPPORT
+  if (NULL != connection->urh)
+    return MHD_NO;
+#endif /* UPGRADE_SUPPORT */
+  if (connection->suspended ||
+      (NULL != connection->offload_task))
+    return MHD_NO;
+  connection->offload_task = task;
+  connection->offload_task_cls = task_cls;
+  internal_suspend_connection_ (connection);
+  if (! MHD_offload_pool_add_ (daemon->offload_pool,
+                               connection))
+  {
+    /* The daemon is being stopped or the pool failed */
+    connection->offload_task = NULL;
+    MHD_resume_connection (connection);
+    return MHD_NO;
+  }
+  return MHD_YES;
+#else  /* ! MHD_USE_POSIX_THREADS && ! MHD_USE_W32_THREADS */
+  (void) connection; (void) task; (void) task_cls; /* Mute compiler warning */
+  return MHD_NO;
+#endif /* ! MHD_USE_POSIX_THREADS && ! MHD_USE_W32_THREADS */
+}
+
+
 #ifdef UPGRADE_SUPPORT
 /**
  * Mark upgraded connection as closed by application.
@@ -3297,8 +3286,7 @@ MHD_upgraded_connection_mark_app_closed_ (struct MHD_Connection *connection)
 
   MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
   connection->urh->was_closed = true;
-  connection->resuming = true;
-  daemon->resuming = true;
+  queue_resume_connection (daemon, connection);
   MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
   if ( (MHD_ITC_IS_VALID_ (daemon->itc)) &&
        (! MHD_itc_activate_ (daemon->itc, "r")) )
@@ -3315,8 +3303,10 @@ MHD_upgraded_connection_mark_app_closed_ (struct MHD_Connection *connection)
 #endif /* UPGRADE_SUPPORT */
 
 /**
- * Run through the suspended connections and move any that are no
- * longer suspended back to the active state.
+ * Run through the connections queued for resuming and move any that
+ * are no longer suspended back to the active state.  Only the queued
+ * connections are processed, the cost does not depend on the total
+ * number of the suspended connections.
  * @remark To be called only from thread that process
  * daemon's select()/poll()/etc.
  *
@@ -3327,7 +3317,6 @@ static enum MHD_Result
 resume_suspended_connections (struct MHD_Daemon *daemon)
 {
   struct MHD_Connection *pos;
-  struct MHD_Connection *prev = NULL;
   enum MHD_Result ret;
   const bool used_thr_p_c = (0 != (daemon->options
                                    & MHD_USE_THREAD_PER_CONNECTION));
@@ -3342,25 +3331,25 @@ resume_suspended_connections (struct MHD_Daemon *daemon)
   MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
 
-  if (daemon->resuming)
-  {
-    prev = daemon->suspended_connections_tail;
-    /* During shutdown check for resuming is forced. */
-    mhd_assert ((NULL != prev) || (daemon->shutdown) || \
-                (0 != (daemon->options & MHD_ALLOW_UPGRADE)));
-  }
-
   daemon->resuming = false;
 
-  while (NULL != (pos = prev))
+  while (NULL != (pos = daemon->resume_tail))
   {
 #ifdef UPGRADE_SUPPORT
     struct MHD_UpgradeResponseHandle *const urh = pos->urh;
 #else  /* ! UPGRADE_SUPPORT */
     static const void *const urh = NULL;
 #endif /* ! UPGRADE_SUPPORT */
-    prev = pos->prev;
-    if ( (! pos->resuming)
+    mhd_assert (pos->in_resume_queue);
+    RDLL_remove (daemon->resume_head,
+                 daemon->resume_tail,
+                 pos);
+    pos->in_resume_queue = false;
+    /* Skip connections suspended again after resume and connections
+       not suspended yet.  "Upgraded" connection will be queued again
+       when it is ready for cleanup. */
+    if ( (! pos->resuming) ||
+         (! pos->suspended)
 #ifdef UPGRADE_SUPPORT
          || ( (NULL != urh) &&
               ( (! urh->was_closed) ||
@@ -3369,11 +3358,11 @@ resume_suspended_connections (struct MHD_Daemon *daemon)
          )
       continue;
     ret = MHD_YES;
-    mhd_assert (pos->suspended);
     DLL_remove (daemon->suspended_connections_head,
                 daemon->suspended_connections_tail,
                 pos);
     pos->suspended = false;
+    daemon->stats.connections_resumed++;
     if (NULL == urh)
     {
       DLL_insert (daemon->connections_head,
@@ -3384,15 +3373,7 @@ resume_suspended_connections (struct MHD_Daemon *daemon)
         /* Reset timeout timer on resume. */
         if (0 != pos->connection_timeout_ms)
           pos->last_activity = MHD_monotonic_msec_counter ();
-
-        if (pos->connection_timeout_ms == daemon->connection_timeout_ms)
-          XDLL_insert (daemon->normal_timeout_head,
-                       daemon->normal_timeout_tail,
-                       pos);
-        else
-          XDLL_insert (daemon->manual_timeout_head,
-                       daemon->manual_timeout_tail,
-                       pos);
+        MHD_connection_arm_timeout_ (pos);
       }
 #ifdef EPOLL_SUPPORT
       if (0 != (daemon->options & MHD_USE_EPOLL))
@@ -3614,6 +3595,7 @@ MHD_add_connection (struct MHD_Daemon *daemon,
                                         _MHD_UNKNOWN);
     }
     /* all pools are at their connection limit, must refuse */
+    count_ext_rejected (&daemon->worker_pool[0]);
     MHD_socket_close_chk_ (client_socket);
 #if defined(ENFILE) && (ENFILE + 0 != 0)
     errno = ENFILE;
@@ -3634,31 +3616,61 @@ MHD_add_connection (struct MHD_Daemon *daemon,
 
 
 /**
- * Accept an incoming connection and create the MHD_Connection object for
- * it.  This function also enforces policy by way of checking with the
- * accept policy callback.
- * @remark To be called only from thread that process
- * daemon's select()/poll()/etc.
- *
- * @param daemon handle with the listen socket
- * @return #MHD_YES on success (connections denied by policy or due
- *         to 'out of memory' and similar errors) are still considered
- *         successful as far as #MHD_accept_connection() is concerned);
- *         a return code of #MHD_NO only refers to the actual
- *         accept() system call.
+ * A socket accepted from the listen socket, but not yet added to
+ * the daemon as a connection.
  */
-static enum MHD_Result
-MHD_accept_connection (struct MHD_Daemon *daemon)
+struct MHD_AcceptedSocket_
 {
-#ifdef HAVE_INET6
-  struct sockaddr_in6 addrstorage;
-#else
-  struct sockaddr_in addrstorage;
-#endif
-  struct sockaddr *addr = (struct sockaddr *) &addrstorage;
-  socklen_t addrlen;
-  MHD_socket s;
-  MHD_socket fd;
+  /**
+   * The accepted socket.
+   */
+  MHD_socket sk;
+
+  /**
+   * Size of the remote address in @a addr.
+   */
+  socklen_t addrlen;
+
+  /**
+   * The remote address.
+   */
+#ifdef HAVE_INET6
+  struct sockaddr_in6 addr;
+#else
+  struct sockaddr_in addr;
+#endif
+
+  /**
+   * Indicate that @a sk is in non-blocking mode.
+   */
+  bool nonblck;
+
+  /**
+   * Indicate that @a sk has set SIGPIPE suppression.
+   */
+  bool spipe_supprs;
+};
+
+
+/**
+ * Accept an incoming socket and set up its basic socket options.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param daemon handle with the listen socket
+ * @param[out] as where to store the accepted socket
+ * @return 'true' if the socket has been accepted and stored in @a as,
+ *         'false' if accept() system call failed or the socket was
+ *         rejected
+ */
+static bool
+MHD_accept_socket_ (struct MHD_Daemon *daemon,
+                    struct MHD_AcceptedSocket_ *as)
+{
+  struct sockaddr *addr = (struct sockaddr *) &as->addr;
+  socklen_t addrlen;
+  MHD_socket s;
+  MHD_socket fd;
   bool sk_nonbl;
   bool sk_spipe_supprs;
   bool sk_cloexec;
@@ -3669,13 +3681,13 @@ MHD_accept_connection (struct MHD_Daemon *daemon)
   mhd_assert (NULL == daemon->worker_pool);
 #endif /* MHD_USE_THREADS */
 
-  addrlen = sizeof (addrstorage);
+  addrlen = sizeof (as->addr);
   memset (addr,
           0,
-          sizeof (addrstorage));
+          sizeof (as->addr));
   if ( (MHD_INVALID_SOCKET == (fd = daemon->listen_fd)) ||
        (daemon->was_quiesced) )
-    return MHD_NO;
+    return false;
 #ifdef USE_ACCEPT4
   s = accept4 (fd,
                addr,
@@ -3713,9 +3725,9 @@ MHD_accept_connection (struct MHD_Daemon *daemon)
     /* This could be a common occurrence with multiple worker threads */
     if (MHD_SCKT_ERR_IS_ (err,
                           MHD_SCKT_EINVAL_))
-      return MHD_NO;   /* can happen during shutdown */
+      return false;   /* can happen during shutdown */
     if (MHD_SCKT_ERR_IS_DISCNN_BEFORE_ACCEPT_ (err))
-      return MHD_NO;   /* do not print error if client just disconnected early */
+      return false;   /* do not print error if client just disconnected early */
 #ifdef HAVE_MESSAGES
     if (! MHD_SCKT_ERR_IS_EAGAIN_ (err) )
       MHD_DLOG (daemon,
@@ -3760,8 +3772,9 @@ MHD_accept_connection (struct MHD_Daemon *daemon)
 #endif
       }
     }
-    return MHD_NO;
+    return false;
   }
+  daemon->stats.connections_accepted++;
 
   if (! sk_nonbl && ! MHD_socket_nonblocking_ (s))
   {
@@ -3805,7 +3818,7 @@ MHD_accept_connection (struct MHD_Daemon *daemon)
     if (! daemon->sigpipe_blocked)
     {
       MHD_socket_close_ (s);
-      return MHD_NO;
+      return false;
     }
 #endif /* MSG_NOSIGNAL */
   }
@@ -3819,18 +3832,122 @@ MHD_accept_connection (struct MHD_Daemon *daemon)
             s);
 #endif
 #endif
+  as->sk = s;
+  as->addrlen = addrlen;
+  as->nonblck = sk_nonbl;
+  as->spipe_supprs = sk_spipe_supprs;
+  return true;
+}
+
+
+/**
+ * Accept an incoming connection and create the MHD_Connection object for
+ * it.  This function also enforces policy by way of checking with the
+ * accept policy callback.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param daemon handle with the listen socket
+ * @return #MHD_YES on success (connections denied by policy or due
+ *         to 'out of memory' and similar errors) are still considered
+ *         successful as far as #MHD_accept_connection() is concerned);
+ *         a return code of #MHD_NO only refers to the actual
+ *         accept() system call.
+ */
+static enum MHD_Result
+MHD_accept_connection (struct MHD_Daemon *daemon)
+{
+  struct MHD_AcceptedSocket_ as;
+
+  if (! MHD_accept_socket_ (daemon,
+                            &as))
+    return MHD_NO;
   (void) internal_add_connection (daemon,
-                                  s,
-                                  addr,
-                                  addrlen,
+                                  as.sk,
+                                  (const struct sockaddr *) &as.addr,
+                                  as.addrlen,
                                   false,
-                                  sk_nonbl,
-                                  sk_spipe_supprs,
+                                  as.nonblck,
+                                  as.spipe_supprs,
                                   daemon->listen_is_unix);
   return MHD_YES;
 }
 
 
+#ifdef EPOLL_SUPPORT
+/**
+ * Accept incoming connections until the backlog of the listen socket is
+ * drained, the daemon reaches the connection limit or @a budget
+ * connections are accepted.
+ * @remark To be called only from thread that process daemon's epoll.
+ *
+ * @param daemon handle with the listen socket
+ * @param budget the maximum number of connections to accept
+ * @return the number of accepted sockets (including the sockets
+ *         rejected by limits or by policy)
+ */
+static unsigned int
+MHD_accept_connections_batch_ (struct MHD_Daemon *daemon,
+                               unsigned int budget)
+{
+  struct MHD_AcceptedSocket_ as;
+  unsigned int num;
+
+  for (num = 0; num < budget; num++)
+  {
+    if ( (daemon->connection_limit <= daemon->connections) ||
+         (daemon->at_limit) )
+      break;
+    if (! MHD_accept_socket_ (daemon,
+                              &as))
+      break;
+    (void) internal_add_connection (daemon,
+                                    as.sk,
+                                    (const struct sockaddr *) &as.addr,
+                                    as.addrlen,
+                                    false,
+                                    as.nonblck,
+                                    as.spipe_supprs,
+                                    daemon->listen_is_unix);
+  }
+  return num;
+}
+
+
+#endif /* EPOLL_SUPPORT */
+
+
+/**
+ * Add the performance counters.
+ *
+ * @param sum the counters to add to
+ * @param add the counters to add
+ */
+static void
+stats_add (struct MHD_DaemonStats *sum,
+           const struct MHD_DaemonStats *add)
+{
+  sum->connections_accepted += add->connections_accepted;
+  sum->connections_rejected += add->connections_rejected;
+  sum->connections_timed_out += add->connections_timed_out;
+  sum->requests_parsed += add->requests_parsed;
+  sum->bytes_received += add->bytes_received;
+  sum->bytes_sent += add->bytes_sent;
+  sum->send_calls += add->send_calls;
+  sum->iovec_calls += add->iovec_calls;
+  sum->sendfile_calls += add->sendfile_calls;
+  sum->splice_calls += add->splice_calls;
+  sum->connections_suspended += add->connections_suspended;
+  sum->connections_resumed += add->connections_resumed;
+  sum->pool_exhausted += add->pool_exhausted;
+  sum->epoll_wakeups += add->epoll_wakeups;
+  sum->epoll_events += add->epoll_events;
+  sum->zerocopy_calls += add->zerocopy_calls;
+  sum->zerocopy_copied += add->zerocopy_copied;
+  sum->zerocopy_fallbacks += add->zerocopy_fallbacks;
+}
+
+
 /**
  * Free resources associated with all closed connections.
  * (destroy responses, free buffers, etc.).  All closed
@@ -3863,10 +3980,14 @@ MHD_cleanup_connections (struct MHD_Daemon *daemon)
          (! MHD_join_thread_ (pos->pid.handle)) )
       MHD_PANIC (_ ("Failed to join a thread.\n"));
 #endif
+    if (&pos->own_stats == pos->stats)
+      stats_add (&daemon->stats,
+                 &pos->own_stats);
 #ifdef UPGRADE_SUPPORT
     cleanup_upgraded_connection (pos);
 #endif /* UPGRADE_SUPPORT */
-    MHD_pool_destroy (pos->pool);
+    MHD_pool_cache_release (&daemon->pool_cache,
+                            pos->pool);
 #ifdef HTTPS_SUPPORT
     if (NULL != pos->tls_session)
       gnutls_deinit (pos->tls_session);
@@ -3918,6 +4039,9 @@ MHD_cleanup_connections (struct MHD_Daemon *daemon)
       MHD_destroy_response (pos->response);
       pos->response = NULL;
     }
+#ifdef MHD_USE_MSG_ZEROCOPY
+    MHD_zerocopy_release_ (pos);
+#endif /* MHD_USE_MSG_ZEROCOPY */
     if (MHD_INVALID_SOCKET != pos->socket_fd)
       MHD_socket_close_chk_ (pos->socket_fd);
     if (NULL != pos->addr)
@@ -3933,6 +4057,58 @@ MHD_cleanup_connections (struct MHD_Daemon *daemon)
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
+#ifdef MHD_USE_MSG_ZEROCOPY
+  if (NULL != daemon->zc_linger_head)
+    MHD_zerocopy_linger_process_ (daemon, false);
+#endif /* MHD_USE_MSG_ZEROCOPY */
+}
+
+
+/**
+ * Process the connections with expired timers.
+ * The timed-out connections are closed, the timers of other connections
+ * (that had some activity after the timer was armed) are re-armed
+ * according to the last activity.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param daemon daemon to process
+ */
+static void
+process_expired_timers (struct MHD_Daemon *daemon)
+{
+  struct MHD_TimerEntry *e;
+
+  mhd_assert (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION));
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+  MHD_timer_wheel_advance (&daemon->timers,
+                           MHD_monotonic_msec_counter ());
+  while (NULL != (e = MHD_timer_wheel_pop_expired (&daemon->timers)))
+  {
+    struct MHD_Connection *const pos = (struct MHD_Connection *) e->cls;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+    MHD_connection_handle_idle (pos);
+    /* Timed-out connection is closed by the first call, the second call
+       moves it to the cleanup list. */
+    if ( (MHD_CONNECTION_CLOSED == pos->state) &&
+         (! pos->in_cleanup) )
+      MHD_connection_handle_idle (pos);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+    if ( (! pos->in_cleanup) &&
+         (! pos->suspended) &&
+         (! MHD_timer_entry_is_armed (&pos->timer)) )
+      MHD_connection_arm_timeout_ (pos);
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
 }
 
 
@@ -4028,9 +4204,9 @@ _MHD_EXTERN enum MHD_Result
 MHD_get_timeout64 (struct MHD_Daemon *daemon,
                    uint64_t *timeout64)
 {
-  uint64_t earliest_deadline;
-  struct MHD_Connection *pos;
-  struct MHD_Connection *earliest_tmot_conn; /**< the connection with earliest timeout */
+  uint64_t next_tick;
+  uint64_t now;
+  bool have_timers;
 
 #ifdef MHD_USE_THREADS
   mhd_assert ( (0 == (daemon->options & MHD_USE_INTERNAL_POLLING_THREAD)) || \
@@ -4065,37 +4241,36 @@ MHD_get_timeout64 (struct MHD_Daemon *daemon,
   }
 #endif /* EPOLL_SUPPORT */
 
-  earliest_tmot_conn = NULL;
-  earliest_deadline = 0; /* mute compiler warning */
-  /* normal timeouts are sorted, so we only need to look at the 'tail' (oldest) */
-  pos = daemon->normal_timeout_tail;
-  if ( (NULL != pos) &&
-       (0 != pos->connection_timeout_ms) )
-  {
-    earliest_tmot_conn = pos;
-    earliest_deadline = pos->last_activity + pos->connection_timeout_ms;
-  }
-
-  for (pos = daemon->manual_timeout_tail; NULL != pos; pos = pos->prevX)
-  {
-    if (0 != pos->connection_timeout_ms)
-    {
-      if ( (NULL == earliest_tmot_conn) ||
-           (earliest_deadline - pos->last_activity >
-            pos->connection_timeout_ms) )
-      {
-        earliest_tmot_conn = pos;
-        earliest_deadline = pos->last_activity + pos->connection_timeout_ms;
-      }
-    }
-  }
-
-  if (NULL != earliest_tmot_conn)
-  {
-    *timeout64 = connection_get_wait (earliest_tmot_conn);
+  /* The wheel could return the time of moving the timers to the lower
+     level of the wheel instead of actual expiration time, in such case
+     the daemon wakes up a bit earlier than required. */
+  now = MHD_monotonic_msec_counter ();
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+  have_timers = MHD_timer_wheel_next (&daemon->timers,
+                                      &next_tick);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+#ifdef MHD_USE_MSG_ZEROCOPY
+  if ( ( ( (0 != daemon->zc_pending) &&
+            (0 == (daemon->options & (MHD_USE_POLL | MHD_USE_EPOLL))) ) ||
+          (NULL != daemon->zc_linger_head) ) &&
+       ( (! have_timers) ||
+         (next_tick > now + MHD_ZEROCOPY_POLL_MS) ) )
+  {
+    /* Check the zerocopy notifications of the sockets, which are not
+       in the read or write set, and of the sockets of the closed
+       connections, which are not monitored at all. */
+    *timeout64 = MHD_ZEROCOPY_POLL_MS;
     return MHD_YES;
   }
-  return MHD_NO;
+#endif /* MHD_USE_MSG_ZEROCOPY */
+  if (! have_timers)
+    return MHD_NO;
+  *timeout64 = (next_tick > now) ? (next_tick - now) : 0;
+  return MHD_YES;
 }
 
 
@@ -4325,6 +4500,7 @@ internal_run_from_select (struct MHD_Daemon *daemon,
                      FD_ISSET (ds,
                                except_fd_set));
     }
+    process_expired_timers (daemon);
   }
 
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
@@ -4802,6 +4978,7 @@ MHD_poll_all (struct MHD_Daemon *daemon,
                            & MHD_POLL_REVENTS_ERR_DISC));
       i++;
     }
+    process_expired_timers (daemon);
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
     for (urh = daemon->urh_tail; NULL != urh; urh = urhn)
     {
@@ -5279,6 +5456,11 @@ MHD_epoll (struct MHD_Daemon *daemon,
 #endif
       return MHD_NO;
     }
+    if (0 != num_events)
+    {
+      daemon->stats.epoll_wakeups++;
+      daemon->stats.epoll_events += (unsigned int) num_events;
+    }
     for (i = 0; i < (unsigned int) num_events; i++)
     {
       /* First, check for the values of `ptr` that would indicate
@@ -5362,45 +5544,25 @@ MHD_epoll (struct MHD_Daemon *daemon,
 
   if (need_to_accept)
   {
-    unsigned int series_length = 0;
+    unsigned int num_accepted;
 
     /* Run 'accept' until it fails or daemon at limit of connections.
-     * Do not accept more then 10 connections at once. The rest will
-     * be accepted on next turn (level trigger is used for listen
-     * socket). */
-    while ( (MHD_NO != MHD_accept_connection (daemon)) &&
-            (series_length < 10) &&
-            (daemon->connections < daemon->connection_limit) &&
-            (! daemon->at_limit) )
-      series_length++;
+     * Do not accept more then 'accept_batch_size' connections at once.
+     * The rest will be accepted on next turn (level trigger is used for
+     * listen socket). */
+    num_accepted = MHD_accept_connections_batch_ (daemon,
+                                                  daemon->accept_batch_size);
+    daemon->accept_wakeups++;
+    if (daemon->accept_batch_max < num_accepted)
+      daemon->accept_batch_max = num_accepted;
   }
 
   /* Handle timed-out connections; we need to do this here
      as the epoll mechanism won't call the 'MHD_connection_handle_idle()' on everything,
      as the other event loops do.  As timeouts do not get an explicit
      event, we need to find those connections that might have timed out
-     here.
-
-     Connections with custom timeouts must all be looked at, as we
-     do not bother to sort that (presumably very short) list. */
-  prev = daemon->manual_timeout_tail;
-  while (NULL != (pos = prev))
-  {
-    prev = pos->prevX;
-    MHD_connection_handle_idle (pos);
-  }
-  /* Connections with the default timeout are sorted by prepending
-     them to the head of the list whenever we touch the connection;
-     thus it suffices to iterate from the tail until the first
-     connection is NOT timed out */
-  prev = daemon->normal_timeout_tail;
-  while (NULL != (pos = prev))
-  {
-    prev = pos->prevX;
-    MHD_connection_handle_idle (pos);
-    if (MHD_CONNECTION_CLOSED != pos->state)
-      break; /* sorted by timeout, no need to visit the rest! */
-  }
+     here. */
+  process_expired_timers (daemon);
 
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
   if (run_upgraded || (NULL != daemon->eready_urh_head))
@@ -5588,14 +5750,8 @@ close_connection (struct MHD_Connection *pos)
 #endif
   mhd_assert (! pos->suspended);
   mhd_assert (! pos->resuming);
-  if (pos->connection_timeout_ms == daemon->connection_timeout_ms)
-    XDLL_remove (daemon->normal_timeout_head,
-                 daemon->normal_timeout_tail,
-                 pos);
-  else
-    XDLL_remove (daemon->manual_timeout_head,
-                 daemon->manual_timeout_tail,
-                 pos);
+  MHD_timer_wheel_disarm (&daemon->timers,
+                          &pos->timer);
   DLL_remove (daemon->connections_head,
               daemon->connections_tail,
               pos);
@@ -5799,6 +5955,12 @@ MHD_quiesce_daemon (struct MHD_Daemon *daemon)
     for (i = 0; i < daemon->worker_pool_size; i++)
     {
       daemon->worker_pool[i].was_quiesced = true;
+#if defined(HAVE_LISTEN_SHUTDOWN) && defined(MHD_LISTEN_PER_WORKER_)
+      /* Stop queuing new connections on the worker's own socket */
+      if (ret != daemon->worker_pool[i].listen_fd)
+        (void) shutdown (daemon->worker_pool[i].listen_fd,
+                         SHUT_RDWR);
+#endif /* HAVE_LISTEN_SHUTDOWN && MHD_LISTEN_PER_WORKER_ */
 #ifdef EPOLL_SUPPORT
       if ( (0 != (daemon->options & MHD_USE_EPOLL)) &&
            (-1 != daemon->worker_pool[i].epoll_fd) &&
@@ -5806,7 +5968,7 @@ MHD_quiesce_daemon (struct MHD_Daemon *daemon)
       {
         if (0 != epoll_ctl (daemon->worker_pool[i].epoll_fd,
                             EPOLL_CTL_DEL,
-                            ret,
+                            daemon->worker_pool[i].listen_fd,
                             NULL))
           MHD_PANIC (_ ("Failed to remove listen FD from epoll set.\n"));
         daemon->worker_pool[i].listen_socket_in_epoll = false;
@@ -5939,6 +6101,33 @@ parse_options_va (struct MHD_Daemon *daemon,
       daemon->pool_increment = va_arg (ap,
                                        size_t);
       break;
+    case MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE:
+      daemon->pool_cache.max_count = va_arg (ap,
+                                             unsigned int);
+      break;
+    case MHD_OPTION_LISTEN_SOCKET_PER_WORKER:
+      daemon->listen_per_worker = va_arg (ap,
+                                          unsigned int);
+      break;
+    case MHD_OPTION_ACCEPT_BATCH_SIZE:
+      daemon->accept_batch_size = va_arg (ap,
+                                          unsigned int);
+      if (0 == daemon->accept_batch_size)
+        daemon->accept_batch_size = MHD_ACCEPT_BATCH_SIZE_DEFAULT;
+      break;
+    case MHD_OPTION_ZEROCOPY_THRESHOLD:
+      daemon->zerocopy_threshold = va_arg (ap,
+                                           size_t);
+#ifndef MHD_USE_MSG_ZEROCOPY
+#ifdef HAVE_MESSAGES
+      if (0 != daemon->zerocopy_threshold)
+        MHD_DLOG (daemon,
+                  _ ("MSG_ZEROCOPY is not supported on this platform, " \
+                     "the option is ignored.\n"));
+#endif /* HAVE_MESSAGES */
+      daemon->zerocopy_threshold = 0;
+#endif /* ! MHD_USE_MSG_ZEROCOPY */
+      break;
     case MHD_OPTION_CONNECTION_LIMIT:
       daemon->connection_limit = va_arg (ap,
                                          unsigned int);
@@ -6054,6 +6243,32 @@ parse_options_va (struct MHD_Daemon *daemon,
       }
       break;
 #endif
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    case MHD_OPTION_OFFLOAD_POOL_SIZE:
+      daemon->offload_pool_size = va_arg (ap,
+                                          unsigned int);
+      if ( (0 != daemon->offload_pool_size) &&
+           (0 == (daemon->options & MHD_USE_INTERNAL_POLLING_THREAD)) )
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("MHD_OPTION_OFFLOAD_POOL_SIZE option is specified but "
+                     "MHD_USE_INTERNAL_POLLING_THREAD flag is not specified.\n"));
+#endif
+        return MHD_NO;
+      }
+      if ( (0 != daemon->offload_pool_size) &&
+           (0 != (daemon->options & MHD_USE_THREAD_PER_CONNECTION)) )
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("Both MHD_OPTION_OFFLOAD_POOL_SIZE option and "
+                     "MHD_USE_THREAD_PER_CONNECTION flag are specified.\n"));
+#endif
+        return MHD_NO;
+      }
+      break;
+#endif
 #ifdef HTTPS_SUPPORT
     case MHD_OPTION_HTTPS_MEM_KEY:
       pstr = va_arg (ap,
@@ -6350,6 +6565,7 @@ parse_options_va (struct MHD_Daemon *daemon,
         case MHD_OPTION_CONNECTION_MEMORY_LIMIT:
         case MHD_OPTION_CONNECTION_MEMORY_INCREMENT:
         case MHD_OPTION_THREAD_STACK_SIZE:
+        case MHD_OPTION_ZEROCOPY_THRESHOLD:
           if (MHD_NO == parse_options (daemon,
                                        servaddr,
                                        opt,
@@ -6367,6 +6583,10 @@ parse_options_va (struct MHD_Daemon *daemon,
         case MHD_OPTION_LISTENING_ADDRESS_REUSE:
         case MHD_OPTION_LISTEN_BACKLOG_SIZE:
         case MHD_OPTION_SERVER_INSANITY:
+        case MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE:
+        case MHD_OPTION_LISTEN_SOCKET_PER_WORKER:
+        case MHD_OPTION_ACCEPT_BATCH_SIZE:
+        case MHD_OPTION_OFFLOAD_POOL_SIZE:
           if (MHD_NO == parse_options (daemon,
                                        servaddr,
                                        opt,
@@ -6398,6 +6618,8 @@ parse_options_va (struct MHD_Daemon *daemon,
         case MHD_OPTION_STRICT_FOR_CLIENT:
         case MHD_OPTION_SIGPIPE_HANDLED_BY_APP:
         case MHD_OPTION_TLS_NO_ALPN:
+        case MHD_OPTION_TLS_KTLS:
+        case MHD_OPTION_CONNECTION_MEMORY_RELEASE_IDLE:
           if (MHD_NO == parse_options (daemon,
                                        servaddr,
                                        opt,
@@ -6494,6 +6716,34 @@ parse_options_va (struct MHD_Daemon *daemon,
 #else  /* ! HTTPS_SUPPORT */
       (void) va_arg (ap, int);
 #endif /* ! HTTPS_SUPPORT */
+#ifdef HAVE_MESSAGES
+      if (0 == (daemon->options & MHD_USE_TLS))
+        MHD_DLOG (daemon,
+                  _ ("MHD HTTPS option %d passed to MHD " \
+                     "but MHD_USE_TLS not set.\n"),
+                  (int) opt);
+#endif /* HAVE_MESSAGES */
+      break;
+    case MHD_OPTION_CONNECTION_MEMORY_RELEASE_IDLE:
+      daemon->pool_release_idle = (va_arg (ap,
+                                           int) != 0);
+      break;
+    case MHD_OPTION_TLS_KTLS:
+#ifdef HTTPS_SUPPORT
+      daemon->use_ktls = (va_arg (ap,
+                                  int) != 0);
+#ifndef HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED
+#ifdef HAVE_MESSAGES
+      if (daemon->use_ktls)
+        MHD_DLOG (daemon,
+                  _ ("The kernel TLS offload is not supported by this " \
+                     "version of GnuTLS, the option is ignored.\n"));
+#endif /* HAVE_MESSAGES */
+      daemon->use_ktls = false;
+#endif /* ! HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED */
+#else  /* ! HTTPS_SUPPORT */
+      (void) va_arg (ap, int);
+#endif /* ! HTTPS_SUPPORT */
 #ifdef HAVE_MESSAGES
       if (0 == (daemon->options & MHD_USE_TLS))
         MHD_DLOG (daemon,
@@ -6647,6 +6897,206 @@ setup_epoll_to_listen (struct MHD_Daemon *daemon)
 #endif
 
 
+#ifdef MHD_LISTEN_PER_WORKER_
+/**
+ * Create the listen socket for the worker daemon.
+ * The socket is bound to the same address as the listen socket of
+ * the master daemon, the kernel distributes incoming connections
+ * between all sockets in the SO_REUSEPORT group.
+ *
+ * @param daemon the master daemon with the bound listen socket
+ * @return the new listen socket, #MHD_INVALID_SOCKET on error
+ */
+static MHD_socket
+create_worker_listen_socket (struct MHD_Daemon *daemon)
+{
+  const MHD_SCKT_OPT_BOOL_ on = 1;
+  struct sockaddr_storage bindaddr;
+  socklen_t addrlen;
+  MHD_socket fd;
+
+  mhd_assert (NULL == daemon->master);
+  mhd_assert (MHD_INVALID_SOCKET != daemon->listen_fd);
+  memset (&bindaddr,
+          0,
+          sizeof (bindaddr));
+  addrlen = sizeof (bindaddr);
+  if (0 != getsockname (daemon->listen_fd,
+                        (struct sockaddr *) &bindaddr,
+                        &addrlen))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to get listen socket address: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif /* HAVE_MESSAGES */
+    return MHD_INVALID_SOCKET;
+  }
+  fd = MHD_socket_create_listen_ (bindaddr.ss_family);
+  if (MHD_INVALID_SOCKET == fd)
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to create socket for listening: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif
+    return MHD_INVALID_SOCKET;
+  }
+  if (0 > setsockopt (fd,
+                      SOL_SOCKET,
+                      SO_REUSEADDR,
+                      (const void *) &on, sizeof (on)))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("setsockopt failed: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif
+  }
+  if (0 > setsockopt (fd,
+                      SOL_SOCKET,
+                      SO_REUSEPORT,
+                      (const void *) &on, sizeof (on)))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("setsockopt failed: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif
+    MHD_socket_close_chk_ (fd);
+    return MHD_INVALID_SOCKET;
+  }
+#if defined(HAVE_INET6) && defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+  if (AF_INET6 == bindaddr.ss_family)
+  {
+    const MHD_SCKT_OPT_BOOL_ v6_only =
+      (MHD_USE_DUAL_STACK != (daemon->options & MHD_USE_DUAL_STACK));
+    if (0 > setsockopt (fd,
+                        IPPROTO_IPV6, IPV6_V6ONLY,
+                        (const void *) &v6_only,
+                        sizeof (v6_only)))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("setsockopt failed: %s\n"),
+                MHD_socket_last_strerr_ ());
+#endif
+    }
+  }
+#endif /* HAVE_INET6 && IPPROTO_IPV6 && IPV6_V6ONLY */
+  if (0 != bind (fd,
+                 (const struct sockaddr *) &bindaddr,
+                 addrlen))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to bind worker listen socket to port %u: %s\n"),
+              (unsigned int) daemon->port,
+              MHD_socket_last_strerr_ ());
+#endif
+    MHD_socket_close_chk_ (fd);
+    return MHD_INVALID_SOCKET;
+  }
+#ifdef TCP_FASTOPEN
+  if (0 != (daemon->options & MHD_USE_TCP_FASTOPEN))
+  {
+    if (0 != setsockopt (fd,
+                         IPPROTO_TCP,
+                         TCP_FASTOPEN,
+                         (const void *) &daemon->fastopen_queue_size,
+                         sizeof (daemon->fastopen_queue_size)))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("setsockopt failed: %s\n"),
+                MHD_socket_last_strerr_ ());
+#endif
+    }
+  }
+#endif
+  if ( (0 != listen (fd,
+                     (int) daemon->listen_backlog_size)) ||
+       (! MHD_socket_nonblocking_ (fd)) )
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to listen for connections: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif
+    MHD_socket_close_chk_ (fd);
+    return MHD_INVALID_SOCKET;
+  }
+  if ( (! MHD_SCKT_FD_FITS_FDSET_ (fd,
+                                   NULL)) &&
+       (0 == (daemon->options & (MHD_USE_POLL | MHD_USE_EPOLL)) ) )
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Listen socket descriptor (%d) is not " \
+                 "less than FD_SETSIZE (%d).\n"),
+              (int) fd,
+              (int) FD_SETSIZE);
+#endif
+    MHD_socket_close_chk_ (fd);
+    return MHD_INVALID_SOCKET;
+  }
+  return fd;
+}
+
+
+/**
+ * Attach the classic BPF program to the SO_REUSEPORT group of the master
+ * daemon's listen socket. The program selects the socket with the same
+ * number as the number of CPU that handles the incoming connection.
+ * As the worker's sockets are added to the group in the order of workers,
+ * the connection is processed by the worker with the same number.
+ * Failure is not fatal, the kernel uses the hash-based distribution then.
+ *
+ * @param daemon the master daemon with the bound listen socket
+ */
+static void
+attach_listen_cpu_steering (struct MHD_Daemon *daemon)
+{
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(SKF_AD_CPU)
+  struct sock_filter code[] = {
+    /* A = the number of the current CPU */
+    { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t) (SKF_AD_OFF + SKF_AD_CPU) },
+    /* A = A % number of workers */
+    { BPF_ALU | BPF_MOD | BPF_K, 0, 0, daemon->worker_pool_size },
+    /* Return A as the number of the socket in the group */
+    { BPF_RET | BPF_A, 0, 0, 0 }
+  };
+  struct sock_fprog prog;
+
+  prog.len = (unsigned short) (sizeof (code) / sizeof (code[0]));
+  prog.filter = code;
+  if (0 != setsockopt (daemon->listen_fd,
+                       SOL_SOCKET,
+                       SO_ATTACH_REUSEPORT_CBPF,
+                       (const void *) &prog,
+                       sizeof (prog)))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to attach CPU steering program to " \
+                 "the listen socket: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif
+  }
+#else  /* ! SO_ATTACH_REUSEPORT_CBPF || ! SKF_AD_CPU */
+#ifdef HAVE_MESSAGES
+  MHD_DLOG (daemon,
+            _ ("Warning: steering connections by CPU is not supported " \
+               "on this platform.\n"));
+#else  /* ! HAVE_MESSAGES */
+  (void) daemon; /* Mute compiler warning */
+#endif /* ! HAVE_MESSAGES */
+#endif /* ! SO_ATTACH_REUSEPORT_CBPF || ! SKF_AD_CPU */
+}
+
+
+#endif /* MHD_LISTEN_PER_WORKER_ */
+
 /**
  * Start a webserver on the given port.
  *
@@ -6758,6 +7208,8 @@ MHD_start_daemon_va (unsigned int flags,
 
   if (NULL == (daemon = MHD_calloc_ (1, sizeof (struct MHD_Daemon))))
     return NULL;
+  MHD_timer_wheel_init (&daemon->timers,
+                        MHD_monotonic_msec_counter ());
 #ifdef EPOLL_SUPPORT
   daemon->epoll_fd = -1;
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
@@ -6790,6 +7242,7 @@ MHD_start_daemon_va (unsigned int flags,
   daemon->connection_limit = MHD_MAX_CONNECTIONS_DEFAULT;
   daemon->pool_size = MHD_POOL_SIZE_DEFAULT;
   daemon->pool_increment = MHD_BUF_INC_SIZE;
+  daemon->accept_batch_size = MHD_ACCEPT_BATCH_SIZE_DEFAULT;
   daemon->unescape_callback = &unescape_wrapper;
   daemon->connection_timeout_ms = 0;       /* no timeout */
   MHD_itc_set_invalid_ (daemon->itc);
@@ -6866,6 +7319,37 @@ MHD_start_daemon_va (unsigned int flags,
        (0 != (daemon->options & MHD_USE_THREAD_PER_CONNECTION)) )
     *pflags |= MHD_USE_ITC; /* requires ITC */
 
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  if (0 != daemon->offload_pool_size)
+    *pflags |= MHD_ALLOW_SUSPEND_RESUME; /* includes MHD_USE_ITC */
+#endif
+
+  if ( (0 != daemon->pool_cache.max_count) &&
+       (0 != (*pflags & MHD_USE_THREAD_PER_CONNECTION)) )
+  {
+    /* Pools are released by connections' threads, the cache
+     * cannot be used without locking. */
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Warning: MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE is "
+                 "ignored with MHD_USE_THREAD_PER_CONNECTION.\n"));
+#endif
+    daemon->pool_cache.max_count = 0;
+  }
+  if (daemon->pool_release_idle &&
+      (0 != (*pflags & MHD_USE_THREAD_PER_CONNECTION)) )
+  {
+    /* Without the cache each keep-alive request would destroy and
+     * re-create the pool, the thread of the connection keeps the
+     * memory anyway. */
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Warning: MHD_OPTION_CONNECTION_MEMORY_RELEASE_IDLE is "
+                 "ignored with MHD_USE_THREAD_PER_CONNECTION.\n"));
+#endif
+    daemon->pool_release_idle = false;
+  }
+
 #ifndef NDEBUG
 #ifdef HAVE_MESSAGES
   MHD_DLOG (daemon,
@@ -6948,12 +7432,19 @@ MHD_start_daemon_va (unsigned int flags,
   }
 
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  if (! MHD_mutex_init_ (&daemon->nnc_lock))
+  for (i = 0; i < MHD_NNC_LOCKS_NUM; i++)
+  {
+    if (! MHD_mutex_init_ (&daemon->nnc_locks[i]))
+      break;
+  }
+  if (MHD_NNC_LOCKS_NUM != i)
   {
 #ifdef HAVE_MESSAGES
     MHD_DLOG (daemon,
               _ ("MHD failed to initialize nonce-nc mutex.\n"));
 #endif
+    while (0 != i)
+      MHD_mutex_destroy_chk_ (&daemon->nnc_locks[--i]);
 #ifdef HTTPS_SUPPORT
     if (0 != (*pflags & MHD_USE_TLS))
       gnutls_priority_deinit (daemon->priority_cache);
@@ -6978,6 +7469,40 @@ MHD_start_daemon_va (unsigned int flags,
     goto free_and_fail;
   }
 #endif
+  if (0 != daemon->listen_per_worker)
+  {
+#ifdef MHD_LISTEN_PER_WORKER_
+    if (0 == daemon->worker_pool_size)
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Warning: MHD_OPTION_LISTEN_SOCKET_PER_WORKER is " \
+                   "ignored without thread pool.\n"));
+#endif
+      daemon->listen_per_worker = 0;
+    }
+    else if ( (MHD_INVALID_SOCKET != daemon->listen_fd) ||
+              (0 != (*pflags & MHD_USE_NO_LISTEN_SOCKET)) ||
+              (0 > daemon->listening_address_reuse) )
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("MHD_OPTION_LISTEN_SOCKET_PER_WORKER requires listen " \
+                   "socket created by MHD with allowed address reuse.\n"));
+#endif
+      goto free_and_fail;
+    }
+    else
+      daemon->listening_address_reuse = 1; /* SO_REUSEPORT is required */
+#else  /* ! MHD_LISTEN_PER_WORKER_ */
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("MHD_OPTION_LISTEN_SOCKET_PER_WORKER is not supported " \
+                 "on this platform.\n"));
+#endif
+    goto free_and_fail;
+#endif /* ! MHD_LISTEN_PER_WORKER_ */
+  }
   if ( (MHD_INVALID_SOCKET == daemon->listen_fd) &&
        (0 == (*pflags & MHD_USE_NO_LISTEN_SOCKET)) )
   {
@@ -7373,18 +7898,20 @@ MHD_start_daemon_va (unsigned int flags,
   }
 #endif /* EPOLL_SUPPORT */
 
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  if (! MHD_mutex_init_ (&daemon->per_ip_connection_mutex))
+  if (0 != daemon->per_ip_connection_limit)
   {
+    daemon->per_ip_table = MHD_ipcount_table_create (daemon->connection_limit);
+    if (NULL == daemon->per_ip_table)
+    {
 #ifdef HAVE_MESSAGES
-    MHD_DLOG (daemon,
-              _ ("MHD failed to initialize IP connection limit mutex.\n"));
+      MHD_DLOG (daemon,
+                _ ("MHD failed to initialize IP connection limit table.\n"));
 #endif
-    if (MHD_INVALID_SOCKET != listen_fd)
-      MHD_socket_close_chk_ (listen_fd);
-    goto free_and_fail;
+      if (MHD_INVALID_SOCKET != listen_fd)
+        MHD_socket_close_chk_ (listen_fd);
+      goto free_and_fail;
+    }
   }
-#endif
 
 #ifdef HTTPS_SUPPORT
   /* initialize HTTPS daemon certificate aspects & send / recv functions */
@@ -7397,13 +7924,22 @@ MHD_start_daemon_va (unsigned int flags,
 #endif
     if (MHD_INVALID_SOCKET != listen_fd)
       MHD_socket_close_chk_ (listen_fd);
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-    MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
-#endif
     goto free_and_fail;
   }
 #endif /* HTTPS_SUPPORT */
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /* The pool is created before the worker daemons, which share it */
+  if (0 != daemon->offload_pool_size)
+  {
+    daemon->offload_pool = MHD_offload_pool_create_ (daemon,
+                                                     daemon->offload_pool_size);
+    if (NULL == daemon->offload_pool)
+    {
+      if (MHD_INVALID_SOCKET != listen_fd)
+        MHD_socket_close_chk_ (listen_fd);
+      goto free_and_fail;
+    }
+  }
   /* Start threads if requested by parameters */
   if (0 != (*pflags & MHD_USE_INTERNAL_POLLING_THREAD))
   {
@@ -7427,7 +7963,6 @@ MHD_start_daemon_va (unsigned int flags,
         MHD_DLOG (daemon,
                   _ ("Failed to initialise internal lists mutex.\n"));
 #endif
-        MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
         if (MHD_INVALID_SOCKET != listen_fd)
           MHD_socket_close_chk_ (listen_fd);
         goto free_and_fail;
@@ -7438,7 +7973,6 @@ MHD_start_daemon_va (unsigned int flags,
         MHD_DLOG (daemon,
                   _ ("Failed to initialise mutex.\n"));
 #endif
-        MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
         MHD_mutex_destroy_chk_ (&daemon->cleanup_connection_mutex);
         if (MHD_INVALID_SOCKET != listen_fd)
           MHD_socket_close_chk_ (listen_fd);
@@ -7466,7 +8000,6 @@ MHD_start_daemon_va (unsigned int flags,
                   MHD_strerror_ (errno));
 #endif /* HAVE_MESSAGES */
         MHD_mutex_destroy_chk_ (&daemon->new_connections_mutex);
-        MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
         MHD_mutex_destroy_chk_ (&daemon->cleanup_connection_mutex);
         if (MHD_INVALID_SOCKET != listen_fd)
           MHD_socket_close_chk_ (listen_fd);
@@ -7486,6 +8019,11 @@ MHD_start_daemon_va (unsigned int flags,
       mhd_assert (2 <= daemon->worker_pool_size);
       i = 0;     /* we need this in case fcntl or malloc fails */
 
+#ifdef MHD_LISTEN_PER_WORKER_
+      if (2 == daemon->listen_per_worker)
+        attach_listen_cpu_steering (daemon);
+#endif /* MHD_LISTEN_PER_WORKER_ */
+
       /* Allocate memory for pooled objects */
       daemon->worker_pool = malloc (sizeof (struct MHD_Daemon)
                                     * daemon->worker_pool_size);
@@ -7567,10 +8105,28 @@ MHD_start_daemon_va (unsigned int flags,
         d->connection_limit = conns_per_thread;
         if (i < leftover_conns)
           ++d->connection_limit;
+#ifdef MHD_LISTEN_PER_WORKER_
+        /* The first worker uses the listen socket of the master daemon */
+        if ( (0 != daemon->listen_per_worker) &&
+             (0 != i) )
+        {
+          d->listen_fd = create_worker_listen_socket (daemon);
+          if (MHD_INVALID_SOCKET == d->listen_fd)
+          {
+            if (MHD_ITC_IS_VALID_ (d->itc))
+              MHD_itc_destroy_chk_ (d->itc);
+            MHD_mutex_destroy_chk_ (&d->new_connections_mutex);
+            MHD_mutex_destroy_chk_ (&d->cleanup_connection_mutex);
+            goto thread_failed;
+          }
+        }
+#endif /* MHD_LISTEN_PER_WORKER_ */
 #ifdef EPOLL_SUPPORT
         if ( (0 != (*pflags & MHD_USE_EPOLL)) &&
              (MHD_NO == setup_epoll_to_listen (d)) )
         {
+          if (listen_fd != d->listen_fd)
+            MHD_socket_close_chk_ (d->listen_fd);
           if (MHD_ITC_IS_VALID_ (d->itc))
             MHD_itc_destroy_chk_ (d->itc);
           MHD_mutex_destroy_chk_ (&d->new_connections_mutex);
@@ -7579,15 +8135,12 @@ MHD_start_daemon_va (unsigned int flags,
         }
 #endif
         /* Some members must be used only in master daemon */
-#if defined(MHD_USE_THREADS)
-        memset (&d->per_ip_connection_mutex, 1,
-                sizeof(d->per_ip_connection_mutex));
-#endif /* MHD_USE_THREADS */
+        d->per_ip_table = NULL;
 #ifdef DAUTH_SUPPORT
         d->nnc = NULL;
         d->nonce_nc_size = 0;
 #if defined(MHD_USE_THREADS)
-        memset (&d->nnc_lock, 1, sizeof(d->nnc_lock));
+        memset (d->nnc_locks, 1, sizeof(d->nnc_locks));
 #endif /* MHD_USE_THREADS */
 #endif /* DAUTH_SUPPORT */
 
@@ -7613,6 +8166,8 @@ MHD_start_daemon_va (unsigned int flags,
 #endif
           /* Free memory for this worker; cleanup below handles
            * all previously-created workers. */
+          if (listen_fd != d->listen_fd)
+            MHD_socket_close_chk_ (d->listen_fd);
           MHD_mutex_destroy_chk_ (&d->cleanup_connection_mutex);
           if (MHD_ITC_IS_VALID_ (d->itc))
             MHD_itc_destroy_chk_ (d->itc);
@@ -7631,7 +8186,6 @@ MHD_start_daemon_va (unsigned int flags,
       MHD_DLOG (daemon,
                 _ ("Failed to initialise internal lists mutex.\n"));
 #endif
-      MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
       if (MHD_INVALID_SOCKET != listen_fd)
         MHD_socket_close_chk_ (listen_fd);
       goto free_and_fail;
@@ -7643,7 +8197,6 @@ MHD_start_daemon_va (unsigned int flags,
                 _ ("Failed to initialise mutex.\n"));
 #endif
       MHD_mutex_destroy_chk_ (&daemon->cleanup_connection_mutex);
-      MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
       if (MHD_INVALID_SOCKET != listen_fd)
         MHD_socket_close_chk_ (listen_fd);
       goto free_and_fail;
@@ -7668,7 +8221,6 @@ thread_failed:
   {
     if (MHD_INVALID_SOCKET != listen_fd)
       MHD_socket_close_chk_ (listen_fd);
-    MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
     if (NULL != daemon->worker_pool)
       free (daemon->worker_pool);
     goto free_and_fail;
@@ -7708,7 +8260,8 @@ free_and_fail:
 #ifdef DAUTH_SUPPORT
   free (daemon->nnc);
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  MHD_mutex_destroy_chk_ (&daemon->nnc_lock);
+  for (i = 0; i < MHD_NNC_LOCKS_NUM; i++)
+    MHD_mutex_destroy_chk_ (&daemon->nnc_locks[i]);
 #endif
 #endif
 #ifdef HTTPS_SUPPORT
@@ -7721,8 +8274,13 @@ free_and_fail:
       gnutls_psk_free_server_credentials (daemon->psk_cred);
   }
 #endif /* HTTPS_SUPPORT */
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  if (NULL != daemon->offload_pool)
+    MHD_offload_pool_destroy_ (daemon->offload_pool);
+#endif
   if (MHD_ITC_IS_VALID_ (daemon->itc))
     MHD_itc_destroy_chk_ (daemon->itc);
+  MHD_ipcount_table_destroy (daemon->per_ip_table);
   free (daemon);
   return NULL;
 }
@@ -7836,8 +8394,7 @@ close_all_connections (struct MHD_Daemon *daemon)
           MHD_connection_finish_forward_ (susp);
         /* Do not use MHD_resume_connection() as mutex is
          * already locked. */
-        susp->resuming = true;
-        daemon->resuming = true;
+        queue_resume_connection (daemon, susp);
       }
       susp = susp->prev;
     }
@@ -7938,6 +8495,9 @@ close_all_connections (struct MHD_Daemon *daemon)
     close_connection (pos);
   }
   MHD_cleanup_connections (daemon);
+#ifdef MHD_USE_MSG_ZEROCOPY
+  MHD_zerocopy_linger_process_ (daemon, true);
+#endif /* MHD_USE_MSG_ZEROCOPY */
 }
 
 
@@ -7961,6 +8521,15 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
     MHD_PANIC (_ ("MHD_stop_daemon() was called twice."));
   /* Slave daemons must be stopped by master daemon. */
   mhd_assert ( (NULL == daemon->master) || (daemon->shutdown) );
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  if ( (NULL == daemon->master) &&
+       (NULL != daemon->offload_pool) )
+  {
+    /* The queued tasks are finished and their connections are resumed
+     * before the connections are closed. */
+    MHD_offload_pool_stop_ (daemon->offload_pool);
+  }
+#endif
 
   daemon->shutdown = true;
   if (daemon->was_quiesced)
@@ -7986,7 +8555,14 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
                        "Failed to signal shutdown via inter-thread communication channel.\n"));
       }
       else
+      {
         mhd_assert (MHD_INVALID_SOCKET != fd);
+#if defined(HAVE_LISTEN_SHUTDOWN) && defined(MHD_LISTEN_PER_WORKER_)
+        if (fd != daemon->worker_pool[i].listen_fd)
+          (void) shutdown (daemon->worker_pool[i].listen_fd,
+                           SHUT_RDWR);
+#endif /* HAVE_LISTEN_SHUTDOWN && MHD_LISTEN_PER_WORKER_ */
+      }
     }
 #ifdef HAVE_LISTEN_SHUTDOWN
     if (MHD_INVALID_SOCKET != fd)
@@ -8057,9 +8633,20 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
     mhd_assert (NULL == daemon->urh_head);
 #endif /* UPGRADE_SUPPORT && HTTPS_SUPPORT */
 
+    MHD_pool_cache_clear (&daemon->pool_cache);
+
     if (MHD_ITC_IS_VALID_ (daemon->itc))
       MHD_itc_destroy_chk_ (daemon->itc);
 
+#ifdef MHD_LISTEN_PER_WORKER_
+    /* Worker's own listen socket is not exposed to the application,
+     * close it even if the daemon was quiesced. */
+    if ( (NULL != daemon->master) &&
+         (MHD_INVALID_SOCKET != daemon->listen_fd) &&
+         (daemon->master->listen_fd != daemon->listen_fd) )
+      MHD_socket_close_chk_ (daemon->listen_fd);
+#endif /* MHD_LISTEN_PER_WORKER_ */
+
 #ifdef EPOLL_SUPPORT
     if ( (0 != (daemon->options & MHD_USE_EPOLL)) &&
          (-1 != daemon->epoll_fd) )
@@ -8104,17 +8691,52 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
 #ifdef DAUTH_SUPPORT
     free (daemon->nnc);
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-    MHD_mutex_destroy_chk_ (&daemon->nnc_lock);
+    for (i = 0; i < MHD_NNC_LOCKS_NUM; i++)
+      MHD_mutex_destroy_chk_ (&daemon->nnc_locks[i]);
 #endif
 #endif
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-    MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
+    if (NULL != daemon->offload_pool)
+      MHD_offload_pool_destroy_ (daemon->offload_pool);
 #endif
+    MHD_ipcount_table_destroy (daemon->per_ip_table);
     free (daemon);
   }
 }
 
 
+/**
+ * Get the number of pool cache hits or misses of the daemon.
+ * For the master daemon the values of all workers are summed.
+ *
+ * @param daemon the daemon to query
+ * @param hits 'true' to get the number of hits, 'false' to get
+ *             the number of misses
+ * @return the requested number
+ */
+static uint64_t
+get_pool_cache_stat (struct MHD_Daemon *daemon,
+                     bool hits)
+{
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  if (NULL != daemon->worker_pool)
+  {
+    unsigned int i;
+    uint64_t num_pools;
+
+    /* Collect the cache information stored in the workers. */
+    num_pools = 0;
+    for (i = 0; i < daemon->worker_pool_size; i++)
+      num_pools += hits ?
+                   daemon->worker_pool[i].pool_cache.hits :
+                   daemon->worker_pool[i].pool_cache.misses;
+    return num_pools;
+  }
+#endif
+  return hits ? daemon->pool_cache.hits : daemon->pool_cache.misses;
+}
+
+
 /**
  * Obtain information about the given daemon.
  * The returned pointer is invalidated with the next call of this function or
@@ -8179,6 +8801,99 @@ MHD_get_daemon_info (struct MHD_Daemon *daemon,
   case MHD_DAEMON_INFO_BIND_PORT:
     daemon->daemon_info_dummy_port.port = daemon->port;
     return &daemon->daemon_info_dummy_port;
+  case MHD_DAEMON_INFO_POOL_CACHE_HITS:
+    daemon->daemon_info_dummy_pool_cache.num_pools =
+      get_pool_cache_stat (daemon, true);
+    return &daemon->daemon_info_dummy_pool_cache;
+  case MHD_DAEMON_INFO_POOL_CACHE_MISSES:
+    daemon->daemon_info_dummy_pool_cache.num_pools =
+      get_pool_cache_stat (daemon, false);
+    return &daemon->daemon_info_dummy_pool_cache;
+  case MHD_DAEMON_INFO_WORKER_CONNECTIONS_ACCEPTED:
+    if (1)
+    {
+      struct MHD_Daemon *d;
+      unsigned int worker;
+      va_list ap;
+
+      va_start (ap, info_type);
+      worker = va_arg (ap, unsigned int);
+      va_end (ap);
+      d = daemon;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+      if (NULL != daemon->worker_pool)
+      {
+        if (daemon->worker_pool_size <= worker)
+          return NULL;
+        d = &daemon->worker_pool[worker];
+      }
+      else
+#endif
+      if (0 != worker)
+        return NULL;
+      daemon->daemon_info_dummy_accepted.num_accepted =
+        d->stats.connections_accepted;
+    }
+    return &daemon->daemon_info_dummy_accepted;
+  case MHD_DAEMON_INFO_ACCEPT_WAKEUPS:
+  case MHD_DAEMON_INFO_ACCEPT_BATCH_MAX:
+    if (1)
+    {
+      uint64_t wakeups;
+      unsigned int batch_max;
+
+      wakeups = daemon->accept_wakeups;
+      batch_max = daemon->accept_batch_max;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+      if (NULL != daemon->worker_pool)
+      {
+        unsigned int i;
+
+        /* Collect the statistics stored in the workers. */
+        for (i = 0; i < daemon->worker_pool_size; i++)
+        {
+          wakeups += daemon->worker_pool[i].accept_wakeups;
+          if (batch_max < daemon->worker_pool[i].accept_batch_max)
+            batch_max = daemon->worker_pool[i].accept_batch_max;
+        }
+      }
+#endif
+      if (MHD_DAEMON_INFO_ACCEPT_WAKEUPS == info_type)
+        daemon->daemon_info_dummy_accept_batch.num_wakeups = wakeups;
+      else
+        daemon->daemon_info_dummy_accept_batch.max_accept_batch = batch_max;
+    }
+    return &daemon->daemon_info_dummy_accept_batch;
+  case MHD_DAEMON_INFO_STATS:
+    daemon->stats_sum = daemon->stats;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    if (NULL != daemon->worker_pool)
+    {
+      unsigned int i;
+
+      /* Collect the statistics stored in the workers. */
+      for (i = 0; i < daemon->worker_pool_size; i++)
+      {
+        struct MHD_Daemon *const worker = &daemon->worker_pool[i];
+
+        stats_add (&daemon->stats_sum,
+                   &worker->stats);
+        MHD_mutex_lock_chk_ (&worker->new_connections_mutex);
+        daemon->stats_sum.connections_rejected +=
+          worker->connections_rejected_ext;
+        MHD_mutex_unlock_chk_ (&worker->new_connections_mutex);
+      }
+    }
+    else if (0 != (daemon->options & MHD_USE_INTERNAL_POLLING_THREAD))
+    {
+      MHD_mutex_lock_chk_ (&daemon->new_connections_mutex);
+      daemon->stats_sum.connections_rejected +=
+        daemon->connections_rejected_ext;
+      MHD_mutex_unlock_chk_ (&daemon->new_connections_mutex);
+    }
+#endif
+    daemon->daemon_info_dummy_stats.stats = &daemon->stats_sum;
+    return &daemon->daemon_info_dummy_stats;
   default:
     return NULL;
   }
@@ -8415,6 +9130,12 @@ MHD_is_feature_supported (enum MHD_FEATURE feature)
 #else
     return MHD_NO;
 #endif
+  case MHD_FEATURE_COMPRESSION:
+#ifdef COMPRESSION_SUPPORT
+    return MHD_YES;
+#else
+    return MHD_NO;
+#endif
 
   default:
     break;
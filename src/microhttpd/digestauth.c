@@ -568,6 +568,14 @@ get_nonce_nc_idx (size_t arr_size,
 }
 
 
+/**
+ * Get the pointer to the mutex protecting the slot of the nonce-nc map.
+ * @param d the master daemon
+ * @param idx the index of the slot
+ */
+#define MHD_nnc_lock_(d,idx) (&((d)->nnc_locks[(idx) % MHD_NNC_LOCKS_NUM]))
+
+
 /**
  * Check nonce-nc map array with the new nonce counter.
  *
@@ -592,6 +600,7 @@ check_nonce_nc (struct MHD_Connection *connection,
   struct MHD_Daemon *daemon = MHD_get_master (connection->daemon);
   struct MHD_NonceNc *nn;
   uint32_t mod;
+  size_t idx;
   enum MHD_CheckNonceNC_ ret;
 
   mhd_assert (0 != noncelen);
@@ -607,9 +616,10 @@ check_nonce_nc (struct MHD_Connection *connection,
   if (nc >= UINT64_MAX - 64)
     return MHD_CHECK_NONCENC_STALE;  /* Overflow, unrealistically high value */
 
-  nn = &daemon->nnc[get_nonce_nc_idx (mod, nonce, noncelen)];
+  idx = get_nonce_nc_idx (mod, nonce, noncelen);
+  nn = &daemon->nnc[idx];
 
-  MHD_mutex_lock_chk_ (&daemon->nnc_lock);
+  MHD_mutex_lock_chk_ (MHD_nnc_lock_ (daemon, idx));
 
   mhd_assert (0 == nn->nonce[noncelen]); /* The old value must be valid */
 
@@ -697,7 +707,7 @@ check_nonce_nc (struct MHD_Connection *connection,
     /* 'nc' was already used */
     ret = MHD_CHECK_NONCENC_STALE;
 
-  MHD_mutex_unlock_chk_ (&daemon->nnc_lock);
+  MHD_mutex_unlock_chk_ (MHD_nnc_lock_ (daemon, idx));
 
   return ret;
 }
@@ -1499,6 +1509,7 @@ calculate_add_nonce (struct MHD_Connection *const connection,
   struct MHD_Daemon *const daemon = MHD_get_master (connection->daemon);
   struct MHD_NonceNc *nn;
   const size_t nonce_size = NONCE_STD_LEN (digest_get_size (da));
+  size_t idx;
   bool ret;
 
   mhd_assert (MAX_DIGEST_NONCE_LENGTH >= nonce_size);
@@ -1522,11 +1533,12 @@ calculate_add_nonce (struct MHD_Connection *const connection,
   /* Sanity check for values */
   mhd_assert (MAX_DIGEST_NONCE_LENGTH == NONCE_STD_LEN (MAX_DIGEST));
 
-  nn = daemon->nnc + get_nonce_nc_idx (daemon->nonce_nc_size,
-                                       nonce,
-                                       nonce_size);
+  idx = get_nonce_nc_idx (daemon->nonce_nc_size,
+                         nonce,
+                         nonce_size);
+  nn = daemon->nnc + idx;
 
-  MHD_mutex_lock_chk_ (&daemon->nnc_lock);
+  MHD_mutex_lock_chk_ (MHD_nnc_lock_ (daemon, idx));
   if (is_slot_available (nn, timestamp, nonce, nonce_size))
   {
     memcpy (nn->nonce,
@@ -1539,7 +1551,7 @@ calculate_add_nonce (struct MHD_Connection *const connection,
   }
   else
     ret = false;
-  MHD_mutex_unlock_chk_ (&daemon->nnc_lock);
+  MHD_mutex_unlock_chk_ (MHD_nnc_lock_ (daemon, idx));
 
   return ret;
 }
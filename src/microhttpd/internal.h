@@ -62,6 +62,8 @@
 #include "mhd_locks.h"
 #include "mhd_sockets.h"
 #include "mhd_itc_types.h"
+#include "memorypool.h"
+#include "timer_wheel.h"
 
 /**
  * Macro to drop 'const' qualifier from pointer without compiler warning.
@@ -251,6 +253,14 @@ enum MHD_ConnectionEventLoopInfo
  */
 #define MAX_DIGEST_NONCE_LENGTH ((32 + 6) * 2)
 
+/**
+ * The number of mutexes protecting the nonce-nc map array.
+ * The slot with index N is protected by the mutex with index
+ * (N % MHD_NNC_LOCKS_NUM), so checks of different nonces rarely
+ * wait for each other.
+ */
+#define MHD_NNC_LOCKS_NUM 32
+
 /**
  * A structure representing the internal holder of the
  * nonce-nc map.
@@ -380,6 +390,79 @@ struct MHD_HTTP_Req_Header
 };
 
 
+/**
+ * The request headers used by MHD itself.  The first occurrence of
+ * each of these headers is remembered in the connection when the header
+ * is added, so the lookup of such headers does not need any search.
+ */
+enum MHD_ReqHeaderWK
+{
+  MHD_REQ_HDR_WK_HOST = 0,
+  MHD_REQ_HDR_WK_CONNECTION,
+  MHD_REQ_HDR_WK_CONTENT_LENGTH,
+  MHD_REQ_HDR_WK_TRANSFER_ENCODING,
+  MHD_REQ_HDR_WK_CONTENT_TYPE,
+  MHD_REQ_HDR_WK_COOKIE,
+  MHD_REQ_HDR_WK_AUTHORIZATION,
+  MHD_REQ_HDR_WK_EXPECT,
+
+  /**
+   * The number of the well-known headers, not a valid header.
+   */
+  MHD_REQ_HDR_WK_COUNT
+};
+
+
+/**
+ * The number of request values kinds with separate hash indices:
+ * headers, cookies, POST data, GET arguments and footers.
+ */
+#define MHD_REQ_HDR_INDEX_KINDS 5
+
+/**
+ * The minimal number of request values of one kind to build the hash
+ * index.  The linear search is fast enough for the smaller lists.
+ */
+#define MHD_REQ_HDR_INDEX_MIN 8
+
+
+/**
+ * Open-addressing hash index of request values of one kind.
+ * Only the first value for each (caseless) key is indexed, as lookup
+ * functions return the first matching value in the list.
+ * The index is allocated from the connection's memory pool lazily,
+ * when the values of this kind are looked up for the first time.
+ */
+struct MHD_ReqHeaderIndex
+{
+  /**
+   * The slots of the index, NULL if the index is not built.
+   */
+  struct MHD_HTTP_Req_Header **slots;
+
+  /**
+   * The number of @e slots, always a power of two.
+   */
+  size_t size;
+
+  /**
+   * The number of used @e slots.
+   */
+  size_t used;
+
+  /**
+   * The number of values of this kind in the list of the values.
+   */
+  size_t count;
+
+  /**
+   * Set to 'true' if the index cannot be allocated, linear search
+   * is used in this case.
+   */
+  bool failed;
+};
+
+
 /**
  * Automatically assigned flags
  */
@@ -390,7 +473,9 @@ enum MHD_ResponseAutoFlags
   MHD_RAF_HAS_CONNECTION_CLOSE = 1 << 1,  /**< Has "Connection: close" */
   MHD_RAF_HAS_TRANS_ENC_CHUNKED = 1 << 2, /**< Has "Transfer-Encoding: chunked" */
   MHD_RAF_HAS_CONTENT_LENGTH = 1 << 3,    /**< Has "Content-Length" header */
-  MHD_RAF_HAS_DATE_HDR = 1 << 4           /**< Has "Date" header */
+  MHD_RAF_HAS_DATE_HDR = 1 << 4,          /**< Has "Date" header */
+  MHD_RAF_VARY_ADDED = 1 << 5,            /**< "Vary" header added by MHD */
+  MHD_RAF_VARY_APPENDED = 1 << 6          /**< "Accept-Encoding" appended to "Vary" */
 } _MHD_FIXED_FLAGS_ENUM;
 
 
@@ -448,6 +533,37 @@ struct MHD_iovec_track_
   size_t sent;
 };
 
+#ifdef COMPRESSION_SUPPORT
+/**
+ * The content codings supported for the automatic compression.
+ * The order is the server preference, the most preferred first.
+ */
+enum MHD_ContentCoding_
+{
+#ifdef HAVE_BROTLI_ENCODER
+  /**
+   * The "br" coding.
+   */
+  MHD_CODING_BR_,
+#endif /* HAVE_BROTLI_ENCODER */
+
+  /**
+   * The "gzip" coding.
+   */
+  MHD_CODING_GZIP_,
+
+  /**
+   * The "deflate" coding (the zlib format).
+   */
+  MHD_CODING_DEFLATE_,
+
+  /**
+   * The number of the supported codings, also used as "no coding".
+   */
+  MHD_CODING_NUM_
+};
+#endif /* COMPRESSION_SUPPORT */
+
 /**
  * Representation of a response.
  */
@@ -573,6 +689,42 @@ struct MHD_Response
    * Number of elements in data_iov.
    */
   unsigned int data_iovcnt;
+
+  /**
+   * The serialised user headers: all #MHD_HEADER_KIND entries as
+   * "Name: value\r\n" lines in the order of the list.
+   * Built when the response is queued for the second time, freed when
+   * the headers are modified.  NULL if not built.
+   * Protected by @e mutex, the connections use the snapshot taken by
+   * MHD_response_queued_().
+   */
+  char *hdrs_cache;
+
+  /**
+   * The size of the data in @e hdrs_cache.
+   */
+  size_t hdrs_cache_size;
+
+  /**
+   * Set to 'true' when the response is queued for the first time.
+   */
+  bool was_queued;
+
+#ifdef COMPRESSION_SUPPORT
+  /**
+   * The compressed variants of the response, indexed by the coding.
+   * Built on the first use and kept until the response is destroyed
+   * or its headers are modified.  Used only for responses with
+   * the data in memory.  Protected by @e mutex.
+   */
+  struct MHD_Response *compressed[MHD_CODING_NUM_];
+
+  /**
+   * The bitmask of the codings (1 << #MHD_ContentCoding_) that do not
+   * reduce the size of the data.  Protected by @e mutex.
+   */
+  unsigned int compress_useless;
+#endif /* COMPRESSION_SUPPORT */
 };
 
 
@@ -928,6 +1080,33 @@ struct MHD_Reply_Properties
   bool chunked; /**< Use chunked encoding for reply */
 };
 
+
+/**
+ * The cached "Date:" reply header.
+ * The header is formatted again only when the value of the monotonic
+ * seconds counter is changed, so the cached value could be behind the
+ * real time by less than one second.
+ * The cache must be used only by a single thread.
+ */
+struct MHD_DateCache
+{
+  /**
+   * The value of #MHD_monotonic_sec_counter() when @a header was formatted.
+   */
+  time_t mono_sec;
+
+  /**
+   * Indicates that @a header and @a mono_sec are set and valid.
+   */
+  bool valid;
+
+  /**
+   * The formatted "Date:" header line, including the terminating CRLF
+   * and the zero-termination.
+   */
+  char header[38];
+};
+
 /**
  * State kept for each HTTP request.
  */
@@ -946,6 +1125,16 @@ struct MHD_Connection
   struct MHD_Connection *prevE;
 #endif
 
+  /**
+   * Next pointer for the RDLL listing connections to be resumed.
+   */
+  struct MHD_Connection *nextR;
+
+  /**
+   * Previous pointer for the RDLL listing connections to be resumed.
+   */
+  struct MHD_Connection *prevR;
+
   /**
    * Next pointer for the DLL describing our IO state.
    */
@@ -957,18 +1146,11 @@ struct MHD_Connection
   struct MHD_Connection *prev;
 
   /**
-   * Next pointer for the XDLL organizing connections by timeout.
-   * This DLL can be either the
-   * 'manual_timeout_head/manual_timeout_tail' or the
-   * 'normal_timeout_head/normal_timeout_tail', depending on whether a
-   * custom timeout is set for the connection.
-   */
-  struct MHD_Connection *nextX;
-
-  /**
-   * Previous pointer for the XDLL organizing connections by timeout.
+   * The entry of the daemon's timer wheel, armed if the connection
+   * has a timeout and is not suspended.
+   * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
    */
-  struct MHD_Connection *prevX;
+  struct MHD_TimerEntry timer;
 
   /**
    * Reference to the MHD_Daemon struct.
@@ -985,11 +1167,54 @@ struct MHD_Connection
    */
   struct MHD_HTTP_Req_Header *headers_received_tail;
 
+  /**
+   * The first occurrences of the well-known request headers, indexed
+   * by #MHD_ReqHeaderWK values.
+   */
+  struct MHD_HTTP_Req_Header *rq_hdr_wk[MHD_REQ_HDR_WK_COUNT];
+
+  /**
+   * The hash indices of the request values, one index for each kind.
+   */
+  struct MHD_ReqHeaderIndex rq_hdr_idx[MHD_REQ_HDR_INDEX_KINDS];
+
+  /**
+   * Set to 'true' if any value with the combined kind (several bits
+   * set) has been added.  Such values are not indexed, so the indices
+   * and @e rq_hdr_wk cannot be used.
+   */
+  bool rq_hdr_no_index;
+
+  /**
+   * The memory of the hash index, which has been replaced by the larger
+   * index.  The memory cannot be returned to the pool, so it is used
+   * for the new request values.
+   */
+  char *rq_hdr_spare;
+
+  /**
+   * The size of the free memory at @e rq_hdr_spare.
+   */
+  size_t rq_hdr_spare_size;
+
   /**
    * Response to transmit (initially NULL).
    */
   struct MHD_Response *response;
 
+  /**
+   * The serialised user headers of @e response, taken under the lock of
+   * the response when the response is queued.  NULL if not available.
+   * The shared response could be modified by other threads, so only
+   * this snapshot is used by the connection.
+   */
+  const char *rp_hdrs_cache;
+
+  /**
+   * The size of the data in @e rp_hdrs_cache.
+   */
+  size_t rp_hdrs_cache_size;
+
   /**
    * The memory pool is created whenever we first read from the TCP
    * stream and destroyed at the end of each request (and re-created
@@ -1122,6 +1347,38 @@ struct MHD_Connection
    */
   size_t read_buffer_offset;
 
+  /**
+   * The number of bytes at the start of @e read_buffer already checked
+   * for the end of the header line and known to have no LF.
+   */
+  size_t read_buffer_scan_pos;
+
+  /**
+   * The expected size of the request header, based on the sizes of
+   * the previous requests of this connection.  Used to choose the
+   * initial size of the read buffer when the daemon releases the
+   * memory pools of the idle connections.  Zero if not known yet.
+   */
+  size_t read_buffer_hint;
+
+  /**
+   * The buffer of the application for the body of the request, set by
+   * #MHD_set_connection_upload_buffer().  NULL if the body is received
+   * to @e read_buffer.
+   */
+  char *upload_buffer;
+
+  /**
+   * Size of @e upload_buffer (in bytes).
+   */
+  size_t upload_buffer_size;
+
+  /**
+   * The number of bytes in @e upload_buffer not yet processed by
+   * the application.
+   */
+  size_t upload_buffer_offset;
+
   /**
    * Size of @e write_buffer (in bytes).
    */
@@ -1170,6 +1427,9 @@ struct MHD_Connection
   enum MHD_resp_sender_
   {
     MHD_resp_sender_std = 0,
+#if defined(_MHD_HAVE_SPLICE)
+    MHD_resp_sender_splice,
+#endif /* _MHD_HAVE_SPLICE */
     MHD_resp_sender_sendfile
   } resp_sender;
 #endif /* _MHD_HAVE_SENDFILE */
@@ -1198,6 +1458,29 @@ struct MHD_Connection
    */
   uint64_t connection_timeout_ms;
 
+  /**
+   * The performance counters updated by the thread processing this
+   * connection.  Points to the counters of the daemon, except in
+   * thread-per-connection mode where it points to @a own_stats.
+   */
+  struct MHD_DaemonStats *stats;
+
+  /**
+   * The performance counters of the connection, used only in
+   * thread-per-connection mode.  Added to the counters of the daemon
+   * when the connection is cleaned up.
+   */
+  struct MHD_DaemonStats own_stats;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /**
+   * The cached "Date:" header.
+   * Used only in MHD_USE_THREAD_PER_CONNECTION mode, where each connection
+   * is processed by its own thread.
+   */
+  struct MHD_DateCache date_cache;
+#endif /* MHD_USE_POSIX_THREADS || MHD_USE_W32_THREADS */
+
   /**
    * Did we ever call the "default_handler" on this connection?  (this
    * flag will determine if we call the #MHD_OPTION_NOTIFY_COMPLETED
@@ -1238,6 +1521,33 @@ struct MHD_Connection
    */
   enum MHD_tristate sk_nodelay;
 
+#ifdef MHD_USE_MSG_ZEROCOPY
+  /**
+   * Tracks SO_ZEROCOPY state of the connection socket.
+   */
+  enum MHD_tristate sk_zerocopy;
+
+  /**
+   * The number of the sends made with MSG_ZEROCOPY.
+   * Used as the identifier of the next zerocopy send, the kernel
+   * numbers the sends in the same way.
+   */
+  uint32_t zc_sent;
+
+  /**
+   * The number of the zerocopy sends reported by the kernel as
+   * completed.
+   */
+  uint32_t zc_done;
+
+  /**
+   * The response with the data not yet released by the kernel.
+   * The connection holds the reference to the response until all
+   * zerocopy sends are completed.
+   */
+  struct MHD_Response *zc_response;
+#endif /* MHD_USE_MSG_ZEROCOPY */
+
   /**
    * Has this socket been closed for reading (i.e.  other side closed
    * the connection)?  If so, we must completely close the connection
@@ -1343,6 +1653,13 @@ struct MHD_Connection
    */
   uint64_t current_chunk_offset;
 
+  /**
+   * If we are receiving with chunked encoding, the number of the decoded
+   * bytes at the start of @e read_buffer not yet processed by
+   * the application.  The undecoded data follows them.
+   */
+  size_t chunked_decoded_size;
+
   /**
    * Function used for reading HTTP request stream.
    */
@@ -1375,6 +1692,13 @@ struct MHD_Connection
    * even though the socket is not?
    */
   bool tls_read_ready;
+
+  /**
+   * Set to 'true' if the encryption of the sent data is performed by
+   * the kernel (kTLS).  The plain socket functions (including
+   * sendfile() and vector send) are used for sending in this case.
+   */
+  bool tls_ktls_send;
 #endif /* HTTPS_SUPPORT */
 
   /**
@@ -1387,6 +1711,30 @@ struct MHD_Connection
    */
   volatile bool resuming;
 
+  /**
+   * Is the connection in the daemon's RDLL of connections to be resumed?
+   * Protected by the daemon's @e cleanup_connection_mutex.
+   */
+  bool in_resume_queue;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /**
+   * The blocking task passed to #MHD_offload_connection(),
+   * NULL if the connection is not offloaded.
+   */
+  MHD_OffloadCallback offload_task;
+
+  /**
+   * The closure for @e offload_task.
+   */
+  void *offload_task_cls;
+
+  /**
+   * Next pointer for the queue of the offload pool.
+   */
+  struct MHD_Connection *next_offload;
+#endif /* MHD_USE_POSIX_THREADS || MHD_USE_W32_THREADS */
+
   /**
    * Special member to be returned by #MHD_get_connection_info()
    */
@@ -1564,6 +1912,14 @@ struct MHD_UpgradeResponseHandle
    */
   volatile bool was_closed;
 
+  /**
+   * Set to true if the "upgraded" connection is used in the direct mode
+   * (see #MHD_RF_UPGRADE_DIRECT): the application exchanges the data
+   * by #MHD_upgrade_recv() and #MHD_upgrade_send(), MHD does not forward
+   * the data.
+   */
+  bool direct;
+
   /**
    * Set to true if connection is ready for cleanup.
    *
@@ -1618,6 +1974,42 @@ typedef size_t
                     char *uri);
 
 
+#ifdef MHD_USE_MSG_ZEROCOPY
+/**
+ * The socket of the closed connection with the zerocopy sends not
+ * completed yet.  The socket is kept open to receive the notifications
+ * and the response is kept until the kernel releases its data.
+ */
+struct MHD_ZerocopyLinger_
+{
+  /**
+   * The next entry in the list of the daemon.
+   */
+  struct MHD_ZerocopyLinger_ *next;
+
+  /**
+   * The response with the data not yet released by the kernel.
+   */
+  struct MHD_Response *response;
+
+  /**
+   * The socket of the closed connection.
+   */
+  MHD_socket fd;
+
+  /**
+   * The number of the sends made with MSG_ZEROCOPY.
+   */
+  uint32_t sent;
+
+  /**
+   * The number of the zerocopy sends reported as completed.
+   */
+  uint32_t done;
+};
+#endif /* MHD_USE_MSG_ZEROCOPY */
+
+
 /**
  * State kept for each MHD daemon.  All connections are kept in two
  * doubly-linked lists.  The first one reflects the state of the
@@ -1676,6 +2068,20 @@ struct MHD_Daemon
    */
   struct MHD_Connection *suspended_connections_tail;
 
+  /**
+   * Head of RDLL of the suspended connections to be resumed.
+   * New elements are inserted at the head, the list is processed
+   * from the tail so connections are resumed in the order of
+   * the #MHD_resume_connection() calls.
+   * Protected by @e cleanup_connection_mutex.
+   */
+  struct MHD_Connection *resume_head;
+
+  /**
+   * Tail of RDLL of the suspended connections to be resumed.
+   */
+  struct MHD_Connection *resume_tail;
+
   /**
    * Head of doubly-linked list of connections to clean up.
    */
@@ -1744,42 +2150,15 @@ struct MHD_Daemon
 #endif /* EPOLL_SUPPORT */
 
   /**
-   * Head of the XDLL of ALL connections with a default ('normal')
-   * timeout, sorted by timeout (earliest at the tail, most recently
-   * used connection at the head).  MHD can just look at the tail of
-   * this list to determine the timeout for all of its elements;
-   * whenever there is an event of a connection, the connection is
-   * moved back to the tail of the list.
-   *
-   * All connections by default start in this list; if a custom
-   * timeout that does not match @e connection_timeout_ms is set, they
-   * are moved to the @e manual_timeout_head-XDLL.
+   * The timer wheel with timeouts of all connections that have
+   * a timeout.  The timeout is not re-armed on every activity of
+   * the connection: when the timer expires, the connection is
+   * checked and the timer is re-armed according to the last activity.
+   * Protected by @e cleanup_connection_mutex.
    * Not used in MHD_USE_THREAD_PER_CONNECTION mode as each thread
    * needs only one connection-specific timeout.
    */
-  struct MHD_Connection *normal_timeout_head;
-
-  /**
-   * Tail of the XDLL of ALL connections with a default timeout,
-   * sorted by timeout (earliest timeout at the tail).
-   * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
-   */
-  struct MHD_Connection *normal_timeout_tail;
-
-  /**
-   * Head of the XDLL of ALL connections with a non-default/custom
-   * timeout, unsorted.  MHD will do a O(n) scan over this list to
-   * determine the current timeout.
-   * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
-   */
-  struct MHD_Connection *manual_timeout_head;
-
-  /**
-   * Tail of the XDLL of ALL connections with a non-default/custom
-   * timeout, unsorted.
-   * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
-   */
-  struct MHD_Connection *manual_timeout_tail;
+  struct MHD_TimerWheel timers;
 
   /**
    * Function to call to check if we should accept or reject an
@@ -1885,9 +2264,11 @@ struct MHD_Daemon
 #endif
 
   /**
-   * Table storing number of connections per IP
+   * Table storing number of connections per IP.
+   * NULL if per-IP connection limit is not used.
+   * Used only in master daemon.
    */
-  void *per_ip_connection_count;
+  struct MHD_IPCountTable *per_ip_table;
 
   /**
    * Number of active parallel connections.
@@ -1907,6 +2288,47 @@ struct MHD_Daemon
    */
   size_t pool_increment;
 
+  /**
+   * The cache of released per-connection memory pools.
+   * Each worker daemon has its own cache, the cache is used only by
+   * the thread that processes daemon's select()/poll()/etc.
+   * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
+   */
+  struct MemoryPoolCache pool_cache;
+
+  /**
+   * Release the memory pools of the idle keep-alive connections.
+   */
+  bool pool_release_idle;
+
+  /**
+   * The cached "Date:" header.
+   * Each worker daemon has its own cache, the cache is used only by
+   * the thread that processes daemon's select()/poll()/etc.
+   * Not used in MHD_USE_THREAD_PER_CONNECTION mode.
+   */
+  struct MHD_DateCache date_cache;
+
+  /**
+   * The performance counters of this daemon (worker).
+   * Updated without locking only by the thread that processes daemon's
+   * select()/poll()/etc.
+   * The counters (as well as the other statistics of the workers) are
+   * read by MHD_get_daemon_info() without locking, such reads are
+   * thread-safe only if the read of the value is atomic.
+   */
+  struct MHD_DaemonStats stats;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /**
+   * The number of connections rejected by MHD_add_connection() called
+   * by the application when the daemon uses the internal threads.
+   * Protected by @a new_connections_mutex, added to
+   * @a stats.connections_rejected when the statistics are read.
+   */
+  uint64_t connections_rejected_ext;
+#endif
+
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   /**
    * Size of threads created by MHD.
@@ -1919,18 +2341,25 @@ struct MHD_Daemon
   unsigned int worker_pool_size;
 
   /**
-   * The select thread handle (if we have internal select)
+   * The number of threads in the pool for the blocking tasks,
+   * zero if the pool is not used.
    */
-  MHD_thread_handle_ID_ pid;
+  unsigned int offload_pool_size;
+
+  /**
+   * The pool for the blocking tasks, shared by the master daemon and
+   * the worker daemons.  Owned by the master daemon.
+   */
+  struct MHD_OffloadPool *offload_pool;
 
   /**
-   * Mutex for per-IP connection counts.
+   * The select thread handle (if we have internal select)
    */
-  MHD_mutex_ per_ip_connection_mutex;
+  MHD_thread_handle_ID_ pid;
 
   /**
-   * Mutex for (modifying) access to the "cleanup", "normal_timeout" and
-   * "manual_timeout" DLLs.
+   * Mutex for (modifying) access to the "cleanup" DLL and to the timer
+   * wheel.
    */
   MHD_mutex_ cleanup_connection_mutex;
 
@@ -1957,6 +2386,15 @@ struct MHD_Daemon
    */
   int listening_address_reuse;
 
+  /**
+   * Whether each worker daemon uses its own listen socket.
+   * 0: all workers use the listen socket of the master daemon
+   * 1: each worker has its own SO_REUSEPORT listen socket
+   * 2: the same as 1 with incoming connections steered by CPU number
+   * @sa #MHD_OPTION_LISTEN_SOCKET_PER_WORKER
+   */
+  unsigned int listen_per_worker;
+
 
   /**
    * Inter-thread communication channel (also used to unblock
@@ -2139,6 +2577,12 @@ struct MHD_Daemon
    */
   bool disable_alpn;
 
+  /**
+   * true if the kernel TLS offload should be used for sending when
+   * it is enabled by GnuTLS for the connection.
+   */
+  bool use_ktls;
+
   #endif /* HTTPS_SUPPORT */
 
 #ifdef DAUTH_SUPPORT
@@ -2155,9 +2599,10 @@ struct MHD_Daemon
 
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   /**
-   * A rw-lock for synchronizing access to @e nnc.
+   * The locks for synchronizing access to the slots of @e nnc.
+   * Use #MHD_nnc_lock_() to get the lock for the slot.
    */
-  MHD_mutex_ nnc_lock;
+  MHD_mutex_ nnc_locks[MHD_NNC_LOCKS_NUM];
 #endif
 
   /**
@@ -2184,6 +2629,49 @@ struct MHD_Daemon
    */
   unsigned int listen_backlog_size;
 
+  /**
+   * The maximum number of connections accepted per single wake up
+   * of the daemon's epoll loop.
+   */
+  unsigned int accept_batch_size;
+
+  /**
+   * The minimal size of the response body sent with MSG_ZEROCOPY,
+   * zero if zerocopy sending is not used.
+   */
+  size_t zerocopy_threshold;
+
+#ifdef MHD_USE_MSG_ZEROCOPY
+  /**
+   * The number of connections with the zerocopy sends not completed
+   * yet.  Updated only by the thread that processes daemon's
+   * select()/poll()/etc., not used in thread-per-connection mode.
+   */
+  unsigned int zc_pending;
+
+  /**
+   * The list of the sockets of the closed connections waiting for the
+   * zerocopy notifications.  Used only by the thread that processes
+   * daemon's select()/poll()/etc., not used in thread-per-connection
+   * mode.
+   */
+  struct MHD_ZerocopyLinger_ *zc_linger_head;
+#endif /* MHD_USE_MSG_ZEROCOPY */
+
+  /**
+   * The number of wake ups of the daemon's epoll loop with the listen
+   * socket ready for accepting.
+   * Updated only by the thread that processes daemon's epoll.
+   */
+  uint64_t accept_wakeups;
+
+  /**
+   * The maximum number of connections accepted in single wake up
+   * of the daemon's epoll loop.
+   * Updated only by the thread that processes daemon's epoll.
+   */
+  unsigned int accept_batch_max;
+
   /**
    * The number of user options used.
    *
@@ -2220,6 +2708,32 @@ struct MHD_Daemon
    * The value to be returned by #MHD_get_daemon_info()
    */
   union MHD_DaemonInfo daemon_info_dummy_port;
+
+  /**
+   * The value to be returned by #MHD_get_daemon_info()
+   */
+  union MHD_DaemonInfo daemon_info_dummy_pool_cache;
+
+  /**
+   * The value to be returned by #MHD_get_daemon_info()
+   */
+  union MHD_DaemonInfo daemon_info_dummy_accepted;
+
+  /**
+   * The value to be returned by #MHD_get_daemon_info()
+   */
+  union MHD_DaemonInfo daemon_info_dummy_accept_batch;
+
+  /**
+   * The counters summed over all workers, pointed by the value
+   * returned by #MHD_get_daemon_info()
+   */
+  struct MHD_DaemonStats stats_sum;
+
+  /**
+   * The value to be returned by #MHD_get_daemon_info()
+   */
+  union MHD_DaemonInfo daemon_info_dummy_stats;
 };
 
 
@@ -2270,53 +2784,6 @@ struct MHD_Daemon
     (element)->prev = NULL; } while (0)
 
 
-/**
- * Insert an element at the head of a XDLL. Assumes that head, tail and
- * element are structs with prevX and nextX fields.
- *
- * @param head pointer to the head of the XDLL
- * @param tail pointer to the tail of the XDLL
- * @param element element to insert
- */
-#define XDLL_insert(head,tail,element) do { \
-    mhd_assert (NULL == (element)->nextX); \
-    mhd_assert (NULL == (element)->prevX); \
-    (element)->nextX = (head);     \
-    (element)->prevX = NULL;       \
-    if (NULL == (tail)) {          \
-      (tail) = element;            \
-    } else {                       \
-      (head)->prevX = element;     \
-    }                              \
-    (head) = (element); } while (0)
-
-
-/**
- * Remove an element from a XDLL. Assumes
- * that head, tail and element are structs
- * with prevX and nextX fields.
- *
- * @param head pointer to the head of the XDLL
- * @param tail pointer to the tail of the XDLL
- * @param element element to remove
- */
-#define XDLL_remove(head,tail,element) do { \
-    mhd_assert ( (NULL != (element)->nextX) || ((element) == (tail)));  \
-    mhd_assert ( (NULL != (element)->prevX) || ((element) == (head)));  \
-    if (NULL == (element)->prevX) {                                     \
-      (head) = (element)->nextX;                  \
-    } else {                                      \
-      (element)->prevX->nextX = (element)->nextX; \
-    }                                             \
-    if (NULL == (element)->nextX) {               \
-      (tail) = (element)->prevX;                  \
-    } else {                                      \
-      (element)->nextX->prevX = (element)->prevX; \
-    }                                             \
-    (element)->nextX = NULL;                      \
-    (element)->prevX = NULL; } while (0)
-
-
 /**
  * Insert an element at the head of a EDLL. Assumes that head, tail and
  * element are structs with prevE and nextE fields.
@@ -2360,6 +2827,49 @@ struct MHD_Daemon
     (element)->prevE = NULL; } while (0)
 
 
+/**
+ * Insert an element at the head of a RDLL. Assumes that head, tail and
+ * element are structs with prevR and nextR fields.
+ *
+ * @param head pointer to the head of the RDLL
+ * @param tail pointer to the tail of the RDLL
+ * @param element element to insert
+ */
+#define RDLL_insert(head,tail,element) do { \
+    (element)->nextR = (head); \
+    (element)->prevR = NULL;   \
+    if ((tail) == NULL) {      \
+      (tail) = element;        \
+    } else {                   \
+      (head)->prevR = element; \
+    }                          \
+    (head) = (element); } while (0)
+
+
+/**
+ * Remove an element from a RDLL. Assumes
+ * that head, tail and element are structs
+ * with prevR and nextR fields.
+ *
+ * @param head pointer to the head of the RDLL
+ * @param tail pointer to the tail of the RDLL
+ * @param element element to remove
+ */
+#define RDLL_remove(head,tail,element) do {       \
+    if ((element)->prevR == NULL) {               \
+      (head) = (element)->nextR;                  \
+    } else {                                      \
+      (element)->prevR->nextR = (element)->nextR; \
+    }                                             \
+    if ((element)->nextR == NULL) {               \
+      (tail) = (element)->prevR;                  \
+    } else {                                      \
+      (element)->nextR->prevR = (element)->prevR; \
+    }                                             \
+    (element)->nextR = NULL;                      \
+    (element)->prevR = NULL; } while (0)
+
+
 /**
  * Convert all occurrences of '+' to ' '.
  *
@@ -2452,6 +2962,24 @@ MHD_check_response_header_token_ci (const struct MHD_Response *response,
                                       (tkn),MHD_STATICSTR_LEN_ (tkn))
 
 
+/**
+ * Check whether the data sent over the connection must be encrypted by
+ * the TLS library.
+ * The data sent over connections with the kernel TLS offload is
+ * encrypted by the kernel, so plain socket functions are used.
+ *
+ * @param c the connection to check
+ * @return true if the TLS library must be used to send the data,
+ *         false if plain socket functions could be used
+ */
+#ifdef HTTPS_SUPPORT
+#define MHD_C_USES_TLS_SEND_(c) \
+  ( (0 != ((c)->daemon->options & MHD_USE_TLS)) && (! (c)->tls_ktls_send) )
+#else  /* ! HTTPS_SUPPORT */
+#define MHD_C_USES_TLS_SEND_(c) (false)
+#endif /* ! HTTPS_SUPPORT */
+
+
 /**
  * Internal version of #MHD_suspend_connection().
  *
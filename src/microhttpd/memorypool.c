@@ -184,6 +184,12 @@ struct MemoryPool
    * 'false' if pool was malloc'ed, 'true' if mmapped (VirtualAlloc'ed for W32).
    */
   bool is_mmap;
+
+  /**
+   * The next pool in the #MemoryPoolCache list.
+   * Used only when the pool is in the cache.
+   */
+  struct MemoryPool *next_cached;
 };
 
 
@@ -253,6 +259,7 @@ MHD_pool_create (size_t max)
   pool->pos = 0;
   pool->end = alloc_size;
   pool->size = alloc_size;
+  pool->next_cached = NULL;
   mhd_assert (0 < alloc_size);
   _MHD_POISON_MEMORY (pool->memory, pool->size);
   return pool;
@@ -290,6 +297,103 @@ MHD_pool_destroy (struct MemoryPool *pool)
 }
 
 
+/**
+ * Create a memory pool, re-using the cached pool if available.
+ *
+ * @param cache the cache to take the pool from
+ * @param max maximum size of the pool
+ * @return NULL on error
+ */
+struct MemoryPool *
+MHD_pool_cache_create (struct MemoryPoolCache *cache,
+                       size_t max)
+{
+  struct MemoryPool *pool;
+
+  if (0 == cache->max_count)
+    return MHD_pool_create (max);
+
+  pool = cache->head;
+  if ( (NULL != pool) &&
+       (pool->size >= max) )
+  {
+    mhd_assert (0 != cache->count);
+    mhd_assert (0 == pool->pos);
+    mhd_assert (pool->size == pool->end);
+    cache->head = pool->next_cached;
+    cache->count--;
+    cache->hits++;
+    pool->next_cached = NULL;
+    return pool;
+  }
+  cache->misses++;
+  return MHD_pool_create (max);
+}
+
+
+/**
+ * Release a memory pool.
+ * The pool is cleared and put into the @a cache if the cache has space,
+ * otherwise the pool is destroyed.
+ *
+ * @param cache the cache to put the pool into
+ * @param pool memory pool to release, could be NULL
+ */
+void
+MHD_pool_cache_release (struct MemoryPoolCache *cache,
+                        struct MemoryPool *pool)
+{
+  if (NULL == pool)
+    return;
+  if (cache->count >= cache->max_count)
+  {
+    MHD_pool_destroy (pool);
+    return;
+  }
+  mhd_assert (pool->end >= pool->pos);
+  mhd_assert (pool->size >= pool->end - pool->pos);
+  mhd_assert (NULL == pool->next_cached);
+
+  /* Areas freed by the pool functions are zeroed already, the area between
+   * 'pos' and 'end' has no data of the previous pool user.
+   * Only allocated areas need to be cleared. */
+  _MHD_UNPOISON_MEMORY (pool->memory, pool->size);
+  memset (pool->memory,
+          0,
+          pool->pos);
+  memset (pool->memory + pool->end,
+          0,
+          pool->size - pool->end);
+  pool->pos = 0;
+  pool->end = pool->size;
+  _MHD_POISON_MEMORY (pool->memory, pool->size);
+
+  pool->next_cached = cache->head;
+  cache->head = pool;
+  cache->count++;
+}
+
+
+/**
+ * Destroy all pools kept in the @a cache.
+ *
+ * @param cache the cache to clear
+ */
+void
+MHD_pool_cache_clear (struct MemoryPoolCache *cache)
+{
+  struct MemoryPool *pool;
+
+  while (NULL != (pool = cache->head))
+  {
+    cache->head = pool->next_cached;
+    pool->next_cached = NULL;
+    MHD_pool_destroy (pool);
+  }
+  cache->count = 0;
+}
+
+
 /**
  * Check how much memory is left in the @a pool
  *
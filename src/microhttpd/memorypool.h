@@ -37,6 +37,7 @@
 #ifdef HAVE_STDBOOL_H
 #include <stdbool.h>
 #endif
+#include <stdint.h>
 
 /**
  * Opaque handle for a memory pool.
@@ -45,6 +46,46 @@
  */
 struct MemoryPool;
 
+/**
+ * Cache of released memory pools.
+ * Pools put into the cache keep their memory regions, so the next
+ * connection can re-use the region without new mmap()/malloc() call.
+ * The cache is not reentrant and must be used only by the thread that
+ * creates and destroys the pools.  The disabled cache (with zero
+ * @e max_count) is not modified, including the counters, so it can
+ * be used by several threads.
+ */
+struct MemoryPoolCache
+{
+  /**
+   * Singly-linked list of cached pools.
+   */
+  struct MemoryPool *head;
+
+  /**
+   * The number of pools currently in the cache.
+   */
+  unsigned int count;
+
+  /**
+   * The maximum number of pools to keep in the cache.
+   * Zero if the cache is disabled.
+   */
+  unsigned int max_count;
+
+  /**
+   * The number of pools taken from the cache.
+   * Not updated if the cache is disabled.
+   */
+  uint64_t hits;
+
+  /**
+   * The number of pools allocated while the cache was empty.
+   * Not updated if the cache is disabled.
+   */
+  uint64_t misses;
+};
+
 /**
  * Initialize values for memory pools
  */
@@ -71,6 +112,40 @@ void
 MHD_pool_destroy (struct MemoryPool *pool);
 
 
+/**
+ * Create a memory pool, re-using the cached pool if available.
+ *
+ * @param cache the cache to take the pool from
+ * @param max maximum size of the pool
+ * @return NULL on error
+ */
+struct MemoryPool *
+MHD_pool_cache_create (struct MemoryPoolCache *cache,
+                       size_t max);
+
+
+/**
+ * Release a memory pool.
+ * The pool is cleared and put into the @a cache if the cache has space,
+ * otherwise the pool is destroyed.
+ *
+ * @param cache the cache to put the pool into
+ * @param pool memory pool to release, could be NULL
+ */
+void
+MHD_pool_cache_release (struct MemoryPoolCache *cache,
+                        struct MemoryPool *pool);
+
+
+/**
+ * Destroy all pools kept in the @a cache.
+ *
+ * @param cache the cache to clear
+ */
+void
+MHD_pool_cache_clear (struct MemoryPoolCache *cache);
+
+
 /**
  * Allocate size bytes from the pool.
  *
@@ -0,0 +1,1101 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/mhd_compress.c
+ * @brief  automatic compression of the responses
+ * @author agent
+ */
+
+#include "mhd_compress.h"
+#include "platform.h"
+#include "internal.h"
+#include "response.h"
+#include "mhd_str.h"
+#include "mhd_assert.h"
+#define ZLIB_CONST 1
+#include <zlib.h>
+#ifdef HAVE_BROTLI_ENCODER
+#include <brotli/encode.h>
+#endif /* HAVE_BROTLI_ENCODER */
+
+
+/**
+ * The responses with the smaller data are not compressed.
+ */
+#define MHD_COMPRESS_MIN_SIZE_ 64
+
+/**
+ * The size of the buffer for the source data of the on-the-fly
+ * compression.
+ */
+#define MHD_COMPRESS_IN_BUF_SIZE_ (16 * 1024)
+
+/**
+ * The block size of the response compressed on-the-fly.
+ */
+#define MHD_COMPRESS_OUT_BLOCK_SIZE_ (16 * 1024)
+
+/**
+ * The maximum size of data given to zlib by one call.
+ */
+#define MHD_COMPRESS_ZLIB_PIECE_MAX_ (1024 * 1024)
+
+/**
+ * The zlib compression level for the data compressed only once.
+ */
+#define MHD_COMPRESS_ZLIB_LEVEL_CACHED_ 9
+
+/**
+ * The zlib compression level for the data compressed on-the-fly.
+ */
+#define MHD_COMPRESS_ZLIB_LEVEL_STREAM_ 6
+
+#ifdef HAVE_BROTLI_ENCODER
+/**
+ * The brotli quality for the data compressed only once.
+ * The maximum quality is too slow for the large data.
+ */
+#define MHD_COMPRESS_BR_QUALITY_CACHED_ 9
+
+/**
+ * The brotli quality for the data compressed on-the-fly.
+ */
+#define MHD_COMPRESS_BR_QUALITY_STREAM_ 4
+#endif /* HAVE_BROTLI_ENCODER */
+
+
+/**
+ * The operation of the encoder.
+ */
+enum MHD_CompressOp_
+{
+  /**
+   * Compress the input, the output may be buffered by the encoder.
+   */
+  MHD_COMPRESS_PROCESS_,
+
+  /**
+   * Compress the input and output all buffered data.
+   */
+  MHD_COMPRESS_FLUSH_,
+
+  /**
+   * Compress the input and finish the compressed stream.
+   */
+  MHD_COMPRESS_FINISH_
+};
+
+
+/**
+ * The state of the encoder.
+ */
+struct MHD_Encoder_
+{
+  /**
+   * The coding used by the encoder.
+   */
+  enum MHD_ContentCoding_ coding;
+
+  /**
+   * The state of the library.
+   */
+  union
+  {
+    /**
+     * The zlib state for "gzip" and "deflate" codings.
+     */
+    z_stream zs;
+
+#ifdef HAVE_BROTLI_ENCODER
+    /**
+     * The brotli state for "br" coding.
+     */
+    BrotliEncoderState *br;
+#endif /* HAVE_BROTLI_ENCODER */
+  } st;
+};
+
+
+/**
+ * The state of the on-the-fly compression of the response.
+ */
+struct MHD_CompressStream_
+{
+  /**
+   * The encoder, initialised on the first read.
+   */
+  struct MHD_Encoder_ enc;
+
+  /**
+   * The coding to use.
+   */
+  enum MHD_ContentCoding_ coding;
+
+  /**
+   * The response with the source data, a reference is held.
+   */
+  struct MHD_Response *src;
+
+  /**
+   * The position of the next source data to read.
+   */
+  uint64_t src_pos;
+
+  /**
+   * The source data not yet given to the encoder.
+   */
+  const uint8_t *in;
+
+  /**
+   * The size of the data pointed by @e in.
+   */
+  size_t in_size;
+
+  /**
+   * Set to 'true' when @e enc is initialised.
+   */
+  bool enc_ready;
+
+  /**
+   * Set to 'true' when all source data has been read.
+   */
+  bool src_eos;
+
+  /**
+   * Set to 'true' when the compressed stream has been finished.
+   */
+  bool finished;
+
+  /**
+   * The buffer for the source data.
+   */
+  uint8_t in_buf[MHD_COMPRESS_IN_BUF_SIZE_];
+};
+
+
+/**
+ * Get the name of the coding.
+ *
+ * @param coding the coding to use
+ * @return the name of the coding as used in "Content-Encoding" header
+ */
+static const char *
+coding_name_ (enum MHD_ContentCoding_ coding)
+{
+  switch (coding)
+  {
+#ifdef HAVE_BROTLI_ENCODER
+  case MHD_CODING_BR_:
+    return "br";
+#endif /* HAVE_BROTLI_ENCODER */
+  case MHD_CODING_GZIP_:
+    return "gzip";
+  case MHD_CODING_DEFLATE_:
+    return "deflate";
+  case MHD_CODING_NUM_:
+  default:
+    break;
+  }
+  mhd_assert (0);
+  return "identity";
+}
+
+
+/**
+ * Initialise the encoder.
+ *
+ * @param enc the encoder to initialise
+ * @param coding the coding to use
+ * @param best set to 'true' to get the better compression for the cost
+ *             of the speed
+ * @return 'true' on success, 'false' on error
+ */
+static bool
+encoder_init_ (struct MHD_Encoder_ *enc,
+               enum MHD_ContentCoding_ coding,
+               bool best)
+{
+  enc->coding = coding;
+#ifdef HAVE_BROTLI_ENCODER
+  if (MHD_CODING_BR_ == coding)
+  {
+    enc->st.br = BrotliEncoderCreateInstance (NULL, NULL, NULL);
+    if (NULL == enc->st.br)
+      return false;
+    if (! BrotliEncoderSetParameter (enc->st.br,
+                                     BROTLI_PARAM_QUALITY,
+                                     best ?
+                                     MHD_COMPRESS_BR_QUALITY_CACHED_ :
+                                     MHD_COMPRESS_BR_QUALITY_STREAM_))
+    {
+      BrotliEncoderDestroyInstance (enc->st.br);
+      return false;
+    }
+    return true;
+  }
+#endif /* HAVE_BROTLI_ENCODER */
+  memset (&enc->st.zs, 0, sizeof (enc->st.zs));
+  /* The window bits 15 plus 16 selects the gzip wrapper */
+  return Z_OK == deflateInit2 (&enc->st.zs,
+                               best ?
+                               MHD_COMPRESS_ZLIB_LEVEL_CACHED_ :
+                               MHD_COMPRESS_ZLIB_LEVEL_STREAM_,
+                               Z_DEFLATED,
+                               (MHD_CODING_GZIP_ == coding) ? 15 + 16 : 15,
+                               8,
+                               Z_DEFAULT_STRATEGY);
+}
+
+
+/**
+ * Free the resources of the initialised encoder.
+ *
+ * @param enc the encoder to use
+ */
+static void
+encoder_deinit_ (struct MHD_Encoder_ *enc)
+{
+#ifdef HAVE_BROTLI_ENCODER
+  if (MHD_CODING_BR_ == enc->coding)
+  {
+    BrotliEncoderDestroyInstance (enc->st.br);
+    return;
+  }
+#endif /* HAVE_BROTLI_ENCODER */
+  (void) deflateEnd (&enc->st.zs);
+}
+
+
+/**
+ * Run the encoder.
+ * Returns when all input data is consumed (and the output is flushed or
+ * the stream is finished, depending on the @a op) or when the output
+ * buffer is full.
+ *
+ * @param enc the encoder to use
+ * @param op the operation to perform
+ * @param[in,out] in the input data, updated to the data not consumed
+ * @param[in,out] in_size the size of the @a in data, updated
+ * @param[in,out] out the output buffer, updated to the free space
+ * @param[in,out] out_size the size of the @a out buffer, updated
+ * @return 1 if the compressed stream is finished,
+ *         0 if the encoder needs more input or more output space,
+ *         -1 on error
+ */
+static int
+encoder_run_ (struct MHD_Encoder_ *enc,
+              enum MHD_CompressOp_ op,
+              const uint8_t **in,
+              size_t *in_size,
+              uint8_t **out,
+              size_t *out_size)
+{
+  z_stream *zs;
+
+#ifdef HAVE_BROTLI_ENCODER
+  if (MHD_CODING_BR_ == enc->coding)
+  {
+    BrotliEncoderOperation bop;
+
+    if (MHD_COMPRESS_FINISH_ == op)
+      bop = BROTLI_OPERATION_FINISH;
+    else if (MHD_COMPRESS_FLUSH_ == op)
+      bop = BROTLI_OPERATION_FLUSH;
+    else
+      bop = BROTLI_OPERATION_PROCESS;
+    while (1)
+    {
+      if (! BrotliEncoderCompressStream (enc->st.br, bop,
+                                         in_size, in,
+                                         out_size, out,
+                                         NULL))
+        return -1;
+      if ( (MHD_COMPRESS_FINISH_ == op) &&
+           BrotliEncoderIsFinished (enc->st.br))
+        return 1;
+      if (0 == *out_size)
+        return 0;
+      if (0 != *in_size)
+        continue;
+      if (MHD_COMPRESS_PROCESS_ == op)
+        return 0;
+      if ( (MHD_COMPRESS_FLUSH_ == op) &&
+           ! BrotliEncoderHasMoreOutput (enc->st.br))
+        return 0;
+    }
+  }
+#endif /* HAVE_BROTLI_ENCODER */
+
+  zs = &enc->st.zs;
+  while (1)
+  {
+    const size_t in_piece = (MHD_COMPRESS_ZLIB_PIECE_MAX_ < *in_size) ?
+                            MHD_COMPRESS_ZLIB_PIECE_MAX_ : *in_size;
+    const size_t out_piece = (MHD_COMPRESS_ZLIB_PIECE_MAX_ < *out_size) ?
+                             MHD_COMPRESS_ZLIB_PIECE_MAX_ : *out_size;
+    int flush;
+    int res;
+
+    if ( (in_piece != *in_size) ||
+         (MHD_COMPRESS_PROCESS_ == op) )
+      flush = Z_NO_FLUSH;
+    else if (MHD_COMPRESS_FLUSH_ == op)
+      flush = Z_SYNC_FLUSH;
+    else
+      flush = Z_FINISH;
+    zs->next_in = *in;
+    zs->avail_in = (uInt) in_piece;
+    zs->next_out = *out;
+    zs->avail_out = (uInt) out_piece;
+    res = deflate (zs, flush);
+    *in += in_piece - zs->avail_in;
+    *in_size -= in_piece - zs->avail_in;
+    *out += out_piece - zs->avail_out;
+    *out_size -= out_piece - zs->avail_out;
+    if (Z_STREAM_END == res)
+      return 1;
+    if (Z_BUF_ERROR == res)
+      return 0; /* No progress is possible */
+    if (Z_OK != res)
+      return -1;
+    if (0 == *out_size)
+      return 0;
+    if (0 != *in_size)
+      continue;
+    if (MHD_COMPRESS_FINISH_ != op)
+      return 0; /* All input is consumed and flushed, if requested */
+  }
+}
+
+
+/**
+ * Give the data to the encoder.
+ *
+ * @param enc the encoder to use
+ * @param data the data to compress
+ * @param data_size the size of the @a data
+ * @param[in,out] out the output buffer, updated to the free space
+ * @param[in,out] out_size the size of the @a out buffer, updated
+ * @return 'true' if all data has been consumed,
+ *         'false' if the output buffer is full or on error
+ */
+static bool
+encoder_feed_ (struct MHD_Encoder_ *enc,
+               const void *data,
+               size_t data_size,
+               uint8_t **out,
+               size_t *out_size)
+{
+  const uint8_t *in = (const uint8_t *) data;
+
+  while (0 != data_size)
+  {
+    if ( (0 == *out_size) ||
+         (0 != encoder_run_ (enc, MHD_COMPRESS_PROCESS_,
+                             &in, &data_size, out, out_size)) )
+      return false;
+  }
+  return true;
+}
+
+
+/**
+ * Compress all data of the response with the data in memory.
+ *
+ * @param response the response to use
+ * @param coding the coding to use
+ * @param[out] buf set to the malloc'ed compressed data
+ * @param[out] buf_size set to the size of the compressed data
+ * @return 1 on success,
+ *         0 if the compressed data is not smaller than the original data
+ *           or the compression failed,
+ *         -1 if memory allocation failed
+ */
+static int
+compress_data_ (struct MHD_Response *response,
+                enum MHD_ContentCoding_ coding,
+                char **buf,
+                size_t *buf_size)
+{
+  const size_t data_size = (size_t) response->total_size;
+  struct MHD_Encoder_ enc;
+  uint8_t *out_buf;
+  uint8_t *out;
+  size_t out_size;
+  const uint8_t *in;
+  size_t in_size;
+  bool ok;
+  int res;
+
+  mhd_assert (NULL == response->crc);
+  mhd_assert (response->total_size == (uint64_t) data_size);
+  /* The compressed data larger than the original data is useless */
+  out_buf = (uint8_t *) malloc (data_size);
+  if (NULL == out_buf)
+    return -1;
+  if (! encoder_init_ (&enc, coding, true))
+  {
+    free (out_buf);
+    return -1;
+  }
+  out = out_buf;
+  out_size = data_size;
+  if (NULL != response->data_iov)
+  {
+    unsigned int i;
+
+    ok = true;
+    for (i = 0; ok && (i < response->data_iovcnt); i++)
+      ok = encoder_feed_ (&enc,
+                          response->data_iov[i].iov_base,
+                          (size_t) response->data_iov[i].iov_len,
+                          &out, &out_size);
+  }
+  else
+    ok = encoder_feed_ (&enc,
+                        response->data,
+                        response->data_size,
+                        &out, &out_size);
+  res = 0;
+  in = NULL;
+  in_size = 0;
+  while (ok && (0 == res))
+  {
+    if (0 == out_size)
+      ok = false;
+    else
+    {
+      res = encoder_run_ (&enc, MHD_COMPRESS_FINISH_,
+                          &in, &in_size, &out, &out_size);
+      if ( (0 > res) ||
+           ((0 == res) && (0 != out_size)) )
+        ok = false;
+    }
+  }
+  encoder_deinit_ (&enc);
+  if (! ok)
+  {
+    free (out_buf);
+    return 0;
+  }
+  *buf_size = data_size - out_size;
+  *buf = (char *) realloc (out_buf, *buf_size);
+  if (NULL == *buf)
+    *buf = (char *) out_buf; /* Shrinking failed, use the larger buffer */
+  return 1;
+}
+
+
+/**
+ * Add the "ETag" header to the variant of the response.
+ * The name of the coding is added to the entity tag, so the variants
+ * with the different codings have the different tags.
+ *
+ * @param variant the variant to use
+ * @param etag the "ETag" header of the original response
+ * @param coding the coding used by the @a variant
+ * @return 'true' on success, 'false' if memory allocation failed
+ */
+static bool
+add_variant_etag_ (struct MHD_Response *variant,
+                   const struct MHD_HTTP_Res_Header *etag,
+                   enum MHD_ContentCoding_ coding)
+{
+  const char *const name = coding_name_ (coding);
+  const size_t name_len = strlen (name);
+  size_t tag_len;
+  size_t val_len;
+  char *val;
+  bool ret;
+
+  /* Insert "-coding" before the closing quote of the entity tag */
+  tag_len = etag->value_size;
+  if ( (0 != tag_len) &&
+       ('"' == etag->value[tag_len - 1]) )
+    tag_len--;
+  val_len = etag->value_size + 1 + name_len;
+  val = (char *) malloc (val_len);
+  if (NULL == val)
+    return false;
+  memcpy (val, etag->value, tag_len);
+  val[tag_len] = '-';
+  memcpy (val + tag_len + 1, name, name_len);
+  memcpy (val + tag_len + 1 + name_len, etag->value + tag_len,
+          etag->value_size - tag_len);
+  ret = MHD_add_response_entry_no_check_ (variant,
+                                          MHD_HEADER_KIND,
+                                          etag->header,
+                                          etag->header_size,
+                                          val,
+                                          val_len);
+  free (val);
+  return ret;
+}
+
+
+/**
+ * Copy the headers and the flags of the response to its variant and
+ * add the "Content-Encoding" header.
+ * The "Content-Length" header is not copied, the coding is added to
+ * the "ETag" header.
+ *
+ * @param variant the variant to use
+ * @param response the original response
+ * @param coding the coding used by the @a variant
+ * @return 'true' on success, 'false' if memory allocation failed
+ */
+static bool
+copy_headers_ (struct MHD_Response *variant,
+               struct MHD_Response *response,
+               enum MHD_ContentCoding_ coding)
+{
+  const char *const name = coding_name_ (coding);
+  struct MHD_HTTP_Res_Header *pos;
+
+  variant->flags = (enum MHD_ResponseFlags)
+                   (response->flags & ~((unsigned int) MHD_RF_COMPRESS));
+  variant->flags_auto = (enum MHD_ResponseAutoFlags)
+                        (response->flags_auto
+                         & ~((unsigned int) MHD_RAF_HAS_CONTENT_LENGTH));
+  for (pos = response->first_header; NULL != pos; pos = pos->next)
+  {
+    if ( (MHD_HEADER_KIND == pos->kind) &&
+         MHD_str_equal_caseless_bin_n_ (pos->header,
+                                        MHD_HTTP_HEADER_CONTENT_LENGTH,
+                                        pos->header_size) &&
+         (MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_LENGTH) ==
+          pos->header_size) )
+      continue;
+    if ( (MHD_HEADER_KIND == pos->kind) &&
+         (MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_ETAG) == pos->header_size) &&
+         MHD_str_equal_caseless_bin_n_ (pos->header,
+                                        MHD_HTTP_HEADER_ETAG,
+                                        pos->header_size) )
+    {
+      if (! add_variant_etag_ (variant, pos, coding))
+        return false;
+      continue;
+    }
+    if (! MHD_add_response_entry_no_check_ (variant,
+                                            pos->kind,
+                                            pos->header,
+                                            pos->header_size,
+                                            pos->value,
+                                            pos->value_size))
+      return false;
+  }
+  return MHD_add_response_entry_no_check_ (variant,
+                                           MHD_HEADER_KIND,
+                                           MHD_HTTP_HEADER_CONTENT_ENCODING,
+                                           MHD_STATICSTR_LEN_ ( \
+                                             MHD_HTTP_HEADER_CONTENT_ENCODING),
+                                           name,
+                                           strlen (name));
+}
+
+
+/**
+ * Get the compressed variant of the response with the data in memory.
+ * The data is compressed on the first call for the @a coding, the
+ * variant is kept with the response.
+ *
+ * @param response the response to use
+ * @param coding the coding to use
+ * @return the variant with the incremented reference counter,
+ *         NULL if the compression is not useful or failed
+ */
+static struct MHD_Response *
+get_cached_variant_ (struct MHD_Response *response,
+                     enum MHD_ContentCoding_ coding)
+{
+  struct MHD_Response *variant;
+
+  /* The data is compressed under the lock, the other connections wait
+   * for the result instead of compressing the same data. */
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&response->mutex);
+#endif
+  variant = response->compressed[coding];
+  if ( (NULL == variant) &&
+       (0 == (response->compress_useless & (1u << coding))) )
+  {
+    char *buf;
+    size_t buf_size;
+    int res;
+
+    res = compress_data_ (response, coding, &buf, &buf_size);
+    if (0 == res)
+      response->compress_useless |= (1u << coding);
+    else if (0 < res)
+    {
+      variant =
+        MHD_create_response_from_buffer_with_free_callback_cls (buf_size,
+                                                                buf,
+                                                                &free,
+                                                                buf);
+      if (NULL == variant)
+        free (buf);
+      else if (! copy_headers_ (variant, response, coding))
+      {
+        MHD_destroy_response (variant);
+        variant = NULL;
+      }
+      response->compressed[coding] = variant;
+    }
+  }
+  if (NULL != variant)
+    MHD_increment_response_rc (variant);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&response->mutex);
+#endif
+  return variant;
+}
+
+
+/**
+ * Read the next part of the source data.
+ *
+ * @param cs the compression state to use
+ * @return the number of bytes read,
+ *         or the return value of the #MHD_ContentReaderCallback
+ */
+static ssize_t
+read_source_ (struct MHD_CompressStream_ *cs)
+{
+  struct MHD_Response *const src = cs->src;
+  size_t size = sizeof (cs->in_buf);
+  ssize_t res;
+
+  if (MHD_SIZE_UNKNOWN != src->total_size)
+  {
+    if (src->total_size <= cs->src_pos)
+      return MHD_CONTENT_READER_END_OF_STREAM;
+    if (src->total_size - cs->src_pos < size)
+      size = (size_t) (src->total_size - cs->src_pos);
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&src->mutex);
+#endif
+  res = src->crc (src->crc_cls,
+                  cs->src_pos,
+                  (char *) cs->in_buf,
+                  size);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&src->mutex);
+#endif
+  if ( (0 < res) &&
+       (size < (size_t) res) )
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  return res;
+}
+
+
+/**
+ * The reader of the response compressed on-the-fly.
+ *
+ * @param cls the compression state
+ * @param pos the position in the compressed data, not used as the data
+ *            is produced sequentially
+ * @param buf where to copy the data
+ * @param max the maximum number of bytes to copy to @a buf
+ * @return the number of bytes written to @a buf,
+ *         or #MHD_CONTENT_READER_END_OF_STREAM,
+ *         or #MHD_CONTENT_READER_END_WITH_ERROR
+ */
+static ssize_t
+compress_stream_reader_ (void *cls,
+                         uint64_t pos,
+                         char *buf,
+                         size_t max)
+{
+  struct MHD_CompressStream_ *const cs = cls;
+  uint8_t *out = (uint8_t *) buf;
+  size_t out_size = max;
+  bool stalled = false;
+  (void) pos; /* Unused. Silent compiler warning. */
+
+  if (cs->finished)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  if (! cs->enc_ready)
+  {
+    if (! encoder_init_ (&cs->enc, cs->coding, false))
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    cs->enc_ready = true;
+  }
+  while (1)
+  {
+    enum MHD_CompressOp_ op;
+    int res;
+
+    if ( (0 == cs->in_size) &&
+         (! cs->src_eos) )
+    {
+      const ssize_t got = read_source_ (cs);
+
+      if (MHD_CONTENT_READER_END_OF_STREAM == got)
+        cs->src_eos = true;
+      else if (0 > got)
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+      else if (0 == got)
+        stalled = true;
+      else
+      {
+        cs->in = cs->in_buf;
+        cs->in_size = (size_t) got;
+        cs->src_pos += (uint64_t) got;
+      }
+    }
+    if (cs->src_eos)
+      op = MHD_COMPRESS_FINISH_;
+    else if (stalled)
+      op = MHD_COMPRESS_FLUSH_; /* Send the data available so far */
+    else
+      op = MHD_COMPRESS_PROCESS_;
+    res = encoder_run_ (&cs->enc, op,
+                        &cs->in, &cs->in_size,
+                        &out, &out_size);
+    if (0 > res)
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    if (0 < res)
+    {
+      cs->finished = true;
+      break;
+    }
+    if ( (0 == out_size) ||
+         stalled ||
+         cs->src_eos)
+      break;
+  }
+  if (max == out_size)
+  {
+    if (cs->finished)
+      return MHD_CONTENT_READER_END_OF_STREAM;
+    if (! stalled)
+      return MHD_CONTENT_READER_END_WITH_ERROR; /* No progress */
+  }
+  return (ssize_t) (max - out_size);
+}
+
+
+/**
+ * Free the state of the on-the-fly compression.
+ *
+ * @param cls the compression state
+ */
+static void
+compress_stream_free_ (void *cls)
+{
+  struct MHD_CompressStream_ *const cs = cls;
+
+  if (cs->enc_ready)
+    encoder_deinit_ (&cs->enc);
+  MHD_destroy_response (cs->src);
+  free (cs);
+}
+
+
+/**
+ * Create the variant of the response compressing the data on-the-fly.
+ *
+ * @param response the response to use
+ * @param coding the coding to use
+ * @return the new variant, NULL on error
+ */
+static struct MHD_Response *
+create_stream_variant_ (struct MHD_Response *response,
+                        enum MHD_ContentCoding_ coding)
+{
+  struct MHD_CompressStream_ *cs;
+  struct MHD_Response *variant;
+
+  cs = (struct MHD_CompressStream_ *)
+       malloc (sizeof (struct MHD_CompressStream_));
+  if (NULL == cs)
+    return NULL;
+  cs->coding = coding;
+  cs->src = response;
+  cs->src_pos = 0;
+  cs->in = cs->in_buf;
+  cs->in_size = 0;
+  cs->enc_ready = false;
+  cs->src_eos = false;
+  cs->finished = false;
+  MHD_increment_response_rc (response);
+  variant = MHD_create_response_from_callback (MHD_SIZE_UNKNOWN,
+                                               MHD_COMPRESS_OUT_BLOCK_SIZE_,
+                                               &compress_stream_reader_,
+                                               cs,
+                                               &compress_stream_free_);
+  if (NULL == variant)
+  {
+    compress_stream_free_ (cs);
+    return NULL;
+  }
+  if (! copy_headers_ (variant, response, coding))
+  {
+    MHD_destroy_response (variant);
+    return NULL;
+  }
+  return variant;
+}
+
+
+/**
+ * Parse the quality value of the "Accept-Encoding" element.
+ *
+ * @param str the value, not zero-terminated
+ * @param len the length of the @a str
+ * @return the value multiplied by 1000, zero if the value is not valid
+ */
+static int
+parse_qvalue_ (const char *str,
+               size_t len)
+{
+  int value;
+  int scale;
+  size_t i;
+
+  if ( (0 == len) ||
+       (('0' != str[0]) && ('1' != str[0])) )
+    return 0;
+  if ('1' == str[0])
+    return 1000;
+  value = 0;
+  if ( (1 < len) &&
+       ('.' == str[1]) )
+  {
+    scale = 100;
+    for (i = 2; (i < len) && (i < 5) && ('0' <= str[i]) && ('9' >= str[i]);
+         i++)
+    {
+      value += (str[i] - '0') * scale;
+      scale /= 10;
+    }
+  }
+  return value;
+}
+
+
+/**
+ * Select the coding for the reply from the "Accept-Encoding" request
+ * header.  The coding with the highest quality value is selected, the
+ * server preference is used for the codings with the same quality.
+ *
+ * @param connection the connection to use
+ * @param skip the bitmask of the codings to skip (already tried)
+ * @return the selected coding, #MHD_CODING_NUM_ if no coding is accepted
+ */
+static enum MHD_ContentCoding_
+select_coding_ (struct MHD_Connection *connection,
+                unsigned int skip)
+{
+  const char *acc;
+  size_t acc_len;
+  size_t pos;
+  int q[MHD_CODING_NUM_];
+  int q_any;
+  int best_q;
+  unsigned int i;
+  enum MHD_ContentCoding_ best;
+
+  if (MHD_NO == MHD_lookup_connection_value_n (connection,
+                                               MHD_HEADER_KIND,
+                                               MHD_HTTP_HEADER_ACCEPT_ENCODING,
+                                               MHD_STATICSTR_LEN_ ( \
+                                                 MHD_HTTP_HEADER_ACCEPT_ENCODING),
+                                               &acc,
+                                               &acc_len))
+    return MHD_CODING_NUM_;
+  for (i = 0; i < MHD_CODING_NUM_; i++)
+    q[i] = -1;
+  q_any = -1;
+  pos = 0;
+  while (pos < acc_len)
+  {
+    size_t tkn_start;
+    size_t tkn_len;
+    int qv;
+    int *dst;
+
+    while ( (pos < acc_len) &&
+            ((' ' == acc[pos]) || ('\t' == acc[pos]) || (',' == acc[pos])) )
+      pos++;
+    tkn_start = pos;
+    while ( (pos < acc_len) &&
+            (' ' != acc[pos]) && ('\t' != acc[pos]) &&
+            (',' != acc[pos]) && (';' != acc[pos]) )
+      pos++;
+    tkn_len = pos - tkn_start;
+    qv = 1000;
+    while ( (pos < acc_len) &&
+            (',' != acc[pos]) )
+    {
+      if (';' != acc[pos++])
+        continue;
+      while ( (pos < acc_len) &&
+              ((' ' == acc[pos]) || ('\t' == acc[pos])) )
+        pos++;
+      if ( (pos + 1 < acc_len) &&
+           (('q' == acc[pos]) || ('Q' == acc[pos])) &&
+           ('=' == acc[pos + 1]) )
+      {
+        pos += 2;
+        qv = parse_qvalue_ (acc + pos, acc_len - pos);
+      }
+    }
+    if (0 == tkn_len)
+      continue;
+    dst = NULL;
+    if ( (1 == tkn_len) &&
+         ('*' == acc[tkn_start]) )
+      dst = &q_any;
+    else if (MHD_str_equal_caseless_bin_n_ (acc + tkn_start, "gzip",
+                                            tkn_len) &&
+             (MHD_STATICSTR_LEN_ ("gzip") == tkn_len))
+      dst = q + MHD_CODING_GZIP_;
+    else if (MHD_str_equal_caseless_bin_n_ (acc + tkn_start, "x-gzip",
+                                            tkn_len) &&
+             (MHD_STATICSTR_LEN_ ("x-gzip") == tkn_len))
+      dst = q + MHD_CODING_GZIP_;
+    else if (MHD_str_equal_caseless_bin_n_ (acc + tkn_start, "deflate",
+                                            tkn_len) &&
+             (MHD_STATICSTR_LEN_ ("deflate") == tkn_len))
+      dst = q + MHD_CODING_DEFLATE_;
+#ifdef HAVE_BROTLI_ENCODER
+    else if (MHD_str_equal_caseless_bin_n_ (acc + tkn_start, "br",
+                                            tkn_len) &&
+             (MHD_STATICSTR_LEN_ ("br") == tkn_len))
+      dst = q + MHD_CODING_BR_;
+#endif /* HAVE_BROTLI_ENCODER */
+    if ( (NULL != dst) &&
+         (0 > *dst) )
+      *dst = qv; /* The first element is used */
+  }
+  best = MHD_CODING_NUM_;
+  best_q = 0;
+  for (i = 0; i < MHD_CODING_NUM_; i++)
+  {
+    const int qi = (0 <= q[i]) ? q[i] : q_any;
+
+    if (0 != (skip & (1u << i)))
+      continue;
+    if (qi > best_q)
+    {
+      best = (enum MHD_ContentCoding_) i;
+      best_q = qi;
+    }
+  }
+  return best;
+}
+
+
+/**
+ * Check whether the response can be compressed.
+ *
+ * @param response the response to check
+ * @return 'true' if the response could be compressed
+ */
+static bool
+is_compressible_ (struct MHD_Response *response)
+{
+  struct MHD_HTTP_Res_Header *hdr;
+
+#ifdef UPGRADE_SUPPORT
+  if (NULL != response->upgrade_handler)
+    return false;
+#endif /* UPGRADE_SUPPORT */
+  if (MHD_SIZE_UNKNOWN != response->total_size)
+  {
+    if (MHD_COMPRESS_MIN_SIZE_ > response->total_size)
+      return false;
+  }
+  else if (NULL == response->crc)
+    return false;
+  if (NULL != MHD_get_response_element_n_ (response,
+                                           MHD_HEADER_KIND,
+                                           MHD_HTTP_HEADER_CONTENT_ENCODING,
+                                           MHD_STATICSTR_LEN_ ( \
+                                             MHD_HTTP_HEADER_CONTENT_ENCODING)))
+    return false;
+  hdr = MHD_get_response_element_n_ (response,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_CACHE_CONTROL,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_CACHE_CONTROL));
+  if ( (NULL != hdr) &&
+       MHD_str_has_s_token_caseless_ (hdr->value, "no-transform") )
+    return false;
+  return true;
+}
+
+
+struct MHD_Response *
+MHD_compress_select_response_ (struct MHD_Connection *connection,
+                               struct MHD_Response *response)
+{
+  struct MHD_Response *variant;
+  enum MHD_ContentCoding_ coding;
+  unsigned int tried;
+
+  mhd_assert (0 != (MHD_RF_COMPRESS & response->flags));
+  variant = NULL;
+  if (is_compressible_ (response))
+  {
+    /* If the coding is not useful for the data (or failed), try the next
+       accepted coding before sending the data uncompressed */
+    tried = 0;
+    while (NULL == variant)
+    {
+      coding = select_coding_ (connection, tried);
+      if (MHD_CODING_NUM_ == coding)
+        break;
+      tried |= 1u << coding;
+      if (NULL == response->crc)
+        variant = get_cached_variant_ (response, coding);
+      else
+        variant = create_stream_variant_ (response, coding);
+    }
+  }
+  if (NULL == variant)
+  {
+    MHD_increment_response_rc (response);
+    return response;
+  }
+  return variant;
+}
+
+
+void
+MHD_compress_drop_variants_ (struct MHD_Response *response)
+{
+  unsigned int i;
+
+  for (i = 0; i < MHD_CODING_NUM_; i++)
+  {
+    if (NULL == response->compressed[i])
+      continue;
+    MHD_destroy_response (response->compressed[i]);
+    response->compressed[i] = NULL;
+  }
+  response->compress_useless = 0;
+}
+
+
+/* end of mhd_compress.c */
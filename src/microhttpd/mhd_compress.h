@@ -0,0 +1,68 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/mhd_compress.h
+ * @brief  automatic compression of the responses
+ * @author agent
+ *
+ * The compressed reply is sent by the separate response object
+ * ("variant") with the same headers as the original response plus
+ * the "Content-Encoding" header, the coding is added to the entity tag
+ * of the "ETag" header.  The variants of the responses with
+ * the data in memory are built once and kept with the original
+ * response, the variants of other responses compress the data
+ * on-the-fly and are created for every reply.
+ */
+
+#ifndef MHD_COMPRESS_H
+#define MHD_COMPRESS_H 1
+
+#include "internal.h"
+
+#ifdef COMPRESSION_SUPPORT
+
+/**
+ * Select the response to send to the client: the compressed variant
+ * of the @a response if the client accepts one of the supported
+ * codings and the compression is useful, or the @a response itself.
+ * The reference counter of the returned response is incremented.
+ *
+ * @param connection the connection to use
+ * @param response the response queued by the application, must have
+ *                 #MHD_RF_COMPRESS flag
+ * @return the response to send, never NULL
+ */
+struct MHD_Response *
+MHD_compress_select_response_ (struct MHD_Connection *connection,
+                               struct MHD_Response *response);
+
+
+/**
+ * Drop the cached compressed variants of the @a response.
+ * Called when the response is modified or destroyed.
+ *
+ * @param response the response to use
+ */
+void
+MHD_compress_drop_variants_ (struct MHD_Response *response);
+
+#endif /* COMPRESSION_SUPPORT */
+
+#endif /* ! MHD_COMPRESS_H */
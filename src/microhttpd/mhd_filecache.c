@@ -0,0 +1,607 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/mhd_filecache.c
+ * @brief  cache of the responses for the files
+ * @author agent
+ *
+ * The cache is a hash table with chaining, the entries are also linked
+ * in the list ordered by the last use.  The cache is protected by
+ * the single lock, the files are opened and checked without the lock.
+ */
+
+#include "mhd_options.h"
+#include "internal.h"
+#include "response.h"
+#include "connection.h"
+#include "mhd_mono_clock.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+#include "mhd_locks.h"
+#endif
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif /* HAVE_SYS_TYPES_H */
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif /* HAVE_SYS_STAT_H */
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h> /* for open(), close() */
+#endif /* _WIN32 */
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif /* ! O_BINARY */
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif /* ! O_CLOEXEC */
+
+/**
+ * The minimal number of the hash buckets, must be a power of two.
+ */
+#define MHD_FILECACHE_MIN_BUCKETS 16
+
+
+/**
+ * The cached file.
+ */
+struct MHD_FileCacheEntry_
+{
+  /**
+   * The next entry in the same hash bucket.
+   */
+  struct MHD_FileCacheEntry_ *next;
+
+  /**
+   * The more recently used entry.
+   */
+  struct MHD_FileCacheEntry_ *lru_prev;
+
+  /**
+   * The less recently used entry.
+   */
+  struct MHD_FileCacheEntry_ *lru_next;
+
+  /**
+   * The response for the file, one reference is held by the cache.
+   */
+  struct MHD_Response *response;
+
+  /**
+   * The time of the last check of the file, in milliseconds.
+   */
+  uint64_t last_check;
+
+  /**
+   * The size of the file.
+   */
+  uint64_t size;
+
+  /**
+   * The modification time of the file.
+   */
+  time_t mtime;
+
+  /**
+   * The inode of the file.
+   */
+  uint64_t ino;
+
+  /**
+   * The device of the file.
+   */
+  uint64_t dev;
+
+  /**
+   * The hash of the @e path.
+   */
+  uint32_t hash;
+
+  /**
+   * The length of the @e path.
+   */
+  size_t path_len;
+
+  /**
+   * The path of the file, allocated together with the entry.
+   */
+  char *path;
+};
+
+
+/**
+ * The cache of the responses for the files.
+ */
+struct MHD_FileCache
+{
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /**
+   * Protects all other members of the cache.
+   */
+  MHD_mutex_ lock;
+#endif
+
+  /**
+   * The hash buckets.
+   */
+  struct MHD_FileCacheEntry_ **buckets;
+
+  /**
+   * The number of the @e buckets, a power of two.
+   */
+  size_t num_buckets;
+
+  /**
+   * The number of the cached files.
+   */
+  size_t num_entries;
+
+  /**
+   * The maximum number of the cached files.
+   */
+  size_t max_entries;
+
+  /**
+   * The interval between the checks of the file, in milliseconds.
+   */
+  uint64_t check_interval;
+
+  /**
+   * The most recently used entry.
+   */
+  struct MHD_FileCacheEntry_ *lru_head;
+
+  /**
+   * The least recently used entry.
+   */
+  struct MHD_FileCacheEntry_ *lru_tail;
+};
+
+
+/**
+ * Calculate the hash of the path (FNV-1a).
+ *
+ * @param path the path to use
+ * @param[out] len set to the length of the @a path
+ * @return the hash value
+ */
+static uint32_t
+path_hash (const char *path,
+           size_t *len)
+{
+  uint32_t h = 2166136261U;
+  size_t i;
+
+  for (i = 0; 0 != path[i]; i++)
+  {
+    h ^= (uint8_t) path[i];
+    h *= 16777619U;
+  }
+  *len = i;
+  return h;
+}
+
+
+/**
+ * Find the entry for the path.
+ * Must be called with the cache lock held.
+ *
+ * @param cache the cache to use
+ * @param path the path of the file
+ * @param len the length of the @a path
+ * @param hash the hash of the @a path
+ * @return the entry, NULL if not found
+ */
+static struct MHD_FileCacheEntry_ *
+cache_find (struct MHD_FileCache *cache,
+            const char *path,
+            size_t len,
+            uint32_t hash)
+{
+  struct MHD_FileCacheEntry_ *e;
+
+  for (e = cache->buckets[hash & (cache->num_buckets - 1)];
+       NULL != e;
+       e = e->next)
+  {
+    if ( (hash == e->hash) &&
+         (len == e->path_len) &&
+         (0 == memcmp (path, e->path, len)) )
+      return e;
+  }
+  return NULL;
+}
+
+
+/**
+ * Move the entry to the head of the LRU list.
+ * Must be called with the cache lock held.
+ *
+ * @param cache the cache to use
+ * @param e the entry to move
+ * @param linked set to 'true' if the @a e is in the list already,
+ *               'false' to link the new entry
+ */
+static void
+lru_to_head (struct MHD_FileCache *cache,
+             struct MHD_FileCacheEntry_ *e,
+             bool linked)
+{
+  if (linked)
+  {
+    if (cache->lru_head == e)
+      return;
+    /* Unlink, the entry is not the head so it has the previous entry */
+    e->lru_prev->lru_next = e->lru_next;
+    if (NULL != e->lru_next)
+      e->lru_next->lru_prev = e->lru_prev;
+    else
+      cache->lru_tail = e->lru_prev;
+  }
+  e->lru_prev = NULL;
+  e->lru_next = cache->lru_head;
+  if (NULL != cache->lru_head)
+    cache->lru_head->lru_prev = e;
+  else
+    cache->lru_tail = e;
+  cache->lru_head = e;
+}
+
+
+/**
+ * Remove the entry from the cache.  The entry is not freed.
+ * Must be called with the cache lock held.
+ *
+ * @param cache the cache to use
+ * @param e the entry to remove
+ */
+static void
+cache_remove (struct MHD_FileCache *cache,
+              struct MHD_FileCacheEntry_ *e)
+{
+  struct MHD_FileCacheEntry_ **pp;
+
+  pp = &cache->buckets[e->hash & (cache->num_buckets - 1)];
+  while (e != *pp)
+  {
+    mhd_assert (NULL != *pp);
+    pp = &(*pp)->next;
+  }
+  *pp = e->next;
+  if (NULL != e->lru_prev)
+    e->lru_prev->lru_next = e->lru_next;
+  else
+    cache->lru_head = e->lru_next;
+  if (NULL != e->lru_next)
+    e->lru_next->lru_prev = e->lru_prev;
+  else
+    cache->lru_tail = e->lru_prev;
+  mhd_assert (0 != cache->num_entries);
+  cache->num_entries--;
+}
+
+
+/**
+ * Free the entry removed from the cache.
+ * Must be called without the cache lock held, as the file may be closed.
+ *
+ * @param e the entry to free, could be NULL
+ */
+static void
+entry_free (struct MHD_FileCacheEntry_ *e)
+{
+  if (NULL == e)
+    return;
+  MHD_destroy_response (e->response);
+  free (e);
+}
+
+
+/**
+ * Check whether the file metadata match the entry.
+ *
+ * @param e the entry to check
+ * @param st the metadata of the file
+ * @return 'true' if the file is not changed
+ */
+static bool
+entry_matches (const struct MHD_FileCacheEntry_ *e,
+               const struct stat *st)
+{
+  return (e->size == (uint64_t) st->st_size) &&
+         (e->mtime == st->st_mtime) &&
+         (e->ino == (uint64_t) st->st_ino) &&
+         (e->dev == (uint64_t) st->st_dev);
+}
+
+
+/**
+ * Open the file and create the new entry with the response.
+ *
+ * @param path the path of the file
+ * @param len the length of the @a path
+ * @param hash the hash of the @a path
+ * @return the new entry, NULL on error
+ */
+static struct MHD_FileCacheEntry_ *
+entry_create (const char *path,
+              size_t len,
+              uint32_t hash)
+{
+  struct MHD_FileCacheEntry_ *e;
+  struct stat st;
+  char etag[48];
+  char date[30];
+  int fd;
+
+  fd = open (path, O_RDONLY | O_BINARY | O_CLOEXEC);
+  if (-1 == fd)
+    return NULL;
+  if ( (0 != fstat (fd, &st)) ||
+       (! S_ISREG (st.st_mode)) ||
+       (0 > st.st_size) )
+  {
+    (void) close (fd);
+    return NULL;
+  }
+  e = (struct MHD_FileCacheEntry_ *) malloc (sizeof (*e) + len + 1);
+  if (NULL == e)
+  {
+    (void) close (fd);
+    return NULL;
+  }
+  e->response = MHD_create_response_from_fd64 ((uint64_t) st.st_size, fd);
+  if (NULL == e->response)
+  {
+    (void) close (fd);
+    free (e);
+    return NULL;
+  }
+  e->path = (char *) (e + 1);
+  memcpy (e->path, path, len + 1);
+  e->path_len = len;
+  e->hash = hash;
+  e->size = (uint64_t) st.st_size;
+  e->mtime = st.st_mtime;
+  e->ino = (uint64_t) st.st_ino;
+  e->dev = (uint64_t) st.st_dev;
+  e->next = NULL;
+  e->lru_prev = NULL;
+  e->lru_next = NULL;
+  e->last_check = MHD_monotonic_msec_counter ();
+
+  /* The same format as used by many other servers: mtime-size in hex */
+  (void) MHD_snprintf_ (etag, sizeof (etag), "\"%llx-%llx\"",
+                        (unsigned long long) st.st_mtime,
+                        (unsigned long long) st.st_size);
+  if (MHD_YES != MHD_add_response_header (e->response,
+                                          MHD_HTTP_HEADER_ETAG,
+                                          etag))
+  {
+    entry_free (e);
+    return NULL;
+  }
+  if (MHD_time_to_http_date_ (st.st_mtime, date))
+  {
+    date[29] = 0;
+    if (MHD_YES != MHD_add_response_header (e->response,
+                                            MHD_HTTP_HEADER_LAST_MODIFIED,
+                                            date))
+    {
+      entry_free (e);
+      return NULL;
+    }
+  }
+  return e;
+}
+
+
+_MHD_EXTERN struct MHD_FileCache *
+MHD_file_cache_create (size_t max_entries,
+                       unsigned int check_interval)
+{
+  struct MHD_FileCache *cache;
+  size_t buckets;
+
+  if (0 == max_entries)
+    return NULL;
+  buckets = MHD_FILECACHE_MIN_BUCKETS;
+  while ( (buckets < max_entries) &&
+          (buckets <= SIZE_MAX / 2 / sizeof (struct MHD_FileCacheEntry_ *)) )
+    buckets *= 2;
+  cache = (struct MHD_FileCache *) MHD_calloc_ (1, sizeof (*cache));
+  if (NULL == cache)
+    return NULL;
+  cache->buckets = (struct MHD_FileCacheEntry_ **)
+                   MHD_calloc_ (buckets, sizeof (struct MHD_FileCacheEntry_ *));
+  if (NULL == cache->buckets)
+  {
+    free (cache);
+    return NULL;
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  if (! MHD_mutex_init_ (&cache->lock))
+  {
+    free (cache->buckets);
+    free (cache);
+    return NULL;
+  }
+#endif
+  cache->num_buckets = buckets;
+  cache->max_entries = max_entries;
+  cache->check_interval = check_interval;
+  return cache;
+}
+
+
+_MHD_EXTERN struct MHD_Response *
+MHD_file_cache_get_response (struct MHD_FileCache *cache,
+                             const char *path)
+{
+  struct MHD_FileCacheEntry_ *e;
+  struct MHD_FileCacheEntry_ *old;
+  struct MHD_Response *r;
+  struct stat st;
+  uint64_t now;
+  size_t len;
+  uint32_t hash;
+  bool check;
+
+  hash = path_hash (path, &len);
+  now = MHD_monotonic_msec_counter ();
+  r = NULL;
+  check = false;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&cache->lock);
+#endif
+  e = cache_find (cache, path, len, hash);
+  if (NULL != e)
+  {
+    lru_to_head (cache, e, true);
+    r = e->response;
+    MHD_increment_response_rc (r);
+    if (now - e->last_check >= cache->check_interval)
+    {
+      /* Other threads use the entry without the check meanwhile */
+      check = true;
+      e->last_check = now;
+    }
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&cache->lock);
+#endif
+  if (! check)
+  {
+    if (NULL != r)
+      return r; /* The cached response is used without the check */
+  }
+  else
+  {
+    /* The entry could be removed from the cache by other thread while
+     * the lock is not held, the reference to the response is held so
+     * the response pointer identifies the entry. */
+    bool found;
+    bool same;
+
+    found = (0 == stat (path, &st));
+    old = NULL;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_lock_chk_ (&cache->lock);
+#endif
+    e = cache_find (cache, path, len, hash);
+    if ( (NULL != e) &&
+         (r != e->response) )
+      e = NULL;
+    same = found &&
+           (NULL != e) &&
+           entry_matches (e, &st);
+    if ( (! same) &&
+         (NULL != e) )
+    {
+      cache_remove (cache, e);
+      old = e;
+    }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_unlock_chk_ (&cache->lock);
+#endif
+    if (same)
+      return r;
+    MHD_destroy_response (r);
+    entry_free (old);
+    if (! found)
+      return NULL;
+  }
+
+  e = entry_create (path, len, hash);
+  if (NULL == e)
+    return NULL;
+  r = e->response;
+  MHD_increment_response_rc (r);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&cache->lock);
+#endif
+  /* The same file could be added by other thread meanwhile,
+   * the newly opened file replaces it */
+  old = cache_find (cache, path, len, hash);
+  if (NULL != old)
+    cache_remove (cache, old);
+  else if (cache->num_entries >= cache->max_entries)
+  {
+    old = cache->lru_tail;
+    mhd_assert (NULL != old);
+    cache_remove (cache, old);
+  }
+  e->next = cache->buckets[hash & (cache->num_buckets - 1)];
+  cache->buckets[hash & (cache->num_buckets - 1)] = e;
+  lru_to_head (cache, e, false);
+  cache->num_entries++;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&cache->lock);
+#endif
+  entry_free (old);
+  return r;
+}
+
+
+_MHD_EXTERN void
+MHD_file_cache_invalidate (struct MHD_FileCache *cache,
+                           const char *path)
+{
+  struct MHD_FileCacheEntry_ *e;
+  size_t len;
+  uint32_t hash;
+
+  hash = path_hash (path, &len);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&cache->lock);
+#endif
+  e = cache_find (cache, path, len, hash);
+  if (NULL != e)
+    cache_remove (cache, e);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&cache->lock);
+#endif
+  entry_free (e);
+}
+
+
+_MHD_EXTERN void
+MHD_file_cache_destroy (struct MHD_FileCache *cache)
+{
+  struct MHD_FileCacheEntry_ *e;
+
+  if (NULL == cache)
+    return;
+  while (NULL != (e = cache->lru_head))
+  {
+    cache_remove (cache, e);
+    entry_free (e);
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_destroy_chk_ (&cache->lock);
+#endif
+  free (cache->buckets);
+  free (cache);
+}
+
+
+/* end of mhd_filecache.c */
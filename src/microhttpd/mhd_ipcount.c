@@ -0,0 +1,514 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/mhd_ipcount.c
+ * @brief  per-IP connection counting table implementation
+ * @author agent
+ */
+
+#include "mhd_ipcount.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mhd_panic.h"
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+#include "mhd_locks.h"
+#endif
+#include "mhd_assert.h"
+#include "mhd_align.h"
+
+/**
+ * Number of stripes in the table, must be a power of two.
+ */
+#define MHD_IPCOUNT_STRIPES 16
+
+/**
+ * Number of bits used to select the stripe.
+ */
+#define MHD_IPCOUNT_STRIPES_BITS 4
+
+/**
+ * The minimal number of slots in one stripe, must be a power of two.
+ */
+#define MHD_IPCOUNT_MIN_SLOTS 16
+
+/**
+ * The maximal initial number of slots in one stripe, must be a power
+ * of two.  The stripes grow when more addresses are tracked.
+ */
+#define MHD_IPCOUNT_MAX_INIT_SLOTS 256
+
+/**
+ * The size of the padded stripe, used to keep the locks of different
+ * stripes in different CPU cache lines.
+ */
+#define MHD_IPCOUNT_STRIPE_PAD 128
+
+/**
+ * The number of bytes of #MHD_IPCount used as the key.
+ */
+#define MHD_IPCOUNT_KEY_SIZE _MHD_OFFSETOF (struct MHD_IPCount, count)
+
+
+/**
+ * One independently locked part of the table.
+ */
+struct MHD_IPCountStripe
+{
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /**
+   * Protects all other members of the stripe.
+   */
+  MHD_mutex_ lock;
+#endif
+
+  /**
+   * The array of the slots, slots with zero count are unused.
+   */
+  struct MHD_IPCount *slots;
+
+  /**
+   * The number of slots minus one.
+   */
+  uint32_t mask;
+
+  /**
+   * The number of used slots.
+   */
+  uint32_t used;
+
+  /**
+   * The maximum number of used slots.
+   */
+  uint32_t max_used;
+};
+
+
+/**
+ * The stripe padded to the size of #MHD_IPCOUNT_STRIPE_PAD.
+ */
+union MHD_IPCountStripePadded
+{
+  struct MHD_IPCountStripe s;
+  char pad[MHD_IPCOUNT_STRIPE_PAD];
+};
+
+
+/**
+ * The table of per-IP connection counters.
+ */
+struct MHD_IPCountTable
+{
+  /**
+   * The stripes.
+   */
+  union MHD_IPCountStripePadded stripes[MHD_IPCOUNT_STRIPES];
+};
+
+
+/**
+ * Calculate the hash of the key.
+ * FNV-1a with final mixing, so both low bits (used for slot
+ * selection) and high bits (used for stripe selection) are
+ * well distributed.
+ *
+ * @param key the key to hash
+ * @return the hash value
+ */
+static uint32_t
+ipcount_hash (const struct MHD_IPCount *key)
+{
+  const uint8_t *p = (const uint8_t *) key;
+  uint32_t h = 2166136261U;
+  size_t i;
+
+  for (i = 0; i < MHD_IPCOUNT_KEY_SIZE; ++i)
+  {
+    h ^= p[i];
+    h *= 16777619U;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+  return h;
+}
+
+
+/**
+ * Check whether two keys are equal.
+ *
+ * @param k1 the first key
+ * @param k2 the second key
+ * @return 'true' if keys are equal
+ */
+static bool
+ipcount_key_eq (const struct MHD_IPCount *k1,
+                const struct MHD_IPCount *k2)
+{
+  return 0 == memcmp (k1,
+                      k2,
+                      MHD_IPCOUNT_KEY_SIZE);
+}
+
+
+/**
+ * Parse address and initialize @a key using the address.
+ *
+ * @param addr address to parse
+ * @param addrlen number of bytes in @a addr
+ * @param key where to store the parsed address
+ * @return 'true' on success and 'false' otherwise (e.g., invalid
+ *         address type)
+ */
+bool
+MHD_ip_addr_to_key (const struct sockaddr *addr,
+                    socklen_t addrlen,
+                    struct MHD_IPCount *key)
+{
+  memset (key,
+          0,
+          sizeof(*key));
+
+  /* IPv4 addresses */
+  if (sizeof (struct sockaddr_in) <= (size_t) addrlen)
+  {
+    if (AF_INET == addr->sa_family)
+    {
+      key->family = AF_INET;
+      memcpy (&key->addr.ipv4,
+              ((const uint8_t *) addr)
+              + _MHD_OFFSETOF (struct sockaddr_in, sin_addr),
+              sizeof(((struct sockaddr_in *) NULL)->sin_addr));
+      return true;
+    }
+  }
+
+#ifdef HAVE_INET6
+  if (sizeof (struct sockaddr_in6) <= (size_t) addrlen)
+  {
+    /* IPv6 addresses */
+    if (AF_INET6 == addr->sa_family)
+    {
+      key->family = AF_INET6;
+      memcpy (&key->addr.ipv6,
+              ((const uint8_t *) addr)
+              + _MHD_OFFSETOF (struct sockaddr_in6, sin6_addr),
+              sizeof(((struct sockaddr_in6 *) NULL)->sin6_addr));
+      return true;
+    }
+  }
+#endif
+
+  /* Some other address */
+  return false;
+}
+
+
+/**
+ * Create new table for per-IP connection counters.
+ *
+ * @param max_addrs the expected number of distinct addresses tracked
+ *                  at the same time, typically the global connection
+ *                  limit; used to choose the initial size of the table
+ * @return the new table on success, NULL if failed to allocate memory
+ *         or to initialise locks
+ */
+struct MHD_IPCountTable *
+MHD_ipcount_table_create (unsigned int max_addrs)
+{
+  struct MHD_IPCountTable *table;
+  uint32_t slots;
+  uint32_t want;
+  unsigned int i;
+
+  mhd_assert (sizeof(struct MHD_IPCountStripe) <= MHD_IPCOUNT_STRIPE_PAD);
+  /* Twice the average number of addresses per stripe, so the table
+     never gets more than half-full when addresses are evenly spread.
+     The initial size is limited, as the connection limit could be
+     huge; the stripes grow on demand. */
+  want = (uint32_t) (((uint64_t) max_addrs * 2 + MHD_IPCOUNT_STRIPES - 1)
+                     / MHD_IPCOUNT_STRIPES);
+  slots = MHD_IPCOUNT_MIN_SLOTS;
+  while ( (slots < want) &&
+          (slots < MHD_IPCOUNT_MAX_INIT_SLOTS) )
+    slots <<= 1;
+
+  table = (struct MHD_IPCountTable *) malloc (sizeof(*table));
+  if (NULL == table)
+    return NULL;
+  for (i = 0; i < MHD_IPCOUNT_STRIPES; ++i)
+  {
+    struct MHD_IPCountStripe *const s = &table->stripes[i].s;
+
+    s->slots = (struct MHD_IPCount *) calloc (slots,
+                                              sizeof(struct MHD_IPCount));
+    if (NULL == s->slots)
+      break;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    if (! MHD_mutex_init_ (&s->lock))
+    {
+      free (s->slots);
+      break;
+    }
+#endif
+    s->mask = slots - 1;
+    s->used = 0;
+    /* Keep at least a quarter of the slots free to limit probing */
+    s->max_used = slots - (slots / 4);
+  }
+  if (MHD_IPCOUNT_STRIPES != i)
+  {
+    while (0 != i--)
+    {
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+      MHD_mutex_destroy_chk_ (&table->stripes[i].s.lock);
+#endif
+      free (table->stripes[i].s.slots);
+    }
+    free (table);
+    return NULL;
+  }
+  return table;
+}
+
+
+/**
+ * Destroy the table created by #MHD_ipcount_table_create().
+ *
+ * @param table the table to destroy, could be NULL
+ */
+void
+MHD_ipcount_table_destroy (struct MHD_IPCountTable *table)
+{
+  unsigned int i;
+
+  if (NULL == table)
+    return;
+  for (i = 0; i < MHD_IPCOUNT_STRIPES; ++i)
+  {
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_destroy_chk_ (&table->stripes[i].s.lock);
+#endif
+    free (table->stripes[i].s.slots);
+  }
+  free (table);
+}
+
+
+/**
+ * Get the stripe for the hash value.
+ *
+ * @param table the table to use
+ * @param hash the hash value of the key
+ * @return the stripe
+ */
+static struct MHD_IPCountStripe *
+ipcount_get_stripe (struct MHD_IPCountTable *table,
+                    uint32_t hash)
+{
+  return &table->stripes[hash >> (32 - MHD_IPCOUNT_STRIPES_BITS)].s;
+}
+
+
+/**
+ * Double the number of slots in the stripe.
+ * Must be called with the stripe locked.
+ *
+ * @param s the stripe to grow
+ * @return 'true' on success,
+ *         'false' if failed to allocate memory
+ */
+static bool
+ipcount_stripe_grow (struct MHD_IPCountStripe *s)
+{
+  struct MHD_IPCount *new_slots;
+  uint32_t new_mask;
+  uint32_t i;
+
+  if ((UINT32_MAX / 2) < s->mask)
+    return false;
+  new_mask = s->mask * 2 + 1;
+  new_slots = (struct MHD_IPCount *) calloc ((size_t) new_mask + 1,
+                                             sizeof(struct MHD_IPCount));
+  if (NULL == new_slots)
+    return false;
+  for (i = 0; i <= s->mask; ++i)
+  {
+    uint32_t j;
+
+    if (0 == s->slots[i].count)
+      continue;
+    j = ipcount_hash (&s->slots[i]) & new_mask;
+    while (0 != new_slots[j].count)
+      j = (j + 1) & new_mask;
+    new_slots[j] = s->slots[i];
+  }
+  free (s->slots);
+  s->slots = new_slots;
+  s->mask = new_mask;
+  s->max_used = (new_mask + 1) - ((new_mask + 1) / 4);
+  return true;
+}
+
+
+/**
+ * Increment the counter for the address in @a key if the counter
+ * is below @a limit.
+ * Thread-safe.
+ *
+ * @param table the table to use
+ * @param key the key initialised by #MHD_ip_addr_to_key()
+ * @param limit the maximum allowed value of the counter
+ * @return #MHD_IPCOUNT_OK if counter was incremented,
+ *         error code otherwise
+ */
+enum MHD_IPCountResult
+MHD_ipcount_add (struct MHD_IPCountTable *table,
+                 const struct MHD_IPCount *key,
+                 unsigned int limit)
+{
+  const uint32_t hash = ipcount_hash (key);
+  struct MHD_IPCountStripe *const s = ipcount_get_stripe (table,
+                                                          hash);
+  enum MHD_IPCountResult res;
+  uint32_t i;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&s->lock);
+#endif
+  i = hash & s->mask;
+  while ( (0 != s->slots[i].count) &&
+          (! ipcount_key_eq (&s->slots[i],
+                             key)) )
+    i = (i + 1) & s->mask;
+
+  if (0 != s->slots[i].count)
+  {
+    if (s->slots[i].count < limit)
+    {
+      s->slots[i].count++;
+      res = MHD_IPCOUNT_OK;
+    }
+    else
+      res = MHD_IPCOUNT_LIMIT;
+  }
+  else if (0 == limit)
+    res = MHD_IPCOUNT_LIMIT;
+  else
+  {
+    res = MHD_IPCOUNT_OK;
+    if (s->used >= s->max_used)
+    {
+      if (ipcount_stripe_grow (s))
+      { /* The stripe has been re-hashed, find the free slot again */
+        i = hash & s->mask;
+        while (0 != s->slots[i].count)
+          i = (i + 1) & s->mask;
+      }
+      else
+        res = MHD_IPCOUNT_FULL;
+    }
+    if (MHD_IPCOUNT_OK == res)
+    {
+      memcpy (&s->slots[i],
+              key,
+              MHD_IPCOUNT_KEY_SIZE);
+      s->slots[i].count = 1;
+      s->used++;
+    }
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&s->lock);
+#endif
+  return res;
+}
+
+
+/**
+ * Decrement the counter for the address in @a key, the slot is
+ * released when counter reaches zero.
+ * Thread-safe.
+ *
+ * @param table the table to use
+ * @param key the key initialised by #MHD_ip_addr_to_key()
+ * @return 'true' if counter was decremented,
+ *         'false' if address was not found in the table
+ */
+bool
+MHD_ipcount_del (struct MHD_IPCountTable *table,
+                 const struct MHD_IPCount *key)
+{
+  const uint32_t hash = ipcount_hash (key);
+  struct MHD_IPCountStripe *const s = ipcount_get_stripe (table,
+                                                          hash);
+  uint32_t i;
+  uint32_t j;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&s->lock);
+#endif
+  i = hash & s->mask;
+  while ( (0 != s->slots[i].count) &&
+          (! ipcount_key_eq (&s->slots[i],
+                             key)) )
+    i = (i + 1) & s->mask;
+
+  if (0 == s->slots[i].count)
+  {
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_unlock_chk_ (&s->lock);
+#endif
+    return false;
+  }
+  if (0 == --s->slots[i].count)
+  {
+    /* Release the slot.  Instead of leaving a tombstone, shift back
+       the following entries of the probe sequence that would become
+       unreachable otherwise. */
+    j = i;
+    while (1)
+    {
+      uint32_t home;
+
+      j = (j + 1) & s->mask;
+      if (0 == s->slots[j].count)
+        break;
+      home = ipcount_hash (&s->slots[j]) & s->mask;
+      /* Move the entry if its home slot is not within (i, j] */
+      if ( (i < j) ?
+           ((home <= i) || (home > j)) :
+           ((home <= i) && (home > j)) )
+      {
+        s->slots[i] = s->slots[j];
+        i = j;
+      }
+    }
+    memset (&s->slots[i],
+            0,
+            sizeof(s->slots[i]));
+    s->used--;
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&s->lock);
+#endif
+  return true;
+}
@@ -0,0 +1,172 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/mhd_ipcount.h
+ * @brief  per-IP connection counting table declarations
+ * @author agent
+ */
+
+#ifndef MHD_IPCOUNT_H
+#define MHD_IPCOUNT_H 1
+
+#include "mhd_options.h"
+#include "mhd_sockets.h"
+#ifdef HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif /* HAVE_STDBOOL_H */
+
+/**
+ * Maintain connection count for single address.
+ */
+struct MHD_IPCount
+{
+  /**
+   * Address family. AF_INET or AF_INET6 for now.
+   */
+  int family;
+
+  /**
+   * Actual address.
+   */
+  union
+  {
+    /**
+     * IPv4 address.
+     */
+    struct in_addr ipv4;
+#ifdef HAVE_INET6
+    /**
+     * IPv6 address.
+     */
+    struct in6_addr ipv6;
+#endif
+  } addr;
+
+  /**
+   * Counter.
+   * Zero for unused slots of the table.
+   */
+  unsigned int count;
+};
+
+
+/**
+ * Opaque handle for the table of per-IP connection counters.
+ *
+ * The table is split into fixed number of independently locked
+ * stripes, each stripe is an open-addressing hash table.  A stripe
+ * is grown when it gets filled, so the number of tracked addresses
+ * is limited only by the available memory.
+ */
+struct MHD_IPCountTable;
+
+
+/**
+ * The result of #MHD_ipcount_add().
+ */
+enum MHD_IPCountResult
+{
+  /**
+   * The counter has been incremented.
+   */
+  MHD_IPCOUNT_OK = 0,
+
+  /**
+   * The address has reached the limit, the counter was not changed.
+   */
+  MHD_IPCOUNT_LIMIT = 1,
+
+  /**
+   * Failed to allocate memory for new address, the counter was not
+   * changed.
+   */
+  MHD_IPCOUNT_FULL = 2
+};
+
+
+/**
+ * Parse address and initialize @a key using the address.
+ *
+ * @param addr address to parse
+ * @param addrlen number of bytes in @a addr
+ * @param key where to store the parsed address
+ * @return 'true' on success and 'false' otherwise (e.g., invalid
+ *         address type)
+ */
+bool
+MHD_ip_addr_to_key (const struct sockaddr *addr,
+                    socklen_t addrlen,
+                    struct MHD_IPCount *key);
+
+
+/**
+ * Create new table for per-IP connection counters.
+ *
+ * @param max_addrs the expected number of distinct addresses tracked
+ *                  at the same time, typically the global connection
+ *                  limit; used to choose the initial size of the table
+ * @return the new table on success, NULL if failed to allocate memory
+ *         or to initialise locks
+ */
+struct MHD_IPCountTable *
+MHD_ipcount_table_create (unsigned int max_addrs);
+
+
+/**
+ * Destroy the table created by #MHD_ipcount_table_create().
+ *
+ * @param table the table to destroy, could be NULL
+ */
+void
+MHD_ipcount_table_destroy (struct MHD_IPCountTable *table);
+
+
+/**
+ * Increment the counter for the address in @a key if the counter
+ * is below @a limit.
+ * Thread-safe.
+ *
+ * @param table the table to use
+ * @param key the key initialised by #MHD_ip_addr_to_key()
+ * @param limit the maximum allowed value of the counter
+ * @return #MHD_IPCOUNT_OK if counter was incremented,
+ *         error code otherwise
+ */
+enum MHD_IPCountResult
+MHD_ipcount_add (struct MHD_IPCountTable *table,
+                 const struct MHD_IPCount *key,
+                 unsigned int limit);
+
+
+/**
+ * Decrement the counter for the address in @a key, the slot is
+ * released when counter reaches zero.
+ * Thread-safe.
+ *
+ * @param table the table to use
+ * @param key the key initialised by #MHD_ip_addr_to_key()
+ * @return 'true' if counter was decremented,
+ *         'false' if address was not found in the table
+ */
+bool
+MHD_ipcount_del (struct MHD_IPCountTable *table,
+                 const struct MHD_IPCount *key);
+
+#endif /* ! MHD_IPCOUNT_H */
@@ -0,0 +1,360 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/mhd_offload.c
+ * @brief  the pool of threads for the blocking tasks of the requests
+ * @author agent
+ */
+
+#include "mhd_offload.h"
+#include "mhd_threads.h"
+#include "mhd_locks.h"
+#include "mhd_itc.h"
+#include "mhd_sockets.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+
+
+/**
+ * The pool of threads for the blocking tasks.
+ */
+struct MHD_OffloadPool
+{
+  /**
+   * The master daemon, used for logging.
+   */
+  struct MHD_Daemon *daemon;
+
+  /**
+   * Head of the queue of the connections with the tasks.
+   * The connections are linked by @e next_offload member.
+   */
+  struct MHD_Connection *head;
+
+  /**
+   * Tail of the queue of the connections with the tasks.
+   */
+  struct MHD_Connection *tail;
+
+  /**
+   * The lock for the queue and @e stopped flag.
+   */
+  MHD_mutex_ lock;
+
+  /**
+   * The ITC to wake up the threads, active while the queue is not empty
+   * or the pool is stopped.
+   */
+  struct MHD_itc_ itc;
+
+  /**
+   * The threads of the pool.
+   */
+  MHD_thread_handle_ID_ *threads;
+
+  /**
+   * The number of running threads in @e threads.
+   */
+  unsigned int num_threads;
+
+  /**
+   * Set to 'true' when the pool is stopped.
+   */
+  bool stopped;
+};
+
+
+/**
+ * Wait until the pool's ITC is active.
+ *
+ * @param pool the pool to use
+ * @return 'true' if the wait is finished or interrupted by a signal,
+ *         'false' on unrecoverable error
+ */
+static bool
+offload_wait (struct MHD_OffloadPool *pool)
+{
+#ifdef HAVE_POLL
+  struct pollfd p[1];
+
+  p[0].events = POLLIN;
+  p[0].fd = MHD_itc_r_fd_ (pool->itc);
+  p[0].revents = 0;
+  if (0 > MHD_sys_poll_ (p,
+                         1,
+                         -1))
+  {
+    if (MHD_SCKT_LAST_ERR_IS_ (MHD_SCKT_EINTR_))
+      return true;
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (pool->daemon,
+              _ ("Error during poll: `%s'\n"),
+              MHD_socket_last_strerr_ ());
+#endif
+    return false;
+  }
+#else  /* ! HAVE_POLL */
+  fd_set rs;
+
+  FD_ZERO (&rs);
+  if (! MHD_add_to_fd_set_ (MHD_itc_r_fd_ (pool->itc),
+                            &rs,
+                            NULL,
+                            FD_SETSIZE))
+    MHD_PANIC (_ ("Failed to add FD to fd_set.\n"));
+  if (0 > MHD_SYS_select_ (MHD_itc_r_fd_ (pool->itc) + 1,
+                           &rs,
+                           NULL,
+                           NULL,
+                           NULL))
+  {
+    const int err = MHD_socket_get_error_ ();
+
+    if (MHD_SCKT_ERR_IS_EINTR_ (err))
+      return true;
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (pool->daemon,
+              _ ("Error during select (%d): `%s'\n"),
+              err,
+              MHD_socket_strerr_ (err));
+#endif
+    return false;
+  }
+#endif /* ! HAVE_POLL */
+  return true;
+}
+
+
+/**
+ * Mark the pool as stopped and wake up all its threads.
+ * The new tasks are rejected, the queued tasks are still processed.
+ * Must be called with the pool's lock held.
+ *
+ * @param pool the pool to stop
+ */
+static void
+offload_set_stopped (struct MHD_OffloadPool *pool)
+{
+  if (pool->stopped)
+    return;
+  pool->stopped = true;
+  if (! MHD_itc_activate_ (pool->itc, "e"))
+    MHD_PANIC (_ ("Failed to signal shutdown via " \
+                  "inter-thread communication channel.\n"));
+}
+
+
+/**
+ * The main function of the pool's thread: run the queued tasks and
+ * resume their connections.  The queued tasks are processed even if
+ * the pool is stopped, the thread is finished when the queue is empty.
+ *
+ * @param cls the pool
+ * @return always 0
+ */
+static MHD_THRD_RTRN_TYPE_ MHD_THRD_CALL_SPEC_
+offload_thread (void *cls)
+{
+  struct MHD_OffloadPool *const pool = (struct MHD_OffloadPool *) cls;
+  struct MHD_Connection *connection;
+  MHD_OffloadCallback task;
+
+  while (1)
+  {
+    MHD_mutex_lock_chk_ (&pool->lock);
+    connection = pool->head;
+    if (NULL != connection)
+    {
+      pool->head = connection->next_offload;
+      if (NULL == pool->head)
+      {
+        pool->tail = NULL;
+        /* Keep ITC active for other threads if the pool is stopped */
+        if (! pool->stopped)
+          MHD_itc_clear_ (pool->itc);
+      }
+      connection->next_offload = NULL;
+    }
+    else if (pool->stopped)
+    {
+      MHD_mutex_unlock_chk_ (&pool->lock);
+      break;
+    }
+    MHD_mutex_unlock_chk_ (&pool->lock);
+
+    if (NULL == connection)
+    {
+      if (! offload_wait (pool))
+      {
+        /* Waiting is not possible anymore, stop the pool to avoid
+           the busy loop.  The new tasks are rejected. */
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (pool->daemon,
+                  _ ("Stopping the offload pool.\n"));
+#endif
+        MHD_mutex_lock_chk_ (&pool->lock);
+        offload_set_stopped (pool);
+        MHD_mutex_unlock_chk_ (&pool->lock);
+      }
+      continue;
+    }
+    task = connection->offload_task;
+    mhd_assert (NULL != task);
+    connection->offload_task = NULL;
+    task (connection->offload_task_cls,
+          connection);
+    MHD_resume_connection (connection);
+  }
+  return (MHD_THRD_RTRN_TYPE_) 0;
+}
+
+
+struct MHD_OffloadPool *
+MHD_offload_pool_create_ (struct MHD_Daemon *daemon,
+                          unsigned int num_threads)
+{
+  struct MHD_OffloadPool *pool;
+
+  mhd_assert (0 != num_threads);
+  pool = MHD_calloc_ (1, sizeof (struct MHD_OffloadPool));
+  if (NULL == pool)
+    return NULL;
+  pool->threads = MHD_calloc_ (num_threads, sizeof (MHD_thread_handle_ID_));
+  if (NULL == pool->threads)
+  {
+    free (pool);
+    return NULL;
+  }
+  pool->daemon = daemon;
+  if (! MHD_mutex_init_ (&pool->lock))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to initialise mutex.\n"));
+#endif
+    free (pool->threads);
+    free (pool);
+    return NULL;
+  }
+  if (! MHD_itc_init_ (pool->itc))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to create inter-thread communication channel: %s\n"),
+              MHD_itc_last_strerror_ ());
+#endif
+    MHD_mutex_destroy_chk_ (&pool->lock);
+    free (pool->threads);
+    free (pool);
+    return NULL;
+  }
+#ifndef HAVE_POLL
+  if (! MHD_SCKT_FD_FITS_FDSET_ (MHD_itc_r_fd_ (pool->itc),
+                                 NULL))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("file descriptor for inter-thread communication " \
+                 "channel exceeds maximum value.\n"));
+#endif
+    MHD_itc_destroy_chk_ (pool->itc);
+    MHD_mutex_destroy_chk_ (&pool->lock);
+    free (pool->threads);
+    free (pool);
+    return NULL;
+  }
+#endif /* ! HAVE_POLL */
+  for (pool->num_threads = 0; pool->num_threads < num_threads;
+       pool->num_threads++)
+  {
+    if (! MHD_create_named_thread_ (&pool->threads[pool->num_threads],
+                                    "MHD-offload",
+                                    daemon->thread_stack_size,
+                                    &offload_thread,
+                                    pool))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Failed to create offload pool thread: %s\n"),
+                MHD_strerror_ (errno));
+#endif
+      MHD_offload_pool_destroy_ (pool);
+      return NULL;
+    }
+  }
+  return pool;
+}
+
+
+bool
+MHD_offload_pool_add_ (struct MHD_OffloadPool *pool,
+                       struct MHD_Connection *connection)
+{
+  mhd_assert (NULL != connection->offload_task);
+  mhd_assert (NULL == connection->next_offload);
+  MHD_mutex_lock_chk_ (&pool->lock);
+  if (pool->stopped)
+  {
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return false;
+  }
+  if (NULL == pool->tail)
+  {
+    pool->head = connection;
+    if (! MHD_itc_activate_ (pool->itc, "o"))
+      MHD_PANIC (_ ("Failed to signal the offload pool via " \
+                    "inter-thread communication channel.\n"));
+  }
+  else
+    pool->tail->next_offload = connection;
+  pool->tail = connection;
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  return true;
+}
+
+
+void
+MHD_offload_pool_stop_ (struct MHD_OffloadPool *pool)
+{
+  unsigned int i;
+
+  MHD_mutex_lock_chk_ (&pool->lock);
+  /* The pool could be stopped already by the failed thread */
+  offload_set_stopped (pool);
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  for (i = 0; i < pool->num_threads; i++)
+  {
+    if (! MHD_join_thread_ (pool->threads[i].handle))
+      MHD_PANIC (_ ("Failed to join a thread.\n"));
+  }
+  pool->num_threads = 0;
+  mhd_assert (NULL == pool->head);
+}
+
+
+void
+MHD_offload_pool_destroy_ (struct MHD_OffloadPool *pool)
+{
+  MHD_offload_pool_stop_ (pool);
+  MHD_itc_destroy_chk_ (pool->itc);
+  MHD_mutex_destroy_chk_ (&pool->lock);
+  free (pool->threads);
+  free (pool);
+}
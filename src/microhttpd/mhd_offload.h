@@ -0,0 +1,88 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/mhd_offload.h
+ * @brief  the pool of threads for the blocking tasks of the requests
+ * @author agent
+ *
+ * The connections with the blocking tasks are suspended and queued
+ * to the pool.  The threads of the pool run the tasks and resume the
+ * connections.  The queue is protected by the pool's mutex, the
+ * idle threads of the pool wait for the pool's ITC, which is kept
+ * active while the queue is not empty.
+ */
+
+#ifndef MHD_OFFLOAD_H
+#define MHD_OFFLOAD_H 1
+
+#include "internal.h"
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+
+/**
+ * Create the pool and start its threads.
+ *
+ * @param daemon the master daemon, used for logging
+ * @param num_threads the number of the threads, must be non-zero
+ * @return the new pool, NULL on error
+ */
+struct MHD_OffloadPool *
+MHD_offload_pool_create_ (struct MHD_Daemon *daemon,
+                          unsigned int num_threads);
+
+
+/**
+ * Add the suspended @a connection with the task set to the queue of
+ * the @a pool.
+ *
+ * @param pool the pool to use
+ * @param connection the connection, must have the task set
+ * @return true if the connection is queued,
+ *         false if the pool is stopped (by MHD_offload_pool_stop_() or
+ *         after an unrecoverable error of the pool's thread)
+ */
+bool
+MHD_offload_pool_add_ (struct MHD_OffloadPool *pool,
+                       struct MHD_Connection *connection);
+
+
+/**
+ * Stop the pool: wait until all queued tasks are processed and
+ * all threads are finished.  The new tasks are rejected after
+ * this call.  Must be called even if the pool has been stopped
+ * already after an error to join the threads.
+ *
+ * @param pool the pool to stop
+ */
+void
+MHD_offload_pool_stop_ (struct MHD_OffloadPool *pool);
+
+
+/**
+ * Stop the pool if not stopped yet and free its resources.
+ *
+ * @param pool the pool to destroy
+ */
+void
+MHD_offload_pool_destroy_ (struct MHD_OffloadPool *pool);
+
+#endif /* MHD_USE_POSIX_THREADS || MHD_USE_W32_THREADS */
+
+#endif /* ! MHD_OFFLOAD_H */
@@ -38,6 +38,9 @@
 #ifdef MHD_LINUX_SOLARIS_SENDFILE
 #include <sys/sendfile.h>
 #endif /* MHD_LINUX_SOLARIS_SENDFILE */
+#ifdef _MHD_HAVE_SPLICE
+#include <fcntl.h>
+#endif /* _MHD_HAVE_SPLICE */
 #if defined(HAVE_FREEBSD_SENDFILE) || defined(HAVE_DARWIN_SENDFILE)
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -50,9 +53,13 @@
 #ifdef HAVE_SYSCONF
 #include <unistd.h>
 #endif /* HAVE_SYSCONF */
+#ifdef MHD_USE_MSG_ZEROCOPY
+#include <linux/errqueue.h>
+#endif /* MHD_USE_MSG_ZEROCOPY */
 #include "mhd_assert.h"
 
 #include "mhd_limits.h"
+#include "response.h"
 
 #ifdef MHD_VECT_SEND
 #if (! defined(HAVE_SENDMSG) || ! defined(MSG_NOSIGNAL)) && \
@@ -758,7 +765,7 @@ MHD_send_data_ (struct MHD_Connection *connection,
   MHD_socket s = connection->socket_fd;
   ssize_t ret;
 #ifdef HTTPS_SUPPORT
-  const bool tls_conn = (connection->daemon->options & MHD_USE_TLS);
+  const bool tls_conn = MHD_C_USES_TLS_SEND_ (connection);
 #else  /* ! HTTPS_SUPPORT */
   const bool tls_conn = false;
 #endif /* ! HTTPS_SUPPORT */
@@ -886,6 +893,8 @@ MHD_send_data_ (struct MHD_Connection *connection,
         ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
 #endif /* EPOLL_SUPPORT */
   }
+  connection->stats->send_calls++;
+  connection->stats->bytes_sent += (size_t) ret;
 
   /* If there is a need to push the data from network buffers
    * call post_send_setopt(). */
@@ -934,7 +943,7 @@ MHD_send_hdr_and_body_ (struct MHD_Connection *connection,
 
   no_vec = false;
 #ifdef HTTPS_SUPPORT
-  no_vec = no_vec || (connection->daemon->options & MHD_USE_TLS);
+  no_vec = no_vec || MHD_C_USES_TLS_SEND_ (connection);
 #endif /* HTTPS_SUPPORT */
 #if (! defined(HAVE_SENDMSG) || ! defined(MSG_NOSIGNAL) ) && \
   defined(MHD_SEND_SPIPE_SEND_SUPPRESS_POSSIBLE) && \
@@ -1131,6 +1140,8 @@ MHD_send_hdr_and_body_ (struct MHD_Connection *connection,
     connection->epoll_state &=
       ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
 #endif /* EPOLL_SUPPORT */
+  connection->stats->iovec_calls++;
+  connection->stats->bytes_sent += (size_t) ret;
 
   /* If there is a need to push the data from network buffers
    * call post_send_setopt(). */
@@ -1208,7 +1219,7 @@ MHD_send_sendfile_ (struct MHD_Connection *connection)
   size_t send_size = 0;
   bool push_data;
   mhd_assert (MHD_resp_sender_sendfile == connection->resp_sender);
-  mhd_assert (0 == (connection->daemon->options & MHD_USE_TLS));
+  mhd_assert (! MHD_C_USES_TLS_SEND_ (connection));
 
   offsetu64 = connection->response_write_position
               + connection->response->fd_off;
@@ -1367,6 +1378,8 @@ MHD_send_sendfile_ (struct MHD_Connection *connection)
   mhd_assert (send_size >= (size_t) len);
   ret = (ssize_t) len;
 #endif /* HAVE_FREEBSD_SENDFILE */
+  connection->stats->sendfile_calls++;
+  connection->stats->bytes_sent += (size_t) ret;
 
   /* If there is a need to push the data from network buffers
    * call post_send_setopt(). */
@@ -1380,39 +1393,388 @@ MHD_send_sendfile_ (struct MHD_Connection *connection)
 }
 
 
+#if defined(_MHD_HAVE_SPLICE)
+ssize_t
+MHD_send_splice_ (struct MHD_Connection *connection)
+{
+  ssize_t ret;
+  const int pipe_fd = connection->response->fd;
+  const bool used_thr_p_c = (0 != (connection->daemon->options
+                                   & MHD_USE_THREAD_PER_CONNECTION));
+  /* Do not allow system to stick sending on single fast connection:
+   * use 128KiB chunks (2MiB for thread-per-connection), the same as
+   * for sendfile(). */
+  const size_t send_size = used_thr_p_c ? MHD_SENFILE_CHUNK_THR_P_C_ :
+                           MHD_SENFILE_CHUNK_;
+  mhd_assert (MHD_resp_sender_splice == connection->resp_sender);
+  mhd_assert (! MHD_C_USES_TLS_SEND_ (connection));
+  mhd_assert (connection->response->is_pipe);
+
+  /* The size of the pipe data is unknown, the data produced by the
+   * application should be delivered to the client without delays. */
+  pre_send_setopt (connection, false, true);
+
+  /* SPLICE_F_NONBLOCK is not used: like read() in pipe_reader(), the call
+   * waits for data if the pipe is empty.  The socket is non-blocking, so
+   * the call does not wait for the space in the socket buffer. */
+  ret = splice (pipe_fd,
+                NULL,
+                connection->socket_fd,
+                NULL,
+                send_size,
+                SPLICE_F_MOVE);
+  if (0 > ret)
+  {
+    const int err = MHD_socket_get_error_ ();
+    if (MHD_SCKT_ERR_IS_EAGAIN_ (err))
+    {
+#ifdef EPOLL_SUPPORT
+      /* EAGAIN --- no longer write-ready */
+      connection->epoll_state &=
+        ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
+#endif /* EPOLL_SUPPORT */
+      return MHD_ERR_AGAIN_;
+    }
+    if (MHD_SCKT_ERR_IS_EINTR_ (err))
+      return MHD_ERR_AGAIN_;
+    if (MHD_SCKT_ERR_IS_ (err,
+                          MHD_SCKT_EBADF_))
+      return MHD_ERR_BADF_;
+    if (MHD_SCKT_ERR_IS_REMOTE_DISCNN_ (err))
+      return MHD_ERR_CONNRESET_;
+    if (MHD_SCKT_ERR_IS_ (err, MHD_SCKT_EPIPE_))
+      return MHD_ERR_PIPE_;
+    /* splice() failed with EINVAL if the FD is not a real pipe or the
+       socket does not support splicing.  No data has been taken from the
+       FD, so the same data can be read and sent by the standard way. */
+    connection->resp_sender = MHD_resp_sender_std;
+    return MHD_ERR_AGAIN_;
+  }
+  /* Unlike sendfile(), the short result typically means that the pipe
+   * had less data than requested, the socket could be still write-ready. */
+  connection->stats->splice_calls++;
+  connection->stats->bytes_sent += (size_t) ret;
+
+  return ret;
+}
+
+
+#endif /* _MHD_HAVE_SPLICE */
+
 #endif /* _MHD_HAVE_SENDFILE */
 
+#ifdef MHD_USE_MSG_ZEROCOPY
+
+/**
+ * Check whether the response data should be sent with MSG_ZEROCOPY.
+ * Enables SO_ZEROCOPY on the connection socket, if needed.
+ *
+ * @param connection the MHD connection structure
+ * @return true if MSG_ZEROCOPY should be used for the response data,
+ *         false otherwise
+ */
+static bool
+zerocopy_check_ (struct MHD_Connection *connection)
+{
+  struct MHD_Response *const response = connection->response;
+  const size_t threshold = connection->daemon->zerocopy_threshold;
+  int on = 1;
+
+  /* The data generated by the callback is stored in the buffer
+   * re-used by MHD, the kernel must not refer to it. */
+  if ( (0 == threshold) ||
+       (NULL == response) ||
+       (NULL != response->crc) ||
+       (response->total_size < threshold) )
+    return false;
+  /* The kernel releases the data when the peer has acknowledged it.
+   * Do not use zerocopy if the connection is going to be closed right
+   * after the response, the socket would be kept open only to receive
+   * the notifications.  Only one response per connection could wait
+   * for the notifications. */
+  /* The kernel TLS rejects MSG_ZEROCOPY, TLS connections are always
+   * excluded. */
+  if ( (_MHD_OFF == connection->sk_zerocopy) ||
+       (0 != (connection->daemon->options & MHD_USE_TLS)) ||
+       (! connection->sk_nonblck) ||
+       (MHD_CONN_MUST_CLOSE == connection->keepalive) ||
+       ( (NULL != connection->zc_response) &&
+         (response != connection->zc_response) ) )
+  {
+    connection->stats->zerocopy_fallbacks++;
+    return false;
+  }
+  if (_MHD_ON != connection->sk_zerocopy)
+  {
+    if (0 != setsockopt (connection->socket_fd,
+                         SOL_SOCKET,
+                         SO_ZEROCOPY,
+                         (const void *) &on,
+                         sizeof (on)))
+    {
+      connection->sk_zerocopy = _MHD_OFF;
+      connection->stats->zerocopy_fallbacks++;
+      return false;
+    }
+    connection->sk_zerocopy = _MHD_ON;
+  }
+  return true;
+}
+
+
+/**
+ * Account the successful send with MSG_ZEROCOPY.
+ * The connection keeps the response until the kernel releases the data.
+ *
+ * @param connection the MHD connection structure
+ */
+static void
+zerocopy_sent_ (struct MHD_Connection *connection)
+{
+  connection->zc_sent++;
+  connection->stats->zerocopy_calls++;
+  if (NULL == connection->zc_response)
+  {
+    MHD_increment_response_rc (connection->response);
+    connection->zc_response = connection->response;
+    if (0 == (connection->daemon->options & MHD_USE_THREAD_PER_CONNECTION))
+      connection->daemon->zc_pending++;
+  }
+}
+
+
+/**
+ * Release the response kept for the zerocopy sends.
+ *
+ * @param connection the MHD connection structure
+ */
+static void
+zerocopy_drop_response_ (struct MHD_Connection *connection)
+{
+  mhd_assert (NULL != connection->zc_response);
+  MHD_destroy_response (connection->zc_response);
+  connection->zc_response = NULL;
+  if (0 == (connection->daemon->options & MHD_USE_THREAD_PER_CONNECTION))
+  {
+    mhd_assert (0 != connection->daemon->zc_pending);
+    connection->daemon->zc_pending--;
+  }
+}
+
+
+/**
+ * Receive the queued zerocopy notifications of the socket.
+ *
+ * @param fd the socket to use
+ * @param sent the number of the sends made with MSG_ZEROCOPY
+ * @param[in,out] done the number of the completed sends, updated
+ * @param stats the statistics to update
+ */
+static void
+zerocopy_recv_ (MHD_socket fd,
+                uint32_t sent,
+                uint32_t *done,
+                struct MHD_DaemonStats *stats)
+{
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (struct sock_extended_err)
+                         + sizeof (struct sockaddr_in6))];
+  } control;
+  struct msghdr msg;
+  struct cmsghdr *cm;
+
+  while (*done != sent)
+  {
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof (control.buf);
+    if (0 > recvmsg (fd, &msg, MSG_ERRQUEUE))
+      break; /* No more notifications */
+    for (cm = CMSG_FIRSTHDR (&msg); NULL != cm; cm = CMSG_NXTHDR (&msg, cm))
+    {
+      const struct sock_extended_err *serr;
+      uint32_t num;
+
+      if ( ((SOL_IP != cm->cmsg_level) || (IP_RECVERR != cm->cmsg_type))
+#ifdef IPV6_RECVERR
+           && ((SOL_IPV6 != cm->cmsg_level) || (IPV6_RECVERR != cm->cmsg_type))
+#endif /* IPV6_RECVERR */
+           )
+        continue;
+      serr = (const struct sock_extended_err *) (const void *) CMSG_DATA (cm);
+      if ( (0 != serr->ee_errno) ||
+           (SO_EE_ORIGIN_ZEROCOPY != serr->ee_origin) )
+        continue;
+      /* The range of the completed sends, both ends are included */
+      num = serr->ee_data - serr->ee_info + 1;
+      *done += num;
+      if (0 != (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED))
+        stats->zerocopy_copied += num;
+    }
+  }
+}
+
+
+void
+MHD_zerocopy_complete_ (struct MHD_Connection *connection)
+{
+  mhd_assert (_MHD_ON == connection->sk_zerocopy);
+  zerocopy_recv_ (connection->socket_fd,
+                  connection->zc_sent,
+                  &connection->zc_done,
+                  connection->stats);
+  if ( (connection->zc_done == connection->zc_sent) &&
+       (NULL != connection->zc_response) )
+    zerocopy_drop_response_ (connection);
+}
+
+
+void
+MHD_zerocopy_wait_ (struct MHD_Connection *connection)
+{
+  struct MHD_Daemon *const daemon = connection->daemon;
+  struct timeval tv;
+
+  mhd_assert (0 != (daemon->options & MHD_USE_THREAD_PER_CONNECTION));
+  if ( (NULL == connection->zc_response) ||
+       (MHD_INVALID_SOCKET == connection->socket_fd) )
+    return;
+  /* Let the peer finish the connection, the data is still sent */
+  shutdown (connection->socket_fd, SHUT_WR);
+  MHD_zerocopy_complete_ (connection);
+  while ( (NULL != connection->zc_response) &&
+          (! daemon->shutdown) )
+  {
+    /* The socket could stay readable or hung up, just check the
+       notifications periodically */
+    tv.tv_sec = 0;
+    tv.tv_usec = MHD_ZEROCOPY_POLL_MS * 1000;
+    (void) MHD_SYS_select_ (0, NULL, NULL, NULL, &tv);
+    MHD_zerocopy_complete_ (connection);
+  }
+}
+
+
+void
+MHD_zerocopy_release_ (struct MHD_Connection *connection)
+{
+  struct MHD_Daemon *const daemon = connection->daemon;
+  struct MHD_ZerocopyLinger_ *zl;
+
+  if (NULL == connection->zc_response)
+    return;
+  if (MHD_INVALID_SOCKET != connection->socket_fd)
+    MHD_zerocopy_complete_ (connection);
+  if (NULL == connection->zc_response)
+    return;
+  /* The kernel could still refer to the data of the response (for
+   * retransmission).  Keep the socket open to receive the remaining
+   * notifications and keep the response until then. */
+  if ( (MHD_INVALID_SOCKET != connection->socket_fd) &&
+       (0 == (daemon->options & MHD_USE_THREAD_PER_CONNECTION)) &&
+       (! daemon->shutdown) )
+  {
+    zl = (struct MHD_ZerocopyLinger_ *) malloc (sizeof (*zl));
+    if (NULL != zl)
+    {
+      shutdown (connection->socket_fd, SHUT_WR);
+      zl->response = connection->zc_response;
+      zl->fd = connection->socket_fd;
+      zl->sent = connection->zc_sent;
+      zl->done = connection->zc_done;
+      zl->next = daemon->zc_linger_head;
+      daemon->zc_linger_head = zl;
+      connection->zc_response = NULL;
+      connection->socket_fd = MHD_INVALID_SOCKET;
+      mhd_assert (0 != daemon->zc_pending);
+      daemon->zc_pending--;
+      return;
+    }
+  }
+  /* The socket is going to be closed, the notifications for
+   * the remaining data will never be received. */
+  zerocopy_drop_response_ (connection);
+}
+
+
+void
+MHD_zerocopy_linger_process_ (struct MHD_Daemon *daemon,
+                              bool release_all)
+{
+  struct MHD_ZerocopyLinger_ **pzl;
+  struct MHD_ZerocopyLinger_ *zl;
+
+  pzl = &daemon->zc_linger_head;
+  while (NULL != (zl = *pzl))
+  {
+    zerocopy_recv_ (zl->fd,
+                    zl->sent,
+                    &zl->done,
+                    &daemon->stats);
+    if ( (zl->done != zl->sent) &&
+         (! release_all) )
+    {
+      pzl = &zl->next;
+      continue;
+    }
+    *pzl = zl->next;
+    MHD_destroy_response (zl->response);
+    MHD_socket_close_chk_ (zl->fd);
+    free (zl);
+  }
+}
+
+
+#endif /* MHD_USE_MSG_ZEROCOPY */
+
 #if defined(MHD_VECT_SEND)
 
 
+/**
+ * The maximum number of the response iov elements sent by single
+ * vector-send call together with the response header.
+ */
+#define MHD_HDR_IOV_ELMNTS_MAX_ 16
+
+
 /**
  * Function sends iov data by system sendmsg or writev function.
  *
  * Connection must be in non-TLS (non-HTTPS) mode.
  *
  * @param connection the MHD connection structure
+ * @param header the header data to send before the iov data, could be NULL
+ * @param header_size the size of the @a header, zero if @a header is NULL
  * @param r_iov the pointer to iov data structure with tracking
  * @param push_data set to true to force push the data to the network from
  *                  system buffers (usually set for the last piece of data),
  *                  set to false to prefer holding incomplete network packets
  *                  (more data will be send for the same reply).
- * @return actual number of bytes sent
+ * @return actual number of bytes sent (including the @a header)
  */
 static ssize_t
 send_iov_nontls (struct MHD_Connection *connection,
+                 const char *header,
+                 size_t header_size,
                  struct MHD_iovec_track_ *const r_iov,
                  bool push_data)
 {
   ssize_t res;
   size_t items_to_send;
+  MHD_iovec_ *vec;
+  MHD_iovec_ hdr_vec[MHD_HDR_IOV_ELMNTS_MAX_ + 1];
 #ifdef HAVE_SENDMSG
   struct msghdr msg;
+  int zc_flag;
 #elif defined(MHD_WINSOCK_SOCKETS)
   DWORD bytes_sent;
   DWORD cnt_w;
 #endif /* MHD_WINSOCK_SOCKETS */
 
-  mhd_assert (0 == (connection->daemon->options & MHD_USE_TLS));
+  mhd_assert (! MHD_C_USES_TLS_SEND_ (connection));
+  mhd_assert ((NULL != header) || (0 == header_size));
 
   if ( (MHD_INVALID_SOCKET == connection->socket_fd) ||
        (MHD_CONNECTION_CLOSED == connection->state) )
@@ -1421,32 +1783,68 @@ send_iov_nontls (struct MHD_Connection *connection,
   }
 
   items_to_send = r_iov->cnt - r_iov->sent;
-#ifdef _MHD_IOV_MAX
-  if (_MHD_IOV_MAX < items_to_send)
+  if (0 != header_size)
   {
-    mhd_assert (0 < _MHD_IOV_MAX);
-    if (0 == _MHD_IOV_MAX)
-      return MHD_ERR_NOTCONN_; /* Should never happen */
-    items_to_send = _MHD_IOV_MAX;
-    push_data = false; /* Incomplete response */
+    if (MHD_HDR_IOV_ELMNTS_MAX_ < items_to_send)
+    {
+      items_to_send = MHD_HDR_IOV_ELMNTS_MAX_;
+      push_data = false; /* Incomplete response */
+    }
+#ifdef _MHD_IOV_MAX
+    if (_MHD_IOV_MAX <= items_to_send)
+    {
+      mhd_assert (1 < _MHD_IOV_MAX);
+      if (1 >= _MHD_IOV_MAX)
+        return MHD_ERR_NOTCONN_; /* Should never happen */
+      items_to_send = _MHD_IOV_MAX - 1;
+      push_data = false; /* Incomplete response */
+    }
+#endif /* _MHD_IOV_MAX */
+    hdr_vec[0].iov_base = (void *) _MHD_DROP_CONST (header);
+    hdr_vec[0].iov_len = (MHD_iov_size_) header_size;
+    memcpy (hdr_vec + 1,
+            r_iov->iov + r_iov->sent,
+            items_to_send * sizeof(MHD_iovec_));
+    vec = hdr_vec;
+    items_to_send++;
   }
+  else
+  {
+#ifdef _MHD_IOV_MAX
+    if (_MHD_IOV_MAX < items_to_send)
+    {
+      mhd_assert (0 < _MHD_IOV_MAX);
+      if (0 == _MHD_IOV_MAX)
+        return MHD_ERR_NOTCONN_; /* Should never happen */
+      items_to_send = _MHD_IOV_MAX;
+      push_data = false; /* Incomplete response */
+    }
 #endif /* _MHD_IOV_MAX */
+    vec = r_iov->iov + r_iov->sent;
+  }
 #ifdef HAVE_SENDMSG
   memset (&msg, 0, sizeof(struct msghdr));
-  msg.msg_iov = r_iov->iov + r_iov->sent;
+  msg.msg_iov = vec;
   msg.msg_iovlen = items_to_send;
+  zc_flag = 0;
+#ifdef MHD_USE_MSG_ZEROCOPY
+  /* The header is stored in the connection memory pool, which is
+   * re-used for the next request. */
+  if ( (0 == header_size) &&
+       zerocopy_check_ (connection) )
+    zc_flag = MSG_ZEROCOPY;
+#endif /* MHD_USE_MSG_ZEROCOPY */
 
   pre_send_setopt (connection, true, push_data);
 #ifdef MHD_USE_MSG_MORE
   res = sendmsg (connection->socket_fd, &msg,
-                 MSG_NOSIGNAL_OR_ZERO | (push_data ? 0 : MSG_MORE));
+                 MSG_NOSIGNAL_OR_ZERO | zc_flag | (push_data ? 0 : MSG_MORE));
 #else  /* ! MHD_USE_MSG_MORE */
-  res = sendmsg (connection->socket_fd, &msg, MSG_NOSIGNAL_OR_ZERO);
+  res = sendmsg (connection->socket_fd, &msg, MSG_NOSIGNAL_OR_ZERO | zc_flag);
 #endif /* ! MHD_USE_MSG_MORE */
 #elif defined(HAVE_WRITEV)
   pre_send_setopt (connection, true, push_data);
-  res = writev (connection->socket_fd, r_iov->iov + r_iov->sent,
-                items_to_send);
+  res = writev (connection->socket_fd, vec, items_to_send);
 #elif defined(MHD_WINSOCK_SOCKETS)
 #ifdef _WIN64
   if (items_to_send > UINT32_MAX)
@@ -1461,7 +1859,7 @@ send_iov_nontls (struct MHD_Connection *connection,
 #endif /* ! _WIN64 */
   pre_send_setopt (connection, true, push_data);
   if (0 == WSASend (connection->socket_fd,
-                    (LPWSABUF) (r_iov->iov + r_iov->sent),
+                    (LPWSABUF) vec,
                     cnt_w,
                     &bytes_sent, 0, NULL, NULL))
     res = (ssize_t) bytes_sent;
@@ -1505,9 +1903,24 @@ send_iov_nontls (struct MHD_Connection *connection,
   }
 
   /* Some data has been sent */
+  connection->stats->iovec_calls++;
+  connection->stats->bytes_sent += (size_t) res;
+#ifdef MHD_USE_MSG_ZEROCOPY
+  if (0 != zc_flag)
+    zerocopy_sent_ (connection);
+#endif /* MHD_USE_MSG_ZEROCOPY */
+  if (header_size > (size_t) res)
+  {
+    /* The header has been sent partially, the iov data is not sent */
+#ifdef EPOLL_SUPPORT
+    connection->epoll_state &=
+      ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
+#endif /* EPOLL_SUPPORT */
+    return res;
+  }
   if (1)
   {
-    size_t track_sent = (size_t) res;
+    size_t track_sent = (size_t) res - header_size;
     /* Adjust the internal tracking information for the iovec to
      * take this last send into account. */
     while ((0 != track_sent) && (r_iov->iov[r_iov->sent].iov_len <= track_sent))
@@ -1637,7 +2050,7 @@ MHD_send_iovec_ (struct MHD_Connection *connection,
   defined(_MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED)
 #ifdef HTTPS_SUPPORT
   use_iov_send = use_iov_send &&
-                 (0 == (connection->daemon->options & MHD_USE_TLS));
+                 (! MHD_C_USES_TLS_SEND_ (connection));
 #endif /* HTTPS_SUPPORT */
 #ifdef _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED
   use_iov_send = use_iov_send && (connection->daemon->sigpipe_blocked ||
@@ -1645,7 +2058,7 @@ MHD_send_iovec_ (struct MHD_Connection *connection,
 #endif /* _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED */
   if (use_iov_send)
 #endif /* HTTPS_SUPPORT || _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED */
-  return send_iov_nontls (connection, r_iov, push_data);
+  return send_iov_nontls (connection, NULL, 0, r_iov, push_data);
 #endif /* MHD_VECT_SEND */
 
 #if ! defined(MHD_VECT_SEND) || defined(HTTPS_SUPPORT) || \
@@ -1654,3 +2067,78 @@ MHD_send_iovec_ (struct MHD_Connection *connection,
 #endif /* !MHD_VECT_SEND || HTTPS_SUPPORT
           || _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED */
 }
+
+
+ssize_t
+MHD_send_hdr_and_iovec_ (struct MHD_Connection *connection,
+                         const char *header,
+                         size_t header_size,
+                         struct MHD_iovec_track_ *const r_iov,
+                         bool complete_response)
+{
+#ifdef MHD_VECT_SEND
+#if defined(HTTPS_SUPPORT) || \
+  defined(_MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED)
+  bool use_iov_send = true;
+#endif /* HTTPS_SUPPORT || _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED */
+#endif /* MHD_VECT_SEND */
+
+  mhd_assert (NULL != r_iov->iov);
+  mhd_assert (r_iov->cnt > r_iov->sent);
+  mhd_assert (0 != header_size);
+#ifdef MHD_VECT_SEND
+#if defined(HTTPS_SUPPORT) || \
+  defined(_MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED)
+#ifdef HTTPS_SUPPORT
+  use_iov_send = use_iov_send &&
+                 (! MHD_C_USES_TLS_SEND_ (connection));
+#endif /* HTTPS_SUPPORT */
+#ifdef _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED
+  use_iov_send = use_iov_send && (connection->daemon->sigpipe_blocked ||
+                                  connection->sk_spipe_suppress);
+#endif /* _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED */
+  if (use_iov_send)
+#endif /* HTTPS_SUPPORT || _MHD_VECT_SEND_NEEDS_SPIPE_SUPPRESSED */
+  {
+    if ( ((size_t) SSIZE_MAX > header_size) &&
+         ((size_t) MHD_IOV_ELMN_MAX_SIZE >= header_size) )
+      return send_iov_nontls (connection, header, header_size,
+                              r_iov, complete_response);
+  }
+#endif /* MHD_VECT_SEND */
+
+  /* Send the header only, the iov data is sent in the next round */
+  return MHD_send_data_ (connection,
+                         header,
+                         header_size,
+                         false);
+}
+
+
+ssize_t
+MHD_send_resp_data_ (struct MHD_Connection *connection,
+                     const char *buffer,
+                     size_t buffer_size,
+                     bool push_data)
+{
+#ifdef MHD_USE_MSG_ZEROCOPY
+  if (zerocopy_check_ (connection))
+  {
+    MHD_iovec_ iov;
+    struct MHD_iovec_track_ track;
+
+    if (buffer_size > MHD_SCKT_SEND_MAX_SIZE_)
+    {
+      buffer_size = MHD_SCKT_SEND_MAX_SIZE_; /* return value limit */
+      push_data = false; /* incomplete send */
+    }
+    iov.iov_base = _MHD_DROP_CONST (buffer);
+    iov.iov_len = buffer_size;
+    track.iov = &iov;
+    track.cnt = 1;
+    track.sent = 0;
+    return send_iov_nontls (connection, NULL, 0, &track, push_data);
+  }
+#endif /* MHD_USE_MSG_ZEROCOPY */
+  return MHD_send_data_ (connection, buffer, buffer_size, push_data);
+}
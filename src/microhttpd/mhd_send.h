@@ -74,6 +74,28 @@ MHD_send_data_ (struct MHD_Connection *connection,
                 bool push_data);
 
 
+/**
+ * Send the data of the response body.
+ *
+ * The data must be the part of the response, it could be sent with
+ * MSG_ZEROCOPY if enabled by #MHD_OPTION_ZEROCOPY_THRESHOLD.
+ *
+ * @param connection the MHD_Connection structure
+ * @param buffer the response data to send
+ * @param buffer_size the size of the @a buffer (in bytes)
+ * @param push_data set to true to force push the data to the network from
+ *                  system buffers (usually set for the last piece of data),
+ *                  set to false to prefer holding incomplete network packets
+ *                  (more data will be send for the same reply).
+ * @return the number of bytes sent or error code (negative)
+ */
+ssize_t
+MHD_send_resp_data_ (struct MHD_Connection *connection,
+                     const char *buffer,
+                     size_t buffer_size,
+                     bool push_data);
+
+
 /**
  * Send reply header with optional reply body.
  *
@@ -111,6 +133,21 @@ MHD_send_hdr_and_body_ (struct MHD_Connection *connection,
 ssize_t
 MHD_send_sendfile_ (struct MHD_Connection *connection);
 
+#if defined(_MHD_HAVE_SPLICE)
+/**
+ * Function for sending responses backed by pipe FD.
+ * The data is moved from the pipe to the socket by splice() without
+ * copying to the user space.
+ *
+ * @param connection the MHD connection structure
+ * @return actual number of bytes sent, zero if the pipe has been closed
+ *         by the writer (the end of the response data)
+ */
+ssize_t
+MHD_send_splice_ (struct MHD_Connection *connection);
+
+#endif /* _MHD_HAVE_SPLICE */
+
 #endif
 
 
@@ -160,4 +197,92 @@ MHD_send_iovec_ (struct MHD_Connection *connection,
                  bool push_data);
 
 
+/**
+ * Send the response header and the response data backed by an array
+ * of memory buffers.
+ *
+ * The header and the iov elements are sent by the single vector-send
+ * call, if possible, otherwise only the header is sent.  The tracking
+ * information in @a r_iov is updated for the sent iov data.
+ *
+ * @param connection the MHD connection structure
+ * @param header content of header to send
+ * @param header_size the size of the @a header
+ * @param r_iov the pointer to iov response structure with tracking
+ * @param complete_response set to true if @a r_iov has the complete
+ *                          response body
+ * @return sum of the number of bytes sent from both buffers or
+ *         error code (negative)
+ */
+ssize_t
+MHD_send_hdr_and_iovec_ (struct MHD_Connection *connection,
+                         const char *header,
+                         size_t header_size,
+                         struct MHD_iovec_track_ *const r_iov,
+                         bool complete_response);
+
+
+#ifdef MHD_USE_MSG_ZEROCOPY
+/**
+ * The interval (in milliseconds) of the checks for the zerocopy
+ * notifications when select() is used.  select() reports the
+ * notifications only for the sockets in the read or write set.
+ */
+#define MHD_ZEROCOPY_POLL_MS 10
+
+/**
+ * Process the completion notifications of the sends made with
+ * MSG_ZEROCOPY.  The notifications are received from the error queue
+ * of the socket.  The response is released when all its data has been
+ * released by the kernel.
+ *
+ * @param connection the MHD connection structure
+ */
+void
+MHD_zerocopy_complete_ (struct MHD_Connection *connection);
+
+
+/**
+ * Wait until the kernel releases the data of the response sent with
+ * MSG_ZEROCOPY or until the daemon is stopped.
+ * To be used in thread-per-connection mode by the thread of the
+ * closed connection.
+ *
+ * @param connection the MHD connection structure
+ */
+void
+MHD_zerocopy_wait_ (struct MHD_Connection *connection);
+
+
+/**
+ * Release the response waiting for the zerocopy notifications.
+ * To be called before closing of the connection socket.
+ * If the kernel has not released the data yet, the socket and the
+ * response are moved to the list of the daemon and the socket of
+ * the @a connection is set to #MHD_INVALID_SOCKET.  The response is
+ * released before the notifications are received only when the daemon
+ * is being stopped.
+ *
+ * @param connection the MHD connection structure
+ */
+void
+MHD_zerocopy_release_ (struct MHD_Connection *connection);
+
+
+/**
+ * Process the zerocopy notifications of the sockets of the closed
+ * connections.  The sockets with all notifications received are closed
+ * and their responses are released.
+ *
+ * @param daemon the daemon to use
+ * @param release_all if 'true', close all sockets and release all
+ *                    responses, used when the daemon is stopped
+ */
+void
+MHD_zerocopy_linger_process_ (struct MHD_Daemon *daemon,
+                              bool release_all);
+
+#endif /* MHD_USE_MSG_ZEROCOPY */
+
+
 #endif /* MHD_SEND_H */
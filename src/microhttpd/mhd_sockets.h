@@ -293,6 +293,17 @@ typedef SOCKET MHD_socket;
 #endif /* __linux__ */
 #endif /* MSG_MORE */
 
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && \
+  defined(HAVE_LINUX_ERRQUEUE_H) && defined(HAVE_SENDMSG)
+#ifdef __linux__
+/**
+ * Indicate MSG_ZEROCOPY is usable for sending of the response data.
+ */
+#define MHD_USE_MSG_ZEROCOPY 1
+#endif /* __linux__ */
+#endif /* MSG_ZEROCOPY && SO_ZEROCOPY && HAVE_LINUX_ERRQUEUE_H
+          && HAVE_SENDMSG */
+
 
 /**
  * MHD_SCKT_OPT_BOOL_ is type for bool parameters for setsockopt()/getsockopt()
@@ -29,6 +29,9 @@
 #include "mhd_str.h"
 #include "mhd_compat.h"
 #include "mhd_assert.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
 
 /**
  * Size of on-stack buffer that we use for un-escaping of the value.
@@ -37,6 +40,165 @@
  */
 #define XBUF_SIZE 512
 
+/**
+ * The part of the delimiter preceding the boundary.
+ */
+#define PP_DELIM_PREFIX "\r\n--"
+
+/**
+ * The length of #PP_DELIM_PREFIX.
+ */
+#define PP_DELIM_PREFIX_LEN 4
+
+
+/**
+ * Get the character of the delimiter ("\r\n--" followed by the boundary).
+ *
+ * @param boundary the boundary
+ * @param pos the position in the delimiter
+ * @return the character at @a pos
+ */
+static char
+delimiter_char (const char *boundary,
+                size_t pos)
+{
+  if (PP_DELIM_PREFIX_LEN > pos)
+    return PP_DELIM_PREFIX[pos];
+  return boundary[pos - PP_DELIM_PREFIX_LEN];
+}
+
+
+/**
+ * Find the delimiter ("\r\n--" followed by the boundary) in the data.
+ * If the delimiter is not found, find the position where the incomplete
+ * delimiter could start at the end of the data, all data before this
+ * position is definitely not a part of the delimiter.
+ *
+ * @param data the data to search
+ * @param size the size of the @a data
+ * @param boundary the boundary
+ * @param blen the length of the @a boundary
+ * @param[out] found set to 'true' if the complete delimiter is found
+ * @return the position of the delimiter if found, otherwise the position
+ *         of the possible incomplete delimiter or @a size
+ */
+static size_t
+find_delimiter (const char *data,
+                size_t size,
+                const char *boundary,
+                size_t blen,
+                bool *found)
+{
+  const size_t dlen = blen + PP_DELIM_PREFIX_LEN;
+  const char last = delimiter_char (boundary, dlen - 1);
+  size_t pos;
+
+  *found = false;
+  pos = 0;
+#ifdef __SSE2__
+  if (1)
+  {
+    /* Check 32 positions at once: the candidate position must have
+       '\r' as the first byte and the last byte of the delimiter at
+       the right distance.  Full comparison is rarely needed. */
+    const __m128i first_v = _mm_set1_epi8 ('\r');
+    const __m128i last_v = _mm_set1_epi8 (last);
+
+    while (pos + dlen + 31 <= size)
+    {
+      const char *const p1 = &data[pos];
+      const char *const p2 = &data[pos + dlen - 1];
+      const __m128i c1 =
+        _mm_and_si128 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) p1),
+                                       first_v),
+                       _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) p2),
+                                       last_v));
+      const __m128i c2 =
+        _mm_and_si128 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *)
+                                                        (p1 + 16)),
+                                       first_v),
+                       _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *)
+                                                        (p2 + 16)),
+                                       last_v));
+      uint32_t mask;
+      size_t i;
+
+      mask = (uint32_t) _mm_movemask_epi8 (_mm_or_si128 (c1, c2));
+      if (0 != mask)
+      {
+        mask = ((uint32_t) _mm_movemask_epi8 (c1))
+               | (((uint32_t) _mm_movemask_epi8 (c2)) << 16);
+        for (i = pos; 0 != mask; i++, mask >>= 1)
+        {
+          if ( (0 != (mask & 1)) &&
+               (0 == memcmp (&data[i + 1],
+                             PP_DELIM_PREFIX + 1,
+                             PP_DELIM_PREFIX_LEN - 1)) &&
+               (0 == memcmp (&data[i + PP_DELIM_PREFIX_LEN],
+                             boundary,
+                             blen)) )
+          {
+            *found = true;
+            return i;
+          }
+        }
+      }
+      pos += 32;
+    }
+  }
+#endif /* __SSE2__ */
+  while (pos + dlen <= size)
+  {
+    const char *r;
+
+    r = memchr (&data[pos],
+                '\r',
+                size - dlen + 1 - pos);
+    if (NULL == r)
+    {
+      pos = size - dlen + 1;
+      break;
+    }
+    pos = (size_t) (r - data);
+    if ( (last == data[pos + dlen - 1]) &&
+         (0 == memcmp (&data[pos],
+                       PP_DELIM_PREFIX,
+                       PP_DELIM_PREFIX_LEN)) &&
+         (0 == memcmp (&data[pos + PP_DELIM_PREFIX_LEN],
+                       boundary,
+                       blen)) )
+    {
+      *found = true;
+      return pos;
+    }
+    pos++;
+  }
+  /* Check for the incomplete delimiter at the end of the data */
+  pos = (size >= dlen) ? (size - dlen + 1) : 0;
+  while (pos < size)
+  {
+    const char *r;
+    size_t i;
+
+    r = memchr (&data[pos],
+                '\r',
+                size - pos);
+    if (NULL == r)
+      break;
+    pos = (size_t) (r - data);
+    for (i = 1; pos + i < size; i++)
+    {
+      if (delimiter_char (boundary, i) != data[pos + i])
+        break;
+    }
+    if (pos + i == size)
+      return pos;
+    pos++;
+  }
+  return size;
+}
+
+
 
 _MHD_EXTERN struct MHD_PostProcessor *
 MHD_create_post_processor (struct MHD_Connection *connection,
@@ -823,66 +985,32 @@ process_value_to_boundary (struct MHD_PostProcessor *pp,
 {
   char *buf = (char *) &pp[1];
   size_t newline;
-  const char *r;
+  bool found;
 
   /* all data in buf until the boundary
      (\r\n--+boundary) is part of the value */
-  newline = 0;
-  while (1)
+  newline = find_delimiter (buf,
+                            pp->buffer_pos,
+                            boundary,
+                            blen,
+                            &found);
+  if (found)
   {
-    while (newline + 4 < pp->buffer_pos)
-    {
-      r = memchr (&buf[newline],
-                  '\r',
-                  pp->buffer_pos - newline - 4);
-      if (NULL == r)
-      {
-        newline = pp->buffer_pos - 4;
-        break;
-      }
-      newline = (size_t) (r - buf);
-      if (0 == memcmp ("\r\n--",
-                       &buf[newline],
-                       4))
-        break;
-      newline++;
-    }
-    if (newline + blen + 4 <= pp->buffer_pos)
-    {
-      /* can check boundary */
-      if (0 != memcmp (&buf[newline + 4],
-                       boundary,
-                       blen))
-      {
-        /* no boundary, "\r\n--" is part of content, skip */
-        newline += 4;
-        continue;
-      }
-      else
-      {
-        /* boundary found, process until newline then
-           skip boundary and go back to init */
-        pp->skip_rn = RN_Dash;
-        pp->state = next_state;
-        pp->dash_state = next_dash_state;
-        (*ioffptr) += blen + 4;             /* skip boundary as well */
-        buf[newline] = '\0';
-        break;
-      }
-    }
-    else
-    {
-      /* cannot check for boundary, process content that
-         we have and check again later; except, if we have
-         no content, abort (out of memory) */
-      if ( (0 == newline) &&
-           (pp->buffer_pos == pp->buffer_size) )
-      {
-        pp->state = PP_Error;
-        return MHD_NO;
-      }
-      break;
-    }
+    /* boundary found, process until newline then
+       skip boundary and go back to init */
+    pp->skip_rn = RN_Dash;
+    pp->state = next_state;
+    pp->dash_state = next_dash_state;
+    (*ioffptr) += blen + 4;             /* skip boundary as well */
+    buf[newline] = '\0';
+  }
+  else if ( (0 == newline) &&
+            (pp->buffer_pos == pp->buffer_size) )
+  {
+    /* cannot check for boundary and have no content
+       to process (out of memory) */
+    pp->state = PP_Error;
+    return MHD_NO;
   }
   /* newline is either at beginning of boundary or
      at least at the last character that we are sure
@@ -909,6 +1037,67 @@ process_value_to_boundary (struct MHD_PostProcessor *pp,
 }
 
 
+/**
+ * Pass the value directly from the input data to the application,
+ * without copying it to the buffer.  The data is passed up to the
+ * delimiter or up to the possible incomplete delimiter at the end of
+ * the input data, the rest is processed by the buffered state machine.
+ * The buffer must be empty.
+ *
+ * @param pp post processor context
+ * @param post_data the input data
+ * @param post_data_len number of bytes in @a post_data
+ * @param poffptr the current position in @a post_data, incremented
+ *                by the number of bytes processed
+ * @return #MHD_YES if we can continue processing,
+ *         #MHD_NO on error
+ */
+static int
+process_value_direct (struct MHD_PostProcessor *pp,
+                      const char *post_data,
+                      size_t post_data_len,
+                      size_t *poffptr)
+{
+  const char *data = &post_data[*poffptr];
+  size_t size;
+  bool found;
+
+  mhd_assert (0 == pp->buffer_pos);
+  mhd_assert (RN_Inactive == pp->skip_rn);
+  if (PP_ProcessValueToBoundary == pp->state)
+    size = find_delimiter (data,
+                           post_data_len - *poffptr,
+                           pp->boundary,
+                           pp->blen,
+                           &found);
+  else
+    size = find_delimiter (data,
+                           post_data_len - *poffptr,
+                           pp->nested_boundary,
+                           pp->nlen,
+                           &found);
+  if (0 == size)
+    return MHD_YES; /* The delimiter is processed by the state machine */
+  if (MHD_NO == pp->ikvi (pp->cls,
+                          MHD_POSTDATA_KIND,
+                          pp->content_name,
+                          pp->content_filename,
+                          pp->content_type,
+                          pp->content_transfer_encoding,
+                          data,
+                          pp->value_offset,
+                          size))
+  {
+    pp->state = PP_Error;
+    return MHD_NO;
+  }
+  pp->must_ikvi = false;
+  pp->value_offset += size;
+  (*poffptr) += size;
+  return MHD_YES;
+}
+
+
 /**
  *
  * @param pp post processor context
@@ -970,6 +1159,19 @@ post_process_multipart (struct MHD_PostProcessor *pp,
           ( (pp->buffer_pos > 0) &&
             (0 != state_changed) ) )
   {
+    if ( (0 == pp->buffer_pos) &&
+         (RN_Inactive == pp->skip_rn) &&
+         ( (PP_ProcessValueToBoundary == pp->state) ||
+           (PP_Nested_ProcessValueToBoundary == pp->state) ) )
+    {
+      /* nothing is buffered, hand the large spans of the value
+         to the application directly from the input data */
+      if (MHD_NO == process_value_direct (pp,
+                                          post_data,
+                                          post_data_len,
+                                          &poff))
+        return MHD_NO;
+    }
     /* first, move as much input data
        as possible to our internal buffer */
     max = pp->buffer_size - pp->buffer_pos;
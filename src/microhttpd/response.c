@@ -46,6 +46,9 @@
 #include "mhd_send.h"
 #include "mhd_compat.h"
 #include "mhd_assert.h"
+#ifdef COMPRESSION_SUPPORT
+#include "mhd_compress.h"
+#endif /* COMPRESSION_SUPPORT */
 
 
 #if defined(MHD_W32_MUTEX_)
@@ -144,6 +147,74 @@
   } \
 } while (0)
 
+/**
+ * Free the serialised user headers of the response and the compressed
+ * variants of the response.
+ * Must be called before any modification of the response headers.
+ *
+ * @param response the response to use
+ */
+static void
+response_drop_hdrs_cache (struct MHD_Response *response)
+{
+#ifdef COMPRESSION_SUPPORT
+  MHD_compress_drop_variants_ (response);
+#endif /* COMPRESSION_SUPPORT */
+  if (NULL == response->hdrs_cache)
+    return;
+  free (response->hdrs_cache);
+  response->hdrs_cache = NULL;
+  response->hdrs_cache_size = 0;
+}
+
+
+/**
+ * Serialise the user headers of the response to @e hdrs_cache.
+ * On failure the cache is not built and the headers will be serialised
+ * for every reply.
+ *
+ * @param response the response to use
+ */
+static void
+response_build_hdrs_cache (struct MHD_Response *response)
+{
+  struct MHD_HTTP_Res_Header *hdr;
+  size_t size;
+  size_t pos;
+  char *buf;
+
+  size = 0;
+  for (hdr = response->first_header; NULL != hdr; hdr = hdr->next)
+  {
+    if (MHD_HEADER_KIND == hdr->kind)
+      size += hdr->header_size + 2 + hdr->value_size + 2;
+  }
+  if (0 == size)
+    return;
+  buf = malloc (size);
+  if (NULL == buf)
+    return;
+  pos = 0;
+  for (hdr = response->first_header; NULL != hdr; hdr = hdr->next)
+  {
+    if (MHD_HEADER_KIND != hdr->kind)
+      continue;
+    memcpy (buf + pos, hdr->header, hdr->header_size);
+    pos += hdr->header_size;
+    buf[pos++] = ':';
+    buf[pos++] = ' ';
+    if (0 != hdr->value_size)
+      memcpy (buf + pos, hdr->value, hdr->value_size);
+    pos += hdr->value_size;
+    buf[pos++] = '\r';
+    buf[pos++] = '\n';
+  }
+  mhd_assert (size == pos);
+  response->hdrs_cache = buf;
+  response->hdrs_cache_size = size;
+}
+
+
 /**
  * Add a header or footer line to the response without checking.
  *
@@ -170,6 +241,7 @@ MHD_add_response_entry_no_check_ (struct MHD_Response *response,
 
   mhd_assert (0 != header_len);
   mhd_assert (0 != content_len);
+  response_drop_hdrs_cache (response);
   if (NULL == (hdr = MHD_calloc_ (1, sizeof (struct MHD_HTTP_Res_Header))))
     return false;
   hdr->header = malloc (header_len + 1);
@@ -578,6 +650,7 @@ MHD_add_response_header (struct MHD_Response *response,
                          const char *header,
                          const char *content)
 {
+  response_drop_hdrs_cache (response);
   if (MHD_str_equal_caseless_ (header, MHD_HTTP_HEADER_CONNECTION))
     return add_response_header_connection (response, content);
 
@@ -707,6 +780,7 @@ MHD_del_response_header (struct MHD_Response *response,
        (NULL == content) )
     return MHD_NO;
   header_len = strlen (header);
+  response_drop_hdrs_cache (response);
 
   if ((0 != (response->flags_auto & MHD_RAF_HAS_CONNECTION_HDR)) &&
       (MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONNECTION) == header_len) &&
@@ -973,6 +1047,95 @@ MHD_create_response_from_callback (uint64_t size,
 }
 
 
+#ifdef COMPRESSION_SUPPORT
+/**
+ * Add "Accept-Encoding" to the "Vary" header of the response when the
+ * compression is enabled, or remove it when the compression is
+ * disabled.  The existing "Vary" header is extended, the token
+ * added by the application is never removed.
+ *
+ * @param response the response to modify
+ * @param compress 'true' if the compression is enabled
+ * @return 'true' on success, 'false' if memory allocation failed
+ */
+static bool
+response_set_vary_ (struct MHD_Response *response,
+                    bool compress)
+{
+  static const char tkn[] = "Accept-Encoding";
+  static const char sfx[] = ", Accept-Encoding";
+  struct MHD_HTTP_Res_Header *hdr;
+  char *val;
+
+  hdr = MHD_get_response_element_n_ (response,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_VARY,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_VARY));
+  if (compress)
+  {
+    if ( (NULL != hdr) &&
+         (MHD_str_has_token_caseless_ (hdr->value, tkn,
+                                       MHD_STATICSTR_LEN_ (tkn)) ||
+          MHD_str_has_token_caseless_ (hdr->value, "*",
+                                       MHD_STATICSTR_LEN_ ("*"))) )
+      return true;
+    response_drop_hdrs_cache (response);
+    if (NULL == hdr)
+    {
+      if (! MHD_add_response_entry_no_check_ (response,
+                                              MHD_HEADER_KIND,
+                                              MHD_HTTP_HEADER_VARY,
+                                              MHD_STATICSTR_LEN_ ( \
+                                                MHD_HTTP_HEADER_VARY),
+                                              tkn,
+                                              MHD_STATICSTR_LEN_ (tkn)))
+        return false;
+      response->flags_auto |= MHD_RAF_VARY_ADDED;
+      return true;
+    }
+    val = (char *) malloc (hdr->value_size + MHD_STATICSTR_LEN_ (sfx) + 1);
+    if (NULL == val)
+      return false;
+    memcpy (val, hdr->value, hdr->value_size);
+    memcpy (val + hdr->value_size, sfx, sizeof (sfx));
+    free (hdr->value);
+    hdr->value = val;
+    hdr->value_size += MHD_STATICSTR_LEN_ (sfx);
+    response->flags_auto |= MHD_RAF_VARY_APPENDED;
+    return true;
+  }
+
+  response_drop_hdrs_cache (response);
+  if (NULL == hdr)
+    ; /* The header has been removed by the application */
+  else if ( (0 != (response->flags_auto & MHD_RAF_VARY_ADDED)) &&
+            (MHD_STATICSTR_LEN_ (tkn) == hdr->value_size) &&
+            (0 == memcmp (hdr->value, tkn, MHD_STATICSTR_LEN_ (tkn))) )
+  {
+    _MHD_remove_header (response, hdr);
+    free (hdr->value);
+    free (hdr->header);
+    free (hdr);
+  }
+  else if ( (0 != (response->flags_auto & MHD_RAF_VARY_APPENDED)) &&
+            (MHD_STATICSTR_LEN_ (sfx) < hdr->value_size) &&
+            (0 == memcmp (hdr->value + hdr->value_size
+                          - MHD_STATICSTR_LEN_ (sfx),
+                          sfx, MHD_STATICSTR_LEN_ (sfx))) )
+  {
+    hdr->value_size -= MHD_STATICSTR_LEN_ (sfx);
+    hdr->value[hdr->value_size] = 0;
+  }
+  response->flags_auto &=
+    ~((enum MHD_ResponseAutoFlags) MHD_RAF_VARY_ADDED
+      | (enum MHD_ResponseAutoFlags) MHD_RAF_VARY_APPENDED);
+  return true;
+}
+
+
+#endif /* COMPRESSION_SUPPORT */
+
 /**
  * Set special flags and options for a response.
  *
@@ -1009,9 +1172,8 @@ MHD_set_response_options (struct MHD_Response *response,
        (0 != response->total_size) )
     return MHD_NO;
 
+  /* Check the options before any modification of the response */
   ret = MHD_YES;
-  response->flags = flags;
-
   va_start (ap, flags);
   while (MHD_RO_END != (ro = va_arg (ap, enum MHD_ResponseOptions)))
   {
@@ -1025,7 +1187,22 @@ MHD_set_response_options (struct MHD_Response *response,
     }
   }
   va_end (ap);
-  return ret;
+  if (MHD_YES != ret)
+    return ret;
+
+#ifdef COMPRESSION_SUPPORT
+  /* The variants have the copy of the flags */
+  MHD_compress_drop_variants_ (response);
+  if ( (0 != (flags & MHD_RF_COMPRESS)) !=
+       (0 != (response->flags & MHD_RF_COMPRESS)) )
+  {
+    if (! response_set_vary_ (response,
+                              (0 != (flags & MHD_RF_COMPRESS))))
+      return MHD_NO;
+  }
+#endif /* COMPRESSION_SUPPORT */
+  response->flags = flags;
+  return MHD_YES;
 }
 
 
@@ -1840,7 +2017,8 @@ MHD_upgrade_action (struct MHD_UpgradeResponseHandle *urh,
 
     /* transition to special 'closed' state for start of cleanup */
 #ifdef HTTPS_SUPPORT
-    if (0 != (daemon->options & MHD_USE_TLS) )
+    if ( (0 != (daemon->options & MHD_USE_TLS) ) &&
+         (! urh->direct) )
     {
       /* signal that app is done by shutdown() of 'app' socket */
       /* Application will not use anyway this socket after this command. */
@@ -1871,6 +2049,134 @@ MHD_upgrade_action (struct MHD_UpgradeResponseHandle *urh,
 }
 
 
+/**
+ * Check whether the "upgraded" connection could be used by
+ * #MHD_upgrade_recv() and #MHD_upgrade_send().
+ *
+ * @param urh the handle to check
+ * @return the connection if it could be used, NULL otherwise
+ */
+static struct MHD_Connection *
+upgrade_direct_connection (struct MHD_UpgradeResponseHandle *urh)
+{
+  if ( (NULL == urh) ||
+       (! urh->direct) ||
+       (urh->was_closed) )
+    return NULL;
+  if ( (NULL == urh->connection) ||
+       (MHD_INVALID_SOCKET == urh->connection->socket_fd) )
+    return NULL;
+  return urh->connection;
+}
+
+
+/**
+ * Receive data from the "upgraded" connection in the direct mode.
+ *
+ * @param urh the handle of the "upgraded" connection
+ * @param[out] buf the buffer for the received data
+ * @param buf_size the size of the @a buf
+ * @return the number of bytes received,
+ *         zero if the remote side closed the connection,
+ *         #MHD_UPGRADE_IO_AGAIN if no data available,
+ *         #MHD_UPGRADE_IO_ERROR on error
+ */
+_MHD_EXTERN ssize_t
+MHD_upgrade_recv (struct MHD_UpgradeResponseHandle *urh,
+                  void *buf,
+                  size_t buf_size)
+{
+  struct MHD_Connection *connection;
+  ssize_t res;
+
+  connection = upgrade_direct_connection (urh);
+  if (NULL == connection)
+    return MHD_UPGRADE_IO_ERROR;
+  if (buf_size > MHD_SCKT_SEND_MAX_SIZE_)
+    buf_size = MHD_SCKT_SEND_MAX_SIZE_; /* return value limit */
+#ifdef HTTPS_SUPPORT
+  if (0 != (connection->daemon->options & MHD_USE_TLS))
+  {
+    res = gnutls_record_recv (connection->tls_session,
+                              buf,
+                              buf_size);
+    if (0 <= res)
+      return res;
+    if ( (GNUTLS_E_AGAIN == res) ||
+         (GNUTLS_E_INTERRUPTED == res) )
+      return MHD_UPGRADE_IO_AGAIN;
+    if (GNUTLS_E_PREMATURE_TERMINATION == res)
+      return 0; /* Treat as the remote close */
+    return MHD_UPGRADE_IO_ERROR;
+  }
+#endif /* HTTPS_SUPPORT */
+  res = MHD_recv_ (connection->socket_fd,
+                   buf,
+                   buf_size);
+  if (0 > res)
+  {
+    const int err = MHD_socket_get_error_ ();
+    if ( (MHD_SCKT_ERR_IS_EAGAIN_ (err)) ||
+         (MHD_SCKT_ERR_IS_EINTR_ (err)) )
+      return MHD_UPGRADE_IO_AGAIN;
+    return MHD_UPGRADE_IO_ERROR;
+  }
+  return res;
+}
+
+
+/**
+ * Send data over the "upgraded" connection in the direct mode.
+ *
+ * @param urh the handle of the "upgraded" connection
+ * @param buf the data to send
+ * @param buf_size the size of the data in the @a buf
+ * @return the number of bytes sent (could be less than @a buf_size),
+ *         #MHD_UPGRADE_IO_AGAIN if the data cannot be sent now,
+ *         #MHD_UPGRADE_IO_ERROR on error
+ */
+_MHD_EXTERN ssize_t
+MHD_upgrade_send (struct MHD_UpgradeResponseHandle *urh,
+                  const void *buf,
+                  size_t buf_size)
+{
+  struct MHD_Connection *connection;
+  ssize_t res;
+
+  connection = upgrade_direct_connection (urh);
+  if (NULL == connection)
+    return MHD_UPGRADE_IO_ERROR;
+  if (buf_size > MHD_SCKT_SEND_MAX_SIZE_)
+    buf_size = MHD_SCKT_SEND_MAX_SIZE_; /* return value limit */
+#ifdef HTTPS_SUPPORT
+  if (0 != (connection->daemon->options & MHD_USE_TLS))
+  {
+    res = gnutls_record_send (connection->tls_session,
+                              buf,
+                              buf_size);
+    if (0 <= res)
+      return res;
+    if ( (GNUTLS_E_AGAIN == res) ||
+         (GNUTLS_E_INTERRUPTED == res) )
+      return MHD_UPGRADE_IO_AGAIN;
+    return MHD_UPGRADE_IO_ERROR;
+  }
+#endif /* HTTPS_SUPPORT */
+  res = MHD_send_ (connection->socket_fd,
+                   buf,
+                   buf_size);
+  if (0 > res)
+  {
+    const int err = MHD_socket_get_error_ ();
+    if ( (MHD_SCKT_ERR_IS_EAGAIN_ (err)) ||
+         (MHD_SCKT_ERR_IS_EINTR_ (err)) )
+      return MHD_UPGRADE_IO_AGAIN;
+    return MHD_UPGRADE_IO_ERROR;
+  }
+  return res;
+}
+
+
 /**
  * We are done sending the header of a given response to the client.
  * Now it is time to perform the upgrade and hand over the connection
@@ -1922,8 +2228,10 @@ MHD_response_execute_upgrade_ (struct MHD_Response *response,
   connection->read_buffer_offset = 0;
   MHD_connection_set_nodelay_state_ (connection, false);
   MHD_connection_set_cork_state_ (connection, false);
+  urh->direct = (0 != (response->flags & MHD_RF_UPGRADE_DIRECT));
 #ifdef HTTPS_SUPPORT
-  if (0 != (daemon->options & MHD_USE_TLS) )
+  if ( (0 != (daemon->options & MHD_USE_TLS) ) &&
+       (! urh->direct) )
   {
     struct MemoryPool *pool;
     size_t avail;
@@ -2105,7 +2413,8 @@ MHD_response_execute_upgrade_ (struct MHD_Response *response,
   {
     urh->app.socket = MHD_INVALID_SOCKET;
     urh->mhd.socket = MHD_INVALID_SOCKET;
-    /* Non-TLS connection do not hold any additional resources. */
+    /* Non-TLS and direct connections do not hold any additional
+       resources, the data is not forwarded by MHD. */
     urh->clean_ready = true;
   }
 #else  /* ! HTTPS_SUPPORT */
@@ -2124,7 +2433,7 @@ MHD_response_execute_upgrade_ (struct MHD_Response *response,
                              connection->read_buffer,
                              rbo,
 #ifdef HTTPS_SUPPORT
-                             (0 == (daemon->options & MHD_USE_TLS) ) ?
+                             (MHD_INVALID_SOCKET == urh->app.socket) ?
                              connection->socket_fd : urh->app.socket,
 #else  /* ! HTTPS_SUPPORT */
                              connection->socket_fd,
@@ -2237,6 +2546,10 @@ MHD_destroy_response (struct MHD_Response *response)
   {
     free (response->data_iov);
   }
+  free (response->hdrs_cache);
+#ifdef COMPRESSION_SUPPORT
+  MHD_compress_drop_variants_ (response);
+#endif /* COMPRESSION_SUPPORT */
 
   while (NULL != response->first_header)
   {
@@ -2268,4 +2581,37 @@ MHD_increment_response_rc (struct MHD_Response *response)
 }
 
 
+/**
+ * Mark the @a response as queued for the reply.
+ * Serialises the response headers when the response is queued for
+ * the second time.
+ *
+ * @param response the queued response, must be referenced by the caller
+ * @param[out] hdrs_cache set to the serialised headers of the response,
+ *                        NULL if not available; valid while the response
+ *                        is referenced and the headers are not modified
+ * @param[out] hdrs_cache_size set to the size of @a hdrs_cache
+ */
+void
+MHD_response_queued_ (struct MHD_Response *response,
+                      const char **hdrs_cache,
+                      size_t *hdrs_cache_size)
+{
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&response->mutex);
+#endif
+  /* Only the responses re-used for several replies benefit from
+     the cache */
+  if (! response->was_queued)
+    response->was_queued = true;
+  else if (NULL == response->hdrs_cache)
+    response_build_hdrs_cache (response);
+  *hdrs_cache = response->hdrs_cache;
+  *hdrs_cache_size = response->hdrs_cache_size;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&response->mutex);
+#endif
+}
+
+
 /* end of response.c */
@@ -38,6 +38,23 @@ void
 MHD_increment_response_rc (struct MHD_Response *response);
 
 
+/**
+ * Mark the @a response as queued for the reply.
+ * Serialises the response headers when the response is queued for
+ * the second time.
+ *
+ * @param response the queued response, must be referenced by the caller
+ * @param[out] hdrs_cache set to the serialised headers of the response,
+ *                        NULL if not available; valid while the response
+ *                        is referenced and the headers are not modified
+ * @param[out] hdrs_cache_size set to the size of @a hdrs_cache
+ */
+void
+MHD_response_queued_ (struct MHD_Response *response,
+                      const char **hdrs_cache,
+                      size_t *hdrs_cache_size);
+
+
 /**
  * We are done sending the header of a given response
  * to the client.  Now it is time to perform the upgrade
@@ -0,0 +1,218 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_file_cache.c
+ * @brief  Test for the cache of the responses for the files
+ * @details The same response must be returned for the unchanged file,
+ *          the new response must be created for the changed file and
+ *          for the file removed from the cache by the LRU eviction.
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+/**
+ * The number of the test files.
+ */
+#define NUM_FILES 3
+
+static char paths[NUM_FILES][512];
+
+
+/**
+ * Write the file with the given content.
+ *
+ * @param path the path of the file
+ * @param content the content of the file
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+write_file (const char *path,
+            const char *content)
+{
+  FILE *f;
+
+  f = fopen (path, "wb");
+  if (NULL == f)
+    return 1;
+  if (strlen (content) != fwrite (content, 1, strlen (content), f))
+  {
+    fclose (f);
+    return 1;
+  }
+  return (0 == fclose (f)) ? 0 : 1;
+}
+
+
+/**
+ * Check the headers of the cached response.
+ *
+ * @param r the response to check
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+check_headers (struct MHD_Response *r)
+{
+  const char *etag;
+  const char *lm;
+
+  etag = MHD_get_response_header (r, MHD_HTTP_HEADER_ETAG);
+  lm = MHD_get_response_header (r, MHD_HTTP_HEADER_LAST_MODIFIED);
+  if ( (NULL == etag) || ('"' != etag[0]) ||
+       (NULL == lm) || (29 != strlen (lm)) ||
+       (0 != strcmp (lm + 25, " GMT")) )
+  {
+    fprintf (stderr, "Wrong headers: ETag '%s', Last-Modified '%s'.\n",
+             (NULL != etag) ? etag : "(NULL)",
+             (NULL != lm) ? lm : "(NULL)");
+    return 1;
+  }
+  return 0;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  struct MHD_FileCache *cache;
+  struct MHD_Response *r1;
+  struct MHD_Response *r2;
+  struct MHD_Response *r3;
+  const char *tmp;
+  char *etag;
+  unsigned int i;
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  if ( (NULL == (tmp = getenv ("TMPDIR"))) &&
+       (NULL == (tmp = getenv ("TMP"))) &&
+       (NULL == (tmp = getenv ("TEMP"))) )
+    tmp = "/tmp";
+  for (i = 0; i < NUM_FILES; i++)
+  {
+    snprintf (paths[i], sizeof (paths[i]), "%s/test-mhd-file-cache-%u",
+              tmp, i);
+    if (0 != write_file (paths[i], "initial content"))
+      return 99;
+  }
+  cache = MHD_file_cache_create (NUM_FILES - 1, 0);
+  if (NULL == cache)
+    return 99;
+
+  /* The same response for the unchanged file */
+  r1 = MHD_file_cache_get_response (cache, paths[0]);
+  r2 = MHD_file_cache_get_response (cache, paths[0]);
+  if ( (NULL == r1) || (r1 != r2) )
+  {
+    fprintf (stderr, "The cached response is not used.\n");
+    errorCount++;
+  }
+  if (NULL != r1)
+    errorCount += check_headers (r1);
+  if (NULL != r2)
+    MHD_destroy_response (r2);
+
+  /* The new response for the changed file */
+  etag = (NULL != r1) ?
+         strdup (MHD_get_response_header (r1, MHD_HTTP_HEADER_ETAG)) : NULL;
+  if (0 != write_file (paths[0], "changed content, longer"))
+    errorCount++;
+  r2 = MHD_file_cache_get_response (cache, paths[0]);
+  if ( (NULL == r2) || (r1 == r2) )
+  {
+    fprintf (stderr, "The changed file is not detected.\n");
+    errorCount++;
+  }
+  else if ( (NULL != etag) &&
+            (0 == strcmp (etag,
+                          MHD_get_response_header (r2,
+                                                   MHD_HTTP_HEADER_ETAG))) )
+  {
+    fprintf (stderr, "The ETag of the changed file is not changed.\n");
+    errorCount++;
+  }
+  free (etag);
+  if (NULL != r1)
+    MHD_destroy_response (r1);
+  r1 = r2;
+
+  /* The least recently used file is evicted */
+  r2 = MHD_file_cache_get_response (cache, paths[1]);
+  r3 = MHD_file_cache_get_response (cache, paths[2]);
+  if ( (NULL == r2) || (NULL == r3) )
+    errorCount++;
+  if (NULL != r3)
+    MHD_destroy_response (r3);
+  r3 = MHD_file_cache_get_response (cache, paths[0]);
+  if ( (NULL == r3) || (r1 == r3) )
+  {
+    fprintf (stderr, "The least recently used file is not evicted.\n");
+    errorCount++;
+  }
+  if (NULL != r3)
+    MHD_destroy_response (r3);
+  /* The second file has been evicted when the first file was added */
+  r3 = MHD_file_cache_get_response (cache, paths[1]);
+  if ( (NULL == r3) || (r2 == r3) )
+  {
+    fprintf (stderr, "The wrong file is evicted.\n");
+    errorCount++;
+  }
+  if (NULL != r3)
+    MHD_destroy_response (r3);
+
+  /* The removed file is not returned */
+  MHD_file_cache_invalidate (cache, paths[2]);
+  (void) unlink (paths[2]);
+  if (NULL != MHD_file_cache_get_response (cache, paths[2]))
+  {
+    fprintf (stderr, "The response for the removed file is returned.\n");
+    errorCount++;
+  }
+  if (NULL != MHD_file_cache_get_response (cache, tmp))
+  {
+    fprintf (stderr, "The response for the directory is returned.\n");
+    errorCount++;
+  }
+
+  /* The responses are valid after the cache is destroyed */
+  MHD_file_cache_destroy (cache);
+  if (NULL != r1)
+  {
+    errorCount += check_headers (r1);
+    MHD_destroy_response (r1);
+  }
+  if (NULL != r2)
+    MHD_destroy_response (r2);
+  for (i = 0; i < NUM_FILES; i++)
+    (void) unlink (paths[i]);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return errorCount != 0;       /* 0 == pass */
+}
@@ -0,0 +1,340 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_header_lookup.c
+ * @brief  Test for the lookup of the request values in the requests
+ *         with many headers, cookies and GET arguments
+ * @details The number of values is large enough to use the hash
+ *          indices.  The values are repeated with different case of
+ *          the names, the first value must be found.
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif /* HAVE_NETINET_IN_H */
+
+/**
+ * The number of headers, cookies and GET arguments of each type.
+ */
+#define NUM_VALUES 40
+
+/**
+ * The number of failed checks in the access handler.
+ */
+static unsigned int handler_errors;
+
+
+/**
+ * Check the value found by the lookup.
+ *
+ * @param connection the connection to use
+ * @param kind the kind of the value
+ * @param key the key to look for
+ * @param expected the expected value, NULL if the value must not be found
+ */
+static void
+check_value (struct MHD_Connection *connection,
+             enum MHD_ValueKind kind,
+             const char *key,
+             const char *expected)
+{
+  const char *value;
+
+  value = MHD_lookup_connection_value (connection,
+                                       kind,
+                                       key);
+  if ( (NULL == expected) ?
+       (NULL != value) :
+       ((NULL == value) || (0 != strcmp (expected, value))) )
+  {
+    fprintf (stderr,
+             "Lookup of '%s' (kind %d): got '%s', expected '%s'.\n",
+             key, (int) kind,
+             (NULL != value) ? value : "(NULL)",
+             (NULL != expected) ? expected : "(NULL)");
+    handler_errors++;
+  }
+}
+
+
+static enum MHD_Result
+ahc_check (void *cls,
+           struct MHD_Connection *connection,
+           const char *url,
+           const char *method,
+           const char *version,
+           const char *upload_data, size_t *upload_data_size,
+           void **req_cls)
+{
+  static int ptr;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  char key[32];
+  char val[32];
+  unsigned int i;
+  (void) cls; (void) url; (void) method; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size;           /* Unused. Silent compiler warning. */
+
+  if (&ptr != *req_cls)
+  {
+    *req_cls = &ptr;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  for (i = 0; i < NUM_VALUES; i++)
+  {
+    snprintf (key, sizeof (key), "x-HEADER-%u", i);
+    snprintf (val, sizeof (val), "h%u", i);
+    check_value (connection, MHD_HEADER_KIND, key, val);
+    snprintf (key, sizeof (key), "ck%u", i);
+    snprintf (val, sizeof (val), "c%u", i);
+    check_value (connection, MHD_COOKIE_KIND, key, val);
+    snprintf (key, sizeof (key), "ARG%u", i);
+    snprintf (val, sizeof (val), "a%u", i);
+    check_value (connection, MHD_GET_ARGUMENT_KIND, key, val);
+    /* Headers must be found by the bitmask too */
+    snprintf (key, sizeof (key), "X-Header-%u", i);
+    snprintf (val, sizeof (val), "h%u", i);
+    check_value (connection, MHD_HEADER_KIND | MHD_FOOTER_KIND, key, val);
+  }
+  check_value (connection, MHD_HEADER_KIND, "host", "example.com");
+  check_value (connection, MHD_HEADER_KIND, "content-type", "text/plain");
+  check_value (connection, MHD_HEADER_KIND, "Content-Length", NULL);
+  check_value (connection, MHD_HEADER_KIND, "X-Header-", NULL);
+  check_value (connection, MHD_HEADER_KIND, "X-Missing", NULL);
+  check_value (connection, MHD_COOKIE_KIND, "X-Header-1", NULL);
+  check_value (connection, MHD_GET_ARGUMENT_KIND, "ck1", NULL);
+
+  /* The values added by the application must be found as well */
+  for (i = 0; i < NUM_VALUES; i++)
+  {
+    static char keys[NUM_VALUES][32];
+    static char vals[NUM_VALUES][32];
+
+    snprintf (keys[i], sizeof (keys[i]), "X-Added-%u", i);
+    snprintf (vals[i], sizeof (vals[i]), "added%u", i);
+    if (MHD_YES != MHD_set_connection_value (connection,
+                                             MHD_HEADER_KIND,
+                                             keys[i],
+                                             vals[i]))
+    {
+      fprintf (stderr, "Failed to add the value.\n");
+      handler_errors++;
+    }
+    check_value (connection, MHD_HEADER_KIND, keys[i], vals[i]);
+    /* Already existing header must not be replaced */
+    if (MHD_YES != MHD_set_connection_value (connection,
+                                             MHD_HEADER_KIND,
+                                             "X-HEADER-0",
+                                             "replaced"))
+      handler_errors++;
+  }
+  for (i = 0; i < NUM_VALUES; i++)
+  {
+    snprintf (key, sizeof (key), "x-added-%u", i);
+    snprintf (val, sizeof (val), "added%u", i);
+    check_value (connection, MHD_HEADER_KIND, key, val);
+  }
+  check_value (connection, MHD_HEADER_KIND, "X-Header-0", "h0");
+
+  response = MHD_create_response_from_buffer (0,
+                                              NULL,
+                                              MHD_RESPMEM_PERSISTENT);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection,
+                            MHD_HTTP_OK,
+                            response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Append the string to the buffer.
+ *
+ * @param buf the buffer
+ * @param buf_size the size of the @a buf
+ * @param[in,out] pos the position in the @a buf
+ * @param str the string to append
+ */
+static void
+append_str (char *buf,
+            size_t buf_size,
+            size_t *pos,
+            const char *str)
+{
+  const size_t len = strlen (str);
+
+  if (*pos + len < buf_size)
+  {
+    memcpy (buf + *pos, str, len);
+    *pos += len;
+  }
+  buf[*pos] = 0;
+}
+
+
+/**
+ * Build the request with many values.
+ *
+ * @param buf the buffer for the request
+ * @param buf_size the size of the @a buf
+ * @return the size of the request
+ */
+static size_t
+build_request (char *buf,
+               size_t buf_size)
+{
+  char tmp[64];
+  size_t pos = 0;
+  unsigned int i;
+
+  append_str (buf, buf_size, &pos, "GET /?");
+  for (i = 0; i < NUM_VALUES; i++)
+  {
+    snprintf (tmp, sizeof (tmp), "ARG%u=a%u&", i, i);
+    append_str (buf, buf_size, &pos, tmp);
+  }
+  /* The GET arguments are case-sensitive, but the lookup is not */
+  append_str (buf, buf_size, &pos, "arg0=dup");
+  append_str (buf, buf_size, &pos,
+              " HTTP/1.1\r\nHost: example.com\r\n"
+              "Content-Type: text/plain\r\n");
+  for (i = 0; i < NUM_VALUES; i++)
+  {
+    snprintf (tmp, sizeof (tmp), "X-Header-%u: h%u\r\n", i, i);
+    append_str (buf, buf_size, &pos, tmp);
+  }
+  for (i = 0; i < NUM_VALUES; i++)
+  {
+    snprintf (tmp, sizeof (tmp), "x-header-%u: dup%u\r\n", i, i);
+    append_str (buf, buf_size, &pos, tmp);
+  }
+  append_str (buf, buf_size, &pos, "Connection: keep-alive\r\n");
+  append_str (buf, buf_size, &pos, "Cookie: ");
+  for (i = 0; i < NUM_VALUES; i++)
+  {
+    snprintf (tmp, sizeof (tmp), "ck%u=c%u; ", i, i);
+    append_str (buf, buf_size, &pos, tmp);
+  }
+  append_str (buf, buf_size, &pos, "CK1=dup\r\n");
+  /* The repeated header with the token must be checked as well */
+  append_str (buf, buf_size, &pos, "CONNECTION: close\r\n\r\n");
+  return pos;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  static char req[16 * 1024];
+  struct MHD_Daemon *d;
+  struct sockaddr_in sa;
+  MHD_socket sv[2];
+  size_t req_size;
+  size_t sent;
+  char reply[1024];
+  ssize_t got;
+  unsigned int i;
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  req_size = build_request (req, sizeof (req));
+  d = MHD_start_daemon (MHD_USE_NO_LISTEN_SOCKET,
+                        0, NULL, NULL,
+                        &ahc_check, NULL,
+                        MHD_OPTION_CONNECTION_MEMORY_LIMIT,
+                        (size_t) (64 * 1024),
+                        MHD_OPTION_END);
+  if (NULL == d)
+    return 77;
+  if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+  {
+    MHD_stop_daemon (d);
+    return 99;
+  }
+  memset (&sa, 0, sizeof (sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (MHD_YES != MHD_add_connection (d,
+                                     sv[0],
+                                     (const struct sockaddr *) &sa,
+                                     sizeof (sa)))
+  {
+    (void) close (sv[1]);
+    MHD_stop_daemon (d);
+    return 99;
+  }
+  sent = 0;
+  while (sent < req_size)
+  {
+    got = send (sv[1], req + sent, req_size - sent, 0);
+    if (0 >= got)
+    {
+      errorCount++;
+      break;
+    }
+    sent += (size_t) got;
+    (void) MHD_run (d);
+  }
+  for (i = 0; i < 10; i++)
+    (void) MHD_run (d);
+  got = recv (sv[1], reply, sizeof (reply) - 1, MSG_DONTWAIT);
+  if (0 >= got)
+  {
+    fprintf (stderr, "No reply received.\n");
+    errorCount++;
+  }
+  else
+  {
+    reply[got] = 0;
+    if (0 != memcmp (reply, "HTTP/1.1 200", strlen ("HTTP/1.1 200")))
+    {
+      fprintf (stderr, "Unexpected reply: %s\n", reply);
+      errorCount++;
+    }
+    if (NULL == strstr (reply, "Connection: close"))
+    {
+      fprintf (stderr, "The 'close' token has not been detected.\n");
+      errorCount++;
+    }
+  }
+  (void) close (sv[1]);
+  MHD_stop_daemon (d);
+  errorCount += handler_errors;
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return errorCount != 0;       /* 0 == pass */
+}
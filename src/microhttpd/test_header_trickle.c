@@ -0,0 +1,238 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_header_trickle.c
+ * @brief  Stress test for the request header received byte by byte
+ * @details The long header line is sent to the daemon one byte per
+ *          MHD_run() call, so every byte is received by the separate
+ *          read.  The processing time must grow linearly with the size
+ *          of the header line, not quadratically.
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif /* HAVE_NETINET_IN_H */
+
+/**
+ * The size of the short header line, in bytes.
+ */
+#define SHORT_HEADER_SIZE (16 * 1024)
+
+/**
+ * The size of the long header line, in bytes.
+ */
+#define LONG_HEADER_SIZE (64 * 1024)
+
+/**
+ * The maximum allowed ratio of the processing time of the long header
+ * to the processing time of the short header.  The linear processing
+ * gives four, the quadratic processing gives up to sixteen.
+ */
+#define MAX_TIME_RATIO 9
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int ptr;
+  size_t *hdr_size = (size_t *) cls;
+  const char *value;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) url; (void) method; (void) version;      /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size;    /* Unused. Silent compiler warning. */
+
+  if (&ptr != *req_cls)
+  {
+    *req_cls = &ptr;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  value = MHD_lookup_connection_value (connection,
+                                       MHD_HEADER_KIND,
+                                       "X-Long");
+  if ( (NULL == value) ||
+       (*hdr_size != strlen (value)) )
+    return MHD_NO;
+  response = MHD_create_response_from_buffer (0,
+                                              NULL,
+                                              MHD_RESPMEM_PERSISTENT);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection,
+                            MHD_HTTP_OK,
+                            response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Send the request with the long header byte by byte.
+ *
+ * @param hdr_size the size of the value of the long header
+ * @param[out] secs set to the processor time used
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+trickle_header (size_t hdr_size,
+                double *secs)
+{
+  static const char req_start[] =
+    "GET / HTTP/1.1\r\nHost: example.com\r\nX-Long: ";
+  static const char req_end[] = "\r\n\r\n";
+  struct MHD_Daemon *d;
+  struct sockaddr_in sa;
+  MHD_socket sv[2];
+  char *req;
+  size_t req_size;
+  size_t i;
+  char reply[64];
+  ssize_t got;
+  clock_t start;
+  unsigned int ret;
+
+  req_size = strlen (req_start) + hdr_size + strlen (req_end);
+  req = malloc (req_size);
+  if (NULL == req)
+    return 99;
+  memcpy (req, req_start, strlen (req_start));
+  memset (req + strlen (req_start), 'a', hdr_size);
+  memcpy (req + strlen (req_start) + hdr_size, req_end, strlen (req_end));
+
+  d = MHD_start_daemon (MHD_USE_NO_LISTEN_SOCKET,
+                        0, NULL, NULL,
+                        &ahc_echo, &hdr_size,
+                        MHD_OPTION_CONNECTION_MEMORY_LIMIT,
+                        (size_t) (4 * LONG_HEADER_SIZE),
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    free (req);
+    return 16;
+  }
+  if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+  {
+    MHD_stop_daemon (d);
+    free (req);
+    return 99;
+  }
+  memset (&sa, 0, sizeof (sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (MHD_YES != MHD_add_connection (d,
+                                     sv[0],
+                                     (const struct sockaddr *) &sa,
+                                     sizeof (sa)))
+  {
+    (void) close (sv[1]);
+    MHD_stop_daemon (d);
+    free (req);
+    return 32;
+  }
+  ret = 0;
+  start = clock ();
+  for (i = 0; i < req_size; i++)
+  {
+    if (1 != send (sv[1], req + i, 1, 0))
+    {
+      ret = 64;
+      break;
+    }
+    if (MHD_YES != MHD_run (d))
+    {
+      ret = 64;
+      break;
+    }
+  }
+  *secs = (double) (clock () - start) / CLOCKS_PER_SEC;
+  free (req);
+  if (0 == ret)
+  {
+    /* Process the request and send the reply */
+    for (i = 0; i < 10; i++)
+      (void) MHD_run (d);
+    got = recv (sv[1], reply, sizeof (reply) - 1, MSG_DONTWAIT);
+    if ( (0 >= got) ||
+         (0 != memcmp (reply,
+                       "HTTP/1.1 200",
+                       strlen ("HTTP/1.1 200"))) )
+    {
+      fprintf (stderr,
+               "Unexpected reply for %u bytes header.\n",
+               (unsigned int) hdr_size);
+      ret = 128;
+    }
+  }
+  (void) close (sv[1]);
+  MHD_stop_daemon (d);
+  return ret;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  double short_secs;
+  double long_secs;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  errorCount += trickle_header (SHORT_HEADER_SIZE, &short_secs);
+  errorCount += trickle_header (LONG_HEADER_SIZE, &long_secs);
+  if (0 == errorCount)
+  {
+    printf ("%u bytes header: %.3f s, %u bytes header: %.3f s\n",
+            (unsigned int) SHORT_HEADER_SIZE, short_secs,
+            (unsigned int) LONG_HEADER_SIZE, long_secs);
+    /* Ignore too short times, they are not precise enough */
+    if ( (0.05 < long_secs) &&
+         (short_secs * MAX_TIME_RATIO < long_secs) )
+    {
+      fprintf (stderr,
+               "The processing time grows faster than linearly.\n");
+      errorCount++;
+    }
+  }
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return errorCount != 0;       /* 0 == pass */
+}
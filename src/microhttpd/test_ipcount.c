@@ -0,0 +1,343 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_ipcount.c
+ * @brief  Unit tests and benchmark for the per-IP connection counters table
+ * @author agent
+ */
+
+#include "mhd_options.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "mhd_ipcount.h"
+#include "mhd_mono_clock.h"
+#ifdef MHD_USE_POSIX_THREADS
+#include <pthread.h>
+#endif /* MHD_USE_POSIX_THREADS */
+
+/**
+ * Number of add/del pairs per thread in the benchmark.
+ */
+#define BENCH_ROUNDS 200000
+
+/**
+ * Number of distinct addresses used by each benchmark thread.
+ */
+#define BENCH_ADDRS 64
+
+static int verbose;
+
+
+/**
+ * Initialise @a key with IPv4 address @a ip.
+ *
+ * @param ip the address in host byte order
+ * @param[out] key the key to initialise
+ */
+static void
+make_key (uint32_t ip,
+          struct MHD_IPCount *key)
+{
+  struct sockaddr_in sa;
+
+  memset (&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (ip);
+  if (! MHD_ip_addr_to_key ((const struct sockaddr *) &sa,
+                            (socklen_t) sizeof(sa),
+                            key))
+    abort ();
+}
+
+
+static unsigned int
+test_limit (void)
+{
+  struct MHD_IPCountTable *t;
+  struct MHD_IPCount k1;
+  struct MHD_IPCount k2;
+  unsigned int errors = 0;
+
+  t = MHD_ipcount_table_create (100);
+  if (NULL == t)
+    return 1;
+  make_key (0x7f000001, &k1);
+  make_key (0x0a000001, &k2);
+  if (MHD_IPCOUNT_OK != MHD_ipcount_add (t, &k1, 2))
+    errors++;
+  if (MHD_IPCOUNT_OK != MHD_ipcount_add (t, &k1, 2))
+    errors++;
+  if (MHD_IPCOUNT_LIMIT != MHD_ipcount_add (t, &k1, 2))
+    errors++;
+  if (MHD_IPCOUNT_OK != MHD_ipcount_add (t, &k2, 2))
+    errors++;
+  if (! MHD_ipcount_del (t, &k1))
+    errors++;
+  if (MHD_IPCOUNT_OK != MHD_ipcount_add (t, &k1, 2))
+    errors++;
+  if (! MHD_ipcount_del (t, &k1))
+    errors++;
+  if (! MHD_ipcount_del (t, &k1))
+    errors++;
+  if (MHD_ipcount_del (t, &k1))
+    errors++;
+  if (! MHD_ipcount_del (t, &k2))
+    errors++;
+  if (MHD_ipcount_del (t, &k2))
+    errors++;
+  MHD_ipcount_table_destroy (t);
+  if (0 != errors)
+    fprintf (stderr, "test_limit() failed: %u errors.\n", errors);
+  return errors;
+}
+
+
+/**
+ * The number of addresses added to the small table.
+ */
+#define GROW_ADDRS 20000
+
+
+static unsigned int
+test_grow_and_delete (void)
+{
+  struct MHD_IPCountTable *t;
+  struct MHD_IPCount k;
+  unsigned int i;
+  unsigned int errors = 0;
+
+  t = MHD_ipcount_table_create (16);
+  if (NULL == t)
+    return 1;
+  /* Much more addresses than the initial size, the table must grow */
+  for (i = 0; i < GROW_ADDRS; i++)
+  {
+    make_key (0x0a000000 + i * 7919, &k);
+    if (MHD_IPCOUNT_OK != MHD_ipcount_add (t, &k, 1))
+      errors++;
+  }
+  if (0 != errors)
+    fprintf (stderr, "Failed to add addresses to the table.\n");
+  /* Delete every second address, the rest must still be reachable */
+  for (i = 0; i < GROW_ADDRS; i += 2)
+  {
+    make_key (0x0a000000 + i * 7919, &k);
+    if (! MHD_ipcount_del (t, &k))
+      errors++;
+  }
+  for (i = 0; i < GROW_ADDRS; i++)
+  {
+    make_key (0x0a000000 + i * 7919, &k);
+    if ((0 == i % 2) == (MHD_IPCOUNT_LIMIT == MHD_ipcount_add (t, &k, 1)))
+      errors++;
+  }
+  for (i = 0; i < GROW_ADDRS; i++)
+  {
+    make_key (0x0a000000 + i * 7919, &k);
+    if (! MHD_ipcount_del (t, &k))
+      errors++;
+    if (MHD_ipcount_del (t, &k))
+      errors++;
+  }
+  MHD_ipcount_table_destroy (t);
+  /* The huge connection limit must not allocate huge table */
+  t = MHD_ipcount_table_create (UINT_MAX);
+  if (NULL == t)
+  {
+    fprintf (stderr, "Failed to create the table for UINT_MAX "
+             "addresses.\n");
+    errors++;
+  }
+  MHD_ipcount_table_destroy (t);
+  if (0 != errors)
+    fprintf (stderr, "test_grow_and_delete() failed: %u errors.\n", errors);
+  return errors;
+}
+
+
+static unsigned int
+test_random_ops (void)
+{
+  static unsigned int counts[512];
+  struct MHD_IPCountTable *t;
+  struct MHD_IPCount k;
+  uint32_t rnd = 12345;
+  unsigned int i;
+  unsigned int errors = 0;
+
+  t = MHD_ipcount_table_create (1024);
+  if (NULL == t)
+    return 1;
+  memset (counts, 0, sizeof(counts));
+  for (i = 0; i < 200000; i++)
+  {
+    unsigned int n;
+
+    rnd = rnd * 1103515245U + 12345U;
+    n = (rnd >> 8) % 512;
+    make_key (0xc0a80000 + n, &k);
+    if (0 != (rnd & 0x80000000U))
+    {
+      enum MHD_IPCountResult r;
+
+      r = MHD_ipcount_add (t, &k, 3);
+      if (3 > counts[n])
+      {
+        if (MHD_IPCOUNT_OK != r)
+          errors++;
+        counts[n]++;
+      }
+      else if (MHD_IPCOUNT_LIMIT != r)
+        errors++;
+    }
+    else
+    {
+      if (MHD_ipcount_del (t, &k) != (0 != counts[n]))
+        errors++;
+      if (0 != counts[n])
+        counts[n]--;
+    }
+  }
+  MHD_ipcount_table_destroy (t);
+  if (0 != errors)
+    fprintf (stderr, "test_random_ops() failed: %u errors.\n", errors);
+  return errors;
+}
+
+
+#ifdef MHD_USE_POSIX_THREADS
+
+struct BenchThread
+{
+  pthread_t tid;
+  struct MHD_IPCountTable *t;
+  uint32_t base;
+  unsigned int num_addrs;
+  unsigned int errors;
+};
+
+
+static void *
+bench_thread (void *cls)
+{
+  struct BenchThread *bt = (struct BenchThread *) cls;
+  struct MHD_IPCount keys[BENCH_ADDRS];
+  unsigned int i;
+
+  for (i = 0; i < bt->num_addrs; i++)
+    make_key (bt->base + i, &keys[i]);
+  for (i = 0; i < BENCH_ROUNDS; i++)
+  {
+    const struct MHD_IPCount *k = &keys[i % bt->num_addrs];
+
+    if (MHD_IPCOUNT_OK != MHD_ipcount_add (bt->t, k, 1000000))
+      bt->errors++;
+    if (! MHD_ipcount_del (bt->t, k))
+      bt->errors++;
+  }
+  return NULL;
+}
+
+
+/**
+ * Run add/del pairs in @a num_threads threads.
+ *
+ * @param num_threads the number of threads
+ * @param single_addr if non-zero, all threads use the same single address,
+ *                    so all operations are serialised by one stripe lock,
+ *                    otherwise each thread uses its own addresses
+ * @return the number of errors
+ */
+static unsigned int
+bench_run (unsigned int num_threads,
+           int single_addr)
+{
+  struct BenchThread bt[8];
+  struct MHD_IPCountTable *t;
+  uint64_t start;
+  uint64_t elapsed;
+  unsigned int i;
+  unsigned int errors = 0;
+
+  t = MHD_ipcount_table_create (1024);
+  if (NULL == t)
+    return 1;
+  start = MHD_monotonic_msec_counter ();
+  for (i = 0; i < num_threads; i++)
+  {
+    bt[i].t = t;
+    bt[i].base = single_addr ? 0x0a000000 : (0x0a000000 + i * 0x10000);
+    bt[i].num_addrs = single_addr ? 1 : BENCH_ADDRS;
+    bt[i].errors = 0;
+    if (0 != pthread_create (&bt[i].tid, NULL, &bench_thread, &bt[i]))
+      abort ();
+  }
+  for (i = 0; i < num_threads; i++)
+  {
+    if (0 != pthread_join (bt[i].tid, NULL))
+      abort ();
+    errors += bt[i].errors;
+  }
+  elapsed = MHD_monotonic_msec_counter () - start;
+  MHD_ipcount_table_destroy (t);
+  if (verbose)
+    printf ("%u thread(s), %s: %u add/del pairs in %u ms " \
+            "(%.0f pairs/ms)\n",
+            num_threads, single_addr ? "one address" : "distinct addresses",
+            num_threads * BENCH_ROUNDS, (unsigned int) elapsed,
+            (double) num_threads * BENCH_ROUNDS
+            / (double) (0 == elapsed ? 1 : elapsed));
+  if (0 != errors)
+    fprintf (stderr, "bench_run() failed: %u errors.\n", errors);
+  return errors;
+}
+
+
+#endif /* MHD_USE_POSIX_THREADS */
+
+
+int
+main (int argc, char *argv[])
+{
+  unsigned int errcount = 0;
+#ifdef MHD_USE_POSIX_THREADS
+  unsigned int n;
+#endif /* MHD_USE_POSIX_THREADS */
+
+  verbose = (1 < argc) && (0 == strcmp (argv[1], "-v"));
+  MHD_monotonic_sec_counter_init ();
+  errcount += test_limit ();
+  errcount += test_grow_and_delete ();
+  errcount += test_random_ops ();
+#ifdef MHD_USE_POSIX_THREADS
+  for (n = 1; n <= 8; n *= 2)
+  {
+    errcount += bench_run (n, 0);
+    errcount += bench_run (n, ! 0);
+  }
+#endif /* MHD_USE_POSIX_THREADS */
+  MHD_monotonic_sec_counter_finish ();
+  if (0 != errcount)
+    fprintf (stderr, "Error (code: %u)\n", errcount);
+  return (0 == errcount) ? 0 : 1;
+}
@@ -240,6 +240,7 @@ test_urlencoding_case (unsigned int want_start,
     memset (&connection, 0, sizeof (struct MHD_Connection));
     memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
     connection.headers_received = &header;
+    connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
     header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
     header.value = MHD_HTTP_POST_ENCODING_FORM_URLENCODED;
     header.header_size = MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_TYPE);
@@ -390,6 +391,7 @@ test_multipart_garbage (void)
     memset (&connection, 0, sizeof (struct MHD_Connection));
     memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
     connection.headers_received = &header;
+    connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
     header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
     header.value =
       MHD_HTTP_POST_ENCODING_MULTIPART_FORMDATA ", boundary=AaB03x";
@@ -452,6 +454,7 @@ test_multipart_splits (void)
     memset (&connection, 0, sizeof (struct MHD_Connection));
     memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
     connection.headers_received = &header;
+    connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
     header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
     header.value =
       MHD_HTTP_POST_ENCODING_MULTIPART_FORMDATA ", boundary=AaB03x";
@@ -511,6 +514,7 @@ test_multipart (void)
   memset (&connection, 0, sizeof (struct MHD_Connection));
   memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
   connection.headers_received = &header;
+  connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
   header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
   header.value =
     MHD_HTTP_POST_ENCODING_MULTIPART_FORMDATA ", boundary=AaB03x";
@@ -568,6 +572,7 @@ test_nested_multipart (void)
   memset (&connection, 0, sizeof (struct MHD_Connection));
   memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
   connection.headers_received = &header;
+  connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
   header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
   header.value =
     MHD_HTTP_POST_ENCODING_MULTIPART_FORMDATA ", boundary=AaB03x";
@@ -643,6 +648,7 @@ test_overflow (void)
   memset (&connection, 0, sizeof (struct MHD_Connection));
   memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
   connection.headers_received = &header;
+  connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
   header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
   header.value = MHD_HTTP_POST_ENCODING_FORM_URLENCODED;
   header.header_size = strlen (header.header);
@@ -702,6 +708,7 @@ test_empty_key (void)
     memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
 
     connection.headers_received = &header;
+    connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
     connection.headers_received_tail = &header;
     header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
     header.header_size = MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_TYPE);
@@ -756,6 +763,7 @@ test_double_value (void)
     memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
 
     connection.headers_received = &header;
+    connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
     connection.headers_received_tail = &header;
     header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
     header.header_size = MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_TYPE);
@@ -82,6 +82,7 @@ main (int argc, char *const *argv)
   memset (&connection, 0, sizeof (struct MHD_Connection));
   memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
   connection.headers_received = &header;
+  connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
   header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
   header.value = MHD_HTTP_POST_ENCODING_FORM_URLENCODED;
   header.header_size = strlen (header.header);
@@ -78,6 +78,7 @@ test_simple_large (void)
   memset (&connection, 0, sizeof (struct MHD_Connection));
   memset (&header, 0, sizeof (struct MHD_HTTP_Res_Header));
   connection.headers_received = &header;
+  connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
   header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
   header.value = MHD_HTTP_POST_ENCODING_FORM_URLENCODED;
   header.header_size = strlen (header.header);
@@ -108,6 +109,173 @@ test_simple_large (void)
 }
 
 
+/**
+ * The boundary of the multipart test data.
+ */
+#define MP_BOUNDARY "AaB03xzzBoundaryOfTheLargeTest"
+
+/**
+ * The size of the file value in the multipart test data.
+ */
+#define MP_VALUE_SIZE (4 * 1024 * 1024)
+
+struct MpCheck
+{
+  const char *expected;
+  size_t received;
+  unsigned int errors;
+};
+
+
+static enum MHD_Result
+mp_value_checker (void *cls,
+                  enum MHD_ValueKind kind,
+                  const char *key,
+                  const char *filename,
+                  const char *content_type,
+                  const char *transfer_encoding,
+                  const char *data, uint64_t off, size_t size)
+{
+  struct MpCheck *chk = (struct MpCheck *) cls;
+  (void) kind; (void) filename; (void) content_type; /* Unused. Silent compiler warning. */
+  (void) transfer_encoding;                          /* Unused. Silent compiler warning. */
+
+  if ( (NULL == key) ||
+       (0 != strcmp (key, "file")) ||
+       (off != chk->received) ||
+       (MP_VALUE_SIZE < off + size) ||
+       ( (0 != size) &&
+         (0 != memcmp (data, &chk->expected[off], size)) ) )
+  {
+    chk->errors++;
+    return MHD_NO;
+  }
+  chk->received += size;
+  return MHD_YES;
+}
+
+
+/**
+ * Feed multipart data to a new postprocessor.
+ *
+ * @param connection the connection to use
+ * @param body the data
+ * @param body_len the size of the @a body
+ * @param random_chunks if non-zero, use random chunks sizes,
+ *                      otherwise use chunks of 64 KiB
+ * @param chk the check context
+ * @return 0 on success, 1 on failure
+ */
+static unsigned int
+mp_feed (struct MHD_Connection *connection,
+         const char *body,
+         size_t body_len,
+         int random_chunks,
+         struct MpCheck *chk)
+{
+  struct MHD_PostProcessor *pp;
+  size_t i;
+  size_t delta;
+
+  chk->received = 0;
+  pp = MHD_create_post_processor (connection, 4096, &mp_value_checker, chk);
+  if (NULL == pp)
+    return 1;
+  i = 0;
+  while (i < body_len)
+  {
+    if (random_chunks)
+      delta = 1 + ((size_t) MHD_random_ ()) % 20000;
+    else
+      delta = 64 * 1024;
+    if (delta > body_len - i)
+      delta = body_len - i;
+    if (MHD_YES !=
+        MHD_post_process (pp,
+                          &body[i],
+                          delta))
+    {
+      fprintf (stderr,
+               "MHD_post_process() failed!\n");
+      MHD_destroy_post_processor (pp);
+      return 1;
+    }
+    i += delta;
+  }
+  if (MHD_YES != MHD_destroy_post_processor (pp))
+    return 1;
+  if ( (0 != chk->errors) ||
+       (MP_VALUE_SIZE != chk->received) )
+    return 1;
+  return 0;
+}
+
+
+static unsigned int
+test_multipart_large (void)
+{
+  struct MHD_Connection connection;
+  struct MHD_HTTP_Req_Header header;
+  struct MpCheck chk;
+  static const char head[] =
+    "--" MP_BOUNDARY "\r\n"
+    "Content-Disposition: form-data; name=\"file\"; filename=\"f.bin\"\r\n"
+    "Content-Type: application/octet-stream\r\n\r\n";
+  static const char tail[] = "\r\n--" MP_BOUNDARY "--\r\n";
+  char *body;
+  char *value;
+  size_t body_len;
+  size_t i;
+  unsigned int errors;
+
+  body_len = MHD_STATICSTR_LEN_ (head) + MP_VALUE_SIZE
+             + MHD_STATICSTR_LEN_ (tail);
+  body = malloc (body_len);
+  if (NULL == body)
+    return 1;
+  value = body + MHD_STATICSTR_LEN_ (head);
+  memcpy (body, head, MHD_STATICSTR_LEN_ (head));
+  for (i = 0; i < MP_VALUE_SIZE; i++)
+    value[i] = (char) ('a' + (i * 7 + (i >> 9)) % 26);
+  /* Put some parts that look like the delimiter into the value */
+  for (i = 1000; i + 100 < MP_VALUE_SIZE; i += 1000 + (i % 777))
+  {
+    static const char near_miss[] = "\r\n--" MP_BOUNDARY;
+    size_t len = (i / 1000) % MHD_STATICSTR_LEN_ (near_miss);
+
+    memcpy (&value[i], near_miss, len);
+    /* Break the delimiter, possibly starting the next one */
+    value[i + len] = (0 == len % 3) ? '\r' : '-';
+  }
+  memcpy (value + MP_VALUE_SIZE, tail, MHD_STATICSTR_LEN_ (tail));
+
+  memset (&connection, 0, sizeof (struct MHD_Connection));
+  memset (&header, 0, sizeof (struct MHD_HTTP_Req_Header));
+  connection.headers_received = &header;
+  connection.rq_hdr_wk[MHD_REQ_HDR_WK_CONTENT_TYPE] = &header;
+  header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
+  header.value = MHD_HTTP_POST_ENCODING_MULTIPART_FORMDATA
+                 ", boundary=" MP_BOUNDARY;
+  header.header_size = strlen (header.header);
+  header.value_size = strlen (header.value);
+  header.kind = MHD_HEADER_KIND;
+  chk.expected = value;
+  chk.errors = 0;
+
+  errors = mp_feed (&connection, body, body_len, ! 0, &chk);
+  if (0 != errors)
+    fprintf (stderr, "Multipart data with random chunks failed.\n");
+  else
+  {
+    errors = mp_feed (&connection, body, body_len, 0, &chk);
+    if (0 != errors)
+      fprintf (stderr, "Multipart data with 64 KiB chunks failed.\n");
+  }
+  free (body);
+  return errors;
+}
+
+
 int
 main (int argc, char *const *argv)
 {
@@ -115,6 +283,7 @@ main (int argc, char *const *argv)
   (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
 
   errorCount += test_simple_large ();
+  errorCount += test_multipart_large ();
   if (errorCount != 0)
     fprintf (stderr, "Error (code: %u)\n", errorCount);
   return errorCount != 0;       /* 0 == pass */
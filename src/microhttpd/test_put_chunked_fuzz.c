@@ -0,0 +1,536 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_put_chunked_fuzz.c
+ * @brief  Randomised test for the decoder of the chunked request body
+ * @details The PUT requests with random chunk sizes, chunk extensions,
+ *          line ends and trailers are sent to the daemon in random
+ *          pieces, the application processes random parts of the data.
+ *          The decoded body must match the original data.  The data
+ *          of many small chunks received together must be given to
+ *          the application by a single call.  The malformed chunked
+ *          encoding must be rejected.
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif /* HAVE_NETINET_IN_H */
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+/**
+ * The number of random requests.
+ */
+#define NUM_ROUNDS 500
+
+/**
+ * The maximum size of the body of the random request.
+ */
+#define MAX_BODY_SIZE 6000
+
+/**
+ * The size of the buffer for the encoded request, enough for the body
+ * in chunks of one byte each.
+ */
+#define REQ_BUF_SIZE (24 * MAX_BODY_SIZE + 1024)
+
+/**
+ * The number of tiny chunks in the coalescing test.
+ */
+#define NUM_TINY_CHUNKS 200
+
+/**
+ * The state of the request.
+ */
+struct Upload
+{
+  /**
+   * The received body.
+   */
+  char body[MAX_BODY_SIZE];
+
+  /**
+   * The size of the received body.
+   */
+  size_t size;
+
+  /**
+   * The number of calls with the body data.
+   */
+  unsigned int num_calls;
+
+  /**
+   * Non-zero if the application should process the random part
+   * of the data only.
+   */
+  int partial;
+
+  /**
+   * Set to non-zero when the whole body is received.
+   */
+  int done;
+
+  /**
+   * Non-zero if the body is too large.
+   */
+  int overflow;
+};
+
+/**
+ * The state of the random numbers generator.
+ */
+static uint64_t rnd_state;
+
+/**
+ * The upload of the current request.
+ */
+static struct Upload upload;
+
+
+static uint32_t
+rnd (void)
+{
+  /* xorshift64* */
+  rnd_state ^= rnd_state >> 12;
+  rnd_state ^= rnd_state << 25;
+  rnd_state ^= rnd_state >> 27;
+  return (uint32_t) ((rnd_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+static size_t
+rnd_range (size_t min,
+           size_t max)
+{
+  return min + (size_t) (rnd () % (uint32_t) (max - min + 1));
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int ptr;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) method; (void) version; /* Unused. Silent compiler warning. */
+
+  if (&ptr != *req_cls)
+  {
+    *req_cls = &ptr;
+    return MHD_YES;
+  }
+  if (0 != *upload_data_size)
+  {
+    size_t size = *upload_data_size;
+
+    upload.num_calls++;
+    if (upload.partial)
+      size = rnd_range (1, size); /* Always make a progress */
+    if (upload.size + size > sizeof (upload.body))
+    {
+      upload.overflow = 1;
+      return MHD_NO;
+    }
+    memcpy (upload.body + upload.size, upload_data, size);
+    upload.size += size;
+    *upload_data_size -= size;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  upload.done = 1;
+  response = MHD_create_response_from_buffer (0,
+                                              NULL,
+                                              MHD_RESPMEM_PERSISTENT);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection,
+                            MHD_HTTP_OK,
+                            response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Send the request to the daemon in pieces and get the status of
+ * the reply.
+ *
+ * @param d the daemon to use
+ * @param req the request
+ * @param req_size the size of the @a req
+ * @param max_piece the maximum size of the piece sent before
+ *                  processing by the daemon, zero to send all at once
+ * @return the status code of the reply, zero if no reply
+ */
+static unsigned int
+send_request (struct MHD_Daemon *d,
+              const char *req,
+              size_t req_size,
+              size_t max_piece)
+{
+  struct sockaddr_in sa;
+  MHD_socket sv[2];
+  char reply[64];
+  ssize_t got;
+  size_t pos;
+  unsigned int status;
+  unsigned int i;
+
+  if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+    return 0;
+  memset (&sa, 0, sizeof (sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (MHD_YES != MHD_add_connection (d,
+                                     sv[0],
+                                     (const struct sockaddr *) &sa,
+                                     sizeof (sa)))
+  {
+    (void) close (sv[1]);
+    return 0;
+  }
+  for (pos = 0; pos < req_size; )
+  {
+    size_t piece = req_size - pos;
+    ssize_t sent;
+
+    if ( (0 != max_piece) &&
+         (piece > max_piece) )
+      piece = rnd_range (1, max_piece);
+    sent = send (sv[1], req + pos, piece, SEND_FLAGS);
+    if (0 >= sent)
+      break; /* The daemon may close the connection on error */
+    pos += (size_t) sent;
+    if (MHD_YES != MHD_run (d))
+      break;
+  }
+  /* Process the rest of the request and send the reply */
+  for (i = 0; i < 4 * MAX_BODY_SIZE && ! upload.done; i++)
+  {
+    if (0 < recv (sv[1], reply, 1, MSG_DONTWAIT | MSG_PEEK))
+      break; /* Got the error reply */
+    (void) MHD_run (d);
+  }
+  for (i = 0; i < 10; i++)
+    (void) MHD_run (d);
+  status = 0;
+  got = recv (sv[1], reply, sizeof (reply) - 1, MSG_DONTWAIT);
+  if ( (12 <= got) &&
+       (0 == memcmp (reply, "HTTP/1.1 ", 9)) )
+    status = (unsigned int) ((reply[9] - '0') * 100
+                             + (reply[10] - '0') * 10
+                             + (reply[11] - '0'));
+  (void) close (sv[1]);
+  /* Let the daemon close the connection */
+  for (i = 0; i < 10; i++)
+    (void) MHD_run (d);
+  return status;
+}
+
+
+/**
+ * Add the chunk size line to the request.
+ *
+ * @param req the request buffer
+ * @param pos the position in the @a req
+ * @param size the size of the chunk
+ * @param crlf non-zero to use CRLF, zero to use bare LF
+ * @return the new position in the @a req
+ */
+static size_t
+add_size_line (char *req,
+               size_t pos,
+               size_t size,
+               int crlf)
+{
+  static const char *const exts[] = {
+    "", "", "", ";a", ";name=value", ";q=\"quoted\""
+  };
+  const char *ext;
+
+  ext = exts[rnd () % (sizeof (exts) / sizeof (exts[0]))];
+  pos += (size_t) sprintf (req + pos,
+                           (0 == rnd () % 2) ? "%0*x%s" : "%0*X%s",
+                           (int) rnd_range (1, 4),
+                           (unsigned int) size,
+                           ext);
+  if (crlf)
+    req[pos++] = '\r';
+  req[pos++] = '\n';
+  return pos;
+}
+
+
+/**
+ * Send the request with random chunks of random body.
+ *
+ * @param d the daemon to use
+ * @param req the buffer for the request
+ * @param body the buffer for the body
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+test_random_request (struct MHD_Daemon *d,
+                     char *req,
+                     char *body)
+{
+  static const char req_start[] =
+    "PUT /upload HTTP/1.1\r\nHost: example.com\r\n"
+    "Transfer-Encoding: chunked\r\n\r\n";
+  size_t body_size;
+  size_t max_chunk;
+  size_t req_size;
+  size_t i;
+  int crlf;
+  unsigned int status;
+
+  body_size = rnd_range (0, MAX_BODY_SIZE);
+  for (i = 0; i < body_size; i++)
+    body[i] = (char) rnd ();
+  /* Mostly tiny chunks, sometimes large chunks */
+  max_chunk = (0 == rnd () % 4) ? MAX_BODY_SIZE : rnd_range (1, 16);
+  crlf = (0 != rnd () % 8);
+
+  memcpy (req, req_start, strlen (req_start));
+  req_size = strlen (req_start);
+  for (i = 0; i < body_size; )
+  {
+    size_t chunk_size = rnd_range (1, max_chunk);
+
+    if (chunk_size > body_size - i)
+      chunk_size = body_size - i;
+    req_size = add_size_line (req, req_size, chunk_size, crlf);
+    memcpy (req + req_size, body + i, chunk_size);
+    req_size += chunk_size;
+    i += chunk_size;
+    if (crlf)
+      req[req_size++] = '\r';
+    req[req_size++] = '\n';
+  }
+  req_size = add_size_line (req, req_size, 0, crlf);
+  if (0 == rnd () % 4)
+  {
+    memcpy (req + req_size, "X-Trailer: value", strlen ("X-Trailer: value"));
+    req_size += strlen ("X-Trailer: value");
+    if (crlf)
+      req[req_size++] = '\r';
+    req[req_size++] = '\n';
+  }
+  if (crlf)
+    req[req_size++] = '\r';
+  req[req_size++] = '\n';
+
+  memset (&upload, 0, sizeof (upload));
+  upload.partial = (0 == rnd () % 2);
+  status = send_request (d,
+                         req,
+                         req_size,
+                         (0 == rnd () % 4) ? 0 : rnd_range (1, 64));
+  if (MHD_HTTP_OK != status)
+  {
+    fprintf (stderr,
+             "Got status %u for %u bytes body in chunks up to %u bytes.\n",
+             status, (unsigned int) body_size, (unsigned int) max_chunk);
+    return 1;
+  }
+  if ( (upload.overflow) ||
+       (body_size != upload.size) ||
+       ( (0 != body_size) &&
+         (0 != memcmp (body, upload.body, body_size)) ) )
+  {
+    fprintf (stderr,
+             "Wrong body decoded: %u bytes instead of %u bytes.\n",
+             (unsigned int) upload.size, (unsigned int) body_size);
+    return 2;
+  }
+  return 0;
+}
+
+
+/**
+ * Check that many tiny chunks received together are given to
+ * the application by a single call.
+ *
+ * @param d the daemon to use
+ * @param req the buffer for the request
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+test_coalescing (struct MHD_Daemon *d,
+                 char *req)
+{
+  static const char req_start[] =
+    "PUT /upload HTTP/1.1\r\nHost: example.com\r\n"
+    "Transfer-Encoding: chunked\r\n\r\n";
+  size_t req_size;
+  unsigned int i;
+
+  memcpy (req, req_start, strlen (req_start));
+  req_size = strlen (req_start);
+  for (i = 0; i < NUM_TINY_CHUNKS; i++)
+    req_size += (size_t) sprintf (req + req_size, "3\r\nabc\r\n");
+  req_size += (size_t) sprintf (req + req_size, "0\r\n\r\n");
+
+  memset (&upload, 0, sizeof (upload));
+  if (MHD_HTTP_OK != send_request (d, req, req_size, 0))
+  {
+    fprintf (stderr, "Tiny chunks are not accepted.\n");
+    return 4;
+  }
+  if (3 * NUM_TINY_CHUNKS != upload.size)
+  {
+    fprintf (stderr, "Wrong size of the body with tiny chunks: %u.\n",
+             (unsigned int) upload.size);
+    return 4;
+  }
+  if (1 != upload.num_calls)
+  {
+    fprintf (stderr, "Tiny chunks are processed by %u calls.\n",
+             upload.num_calls);
+    return 8;
+  }
+  return 0;
+}
+
+
+/**
+ * Check that the malformed chunked encoding is rejected.
+ *
+ * @param d the daemon to use
+ * @param req the buffer for the request
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+test_malformed (struct MHD_Daemon *d,
+                char *req)
+{
+  static const struct
+  {
+    const char *body;
+    unsigned int status;
+  } tests[] = {
+    { "Z\r\nabc\r\n0\r\n\r\n", MHD_HTTP_BAD_REQUEST },
+    { "\r\nabc\r\n0\r\n\r\n", MHD_HTTP_BAD_REQUEST },
+    { ";ext\r\nabc\r\n0\r\n\r\n", MHD_HTTP_BAD_REQUEST },
+    { "3 \r\nabc\r\n0\r\n\r\n", MHD_HTTP_BAD_REQUEST },
+    { "3\r\nabcXY\r\n0\r\n\r\n", MHD_HTTP_BAD_REQUEST },
+    { "1\r\na\r\n2\r\nbcd\r\n0\r\n\r\n", MHD_HTTP_BAD_REQUEST },
+    { "-3\r\nabc\r\n0\r\n\r\n", MHD_HTTP_BAD_REQUEST },
+    { "1FFFFFFFFFFFFFFFF\r\nabc\r\n0\r\n\r\n", MHD_HTTP_CONTENT_TOO_LARGE }
+  };
+  static const char req_start[] =
+    "PUT /upload HTTP/1.1\r\nHost: example.com\r\n"
+    "Transfer-Encoding: chunked\r\n\r\n";
+  unsigned int ret = 0;
+  unsigned int i;
+
+  for (i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+  {
+    unsigned int status;
+    size_t req_size;
+    unsigned int j;
+
+    req_size = (size_t) sprintf (req, "%s%s", req_start, tests[i].body);
+    /* Both at once and byte by byte */
+    for (j = 0; j < 2; j++)
+    {
+      memset (&upload, 0, sizeof (upload));
+      status = send_request (d, req, req_size, j);
+      if (tests[i].status != status)
+      {
+        fprintf (stderr,
+                 "Got status %u instead of %u for the body '%s'.\n",
+                 status, tests[i].status, tests[i].body);
+        ret = 16;
+      }
+    }
+  }
+  return ret;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  struct MHD_Daemon *d;
+  char *req;
+  char *body;
+  unsigned int i;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  rnd_state = 0x9E3779B97F4A7C15ULL;
+  req = malloc (REQ_BUF_SIZE);
+  body = malloc (MAX_BODY_SIZE);
+  if ( (NULL == req) ||
+       (NULL == body) )
+  {
+    free (req);
+    free (body);
+    return 99;
+  }
+  d = MHD_start_daemon (MHD_USE_NO_LISTEN_SOCKET,
+                        0, NULL, NULL,
+                        &ahc_echo, NULL,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    free (req);
+    free (body);
+    return 77;
+  }
+  for (i = 0; i < NUM_ROUNDS && 0 == errorCount; i++)
+    errorCount += test_random_request (d, req, body);
+  if (0 != errorCount)
+    fprintf (stderr, "Failed at round %u.\n", i - 1);
+  errorCount += test_coalescing (d, req);
+  errorCount += test_malformed (d, req);
+  MHD_stop_daemon (d);
+  free (req);
+  free (body);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return errorCount != 0;       /* 0 == pass */
+}
@@ -0,0 +1,238 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_response_hdrs.c
+ * @brief  Test for the headers of the response queued many times
+ * @details The same response object is used for all replies, its
+ *          headers are modified between the requests.  The reply must
+ *          always have the current headers of the response.
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif /* HAVE_NETINET_IN_H */
+
+/**
+ * The shared response.
+ */
+static struct MHD_Response *shared_response;
+
+
+static enum MHD_Result
+ahc_shared (void *cls,
+            struct MHD_Connection *connection,
+            const char *url,
+            const char *method,
+            const char *version,
+            const char *upload_data, size_t *upload_data_size,
+            void **req_cls)
+{
+  static int ptr;
+  (void) cls; (void) url; (void) method; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size;           /* Unused. Silent compiler warning. */
+
+  if (&ptr != *req_cls)
+  {
+    *req_cls = &ptr;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  return MHD_queue_response (connection,
+                             MHD_HTTP_OK,
+                             shared_response);
+}
+
+
+/**
+ * Send the request and get the reply.
+ *
+ * @param d the daemon to use
+ * @param req the request to send
+ * @param[out] reply the buffer for the reply
+ * @param reply_size the size of the @a reply
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+get_reply (struct MHD_Daemon *d,
+           const char *req,
+           char *reply,
+           size_t reply_size)
+{
+  struct sockaddr_in sa;
+  MHD_socket sv[2];
+  ssize_t got;
+  unsigned int i;
+
+  if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+    return 99;
+  memset (&sa, 0, sizeof (sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (MHD_YES != MHD_add_connection (d,
+                                     sv[0],
+                                     (const struct sockaddr *) &sa,
+                                     sizeof (sa)))
+  {
+    (void) close (sv[1]);
+    return 99;
+  }
+  if ((ssize_t) strlen (req) != send (sv[1], req, strlen (req), 0))
+  {
+    (void) close (sv[1]);
+    return 1;
+  }
+  for (i = 0; i < 10; i++)
+    (void) MHD_run (d);
+  got = recv (sv[1], reply, reply_size - 1, MSG_DONTWAIT);
+  (void) close (sv[1]);
+  for (i = 0; i < 3; i++)
+    (void) MHD_run (d);
+  if (0 >= got)
+  {
+    fprintf (stderr, "No reply received.\n");
+    return 2;
+  }
+  reply[got] = 0;
+  return 0;
+}
+
+
+/**
+ * Check the reply for the request.
+ *
+ * @param d the daemon to use
+ * @param req the request to send
+ * @param must_have the string that must be in the reply
+ * @param must_not_have the string that must not be in the reply, or NULL
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+check_reply (struct MHD_Daemon *d,
+             const char *req,
+             const char *must_have,
+             const char *must_not_have)
+{
+  char reply[2048];
+  unsigned int ret;
+
+  ret = get_reply (d, req, reply, sizeof (reply));
+  if (0 != ret)
+    return ret;
+  if (NULL == strstr (reply, must_have))
+  {
+    fprintf (stderr, "The reply does not have '%s':\n%s\n",
+             must_have, reply);
+    return 4;
+  }
+  if ( (NULL != must_not_have) &&
+       (NULL != strstr (reply, must_not_have)) )
+  {
+    fprintf (stderr, "The reply has '%s':\n%s\n",
+             must_not_have, reply);
+    return 8;
+  }
+  return 0;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  static const char req11[] =
+    "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n";
+  static const char req10[] =
+    "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n";
+  struct MHD_Daemon *d;
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  shared_response = MHD_create_response_from_buffer_static (2, "OK");
+  if (NULL == shared_response)
+    return 99;
+  if ( (MHD_YES != MHD_add_response_header (shared_response,
+                                            "X-First", "one")) ||
+       (MHD_YES != MHD_add_response_header (shared_response,
+                                            "X-Second", "two")) )
+    return 99;
+  d = MHD_start_daemon (MHD_USE_NO_LISTEN_SOCKET,
+                        0, NULL, NULL,
+                        &ahc_shared, NULL,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    MHD_destroy_response (shared_response);
+    return 77;
+  }
+  errorCount += check_reply (d, req11,
+                             "\r\nX-First: one\r\nX-Second: two\r\n",
+                             NULL);
+  /* The same headers again */
+  errorCount += check_reply (d, req11,
+                             "\r\nX-First: one\r\nX-Second: two\r\n",
+                             NULL);
+  /* The reply with the additional "Connection" header */
+  errorCount += check_reply (d, req10,
+                             "\r\nX-First: one\r\nX-Second: two\r\n",
+                             NULL);
+  /* The headers modified after the response has been used */
+  if (MHD_YES != MHD_add_response_header (shared_response,
+                                          "X-Third", "three"))
+    errorCount++;
+  errorCount += check_reply (d, req11,
+                             "\r\nX-First: one\r\nX-Second: two\r\n"
+                             "X-Third: three\r\n",
+                             NULL);
+  if (MHD_YES != MHD_del_response_header (shared_response,
+                                          "X-First", "one"))
+    errorCount++;
+  errorCount += check_reply (d, req11,
+                             "\r\nX-Second: two\r\nX-Third: three\r\n",
+                             "X-First");
+  /* The user "Connection" header is combined with the automatic one */
+  if (MHD_YES != MHD_add_response_header (shared_response,
+                                          MHD_HTTP_HEADER_CONNECTION,
+                                          "x-custom"))
+    errorCount++;
+  errorCount += check_reply (d, req10,
+                             "\r\nConnection: Keep-Alive, x-custom\r\n",
+                             NULL);
+  errorCount += check_reply (d, req11,
+                             "\r\nConnection: x-custom\r\n",
+                             NULL);
+  MHD_stop_daemon (d);
+  MHD_destroy_response (shared_response);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return errorCount != 0;       /* 0 == pass */
+}
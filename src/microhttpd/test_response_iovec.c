@@ -0,0 +1,271 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_response_iovec.c
+ * @brief  Test for the response header sent together with the iovec
+ *         response body
+ * @details The small reply must be sent by the single vector-send call.
+ *          The large reply with many iov elements is read slowly so
+ *          the header and the elements are sent partially.
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif /* HAVE_NETINET_IN_H */
+
+/**
+ * The number of the iov elements of the large reply.
+ */
+#define LARGE_IOVCNT 50
+
+/**
+ * The size of each iov element of the large reply.
+ */
+#define LARGE_IOVLEN (20 * 1024 + 7)
+
+/**
+ * The data of the large reply.
+ */
+static char large_data[LARGE_IOVCNT * LARGE_IOVLEN];
+
+
+static enum MHD_Result
+ahc_iovec (void *cls,
+           struct MHD_Connection *connection,
+           const char *url,
+           const char *method,
+           const char *version,
+           const char *upload_data, size_t *upload_data_size,
+           void **req_cls)
+{
+  static int ptr;
+  static const char *const small_parts[] = { "{\"a\":", "1,", "\"b\":2}" };
+  struct MHD_IoVec iov[LARGE_IOVCNT];
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  unsigned int i;
+  (void) cls; (void) method; (void) version;    /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size;  /* Unused. Silent compiler warning. */
+
+  if (&ptr != *req_cls)
+  {
+    *req_cls = &ptr;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  if (0 == strcmp (url, "/large"))
+  {
+    for (i = 0; i < LARGE_IOVCNT; i++)
+    {
+      iov[i].iov_base = large_data + i * LARGE_IOVLEN;
+      iov[i].iov_len = LARGE_IOVLEN;
+    }
+    response = MHD_create_response_from_iovec (iov, LARGE_IOVCNT,
+                                               NULL, NULL);
+  }
+  else
+  {
+    for (i = 0; i < 3; i++)
+    {
+      iov[i].iov_base = small_parts[i];
+      iov[i].iov_len = strlen (small_parts[i]);
+    }
+    response = MHD_create_response_from_iovec (iov, 3,
+                                               NULL, NULL);
+  }
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection,
+                            MHD_HTTP_OK,
+                            response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Send the request and read the reply slowly.
+ *
+ * @param d the daemon to use
+ * @param req the request to send
+ * @param[out] reply the buffer for the reply
+ * @param reply_size the size of the @a reply
+ * @param[out] got_size the size of the received reply
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+get_reply (struct MHD_Daemon *d,
+           const char *req,
+           char *reply,
+           size_t reply_size,
+           size_t *got_size)
+{
+  struct sockaddr_in sa;
+  MHD_socket sv[2];
+  ssize_t got;
+  unsigned int idle;
+
+  if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+    return 99;
+  memset (&sa, 0, sizeof (sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (MHD_YES != MHD_add_connection (d,
+                                     sv[0],
+                                     (const struct sockaddr *) &sa,
+                                     sizeof (sa)))
+  {
+    (void) close (sv[1]);
+    return 99;
+  }
+  if ((ssize_t) strlen (req) != send (sv[1], req, strlen (req), 0))
+  {
+    (void) close (sv[1]);
+    return 1;
+  }
+  *got_size = 0;
+  for (idle = 0; idle < 10; idle++)
+  {
+    (void) MHD_run (d);
+    /* Read by small pieces to get the partial sends */
+    got = recv (sv[1], reply + *got_size,
+                (reply_size - *got_size < 4096) ?
+                (reply_size - *got_size) : 4096,
+                MSG_DONTWAIT);
+    if (0 < got)
+    {
+      *got_size += (size_t) got;
+      idle = 0;
+    }
+    if (reply_size == *got_size)
+      break;
+  }
+  (void) close (sv[1]);
+  for (idle = 0; idle < 3; idle++)
+    (void) MHD_run (d);
+  if (0 == *got_size)
+  {
+    fprintf (stderr, "No reply received.\n");
+    return 2;
+  }
+  return 0;
+}
+
+
+/**
+ * Get the body of the reply.
+ *
+ * @param reply the reply
+ * @param reply_size the size of the @a reply
+ * @param[out] body_size the size of the body
+ * @return the pointer to the body, NULL if the header is not complete
+ */
+static const char *
+get_body (const char *reply,
+          size_t reply_size,
+          size_t *body_size)
+{
+  size_t i;
+
+  for (i = 0; i + 4 <= reply_size; i++)
+  {
+    if (0 == memcmp (reply + i, "\r\n\r\n", 4))
+    {
+      *body_size = reply_size - i - 4;
+      return reply + i + 4;
+    }
+  }
+  return NULL;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  static const char req_small[] =
+    "GET /small HTTP/1.1\r\nHost: example.com\r\n\r\n";
+  static const char req_large[] =
+    "GET /large HTTP/1.1\r\nHost: example.com\r\n\r\n";
+  static char reply[sizeof (large_data) + 1024];
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  const char *body;
+  size_t got_size;
+  size_t body_size;
+  size_t i;
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  for (i = 0; i < sizeof (large_data); i++)
+    large_data[i] = (char) ('a' + (i * 7 + i / 1000) % 26);
+  d = MHD_start_daemon (MHD_USE_NO_LISTEN_SOCKET,
+                        0, NULL, NULL,
+                        &ahc_iovec, NULL,
+                        MHD_OPTION_END);
+  if (NULL == d)
+    return 77;
+
+  errorCount += get_reply (d, req_small, reply, sizeof (reply), &got_size);
+  body = get_body (reply, got_size, &body_size);
+  if ( (NULL == body) ||
+       (strlen ("{\"a\":1,\"b\":2}") != body_size) ||
+       (0 != memcmp (body, "{\"a\":1,\"b\":2}", body_size)) )
+  {
+    fprintf (stderr, "Wrong small reply.\n");
+    errorCount++;
+  }
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_STATS);
+  if ( (NULL == dinfo) ||
+       (1 != dinfo->stats->iovec_calls) ||
+       (0 != dinfo->stats->send_calls) )
+  {
+    fprintf (stderr, "The small reply has not been sent by the single "
+             "vector-send call.\n");
+    errorCount++;
+  }
+
+  errorCount += get_reply (d, req_large, reply, sizeof (reply), &got_size);
+  body = get_body (reply, got_size, &body_size);
+  if ( (NULL == body) ||
+       (sizeof (large_data) != body_size) ||
+       (0 != memcmp (body, large_data, body_size)) )
+  {
+    fprintf (stderr, "Wrong large reply.\n");
+    errorCount++;
+  }
+  MHD_stop_daemon (d);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return errorCount != 0;       /* 0 == pass */
+}
@@ -0,0 +1,195 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_timer_wheel.c
+ * @brief  Unit tests for the hierarchical timer wheel
+ * @author agent
+ */
+
+#include "mhd_options.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "timer_wheel.h"
+
+#define NUM_ENTRIES 1000
+
+static struct MHD_TimerEntry entries[NUM_ENTRIES];
+
+/**
+ * The expected expiration tick for each entry, zero if not armed.
+ */
+static uint64_t expected[NUM_ENTRIES];
+
+static uint32_t rnd_state = 1234567;
+
+
+static uint32_t
+rnd (void)
+{
+  rnd_state = rnd_state * 1103515245U + 12345U;
+  return rnd_state >> 1;
+}
+
+
+/**
+ * Get random delay, mostly short ones, but some delays
+ * should hit the higher levels of the wheel.
+ */
+static uint64_t
+rnd_delay (void)
+{
+  switch (rnd () % 4)
+  {
+  case 0:
+    return rnd () % 64;
+  case 1:
+    return rnd () % 5000;
+  case 2:
+    return rnd () % 300000;
+  default:
+    return ((uint64_t) rnd ()) * 16;
+  }
+}
+
+
+/**
+ * Advance the wheel and check that exactly the expected entries
+ * have expired.
+ *
+ * @return the number of errors
+ */
+static unsigned int
+check_advance (struct MHD_TimerWheel *w,
+               uint64_t now)
+{
+  struct MHD_TimerEntry *e;
+  unsigned int errors = 0;
+  unsigned int i;
+  uint64_t next;
+
+  if (MHD_timer_wheel_next (w, &next))
+  {
+    /* Nothing may expire before the reported tick */
+    for (i = 0; i < NUM_ENTRIES; i++)
+    {
+      if ( (0 != expected[i]) &&
+           (expected[i] < next) &&
+           (expected[i] > w->now) )
+      {
+        fprintf (stderr,
+                 "Entry %u expires at %llu, but next tick is %llu.\n",
+                 i, (unsigned long long) expected[i],
+                 (unsigned long long) next);
+        errors++;
+      }
+    }
+  }
+  MHD_timer_wheel_advance (w, now);
+  while (NULL != (e = MHD_timer_wheel_pop_expired (w)))
+  {
+    i = (unsigned int) (e - entries);
+    if ( (0 == expected[i]) ||
+         (expected[i] > now) )
+    {
+      fprintf (stderr,
+               "Entry %u expired at %llu, expected at %llu.\n",
+               i, (unsigned long long) now,
+               (unsigned long long) expected[i]);
+      errors++;
+    }
+    if (MHD_timer_entry_is_armed (e))
+      errors++;
+    expected[i] = 0;
+  }
+  for (i = 0; i < NUM_ENTRIES; i++)
+  {
+    if ( (0 != expected[i]) &&
+         (expected[i] <= now) )
+    {
+      fprintf (stderr,
+               "Entry %u not expired at %llu, expected at %llu.\n",
+               i, (unsigned long long) now,
+               (unsigned long long) expected[i]);
+      errors++;
+      expected[i] = 0;
+    }
+  }
+  return errors;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  struct MHD_TimerWheel w;
+  uint64_t now;
+  unsigned int errors = 0;
+  unsigned int round;
+  unsigned int i;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  now = 1000000007;
+  MHD_timer_wheel_init (&w, now);
+  memset (entries, 0, sizeof(entries));
+  memset (expected, 0, sizeof(expected));
+  for (round = 0; round < 3000; round++)
+  {
+    unsigned int n;
+
+    /* Arm, re-arm or disarm some entries */
+    for (n = 0; n < 20; n++)
+    {
+      i = rnd () % NUM_ENTRIES;
+      if (0 == rnd () % 5)
+      {
+        MHD_timer_wheel_disarm (&w, &entries[i]);
+        expected[i] = 0;
+      }
+      else
+      {
+        const uint64_t delay = rnd_delay () + 1;
+
+        MHD_timer_wheel_arm (&w, &entries[i], now + delay);
+        expected[i] = now + delay;
+      }
+    }
+    /* Advance by short steps mostly, sometimes by long jumps */
+    if (0 == rnd () % 50)
+      now += rnd () % 1000000;
+    else
+      now += rnd () % 100;
+    errors += check_advance (&w, now);
+    if (100 < errors)
+      break;
+  }
+  /* Expire everything */
+  now += ((uint64_t) 1) << 40;
+  errors += check_advance (&w, now);
+  if (MHD_timer_wheel_next (&w, &now))
+  {
+    fprintf (stderr, "The wheel is not empty.\n");
+    errors++;
+  }
+  if (0 != errors)
+    fprintf (stderr, "Error (code: %u)\n", errors);
+  return (0 == errors) ? 0 : 1;
+}
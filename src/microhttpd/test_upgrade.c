@@ -279,8 +279,14 @@ struct wr_socket
   {
     wr_invalid = 0,
     wr_plain = 1,
-    wr_tls = 2
+    wr_tls = 2,
+    wr_direct = 3
   } t;
+
+  /**
+   * The handle of the "upgraded" connection for #wr_direct sockets
+   */
+  struct MHD_UpgradeResponseHandle *urh;
 #ifdef HTTPS_SUPPORT
   /**
    * TLS credentials
@@ -413,6 +419,26 @@ wr_create_from_plain_sckt (MHD_socket plain_sk)
 }
 
 
+/**
+ * Create wr_socket for the "upgraded" connection in the direct mode.
+ * @param plain_sk the socket of the connection, used only for waiting
+ * @param urh the handle of the "upgraded" connection
+ * @return created socket on success, NULL otherwise
+ */
+static struct wr_socket *
+wr_create_from_urh (MHD_socket plain_sk,
+                    struct MHD_UpgradeResponseHandle *urh)
+{
+  struct wr_socket *s = wr_create_from_plain_sckt (plain_sk);
+
+  if (NULL == s)
+    return NULL;
+  s->t = wr_direct;
+  s->urh = urh;
+  return s;
+}
+
+
 /**
  * Connect socket to specified address.
  * @param s socket to use
@@ -488,6 +514,22 @@ wr_send (struct wr_socket *s,
 {
   if (wr_plain == s->t)
     return MHD_send_ (s->fd, buf, len);
+  if (wr_direct == s->t)
+  {
+    ssize_t ret;
+
+    ret = MHD_upgrade_send (s->urh, buf, len);
+    if (0 <= ret)
+      return ret;
+    if (MHD_UPGRADE_IO_AGAIN == ret)
+      MHD_socket_set_error_ (MHD_SCKT_EAGAIN_);
+    else
+    {
+      testErrorLogDesc ("MHD_upgrade_send() failed with hard error");
+      MHD_socket_set_error_ (MHD_SCKT_ECONNABORTED_);   /* hard error */
+    }
+    return -1;
+  }
 #ifdef HTTPS_SUPPORT
   if (wr_tls == s->t)
   {
@@ -530,6 +572,22 @@ wr_recv (struct wr_socket *s,
 {
   if (wr_plain == s->t)
     return MHD_recv_ (s->fd, buf, len);
+  if (wr_direct == s->t)
+  {
+    ssize_t ret;
+
+    ret = MHD_upgrade_recv (s->urh, buf, len);
+    if (0 <= ret)
+      return ret;
+    if (MHD_UPGRADE_IO_AGAIN == ret)
+      MHD_socket_set_error_ (MHD_SCKT_EAGAIN_);
+    else
+    {
+      testErrorLogDesc ("MHD_upgrade_recv() failed with hard error");
+      MHD_socket_set_error_ (MHD_SCKT_ECONNABORTED_);   /* hard error */
+    }
+    return -1;
+  }
 #ifdef HTTPS_SUPPORT
   if (wr_tls == s->t)
   {
@@ -595,6 +653,11 @@ static pthread_t pt_client;
  */
 static volatile bool done;
 
+/**
+ * Set to true if the "upgraded" connections use the direct mode.
+ */
+static bool test_direct;
+
 
 static const char *
 term_reason_str (enum MHD_RequestTerminationCode term_code)
@@ -992,7 +1055,10 @@ upgrade_cb (void *cls,
   (void) req_cls;
   (void) extra_in; /* Unused. Silent compiler warning. */
 
-  usock = wr_create_from_plain_sckt (sock);
+  if (test_direct)
+    usock = wr_create_from_urh (sock, urh);
+  else
+    usock = wr_create_from_plain_sckt (sock);
   if (0 != extra_in_size)
     mhdErrorExitDesc ("'extra_in_size' is not zero");
   if (0 != pthread_create (&pt,
@@ -1070,6 +1136,11 @@ ahc_upgrade (void *cls,
                                           NULL);
   if (NULL == resp)
     mhdErrorExitDesc ("MHD_create_response_for_upgrade() failed");
+  if (test_direct &&
+      (MHD_YES != MHD_set_response_options (resp,
+                                            MHD_RF_UPGRADE_DIRECT,
+                                            MHD_RO_END)))
+    mhdErrorExitDesc ("MHD_set_response_options() failed");
   if (MHD_YES != MHD_add_response_header (resp,
                                           MHD_HTTP_HEADER_UPGRADE,
                                           "Hello World Protocol"))
@@ -1377,6 +1448,7 @@ main (int argc,
 
   use_tls_tool = TLS_CLI_NO_TOOL;
   test_tls = has_in_name (argv[0], "_tls");
+  test_direct = has_in_name (argv[0], "_direct");
 
   verbose = ! (has_param (argc, argv, "-q") ||
                has_param (argc, argv, "--quiet") ||
@@ -1428,12 +1500,13 @@ main (int argc,
   }
 
   global_port = MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT) ?
-                0 : (test_tls ? 1091 : 1090);
+                0 : ((test_tls ? 1091 : 1090) + (test_direct ? 4 : 0));
 
   /* run tests */
   if (verbose)
-    printf ("Starting HTTP \"Upgrade\" tests with %s connections.\n",
-            test_tls ? "TLS" : "plain");
+    printf ("Starting HTTP \"Upgrade\" tests with %s%s connections.\n",
+            test_tls ? "TLS" : "plain",
+            test_direct ? " direct" : "");
   /* try external select */
   res = test_upgrade (0,
                       0);
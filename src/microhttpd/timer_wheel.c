@@ -0,0 +1,405 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/timer_wheel.c
+ * @brief  hierarchical timer wheel implementation
+ * @author agent
+ */
+
+#include "timer_wheel.h"
+#include <string.h>
+#include "mhd_assert.h"
+
+/**
+ * The value of 'where' member for entries in the list of expired entries.
+ */
+#define MHD_TW_WHERE_EXPIRED (MHD_TW_LEVELS + 1)
+
+/**
+ * The maximum distance between the current tick and the expiration tick.
+ */
+#define MHD_TW_MAX_DELTA \
+  ((((uint64_t) 1) << (MHD_TW_SLOT_BITS * MHD_TW_LEVELS)) - 1)
+
+/**
+ * The number of ticks covered by one slot of the @a level.
+ */
+#define MHD_TW_LEVEL_GRAN(level) \
+  (((uint64_t) 1) << (MHD_TW_SLOT_BITS * (level)))
+
+
+/**
+ * Find the number of trailing zero bits.
+ *
+ * @param v the value to check, must not be zero
+ * @return the number of trailing zero bits
+ */
+static unsigned int
+tw_ctz64 (uint64_t v)
+{
+  unsigned int n = 0;
+
+  mhd_assert (0 != v);
+  if (0 == (v & 0xFFFFFFFFU))
+  {
+    n += 32;
+    v >>= 32;
+  }
+  if (0 == (v & 0xFFFFU))
+  {
+    n += 16;
+    v >>= 16;
+  }
+  if (0 == (v & 0xFFU))
+  {
+    n += 8;
+    v >>= 8;
+  }
+  if (0 == (v & 0xFU))
+  {
+    n += 4;
+    v >>= 4;
+  }
+  if (0 == (v & 0x3U))
+  {
+    n += 2;
+    v >>= 2;
+  }
+  if (0 == (v & 0x1U))
+    n += 1;
+  return n;
+}
+
+
+/**
+ * Insert entry to the head of the list.
+ *
+ * @param head the head of the list
+ * @param e the entry to insert
+ */
+static void
+tw_list_insert (struct MHD_TimerEntry **head,
+                struct MHD_TimerEntry *e)
+{
+  e->prev = NULL;
+  e->next = *head;
+  if (NULL != *head)
+    (*head)->prev = e;
+  *head = e;
+}
+
+
+/**
+ * Initialise the wheel.
+ *
+ * @param w the wheel to initialise
+ * @param now the current tick
+ */
+void
+MHD_timer_wheel_init (struct MHD_TimerWheel *w,
+                      uint64_t now)
+{
+  memset (w,
+          0,
+          sizeof(*w));
+  w->now = now;
+}
+
+
+/**
+ * Put the entry into the slot or into the list of expired entries
+ * according to the current tick of the wheel.
+ *
+ * @param w the wheel to use
+ * @param e the entry to put, not armed
+ */
+static void
+tw_place (struct MHD_TimerWheel *w,
+          struct MHD_TimerEntry *e)
+{
+  uint64_t delta;
+  unsigned int level;
+
+  if (e->expires <= w->now)
+  {
+    e->where = MHD_TW_WHERE_EXPIRED;
+    tw_list_insert (&w->expired,
+                    e);
+    return;
+  }
+  delta = e->expires - w->now;
+  if (MHD_TW_MAX_DELTA < delta)
+  {
+    /* The owner of the entry will re-arm it on expiration */
+    delta = MHD_TW_MAX_DELTA;
+    e->expires = w->now + delta;
+  }
+  level = 0;
+  while (MHD_TW_LEVEL_GRAN (level + 1) <= delta)
+    level++;
+  mhd_assert (MHD_TW_LEVELS > level);
+  e->slot = (uint8_t) ((e->expires >> (MHD_TW_SLOT_BITS * level))
+                       & (MHD_TW_SLOTS - 1));
+  e->where = (uint8_t) (level + 1);
+  tw_list_insert (&w->slots[level][e->slot],
+                  e);
+  w->occupied[level] |= ((uint64_t) 1) << e->slot;
+  w->num_pending++;
+}
+
+
+/**
+ * Arm (or re-arm) timer entry.
+ *
+ * @param w the wheel to use
+ * @param e the entry to arm, could be already armed
+ * @param expires the tick when the timer should expire
+ */
+void
+MHD_timer_wheel_arm (struct MHD_TimerWheel *w,
+                     struct MHD_TimerEntry *e,
+                     uint64_t expires)
+{
+  MHD_timer_wheel_disarm (w,
+                          e);
+  e->expires = expires;
+  tw_place (w,
+            e);
+}
+
+
+/**
+ * Disarm timer entry.
+ *
+ * @param w the wheel to use
+ * @param e the entry to disarm, no-op if entry is not armed
+ */
+void
+MHD_timer_wheel_disarm (struct MHD_TimerWheel *w,
+                        struct MHD_TimerEntry *e)
+{
+  struct MHD_TimerEntry **head;
+
+  if (0 == e->where)
+    return;
+  if (MHD_TW_WHERE_EXPIRED == e->where)
+    head = &w->expired;
+  else
+  {
+    mhd_assert (MHD_TW_LEVELS >= e->where);
+    head = &w->slots[e->where - 1][e->slot];
+  }
+  if (NULL != e->prev)
+    e->prev->next = e->next;
+  else
+    *head = e->next;
+  if (NULL != e->next)
+    e->next->prev = e->prev;
+  if (MHD_TW_WHERE_EXPIRED != e->where)
+  {
+    if (NULL == *head)
+      w->occupied[e->where - 1] &= ~(((uint64_t) 1) << e->slot);
+    mhd_assert (0 != w->num_pending);
+    w->num_pending--;
+  }
+  e->next = NULL;
+  e->prev = NULL;
+  e->where = 0;
+}
+
+
+/**
+ * Get the first tick after the current tick when any slot of
+ * the @a level must be processed.
+ *
+ * @param w the wheel to use
+ * @param level the level to check, must have non-empty slots
+ * @return the tick number
+ */
+static uint64_t
+tw_level_next (const struct MHD_TimerWheel *w,
+               unsigned int level)
+{
+  const unsigned int shift = MHD_TW_SLOT_BITS * level;
+  const uint64_t pos = w->now >> shift;
+  const unsigned int first = (unsigned int) ((pos + 1) & (MHD_TW_SLOTS - 1));
+  uint64_t bits = w->occupied[level];
+
+  mhd_assert (0 != bits);
+  /* Rotate, so the bit of the slot following the current one is
+     the lowest bit */
+  if (0 != first)
+    bits = (bits >> first) | (bits << (MHD_TW_SLOTS - first));
+  return (pos + 1 + tw_ctz64 (bits)) << shift;
+}
+
+
+/**
+ * Get the tick when the wheel must be advanced next time.
+ * The returned value could be earlier than the earliest expiration
+ * as entries on the higher levels need to be moved to the lower
+ * levels first.
+ *
+ * @param w the wheel to use
+ * @param[out] tick set to the next tick to process, the current
+ *                  tick if there are expired entries
+ * @return 'true' if any entry is armed, 'false' otherwise
+ */
+bool
+MHD_timer_wheel_next (const struct MHD_TimerWheel *w,
+                      uint64_t *tick)
+{
+  unsigned int level;
+  bool found;
+
+  if (NULL != w->expired)
+  {
+    *tick = w->now;
+    return true;
+  }
+  if (0 == w->num_pending)
+    return false;
+  found = false;
+  for (level = 0; level < MHD_TW_LEVELS; level++)
+  {
+    uint64_t t;
+
+    if (0 == w->occupied[level])
+      continue;
+    t = tw_level_next (w,
+                       level);
+    if ( (! found) ||
+         (t < *tick) )
+      *tick = t;
+    found = true;
+  }
+  mhd_assert (found);
+  return found;
+}
+
+
+/**
+ * Process the current tick of the wheel: move the entries of the
+ * higher levels to the lower levels and move expired entries to
+ * the list of expired entries.
+ *
+ * @param w the wheel to use
+ */
+static void
+tw_process_tick (struct MHD_TimerWheel *w)
+{
+  unsigned int level;
+  unsigned int slot;
+  struct MHD_TimerEntry *e;
+
+  /* Higher levels first, entries could be moved to the slot of lower
+     level which is processed at the same tick. */
+  for (level = MHD_TW_LEVELS - 1; 0 < level; level--)
+  {
+    if (0 != (w->now & (MHD_TW_LEVEL_GRAN (level) - 1)))
+      continue;
+    slot = (unsigned int) ((w->now >> (MHD_TW_SLOT_BITS * level))
+                           & (MHD_TW_SLOTS - 1));
+    while (NULL != (e = w->slots[level][slot]))
+    {
+      MHD_timer_wheel_disarm (w,
+                              e);
+      tw_place (w,
+                e);
+    }
+  }
+  slot = (unsigned int) (w->now & (MHD_TW_SLOTS - 1));
+  while (NULL != (e = w->slots[0][slot]))
+  {
+    mhd_assert (e->expires == w->now);
+    MHD_timer_wheel_disarm (w,
+                            e);
+    tw_place (w,
+              e);
+  }
+}
+
+
+/**
+ * Advance the wheel to the @a now tick.  All entries expired by
+ * the @a now tick are moved to the list of expired entries.
+ * The complexity depends on the number of slots with entries, not
+ * on the number of elapsed ticks.
+ *
+ * @param w the wheel to use
+ * @param now the current tick
+ */
+void
+MHD_timer_wheel_advance (struct MHD_TimerWheel *w,
+                         uint64_t now)
+{
+  while (w->now < now)
+  {
+    uint64_t next;
+    unsigned int level;
+
+    if (0 == w->num_pending)
+    {
+      w->now = now;
+      return;
+    }
+    next = 0;
+    for (level = 0; level < MHD_TW_LEVELS; level++)
+    {
+      uint64_t t;
+
+      if (0 == w->occupied[level])
+        continue;
+      t = tw_level_next (w,
+                         level);
+      if ( (0 == next) ||
+           (t < next) )
+        next = t;
+    }
+    mhd_assert (next > w->now);
+    if (next > now)
+    {
+      w->now = now;
+      return;
+    }
+    w->now = next;
+    tw_process_tick (w);
+  }
+}
+
+
+/**
+ * Take one entry from the list of expired entries.
+ * The returned entry is not armed anymore.
+ *
+ * @param w the wheel to use
+ * @return the expired entry or NULL if no entries expired
+ */
+struct MHD_TimerEntry *
+MHD_timer_wheel_pop_expired (struct MHD_TimerWheel *w)
+{
+  struct MHD_TimerEntry *e;
+
+  e = w->expired;
+  if (NULL != e)
+    MHD_timer_wheel_disarm (w,
+                            e);
+  return e;
+}
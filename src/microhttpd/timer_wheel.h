@@ -0,0 +1,218 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/timer_wheel.h
+ * @brief  hierarchical timer wheel declarations
+ * @author agent
+ *
+ * The wheel keeps timer entries in slots of several levels, each
+ * level having #MHD_TW_SLOTS slots.  A slot of level L covers
+ * 2^(L * #MHD_TW_SLOT_BITS) ticks.  Arming and disarming an entry
+ * is O(1), entries are moved ("cascaded") to the lower levels when
+ * the time approaches their expiration.  The wheel does not use
+ * any locking, the caller must serialise access.
+ */
+
+#ifndef MHD_TIMER_WHEEL_H
+#define MHD_TIMER_WHEEL_H 1
+
+#include "mhd_options.h"
+#include <stddef.h>
+#include <stdint.h>
+#ifdef HAVE_STDBOOL_H
+#include <stdbool.h>
+#endif /* HAVE_STDBOOL_H */
+
+/**
+ * The number of bits of the tick number used by single level.
+ */
+#define MHD_TW_SLOT_BITS 6
+
+/**
+ * The number of slots on each level.
+ */
+#define MHD_TW_SLOTS (1U << MHD_TW_SLOT_BITS)
+
+/**
+ * The number of levels.  With one millisecond ticks the wheel covers
+ * about two years, later timers are clamped to the maximum range.
+ */
+#define MHD_TW_LEVELS 6
+
+
+/**
+ * Timer entry, to be embedded into the object that needs a timer.
+ * Zero-initialised entry is not armed.
+ */
+struct MHD_TimerEntry
+{
+  /**
+   * Next entry in the same slot.
+   */
+  struct MHD_TimerEntry *next;
+
+  /**
+   * Previous entry in the same slot.
+   */
+  struct MHD_TimerEntry *prev;
+
+  /**
+   * The closure, typically the object with embedded entry.
+   */
+  void *cls;
+
+  /**
+   * The tick when the timer expires.
+   */
+  uint64_t expires;
+
+  /**
+   * Zero if not armed, level number plus one if entry is in the
+   * wheel, #MHD_TW_LEVELS plus one if entry is in the list
+   * of expired entries.
+   */
+  uint8_t where;
+
+  /**
+   * The slot of the level.
+   */
+  uint8_t slot;
+};
+
+
+/**
+ * Hierarchical timer wheel.
+ */
+struct MHD_TimerWheel
+{
+  /**
+   * The slots, each slot is a DLL of entries.
+   */
+  struct MHD_TimerEntry *slots[MHD_TW_LEVELS][MHD_TW_SLOTS];
+
+  /**
+   * The bitmaps of non-empty slots, one bitmap per level.
+   */
+  uint64_t occupied[MHD_TW_LEVELS];
+
+  /**
+   * The list of expired entries, not yet taken by
+   * #MHD_timer_wheel_pop_expired().
+   */
+  struct MHD_TimerEntry *expired;
+
+  /**
+   * The current tick, all ticks up to this one have been processed.
+   */
+  uint64_t now;
+
+  /**
+   * The number of entries in the slots (not counting expired entries).
+   */
+  size_t num_pending;
+};
+
+
+/**
+ * Check whether timer entry is armed (or expired and not yet
+ * taken from the wheel).
+ *
+ * @param e the entry to check
+ * @return 'true' if entry is armed
+ */
+#define MHD_timer_entry_is_armed(e) (0 != (e)->where)
+
+
+/**
+ * Initialise the wheel.
+ *
+ * @param w the wheel to initialise
+ * @param now the current tick
+ */
+void
+MHD_timer_wheel_init (struct MHD_TimerWheel *w,
+                      uint64_t now);
+
+
+/**
+ * Arm (or re-arm) timer entry.
+ *
+ * @param w the wheel to use
+ * @param e the entry to arm, could be already armed
+ * @param expires the tick when the timer should expire
+ */
+void
+MHD_timer_wheel_arm (struct MHD_TimerWheel *w,
+                     struct MHD_TimerEntry *e,
+                     uint64_t expires);
+
+
+/**
+ * Disarm timer entry.
+ *
+ * @param w the wheel to use
+ * @param e the entry to disarm, no-op if entry is not armed
+ */
+void
+MHD_timer_wheel_disarm (struct MHD_TimerWheel *w,
+                        struct MHD_TimerEntry *e);
+
+
+/**
+ * Advance the wheel to the @a now tick.  All entries expired by
+ * the @a now tick are moved to the list of expired entries.
+ * The complexity depends on the number of slots with entries, not
+ * on the number of elapsed ticks.
+ *
+ * @param w the wheel to use
+ * @param now the current tick
+ */
+void
+MHD_timer_wheel_advance (struct MHD_TimerWheel *w,
+                         uint64_t now);
+
+
+/**
+ * Take one entry from the list of expired entries.
+ * The returned entry is not armed anymore.
+ *
+ * @param w the wheel to use
+ * @return the expired entry or NULL if no entries expired
+ */
+struct MHD_TimerEntry *
+MHD_timer_wheel_pop_expired (struct MHD_TimerWheel *w);
+
+
+/**
+ * Get the tick when the wheel must be advanced next time.
+ * The returned value could be earlier than the earliest expiration
+ * as entries on the higher levels need to be moved to the lower
+ * levels first.
+ *
+ * @param w the wheel to use
+ * @param[out] tick set to the next tick to process, the current
+ *                  tick if there are expired entries
+ * @return 'true' if any entry is armed, 'false' otherwise
+ */
+bool
+MHD_timer_wheel_next (const struct MHD_TimerWheel *w,
+                      uint64_t *tick);
+
+#endif /* ! MHD_TIMER_WHEEL_H */
@@ -27,6 +27,9 @@
 #include "microhttpd.h"
 #include "microhttpd_ws.h"
 #include "sha1.h"
+#if defined(__SSE2__) || defined(HAVE_AVX2_TARGET_FUNCS)
+#include <immintrin.h>
+#endif /* __SSE2__ || HAVE_AVX2_TARGET_FUNCS */
 
 struct MHD_WebSocketStream
 {
@@ -2062,6 +2065,294 @@ MHD_websocket_encode_overhead_size (struct MHD_WebSocketStream *ws,
 }
 
 
+#ifdef HAVE_AVX2_TARGET_FUNCS
+/**
+ * Unmasks the payload by 32 bytes blocks using AVX2 instructions
+ *
+ * @param dst the destination buffer
+ * @param src the source buffer
+ * @param len the size of the data
+ * @param mask4 the mask, rotated to the start of the data
+ * @return the number of processed bytes, multiple of 32
+ */
+__attribute__((target ("avx2"))) static size_t
+MHD_websocket_unmask_avx2 (char *dst,
+                           const char *src,
+                           size_t len,
+                           uint32_t mask4)
+{
+  const __m256i mask_v = _mm256_set1_epi32 ((int) mask4);
+  size_t i;
+
+  for (i = 0; i + 32 <= len; i += 32)
+  {
+    __m256i v = _mm256_loadu_si256 ((const __m256i *) (src + i));
+    _mm256_storeu_si256 ((__m256i *) (dst + i),
+                         _mm256_xor_si256 (v, mask_v));
+  }
+  return i;
+}
+
+
+/**
+ * Counts the leading ASCII characters by 32 bytes blocks using
+ * AVX2 instructions
+ *
+ * @param buf the buffer to check
+ * @param len the size of the data
+ * @return the number of checked bytes, all of them are ASCII characters
+ */
+__attribute__((target ("avx2"))) static size_t
+MHD_websocket_skip_ascii_avx2 (const char *buf,
+                               size_t len)
+{
+  size_t i;
+
+  for (i = 0; i + 32 <= len; i += 32)
+  {
+    __m256i v = _mm256_loadu_si256 ((const __m256i *) (buf + i));
+    if (0 != _mm256_movemask_epi8 (v))
+      break;
+  }
+  return i;
+}
+
+
+/* The error bits used by MHD_websocket_validate_utf8_avx2(),
+   the combination of the first two bytes which is invalid */
+/* 11______ 0_______ or 11______ 11______ */
+#define MHD_WS_UTF8_TOO_SHORT   0x01
+/* 0_______ 10______ */
+#define MHD_WS_UTF8_TOO_LONG    0x02
+/* 11100000 100_____ */
+#define MHD_WS_UTF8_OVERLONG_3  0x04
+/* 11110100 1001____ and larger code points */
+#define MHD_WS_UTF8_TOO_LARGE   0x08
+/* 11101101 101_____ */
+#define MHD_WS_UTF8_SURROGATE   0x10
+/* 1100000_ 10______ */
+#define MHD_WS_UTF8_OVERLONG_2  0x20
+/* 11110000 1000____ or 11110101 1000____ and larger code points */
+#define MHD_WS_UTF8_OVERLONG_4  0x40
+/* 10______ 10______ */
+#define MHD_WS_UTF8_TWO_CONTS   0x80
+#define MHD_WS_UTF8_CARRY \
+  (MHD_WS_UTF8_TOO_SHORT | MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_TWO_CONTS)
+#define MHD_WS_UTF8_LARGE \
+  (MHD_WS_UTF8_CARRY | MHD_WS_UTF8_TOO_LARGE | MHD_WS_UTF8_OVERLONG_4)
+
+
+/**
+ * Gets the bytes of @a input shifted by @a n positions, the bytes
+ * of @a prev are shifted in
+ */
+#define MHD_WS_AVX2_PREV(input,prev,n)                                   \
+  _mm256_alignr_epi8 ((input),                                           \
+                      _mm256_permute2x128_si256 ((prev), (input), 0x21), \
+                      16 - (n))
+
+
+/**
+ * Validates UTF-8 text by 32 bytes blocks using AVX2 instructions.
+ * The lookup tables classify the first two bytes of each sequence,
+ * the third and the fourth bytes are checked by the lengths of
+ * the sequences (the algorithm by J. Keiser and D. Lemire).
+ * The text must start with the first byte of a sequence.
+ *
+ * @param buf the buffer to check
+ * @param len the size of the data
+ * @return the size of the valid data at the start of the buffer,
+ *         the data ends with complete sequence; the rest of the data
+ *         must be checked by the scalar code
+ */
+__attribute__((target ("avx2"))) static size_t
+MHD_websocket_validate_utf8_avx2 (const char *buf,
+                                  size_t len)
+{
+  const __m256i byte_1_high_tbl = _mm256_setr_epi8 (
+    /* 0_______ ________ */
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    /* 10______ ________ */
+    (char) MHD_WS_UTF8_TWO_CONTS, (char) MHD_WS_UTF8_TWO_CONTS,
+    (char) MHD_WS_UTF8_TWO_CONTS, (char) MHD_WS_UTF8_TWO_CONTS,
+    /* 1100____ ________ */
+    MHD_WS_UTF8_TOO_SHORT | MHD_WS_UTF8_OVERLONG_2,
+    /* 1101____ ________ */
+    MHD_WS_UTF8_TOO_SHORT,
+    /* 1110____ ________ */
+    MHD_WS_UTF8_TOO_SHORT | MHD_WS_UTF8_OVERLONG_3 | MHD_WS_UTF8_SURROGATE,
+    /* 1111____ ________ */
+    MHD_WS_UTF8_TOO_SHORT | MHD_WS_UTF8_TOO_LARGE | MHD_WS_UTF8_OVERLONG_4,
+    /* the same for the second lane */
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    MHD_WS_UTF8_TOO_LONG, MHD_WS_UTF8_TOO_LONG,
+    (char) MHD_WS_UTF8_TWO_CONTS, (char) MHD_WS_UTF8_TWO_CONTS,
+    (char) MHD_WS_UTF8_TWO_CONTS, (char) MHD_WS_UTF8_TWO_CONTS,
+    MHD_WS_UTF8_TOO_SHORT | MHD_WS_UTF8_OVERLONG_2,
+    MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT | MHD_WS_UTF8_OVERLONG_3 | MHD_WS_UTF8_SURROGATE,
+    MHD_WS_UTF8_TOO_SHORT | MHD_WS_UTF8_TOO_LARGE | MHD_WS_UTF8_OVERLONG_4);
+  const __m256i byte_1_low_tbl = _mm256_setr_epi8 (
+    /* ____0000 ________ */
+    (char) (MHD_WS_UTF8_CARRY | MHD_WS_UTF8_OVERLONG_3
+            | MHD_WS_UTF8_OVERLONG_2 | MHD_WS_UTF8_OVERLONG_4),
+    /* ____0001 ________ */
+    (char) (MHD_WS_UTF8_CARRY | MHD_WS_UTF8_OVERLONG_2),
+    /* ____001_ ________ */
+    (char) MHD_WS_UTF8_CARRY, (char) MHD_WS_UTF8_CARRY,
+    /* ____0100 ________ */
+    (char) (MHD_WS_UTF8_CARRY | MHD_WS_UTF8_TOO_LARGE),
+    /* ____0101 ________ and above */
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    /* ____1101 ________ */
+    (char) (MHD_WS_UTF8_LARGE | MHD_WS_UTF8_SURROGATE),
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    /* the same for the second lane */
+    (char) (MHD_WS_UTF8_CARRY | MHD_WS_UTF8_OVERLONG_3
+            | MHD_WS_UTF8_OVERLONG_2 | MHD_WS_UTF8_OVERLONG_4),
+    (char) (MHD_WS_UTF8_CARRY | MHD_WS_UTF8_OVERLONG_2),
+    (char) MHD_WS_UTF8_CARRY, (char) MHD_WS_UTF8_CARRY,
+    (char) (MHD_WS_UTF8_CARRY | MHD_WS_UTF8_TOO_LARGE),
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE,
+    (char) (MHD_WS_UTF8_LARGE | MHD_WS_UTF8_SURROGATE),
+    (char) MHD_WS_UTF8_LARGE, (char) MHD_WS_UTF8_LARGE);
+  const __m256i byte_2_high_tbl = _mm256_setr_epi8 (
+    /* ________ 0_______ */
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    /* ________ 1000____ */
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_OVERLONG_3
+            | MHD_WS_UTF8_OVERLONG_4),
+    /* ________ 1001____ */
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_OVERLONG_3
+            | MHD_WS_UTF8_TOO_LARGE),
+    /* ________ 101_____ */
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_SURROGATE
+            | MHD_WS_UTF8_TOO_LARGE),
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_SURROGATE
+            | MHD_WS_UTF8_TOO_LARGE),
+    /* ________ 11______ */
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    /* the same for the second lane */
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_OVERLONG_3
+            | MHD_WS_UTF8_OVERLONG_4),
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_OVERLONG_3
+            | MHD_WS_UTF8_TOO_LARGE),
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_SURROGATE
+            | MHD_WS_UTF8_TOO_LARGE),
+    (char) (MHD_WS_UTF8_TOO_LONG | MHD_WS_UTF8_OVERLONG_2
+            | MHD_WS_UTF8_TWO_CONTS | MHD_WS_UTF8_SURROGATE
+            | MHD_WS_UTF8_TOO_LARGE),
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT,
+    MHD_WS_UTF8_TOO_SHORT, MHD_WS_UTF8_TOO_SHORT);
+  /* the last bytes of the block, which start incomplete sequence */
+  const __m256i incomplete_max = _mm256_setr_epi8 (
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+  const __m256i nibble_mask = _mm256_set1_epi8 (0x0F);
+  __m256i prev_input = _mm256_setzero_si256 ();
+  __m256i prev_incomplete = _mm256_setzero_si256 ();
+  size_t valid = 0;
+  size_t i;
+
+  for (i = 0; i + 32 <= len; i += 32)
+  {
+    const __m256i input = _mm256_loadu_si256 ((const __m256i *) (buf + i));
+    __m256i error;
+
+    if (0 == _mm256_movemask_epi8 (input))
+    {
+      /* ASCII block, only previous incomplete sequence is an error */
+      if (! _mm256_testz_si256 (prev_incomplete, prev_incomplete))
+        break;
+      prev_input = input;
+      valid = i + 32;
+    }
+    else
+    {
+      const __m256i prev1 = MHD_WS_AVX2_PREV (input, prev_input, 1);
+      const __m256i prev2 = MHD_WS_AVX2_PREV (input, prev_input, 2);
+      const __m256i prev3 = MHD_WS_AVX2_PREV (input, prev_input, 3);
+      const __m256i byte_1_high =
+        _mm256_shuffle_epi8 (byte_1_high_tbl,
+                             _mm256_and_si256 (_mm256_srli_epi16 (prev1, 4),
+                                               nibble_mask));
+      const __m256i byte_1_low =
+        _mm256_shuffle_epi8 (byte_1_low_tbl,
+                             _mm256_and_si256 (prev1, nibble_mask));
+      const __m256i byte_2_high =
+        _mm256_shuffle_epi8 (byte_2_high_tbl,
+                             _mm256_and_si256 (_mm256_srli_epi16 (input, 4),
+                                               nibble_mask));
+      const __m256i special_cases =
+        _mm256_and_si256 (_mm256_and_si256 (byte_1_high, byte_1_low),
+                          byte_2_high);
+      /* the third and the fourth bytes of the sequences must be
+         continuation bytes, the highest bit is set for them */
+      const __m256i must23 =
+        _mm256_or_si256 (_mm256_subs_epu8 (prev2,
+                                           _mm256_set1_epi8 (0xE0 - 0x80)),
+                         _mm256_subs_epu8 (prev3,
+                                           _mm256_set1_epi8 (0xF0 - 0x80)));
+      const __m256i must23_80 =
+        _mm256_and_si256 (must23,
+                          _mm256_set1_epi8 ((char) 0x80));
+
+      error = _mm256_xor_si256 (must23_80,
+                                special_cases);
+      if (! _mm256_testz_si256 (error, error))
+        break;
+      prev_incomplete = _mm256_subs_epu8 (input,
+                                          incomplete_max);
+      prev_input = input;
+      valid = i + 32;
+      if (! _mm256_testz_si256 (prev_incomplete, prev_incomplete))
+      {
+        /* the block ends with incomplete sequence, the data is valid
+           up to the first byte of this sequence */
+        while (0x80 == (((unsigned char) buf[valid - 1]) & 0xC0))
+          --valid;
+        --valid;
+      }
+    }
+  }
+  return valid;
+}
+
+
+/**
+ * Checks whether AVX2 instructions can be used
+ */
+#define MHD_websocket_have_avx2() (0 != __builtin_cpu_supports ("avx2"))
+#endif /* HAVE_AVX2_TARGET_FUNCS */
+
+
 /**
  * Copies the payload to the destination (using mask)
  */
@@ -2083,16 +2374,89 @@ MHD_websocket_copy_payload (char *dst,
     {
       /* mask is used */
       char mask_[4];
+      char mask4_[4];
+      uint32_t mask4;
+      uint64_t mask8;
+      size_t i = 0;
       *((uint32_t *) mask_) = mask;
-      for (size_t i = 0; i < len; ++i)
+      /* rotate the mask, so the first byte of the mask is used for
+         the first byte of the data */
+      for (size_t j = 0; j < 4; ++j)
+        mask4_[j] = mask_[(j + mask_offset) & 3];
+      memcpy (&mask4, mask4_, sizeof(mask4));
+      mask8 = (((uint64_t) mask4) << 32) | mask4;
+      /* all wide blocks are multiple of 4 bytes, so the mask
+         keeps the same position */
+#ifdef HAVE_AVX2_TARGET_FUNCS
+      if ((64 <= len) && MHD_websocket_have_avx2 ())
+        i = MHD_websocket_unmask_avx2 (dst, src, len, mask4);
+#endif /* HAVE_AVX2_TARGET_FUNCS */
+#ifdef __SSE2__
+      if (i + 16 <= len)
+      {
+        const __m128i mask_v = _mm_set1_epi32 ((int) mask4);
+        for (; i + 16 <= len; i += 16)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+          _mm_storeu_si128 ((__m128i *) (dst + i),
+                            _mm_xor_si128 (v, mask_v));
+        }
+      }
+#endif /* __SSE2__ */
+      for (; i + 8 <= len; i += 8)
+      {
+        uint64_t w;
+        memcpy (&w, src + i, sizeof(w));
+        w ^= mask8;
+        memcpy (dst + i, &w, sizeof(w));
+      }
+      for (; i < len; ++i)
       {
-        dst[i] = src[i] ^ mask_[(i + mask_offset) & 3];
+        dst[i] = src[i] ^ mask4_[i & 3];
       }
     }
   }
 }
 
 
+/**
+ * Counts the leading ASCII characters (which do not need
+ * the UTF-8 state machine)
+ *
+ * @param buf the buffer to check
+ * @param len the size of the data
+ * @return the number of leading ASCII characters
+ */
+static size_t
+MHD_websocket_skip_ascii (const char *buf,
+                          size_t len)
+{
+  size_t i = 0;
+#ifdef HAVE_AVX2_TARGET_FUNCS
+  if ((64 <= len) && MHD_websocket_have_avx2 ())
+    i = MHD_websocket_skip_ascii_avx2 (buf, len);
+#endif /* HAVE_AVX2_TARGET_FUNCS */
+#ifdef __SSE2__
+  for (; i + 16 <= len; i += 16)
+  {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (buf + i));
+    if (0 != _mm_movemask_epi8 (v))
+      break;
+  }
+#endif /* __SSE2__ */
+  for (; i + 8 <= len; i += 8)
+  {
+    uint64_t w;
+    memcpy (&w, buf + i, sizeof(w));
+    if (0 != (w & UINT64_C (0x8080808080808080)))
+      break;
+  }
+  while ((i < len) && (0 == (((unsigned char) buf[i]) & 0x80)))
+    ++i;
+  return i;
+}
+
+
 /**
  * Checks a UTF-8 sequence
  */
@@ -2107,6 +2471,24 @@ MHD_websocket_check_utf8 (const char *buf,
 
   for (size_t i = 0; i < buf_len; ++i)
   {
+    if (MHD_WEBSOCKET_UTF8STEP_NORMAL == utf8_step_)
+    {
+#ifdef HAVE_AVX2_TARGET_FUNCS
+      /* Validate the large blocks by the vector code, the step is normal */
+      /* at the end of the validated data */
+      if ((64 <= buf_len - i) && MHD_websocket_have_avx2 ())
+      {
+        i += MHD_websocket_validate_utf8_avx2 (buf + i, buf_len - i);
+        if (i == buf_len)
+          break;
+      }
+#endif /* HAVE_AVX2_TARGET_FUNCS */
+      /* RFC 3629 4: single byte UTF-8 sequences do not change the step, */
+      /* so skip them in the large blocks */
+      i += MHD_websocket_skip_ascii (buf + i, buf_len - i);
+      if (i == buf_len)
+        break;
+    }
     unsigned char character = (unsigned char) buf[i];
     switch (utf8_step_)
     {
@@ -0,0 +1,277 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd_ws/perf_websocket.c
+ * @brief  Micro-benchmark for decoding of masked websocket frames
+ *         (unmasking and UTF-8 validation)
+ * @author agent
+ */
+#include "microhttpd.h"
+#include "microhttpd_ws.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * The size of the payload of the test frames
+ */
+#define PAYLOAD_SIZE (1024 * 1024)
+
+/**
+ * The total amount of the payload data decoded for each frame type
+ */
+#define TOTAL_SIZE ((size_t) 256 * 1024 * 1024)
+
+
+/**
+ * Custom `rng()` function used for client mode
+ */
+static size_t
+perf_rng (void *cls, void *buf, size_t buf_len)
+{
+  (void) cls;
+  for (size_t i = 0; i < buf_len; ++i)
+  {
+    ((char *) buf) [i] = (char) (rand () % 0xFF);
+  }
+
+  return buf_len;
+}
+
+
+/**
+ * Fills the buffer with the repeated sample
+ */
+static void
+fill_payload (char *buf,
+              size_t buf_len,
+              const char *sample)
+{
+  const size_t sample_len = strlen (sample);
+  size_t i = 0;
+
+  while (i + sample_len <= buf_len)
+  {
+    memcpy (buf + i, sample, sample_len);
+    i += sample_len;
+  }
+  /* pad with ASCII to keep the text valid */
+  memset (buf + i, ' ', buf_len - i);
+}
+
+
+/**
+ * Decodes the frame in pieces of the given size and compares
+ * the result with the original payload
+ *
+ * @return 0 on success, 1 on failure
+ */
+static int
+decode_frame (const char *frame,
+              size_t frame_len,
+              size_t piece_size,
+              const char *payload,
+              size_t payload_len)
+{
+  struct MHD_WebSocketStream *ws;
+  size_t pos = 0;
+  int result = 1;
+
+  if (MHD_WEBSOCKET_STATUS_OK !=
+      MHD_websocket_stream_init (&ws,
+                                 MHD_WEBSOCKET_FLAG_SERVER,
+                                 0))
+    return 1;
+  while (pos < frame_len)
+  {
+    size_t piece = frame_len - pos;
+    size_t read_len = 0;
+    char *decoded = NULL;
+    size_t decoded_len = 0;
+    int ret;
+
+    if (piece > piece_size)
+      piece = piece_size;
+    ret = MHD_websocket_decode (ws,
+                                frame + pos,
+                                piece,
+                                &read_len,
+                                &decoded,
+                                &decoded_len);
+    pos += read_len;
+    if (NULL != decoded)
+    {
+      if ( ((MHD_WEBSOCKET_STATUS_TEXT_FRAME == ret) ||
+            (MHD_WEBSOCKET_STATUS_BINARY_FRAME == ret)) &&
+           (pos == frame_len) &&
+           (decoded_len == payload_len) &&
+           (0 == memcmp (decoded, payload, payload_len)) )
+        result = 0;
+      MHD_websocket_free (ws, decoded);
+      break;
+    }
+    if ((0 > ret) || (0 == read_len))
+      break;
+  }
+  MHD_websocket_stream_free (ws);
+  return result;
+}
+
+
+/**
+ * Encodes the payload with the client mask and measures the decoding
+ * speed for the encoded frame
+ *
+ * @return 0 on success, the number of failures otherwise
+ */
+static int
+perf_frame (const char *name,
+            const char *payload,
+            size_t payload_len,
+            int is_text)
+{
+  struct MHD_WebSocketStream *ws;
+  char *frame = NULL;
+  size_t frame_len = 0;
+  int ret;
+  int errors = 0;
+  clock_t start;
+  double secs;
+  size_t rounds;
+  static const size_t pieces[] = { 1, 3, 7, 61, 1000, 4093 };
+
+  if (MHD_WEBSOCKET_STATUS_OK !=
+      MHD_websocket_stream_init2 (&ws,
+                                  MHD_WEBSOCKET_FLAG_CLIENT,
+                                  0,
+                                  malloc,
+                                  realloc,
+                                  free,
+                                  NULL,
+                                  perf_rng))
+    return 1;
+  if (is_text)
+    ret = MHD_websocket_encode_text (ws,
+                                     payload,
+                                     payload_len,
+                                     MHD_WEBSOCKET_FRAGMENTATION_NONE,
+                                     &frame,
+                                     &frame_len,
+                                     NULL);
+  else
+    ret = MHD_websocket_encode_binary (ws,
+                                       payload,
+                                       payload_len,
+                                       MHD_WEBSOCKET_FRAGMENTATION_NONE,
+                                       &frame,
+                                       &frame_len);
+  if (MHD_WEBSOCKET_STATUS_OK != ret)
+  {
+    fprintf (stderr, "%s: encoding failed: %d\n", name, ret);
+    MHD_websocket_stream_free (ws);
+    return 1;
+  }
+  /* check the decoding with different alignment of the data */
+  for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); ++i)
+  {
+    size_t part_len = payload_len < 16 * 1024 ? payload_len : 16 * 1024;
+    char *part_frame = NULL;
+    size_t part_frame_len = 0;
+
+    /* do not split UTF-8 sequence */
+    while ((0 < part_len) && (0 != (payload[part_len - 1] & 0x80)))
+      --part_len;
+
+    if (is_text)
+      ret = MHD_websocket_encode_text (ws, payload, part_len,
+                                       MHD_WEBSOCKET_FRAGMENTATION_NONE,
+                                       &part_frame, &part_frame_len, NULL);
+    else
+      ret = MHD_websocket_encode_binary (ws, payload, part_len,
+                                         MHD_WEBSOCKET_FRAGMENTATION_NONE,
+                                         &part_frame, &part_frame_len);
+    if ((MHD_WEBSOCKET_STATUS_OK != ret) ||
+        (0 != decode_frame (part_frame, part_frame_len, pieces[i],
+                            payload, part_len)))
+    {
+      fprintf (stderr, "%s: decoding by %u bytes pieces failed.\n",
+               name, (unsigned int) pieces[i]);
+      errors++;
+    }
+    MHD_websocket_free (ws, part_frame);
+  }
+  /* measure the speed */
+  rounds = TOTAL_SIZE / payload_len;
+  start = clock ();
+  for (size_t i = 0; i < rounds; ++i)
+  {
+    if (0 != decode_frame (frame, frame_len, frame_len,
+                           payload, payload_len))
+    {
+      fprintf (stderr, "%s: decoding failed.\n", name);
+      errors++;
+      break;
+    }
+  }
+  secs = (double) (clock () - start) / CLOCKS_PER_SEC;
+  printf ("%-12s %4u MiB decoded in %6.3f s: %6.2f GB/s\n",
+          name,
+          (unsigned int) (rounds * payload_len / (1024 * 1024)),
+          secs,
+          (0 < secs) ? ((double) (rounds * payload_len) / secs / 1e9) : 0.0);
+  MHD_websocket_free (ws, frame);
+  MHD_websocket_stream_free (ws);
+  return errors;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  char *payload;
+  int errors = 0;
+  (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
+
+  payload = (char *) malloc (PAYLOAD_SIZE);
+  if (NULL == payload)
+    return 99;
+
+  fill_payload (payload, PAYLOAD_SIZE,
+                "The quick brown fox jumps over the lazy dog. ");
+  errors += perf_frame ("ASCII text", payload, PAYLOAD_SIZE, 1);
+
+  fill_payload (payload, PAYLOAD_SIZE,
+                "Hello, \xd0\x9c\xd0\xb8\xd1\x80! "
+                "\xe4\xbd\xa0\xe5\xa5\xbd\xe4\xb8\x96\xe7\x95\x8c "
+                "\xf0\x9f\x98\x80 The quick brown fox. ");
+  errors += perf_frame ("UTF-8 text", payload, PAYLOAD_SIZE, 1);
+
+  for (size_t i = 0; i < PAYLOAD_SIZE; ++i)
+    payload[i] = (char) (i * 7 + (i >> 8));
+  errors += perf_frame ("binary", payload, PAYLOAD_SIZE, 0);
+
+  free (payload);
+  if (0 != errors)
+    fprintf (stderr, "Error (code: %d)\n", errors);
+  return (0 == errors) ? 0 : 1;
+}
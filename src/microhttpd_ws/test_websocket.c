@@ -292,6 +292,53 @@ test_decode_single (unsigned int test_line,
 }
 
 
+/**
+ * Helper function which performs a decoder test for a text frame
+ * with a long payload of ASCII characters and the specified bytes
+ * at the specified offset (to check the vectorised UTF-8 validation)
+ */
+static int
+test_decode_long_utf8 (unsigned int test_line,
+                       size_t offset,
+                       const char *seq, size_t seq_len,
+                       int expected_return,
+                       size_t expected_error_offset)
+{
+  /* the text frame with 16-bit payload length 256 and the zero mask */
+  char frame[8 + 256] = "\x81\xFE\x01\x00\x00\x00\x00\x00";
+
+  memset (frame + 8, 'a', 256);
+  memcpy (frame + 8 + offset, seq, seq_len);
+  if (MHD_WEBSOCKET_STATUS_TEXT_FRAME == expected_return)
+    return test_decode_single (test_line,
+                               MHD_WEBSOCKET_FLAG_SERVER
+                               | MHD_WEBSOCKET_FLAG_NO_FRAGMENTS,
+                               0,
+                               1,
+                               0,
+                               frame,
+                               sizeof (frame),
+                               frame + 8,
+                               256,
+                               MHD_WEBSOCKET_STATUS_TEXT_FRAME,
+                               MHD_WEBSOCKET_VALIDITY_VALID,
+                               sizeof (frame));
+  return test_decode_single (test_line,
+                             MHD_WEBSOCKET_FLAG_SERVER
+                             | MHD_WEBSOCKET_FLAG_NO_FRAGMENTS,
+                             0,
+                             1,
+                             0,
+                             frame,
+                             sizeof (frame),
+                             NULL,
+                             0,
+                             expected_return,
+                             MHD_WEBSOCKET_VALIDITY_INVALID,
+                             8 + expected_error_offset);
+}
+
+
 /**
  * Test procedure for `MHD_websocket_stream_init()` and
  * `MHD_websocket_stream_init2()`
@@ -3482,6 +3529,101 @@ test_decodes ()
                                 MHD_WEBSOCKET_VALIDITY_INVALID,
                                 7);
 
+  /*
+  ------------------------------------------------------------------------------
+    UTF-8 sequences in the long payload
+  ------------------------------------------------------------------------------
+  */
+  /* Regular test: A two byte UTF-8 sequence split by the 32 bytes boundary */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   31,
+                                   "\xC3\xA4",
+                                   2,
+                                   MHD_WEBSOCKET_STATUS_TEXT_FRAME,
+                                   0);
+  /* Regular test: A three byte UTF-8 sequence split by the 64 bytes boundary */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   63,
+                                   "\xE2\x82\xAC",
+                                   3,
+                                   MHD_WEBSOCKET_STATUS_TEXT_FRAME,
+                                   0);
+  /* Regular test: A four byte UTF-8 sequence split by the 96 bytes boundary */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   94,
+                                   "\xF0\x9F\x98\x80",
+                                   4,
+                                   MHD_WEBSOCKET_STATUS_TEXT_FRAME,
+                                   0);
+  /* Regular test: A four byte UTF-8 sequence split by the 128 bytes boundary */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   127,
+                                   "\xF0\x9F\x98\x80",
+                                   4,
+                                   MHD_WEBSOCKET_STATUS_TEXT_FRAME,
+                                   0);
+  /* Fail test: A UTF-8 tail character without sequence start character
+     after the first 64 bytes */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   70,
+                                   "\xA4",
+                                   1,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   70);
+  /* Fail test: An overlong two byte UTF-8 sequence after the first 64 bytes */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   80,
+                                   "\xC0\x80",
+                                   2,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   80);
+  /* Fail test: An UTF-16 surrogate after the first 64 bytes */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   100,
+                                   "\xED\xA0\x80",
+                                   3,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   101);
+  /* Fail test: A broken two byte UTF-8 sequence,
+     the 32 bytes boundary is between the start and the wrong tail */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   95,
+                                   "\xC3",
+                                   1,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   96);
+  /* Fail test: A broken three byte UTF-8 sequence (two of three bytes),
+     the 64 bytes boundary is within the sequence */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   62,
+                                   "\xE2\x82",
+                                   2,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   64);
+  /* Fail test: A broken four byte UTF-8 sequence (three of four bytes),
+     the 128 bytes boundary is within the sequence */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   126,
+                                   "\xF0\x9F\x98",
+                                   3,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   129);
+  /* Fail test: The maximum allowed UTF-8 character + 1,
+     split by the 160 bytes boundary */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   158,
+                                   "\xF4\x90\x80\x80",
+                                   4,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   159);
+  /* Fail test: A broken two byte UTF-8 sequence in the last 64 bytes */
+  failed += test_decode_long_utf8 (__LINE__,
+                                   223,
+                                   "\xC3",
+                                   1,
+                                   MHD_WEBSOCKET_STATUS_UTF8_ENCODING_ERROR,
+                                   224);
+
   /*
   ------------------------------------------------------------------------------
     Unfinished UTF-8 sequence between fragmented text frame
@@ -0,0 +1,452 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 agent
+
+  libmicrohttpd is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3, or (at your
+  option) any later version.
+
+  libmicrohttpd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libmicrohttpd; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_https_get_sendfile.c
+ * @brief  Testcase for libmicrohttpd HTTPS GET operations with file-backed
+ *         responses and enabled kernel TLS offload
+ * @details The kernel TLS is enabled in GnuTLS by the configuration file
+ *          given by GNUTLS_SYSTEM_PRIORITY_FILE environment variable, the
+ *          test is re-executed with this variable set.  If the kernel TLS
+ *          is active on the connection socket, the file must be sent by
+ *          sendfile().  The test is skipped if the kernel or GnuTLS cannot
+ *          enable the kernel TLS.
+ *          The same data is requested also as the buffer response with
+ *          #MHD_OPTION_ZEROCOPY_THRESHOLD: MSG_ZEROCOPY must not be used
+ *          for TLS connections, including the kernel TLS ones.
+ * @author agent
+ */
+
+#include "platform.h"
+#include "microhttpd.h"
+#include <limits.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <curl/curl.h>
+#ifdef MHD_HTTPS_REQUIRE_GRYPT
+#include <gcrypt.h>
+#endif /* MHD_HTTPS_REQUIRE_GRYPT */
+#include "tls_test_common.h"
+#include "tls_test_keys.h"
+
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TLS_TX
+#define TLS_TX 1
+#endif
+#endif /* __linux__ */
+
+/**
+ * The name of the environment variable with the GnuTLS configuration
+ * file.  GnuTLS reads it only when the library is initialised.
+ */
+#define GNUTLS_CONFIG_ENV "GNUTLS_SYSTEM_PRIORITY_FILE"
+
+/**
+ * The environment variable set when the test is re-executed.
+ */
+#define REEXEC_ENV "MHD_TEST_KTLS_REEXEC"
+
+/**
+ * The path of the buffer response, other paths are the file response.
+ */
+#define BUFFER_PATH "/buffer"
+
+/**
+ * The threshold for the zerocopy sending, less than the size of the
+ * buffer response.
+ */
+#define ZEROCOPY_THRESHOLD (64 * 1024)
+
+#if defined(__linux__) && defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && \
+  defined(HAVE_LINUX_ERRQUEUE_H) && defined(HAVE_SENDMSG)
+/**
+ * MHD is expected to support the zerocopy sending.
+ */
+#define HAVE_ZEROCOPY 1
+#endif
+
+/**
+ * The size of the test file, large enough to require several
+ * sendfile() calls and several TLS records.
+ */
+#define TEST_FILE_SIZE (1024 * 1024 + 123)
+
+static char *sourcefile;
+
+static char *file_data;
+
+/**
+ * Set to non-zero if the kernel TLS is active for the sending on the
+ * socket of the connection.
+ */
+static volatile int ktls_active;
+
+/**
+ * The number of the tests with the kernel TLS active.
+ */
+static unsigned int ktls_tests;
+
+
+/**
+ * Check whether the kernel TLS is used for the sending on the socket
+ * of the @a connection.
+ *
+ * @param connection the connection to check
+ * @return non-zero if the kernel TLS is active
+ */
+static int
+is_ktls_active (struct MHD_Connection *connection)
+{
+#ifdef __linux__
+  const union MHD_ConnectionInfo *cinfo;
+  char crypto_info[128];
+  socklen_t len = (socklen_t) sizeof (crypto_info);
+
+  cinfo = MHD_get_connection_info (connection,
+                                   MHD_CONNECTION_INFO_CONNECTION_FD);
+  if (NULL == cinfo)
+    return 0;
+  /* Fails if the TLS ULP or the TX crypto parameters are not set */
+  return (0 == getsockopt (cinfo->connect_fd, SOL_TLS, TLS_TX,
+                           crypto_info, &len));
+#else  /* ! __linux__ */
+  (void) connection; /* Unused. Silent compiler warning. */
+  return 0;
+#endif /* ! __linux__ */
+}
+
+
+static enum MHD_Result
+file_ahc (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data,
+          size_t *upload_data_size,
+          void **req_cls)
+{
+  static int aptr;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  int fd;
+  (void) cls; (void) version;          /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size;     /* Unused. Silent compiler warning. */
+
+  if (0 != strcmp (method, MHD_HTTP_METHOD_GET))
+    return MHD_NO;              /* unexpected method */
+  if (&aptr != *req_cls)
+  {
+    /* do never respond on first call */
+    *req_cls = &aptr;
+    return MHD_YES;
+  }
+  *req_cls = NULL;                  /* reset when done */
+
+  /* The handshake is finished already */
+  ktls_active = is_ktls_active (connection);
+  if (0 == strcmp (url, BUFFER_PATH))
+  {
+    response = MHD_create_response_from_buffer_static (TEST_FILE_SIZE,
+                                                       file_data);
+    if (NULL == response)
+      return MHD_NO;
+    ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+    MHD_destroy_response (response);
+    return ret;
+  }
+  fd = open (sourcefile, O_RDONLY);
+  if (-1 == fd)
+  {
+    fprintf (stderr, "Failed to open `%s': %s\n",
+             sourcefile,
+             strerror (errno));
+    return MHD_NO;
+  }
+  response = MHD_create_response_from_fd (TEST_FILE_SIZE, fd);
+  if (NULL == response)
+  {
+    close (fd);
+    return MHD_NO;
+  }
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Perform HTTPS GET request of the file and check the result.
+ *
+ * @param flags the flags for the daemon
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+test_file_get (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  struct CBC cbc;
+  char url[255];
+  int port;
+  unsigned int ret = 0;
+
+  ktls_active = 0;
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 3050;
+
+  d = MHD_start_daemon (flags | MHD_USE_TLS | MHD_USE_ERROR_LOG, port,
+                        NULL, NULL,
+                        &file_ahc, NULL,
+                        MHD_OPTION_HTTPS_MEM_KEY, srv_signed_key_pem,
+                        MHD_OPTION_HTTPS_MEM_CERT, srv_signed_cert_pem,
+                        MHD_OPTION_TLS_KTLS, (int) 1,
+                        MHD_OPTION_ZEROCOPY_THRESHOLD,
+                        (size_t) ZEROCOPY_THRESHOLD,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, MHD_E_SERVER_INIT);
+    return 1;
+  }
+  if (0 == port)
+  {
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d);
+      return 2;
+    }
+    port = (int) dinfo->port;
+  }
+
+  cbc.size = TEST_FILE_SIZE + 1;
+  cbc.pos = 0;
+  if (NULL == (cbc.buf = malloc (cbc.size)))
+  {
+    fprintf (stderr, MHD_E_MEM);
+    MHD_stop_daemon (d);
+    return 4;
+  }
+  if (0 != gen_test_file_url (url,
+                              sizeof (url),
+                              port))
+    ret = 8;
+  /* Use the default cipher suites and protocol versions to allow
+   * negotiation of the parameters supported by the kernel TLS */
+  else if (CURLE_OK !=
+           send_curl_req (url, &cbc, NULL, CURL_SSLVERSION_DEFAULT))
+    ret = 16;
+  else if ( (TEST_FILE_SIZE != cbc.pos) ||
+            (0 != memcmp (file_data, cbc.buf, TEST_FILE_SIZE)) )
+  {
+    fprintf (stderr, "Error: local file & received file differ.\n");
+    ret = 32;
+  }
+  if (0 == ret)
+  {
+    /* The large buffer response must not be sent with MSG_ZEROCOPY */
+    cbc.pos = 0;
+    snprintf (url, sizeof (url), "https://127.0.0.1:%d%s",
+              port, BUFFER_PATH);
+    if (CURLE_OK !=
+        send_curl_req (url, &cbc, NULL, CURL_SSLVERSION_DEFAULT))
+      ret = 16;
+    else if ( (TEST_FILE_SIZE != cbc.pos) ||
+              (0 != memcmp (file_data, cbc.buf, TEST_FILE_SIZE)) )
+    {
+      fprintf (stderr, "Error: wrong buffer response data.\n");
+      ret = 32;
+    }
+  }
+  free (cbc.buf);
+
+  /* The counters of the connections with own threads are added to
+   * the daemon counters only when the connection is cleaned up */
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_STATS);
+  if ( (0 == ret) && ktls_active &&
+       (0 == (flags & MHD_USE_THREAD_PER_CONNECTION)) &&
+       ((NULL == dinfo) || (0 == dinfo->stats->sendfile_calls)) )
+  {
+    fprintf (stderr, "The kernel TLS is active, but the file has not "
+             "been sent by sendfile().\n");
+    ret = 64;
+  }
+  if ( (0 == ret) &&
+       (0 == (flags & MHD_USE_THREAD_PER_CONNECTION)) &&
+       (NULL != dinfo) )
+  {
+    if (0 != dinfo->stats->zerocopy_calls)
+    {
+      fprintf (stderr, "MSG_ZEROCOPY has been used for TLS connection.\n");
+      ret = 128;
+    }
+#ifdef HAVE_ZEROCOPY
+    else if (0 == dinfo->stats->zerocopy_fallbacks)
+    {
+      fprintf (stderr, "The zerocopy fallback has not been counted.\n");
+      ret = 128;
+    }
+#endif /* HAVE_ZEROCOPY */
+  }
+  if (ktls_active)
+    ktls_tests++;
+  MHD_stop_daemon (d);
+  return ret;
+}
+
+
+/**
+ * Write the GnuTLS configuration file enabling the kernel TLS and
+ * re-execute the test with the configuration file used by GnuTLS.
+ * Returns only on failure.
+ *
+ * @param argv the arguments of the test
+ * @param tmp the directory for the configuration file
+ */
+static void
+reexec_with_ktls (char *const *argv,
+                  const char *tmp)
+{
+  static char config_path[PATH_MAX];
+  static const char config[] = "[global]\nktls = true\n";
+  FILE *f;
+
+  snprintf (config_path, sizeof (config_path), "%s/%s",
+            tmp, "test-mhd-https-ktls.conf");
+  f = fopen (config_path, "w");
+  if (NULL == f)
+    return;
+  if (1 != fwrite (config, sizeof (config) - 1, 1, f))
+  {
+    fclose (f);
+    return;
+  }
+  fclose (f);
+  if ( (0 != setenv (GNUTLS_CONFIG_ENV, config_path, 1)) ||
+       (0 != setenv (REEXEC_ENV, "1", 1)) )
+    return;
+  execv (argv[0], argv);
+  fprintf (stderr, "Failed to re-execute `%s': %s\n",
+           argv[0], strerror (errno));
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  const char *tmp;
+  FILE *f;
+  size_t i;
+  (void) argc;   /* Unused. Silent compiler warning. */
+
+#ifdef MHD_HTTPS_REQUIRE_GRYPT
+  gcry_control (GCRYCTL_ENABLE_QUICK_RANDOM, 0);
+#ifdef GCRYCTL_INITIALIZATION_FINISHED
+  gcry_control (GCRYCTL_INITIALIZATION_FINISHED, 0);
+#endif
+#endif /* MHD_HTTPS_REQUIRE_GRYPT */
+  if ( (NULL == (tmp = getenv ("TMPDIR"))) &&
+       (NULL == (tmp = getenv ("TMP"))) &&
+       (NULL == (tmp = getenv ("TEMP"))) )
+    tmp = "/tmp";
+#if ! defined(__linux__) || ! defined(HAVE_GNUTLS_TRANSPORT_IS_KTLS_ENABLED)
+  fprintf (stderr, "The kernel TLS is not supported.  "
+           "Cannot run the test.\n");
+  return 77;
+#else
+  if (NULL == getenv (REEXEC_ENV))
+  {
+    reexec_with_ktls (argv, tmp);
+    return 77;
+  }
+#endif
+  if (! testsuite_curl_global_init ())
+    return 99;
+  if (NULL == curl_version_info (CURLVERSION_NOW)->ssl_version)
+  {
+    fprintf (stderr, "Curl does not support SSL.  Cannot run the test.\n");
+    curl_global_cleanup ();
+    return 77;
+  }
+
+  sourcefile = malloc (strlen (tmp) + 32);
+  file_data = malloc (TEST_FILE_SIZE);
+  if ( (NULL == sourcefile) ||
+       (NULL == file_data) )
+  {
+    curl_global_cleanup ();
+    return 99;
+  }
+  snprintf (sourcefile,
+            strlen (tmp) + 32,
+            "%s/%s",
+            tmp,
+            "test-mhd-https-sendfile");
+  for (i = 0; i < TEST_FILE_SIZE; i++)
+    file_data[i] = (char) ('a' + (i * 7 + i / 4096) % 26);
+  f = fopen (sourcefile, "w");
+  if (NULL == f)
+  {
+    fprintf (stderr, "failed to write test file\n");
+    free (file_data);
+    free (sourcefile);
+    curl_global_cleanup ();
+    return 99;
+  }
+  if (1 != fwrite (file_data, TEST_FILE_SIZE, 1, f))
+    abort ();
+  fclose (f);
+
+  errorCount += test_file_get (MHD_USE_INTERNAL_POLLING_THREAD);
+  errorCount += test_file_get (MHD_USE_INTERNAL_POLLING_THREAD
+                               | MHD_USE_THREAD_PER_CONNECTION);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += test_file_get (MHD_USE_INTERNAL_POLLING_THREAD
+                                 | MHD_USE_EPOLL);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  unlink (sourcefile);
+  if (NULL != getenv (GNUTLS_CONFIG_ENV))
+    unlink (getenv (GNUTLS_CONFIG_ENV));
+  free (sourcefile);
+  free (file_data);
+
+  if (errorCount != 0)
+    return 1;
+  if (0 == ktls_tests)
+  {
+    fprintf (stderr, "The kernel TLS has not been enabled by the kernel "
+             "or GnuTLS.  The test is skipped.\n");
+    return 77;
+  }
+  return 0;
+}
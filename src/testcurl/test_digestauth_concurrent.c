@@ -22,6 +22,9 @@
 /**
  * @file test_digestauth_concurrent.c
  * @brief  Testcase for libmicrohttpd concurrent Digest Authorisation
+ * @details When built as perf_digestauth_concurrent, measures the
+ *          throughput of Digest Authorisation with the growing number of
+ *          the daemon's worker threads and the client threads.
  * @author Amr Ali
  * @author Karlson2k (Evgeny Grin)
  */
@@ -49,6 +52,8 @@
 #include <pthread.h>
 
 #include "mhd_has_param.h"
+#include "mhd_has_in_name.h"
+#include "gauger.h"
 
 #ifndef CURL_VERSION_BITS
 #define CURL_VERSION_BITS(x,y,z) ((x)<<16|(y)<<8|(z))
@@ -236,6 +241,11 @@ _checkCURLE_OK_func (CURLcode code, const char *curlFunc,
 
 #define MY_OPAQUE "11733b200778ce33060f31c9af70a870ba96ddd4"
 
+/**
+ * The number of requests performed by each client in the benchmark mode
+ */
+#define BENCH_REQUESTS 500
+
 struct CBC
 {
   char *buf;
@@ -245,6 +255,11 @@ struct CBC
 
 static int verbose;
 
+/**
+ * Non-zero if running as the throughput benchmark
+ */
+static int bench_mode;
+
 static size_t
 copyBuffer (void *ptr,
             size_t size,
@@ -449,6 +464,10 @@ struct curlWokerInfo
    */
   CURL *c;
   char *libcurl_errbuf;
+  /**
+   * The number of requests to perform
+   */
+  unsigned int num_requests;
   /**
    * Non-zero if worker is finished
    */
@@ -465,67 +484,30 @@ worker_func (void *param)
 {
   struct curlWokerInfo *const w = (struct curlWokerInfo *) param;
   CURLcode req_result;
+  unsigned int i;
   if (NULL == w)
     externalErrorExit ();
 
-  req_result = curl_easy_perform (w->c);
-  if (CURLE_OK != req_result)
-  {
-    fflush (stdout);
-    if (0 != w->libcurl_errbuf[0])
-      fprintf (stderr, "Worker %d: first request failed. "
-               "libcurl error: '%s'.\n"
-               "libcurl error description: '%s'.\n",
-               w->workerNumber, curl_easy_strerror (req_result),
-               w->libcurl_errbuf);
-    else
-      fprintf (stderr, "Worker %d: first request failed. "
-               "libcurl error: '%s'.\n",
-               w->workerNumber, curl_easy_strerror (req_result));
-    fflush (stderr);
-  }
-  else
+  for (i = 0; i < w->num_requests; i++)
   {
-    if (w->cbc.pos != strlen (PAGE))
-    {
-      fprintf (stderr, "Worker %d: Got %u bytes ('%.*s'), expected %u bytes. ",
-               w->workerNumber,
-               (unsigned) w->cbc.pos, (int) w->cbc.pos, w->cbc.buf,
-               (unsigned) strlen (MHD_URI_BASE_PATH));
-      mhdErrorExitDesc ("Wrong returned data length");
-    }
-    if (0 != strncmp (PAGE, w->cbc.buf, strlen (PAGE)))
+    w->cbc.pos = 0;
+    req_result = curl_easy_perform (w->c);
+    if (CURLE_OK != req_result)
     {
-      fprintf (stderr, "Worker %d: Got invalid response '%.*s'. ",
-               w->workerNumber,
-               (int) w->cbc.pos, w->cbc.buf);
-      mhdErrorExitDesc ("Wrong returned data");
+      fflush (stdout);
+      if (0 != w->libcurl_errbuf[0])
+        fprintf (stderr, "Worker %d: request %u failed. "
+                 "libcurl error: '%s'.\n"
+                 "libcurl error description: '%s'.\n",
+                 w->workerNumber, i + 1, curl_easy_strerror (req_result),
+                 w->libcurl_errbuf);
+      else
+        fprintf (stderr, "Worker %d: request %u failed. "
+                 "libcurl error: '%s'.\n",
+                 w->workerNumber, i + 1, curl_easy_strerror (req_result));
+      fflush (stderr);
+      continue;
     }
-    if (verbose)
-      printf ("Worker %d: first request successful.\n", w->workerNumber);
-    w->success++;
-  }
-
-  /* Second request */
-  w->cbc.pos = 0;
-  req_result = curl_easy_perform (w->c);
-  if (CURLE_OK != req_result)
-  {
-    fflush (stdout);
-    if (0 != w->libcurl_errbuf[0])
-      fprintf (stderr, "Worker %d: second request failed. "
-               "libcurl error: '%s'.\n"
-               "libcurl error description: '%s'.\n",
-               w->workerNumber, curl_easy_strerror (req_result),
-               w->libcurl_errbuf);
-    else
-      fprintf (stderr, "Worker %d: second request failed. "
-               "libcurl error: '%s'.\n",
-               w->workerNumber, curl_easy_strerror (req_result));
-    fflush (stderr);
-  }
-  else
-  {
     if (w->cbc.pos != strlen (PAGE))
     {
       fprintf (stderr, "Worker %d: Got %u bytes ('%.*s'), expected %u bytes. ",
@@ -541,8 +523,8 @@ worker_func (void *param)
                (int) w->cbc.pos, w->cbc.buf);
       mhdErrorExitDesc ("Wrong returned data");
     }
-    if (verbose)
-      printf ("Worker %d: second request successful.\n", w->workerNumber);
+    if (verbose && (! bench_mode))
+      printf ("Worker %d: request %u successful.\n", w->workerNumber, i + 1);
     w->success++;
   }
 
@@ -551,37 +533,69 @@ worker_func (void *param)
 }
 
 
+/**
+ * Get the current timestamp
+ *
+ * @return current time in ms
+ */
+static unsigned long long
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return (((unsigned long long) tv.tv_sec * 1000LL)
+          + ((unsigned long long) tv.tv_usec / 1000LL));
+}
+
+
 #define CLIENT_BUF_SIZE 2048
 
+/**
+ * Run the parallel requests with Digest Authorisation.
+ *
+ * @param num_workers the number of the client threads and the number
+ *                    of the daemon's worker threads
+ * @param num_requests the number of requests performed by each client
+ * @return 0 on success, the number of failed requests otherwise
+ */
 static unsigned int
-testDigestAuth (void)
+testDigestAuth (unsigned int num_workers,
+                unsigned int num_requests)
 {
   struct MHD_Daemon *d;
   char rnd[8];
   uint16_t port;
   size_t i;
-  /* Run three workers in parallel so at least two workers would start within
-   * the same monotonic clock second.*/
-  struct curlWokerInfo workers[3];
+  struct curlWokerInfo *workers;
+  unsigned long long start_time;
   unsigned int ret;
 
   if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
     port = 0;
   else
-    port = 4200;
+    port = bench_mode ? 4201 : 4200;
 
   getRnd (rnd, sizeof(rnd));
 
+  workers = calloc (num_workers, sizeof(struct curlWokerInfo));
+  if (NULL == workers)
+    externalErrorExitDesc ("calloc() failed");
+
   d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG,
                         port, NULL, NULL,
                         &ahc_echo, NULL,
                         MHD_OPTION_DIGEST_AUTH_RANDOM, sizeof (rnd), rnd,
                         MHD_OPTION_NONCE_NC_SIZE, 300,
-                        MHD_OPTION_THREAD_POOL_SIZE,
-                        (unsigned int) (sizeof(workers) / sizeof(workers[0])),
+                        (1 < num_workers) ?
+                        MHD_OPTION_THREAD_POOL_SIZE : MHD_OPTION_END,
+                        num_workers,
                         MHD_OPTION_END);
   if (d == NULL)
+  {
+    free (workers);
     return 1;
+  }
   if (0 == port)
   {
     const union MHD_DaemonInfo *dinfo;
@@ -595,7 +609,7 @@ testDigestAuth (void)
   }
 
   /* Initialise all workers */
-  for (i = 0; i < sizeof(workers) / sizeof(workers[0]); i++)
+  for (i = 0; i < num_workers; i++)
   {
     struct curlWokerInfo *const w = workers + i;
     w->workerNumber = (int) i + 1; /* Use 1-based numbering */
@@ -609,12 +623,14 @@ testDigestAuth (void)
       externalErrorExitDesc ("malloc() failed");
     w->libcurl_errbuf[0] = 0;
     w->c = setupCURL (&w->cbc, port, w->libcurl_errbuf);
+    w->num_requests = num_requests;
     w->finished = 0;
     w->success = 0;
   }
 
+  start_time = now ();
   /* Fire already initialised workers */
-  for (i = 0; i < sizeof(workers) / sizeof(workers[0]); i++)
+  for (i = 0; i < num_workers; i++)
   {
     struct curlWokerInfo *const w = workers + i;
     if (0 != pthread_create (&w->pid, NULL, &worker_func, w))
@@ -623,7 +639,7 @@ testDigestAuth (void)
 
   /* Collect results, cleanup workers */
   ret = 0;
-  for (i = 0; i < sizeof(workers) / sizeof(workers[0]); i++)
+  for (i = 0; i < num_workers; i++)
   {
     struct curlWokerInfo *const w = workers + i;
     if (0 != pthread_join (w->pid, NULL))
@@ -633,9 +649,27 @@ testDigestAuth (void)
     free (w->cbc.buf);
     if (! w->finished)
       externalErrorExitDesc ("The worker thread did't signal 'finished' state");
-    ret += 2 - w->success;
+    ret += num_requests - w->success;
+  }
+  if (bench_mode && (0 == ret))
+  {
+    const unsigned long long elapsed = now () - start_time;
+    const double rps = ((double) (num_workers * num_requests * 1000))
+                       / ((double) ((0 != elapsed) ? elapsed : 1));
+    char desc[64];
+
+    snprintf (desc, sizeof(desc), "%u workers", num_workers);
+    fprintf (stderr,
+             "Digest Auth requests using %s: %f requests/s\n",
+             desc,
+             rps);
+    GAUGER (desc,
+            "Parallel Digest Auth requests",
+            rps,
+            "requests/s");
   }
 
+  free (workers);
   MHD_stop_daemon (d);
   return ret;
 }
@@ -656,6 +690,7 @@ main (int argc, char *const *argv)
   }
 #endif /* libcurl version 7.62.x */
 
+  bench_mode = has_in_name (argv[0], "perf_");
   verbose = ! (has_param (argc, argv, "-q") ||
                has_param (argc, argv, "--quiet") ||
                has_param (argc, argv, "-s") ||
@@ -671,7 +706,20 @@ main (int argc, char *const *argv)
 #endif /* MHD_HTTPS_REQUIRE_GRYPT */
   if (0 != curl_global_init (CURL_GLOBAL_WIN32))
     return 2;
-  errorCount += testDigestAuth ();
+  if (! bench_mode)
+  {
+    /* Run three workers in parallel so at least two workers would start
+     * within the same monotonic clock second. */
+    errorCount += testDigestAuth (3, 2);
+  }
+  else
+  {
+    static const unsigned int workers_nums[] = {1, 2, 4, 8, 16, 32};
+    size_t i;
+
+    for (i = 0; i < sizeof(workers_nums) / sizeof(workers_nums[0]); i++)
+      errorCount += testDigestAuth (workers_nums[i], BENCH_REQUESTS);
+  }
   if (errorCount != 0)
     fprintf (stderr, "Error (code: %u)\n", errorCount);
   curl_global_cleanup ();
@@ -0,0 +1,451 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 agent
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_get_compress.c
+ * @brief  Testcase for the responses with #MHD_RF_COMPRESS flag
+ * @details The shared buffer response and the callback responses are
+ *          requested with different "Accept-Encoding" headers.  The
+ *          body decoded by libcurl must be the same as the original
+ *          data, the "Content-Encoding" header must match the
+ *          accepted coding.
+ * @author agent
+ */
+
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <microhttpd.h>
+#include <curl/curl.h>
+
+/**
+ * The size of the response body.
+ */
+#define BODY_SIZE (256 * 1024 + 17)
+
+/**
+ * The size of the blocks produced by the callback response.
+ */
+#define CB_BLOCK_SIZE 1000
+
+static char body_data[BODY_SIZE];
+
+/**
+ * The shared response with the data in memory.
+ */
+static struct MHD_Response *shared_response;
+
+struct CBC
+{
+  char *buf;
+  size_t pos;
+  size_t size;
+};
+
+/**
+ * The entity tag of the shared response.
+ */
+#define SHARED_ETAG "\"body\""
+
+/**
+ * The value of the "Content-Encoding", "Vary" and "ETag" reply headers.
+ */
+static char reply_coding[32];
+static char reply_vary[64];
+static char reply_etag[64];
+
+
+static ssize_t
+body_reader (void *cls,
+             uint64_t pos,
+             char *buf,
+             size_t max)
+{
+  size_t size = CB_BLOCK_SIZE;
+  (void) cls;  /* Unused. Silent compiler warning. */
+
+  if (BODY_SIZE <= pos)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  if (size > max)
+    size = max;
+  if (size > BODY_SIZE - pos)
+    size = (size_t) (BODY_SIZE - pos);
+  memcpy (buf, body_data + pos, size);
+  return (ssize_t) size;
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) method; (void) version;
+  (void) upload_data; (void) upload_data_size;
+
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  if (0 != strcmp (url, "/stream"))
+    return MHD_queue_response (connection, MHD_HTTP_OK, shared_response);
+  response = MHD_create_response_from_callback (MHD_SIZE_UNKNOWN,
+                                                4 * CB_BLOCK_SIZE,
+                                                &body_reader,
+                                                NULL,
+                                                NULL);
+  if (NULL == response)
+    return MHD_NO;
+  /* "Accept-Encoding" must be appended to the existing header */
+  if ( (MHD_YES != MHD_add_response_header (response,
+                                            MHD_HTTP_HEADER_VARY,
+                                            "Cookie")) ||
+       (MHD_YES != MHD_set_response_options (response,
+                                             MHD_RF_COMPRESS,
+                                             MHD_RO_END)) )
+  {
+    MHD_destroy_response (response);
+    return MHD_NO;
+  }
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static size_t
+copy_buffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct CBC *cbc = ctx;
+
+  if (cbc->pos + size * nmemb > cbc->size)
+    return 0;                   /* overflow */
+  memcpy (&cbc->buf[cbc->pos], ptr, size * nmemb);
+  cbc->pos += size * nmemb;
+  return size * nmemb;
+}
+
+
+/**
+ * Copy the value of the header if the @a line is the header @a name.
+ */
+static void
+get_header_value (const char *line,
+                  size_t len,
+                  const char *name,
+                  char *value,
+                  size_t value_size)
+{
+  const size_t name_len = strlen (name);
+  size_t i;
+
+  if (len <= name_len)
+    return;
+  for (i = 0; i < name_len; i++)
+  {
+    if (tolower ((unsigned char) line[i]) != tolower ((unsigned char) name[i]))
+      return;
+  }
+  line += name_len;
+  len -= name_len;
+  while ( (0 != len) && (' ' == *line) )
+  {
+    line++;
+    len--;
+  }
+  for (i = 0; (i < len) && (i + 1 < value_size); i++)
+  {
+    if (('\r' == line[i]) || ('\n' == line[i]))
+      break;
+    value[i] = line[i];
+  }
+  value[i] = 0;
+}
+
+
+static size_t
+header_cb (char *buffer, size_t size, size_t nitems, void *ctx)
+{
+  (void) ctx;  /* Unused. Silent compiler warning. */
+  get_header_value (buffer, size * nitems, "Content-Encoding:",
+                    reply_coding, sizeof (reply_coding));
+  get_header_value (buffer, size * nitems, "Vary:",
+                    reply_vary, sizeof (reply_vary));
+  get_header_value (buffer, size * nitems, "ETag:",
+                    reply_etag, sizeof (reply_etag));
+  return size * nitems;
+}
+
+
+/**
+ * Perform the request and check the reply.
+ *
+ * @param c the curl handle to use
+ * @param port the port of the daemon
+ * @param path the path to request
+ * @param accept the value for "Accept-Encoding", NULL to not send it
+ * @param coding the expected coding, "" for the uncompressed reply
+ * @param alt_coding the alternative expected coding, or NULL
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+check_request (CURL *c,
+               uint16_t port,
+               const char *path,
+               const char *accept,
+               const char *coding,
+               const char *alt_coding)
+{
+  struct CBC cbc;
+  char url[64];
+  char etag[64];
+  const int is_stream = (0 == strcmp (path, "/stream"));
+  unsigned int ret = 0;
+
+  cbc.size = BODY_SIZE + 1;
+  cbc.buf = malloc (cbc.size);
+  if (NULL == cbc.buf)
+    return 64;
+  cbc.pos = 0;
+  reply_coding[0] = 0;
+  reply_vary[0] = 0;
+  reply_etag[0] = 0;
+  snprintf (url, sizeof (url), "http://127.0.0.1:%u%s",
+            (unsigned int) port, path);
+  curl_easy_setopt (c, CURLOPT_URL, url);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &cbc);
+  curl_easy_setopt (c, CURLOPT_ACCEPT_ENCODING, accept);
+  if (CURLE_OK != curl_easy_perform (c))
+  {
+    fprintf (stderr, "curl_easy_perform() failed for '%s' (%s).\n",
+             path, (NULL != accept) ? accept : "no Accept-Encoding");
+    ret = 1;
+  }
+  else if ( (BODY_SIZE != cbc.pos) ||
+            (0 != memcmp (cbc.buf, body_data, BODY_SIZE)) )
+  {
+    fprintf (stderr, "Wrong reply body for '%s' (%s).\n",
+             path, (NULL != accept) ? accept : "no Accept-Encoding");
+    ret = 2;
+  }
+  else if ( (0 != strcmp (coding, reply_coding)) &&
+            ((NULL == alt_coding) || (0 != strcmp (alt_coding, reply_coding))) )
+  {
+    fprintf (stderr, "Wrong coding for '%s' (%s): '%s', expected '%s'.\n",
+             path, (NULL != accept) ? accept : "no Accept-Encoding",
+             reply_coding, coding);
+    ret = 4;
+  }
+  else if (0 != strcmp (is_stream ? "Cookie, Accept-Encoding" :
+                        "Accept-Encoding", reply_vary))
+  {
+    fprintf (stderr, "Wrong 'Vary' header for '%s': '%s'.\n",
+             path, reply_vary);
+    ret = 8;
+  }
+  else if (! is_stream)
+  {
+    /* Each coding must have its own entity tag */
+    if (0 == reply_coding[0])
+      snprintf (etag, sizeof (etag), "%s", SHARED_ETAG);
+    else
+      snprintf (etag, sizeof (etag), "\"body-%s\"", reply_coding);
+    if (0 != strcmp (etag, reply_etag))
+    {
+      fprintf (stderr, "Wrong 'ETag' header for '%s': '%s', "
+               "expected '%s'.\n", reply_coding, reply_etag, etag);
+      ret = 8;
+    }
+  }
+  free (cbc.buf);
+  return ret;
+}
+
+
+/**
+ * Check the "Vary" header set by MHD_set_response_options().
+ *
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+test_vary (void)
+{
+  struct MHD_Response *r;
+  const char *vary;
+  unsigned int ret = 0;
+
+  r = MHD_create_response_empty (MHD_RF_NONE);
+  if (NULL == r)
+    return 64;
+  /* The invalid option must not modify the response */
+  if ( (MHD_NO != MHD_set_response_options (r, MHD_RF_COMPRESS,
+                                            (enum MHD_ResponseOptions) 1,
+                                            MHD_RO_END)) ||
+       (NULL != MHD_get_response_header (r, MHD_HTTP_HEADER_VARY)) )
+  {
+    fprintf (stderr, "Invalid option modified the response.\n");
+    ret |= 128;
+  }
+  if ( (MHD_YES != MHD_set_response_options (r, MHD_RF_COMPRESS,
+                                             MHD_RO_END)) ||
+       (MHD_YES != MHD_set_response_options (r, MHD_RF_NONE,
+                                             MHD_RO_END)) ||
+       (NULL != MHD_get_response_header (r, MHD_HTTP_HEADER_VARY)) )
+  {
+    fprintf (stderr, "The 'Vary' header is not removed.\n");
+    ret |= 128;
+  }
+  if ( (MHD_YES != MHD_add_response_header (r, MHD_HTTP_HEADER_VARY,
+                                            "Cookie")) ||
+       (MHD_YES != MHD_set_response_options (r, MHD_RF_COMPRESS,
+                                             MHD_RO_END)) )
+    ret |= 128;
+  vary = MHD_get_response_header (r, MHD_HTTP_HEADER_VARY);
+  if ( (NULL == vary) || (0 != strcmp (vary, "Cookie, Accept-Encoding")) )
+  {
+    fprintf (stderr, "The 'Vary' header is not extended.\n");
+    ret |= 128;
+  }
+  if (MHD_YES != MHD_set_response_options (r, MHD_RF_NONE, MHD_RO_END))
+    ret |= 128;
+  vary = MHD_get_response_header (r, MHD_HTTP_HEADER_VARY);
+  if ( (NULL == vary) || (0 != strcmp (vary, "Cookie")) )
+  {
+    fprintf (stderr, "The 'Vary' header is not restored.\n");
+    ret |= 128;
+  }
+  MHD_destroy_response (r);
+  return ret;
+}
+
+
+/**
+ * Send the requests with the different codings.
+ *
+ * @param flags the flags for the daemon
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+test_compress (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  uint16_t port;
+  CURL *c;
+  unsigned int ret;
+
+  d = MHD_start_daemon (flags | MHD_USE_INTERNAL_POLLING_THREAD
+                        | MHD_USE_ERROR_LOG,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, "Daemon cannot be started!\n");
+    return 16;
+  }
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+  {
+    MHD_stop_daemon (d);
+    return 32;
+  }
+  port = dinfo->port;
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 64;
+  }
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copy_buffer);
+  curl_easy_setopt (c, CURLOPT_HEADERFUNCTION, &header_cb);
+  curl_easy_setopt (c, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 30L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  ret = check_request (c, port, "/", "gzip", "gzip", NULL);
+  /* The second reply uses the cached compressed data */
+  ret |= check_request (c, port, "/", "gzip", "gzip", NULL);
+  ret |= check_request (c, port, "/", "deflate", "deflate", NULL);
+  ret |= check_request (c, port, "/", "gzip;q=0.5, deflate;q=0.8",
+                        "deflate", NULL);
+  ret |= check_request (c, port, "/", "gzip;q=0, deflate;q=0", "", NULL);
+  ret |= check_request (c, port, "/", NULL, "", NULL);
+  ret |= check_request (c, port, "/stream", "gzip", "gzip", NULL);
+  ret |= check_request (c, port, "/stream", "deflate", "deflate", NULL);
+  ret |= check_request (c, port, "/stream", NULL, "", NULL);
+  if (0 != (curl_version_info (CURLVERSION_NOW)->features
+            & CURL_VERSION_BROTLI))
+  {
+    /* "br" is used only if MHD is built with brotli */
+    ret |= check_request (c, port, "/", "br, gzip", "br", "gzip");
+    ret |= check_request (c, port, "/stream", "br, gzip", "br", "gzip");
+  }
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  return ret;
+}
+
+
+int
+main (void)
+{
+  unsigned int errorCount = 0;
+  size_t i;
+
+  if (MHD_YES != MHD_is_feature_supported (MHD_FEATURE_COMPRESSION))
+    return 77;
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 99;
+  for (i = 0; i < BODY_SIZE; i++)
+    body_data[i] = (char) ('a' + (i * 7 + i / 4096) % 26);
+  shared_response = MHD_create_response_from_buffer_static (BODY_SIZE,
+                                                            body_data);
+  if ( (NULL == shared_response) ||
+       (MHD_YES != MHD_add_response_header (shared_response,
+                                            MHD_HTTP_HEADER_ETAG,
+                                            SHARED_ETAG)) ||
+       (MHD_YES != MHD_set_response_options (shared_response,
+                                             MHD_RF_COMPRESS,
+                                             MHD_RO_END)) )
+  {
+    curl_global_cleanup ();
+    return 99;
+  }
+  errorCount += test_vary ();
+  errorCount += test_compress (0);
+  errorCount += test_compress (MHD_USE_THREAD_PER_CONNECTION);
+  MHD_destroy_response (shared_response);
+  if (0 != errorCount)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;
+}
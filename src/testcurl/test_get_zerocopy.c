@@ -0,0 +1,259 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 agent
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_get_zerocopy.c
+ * @brief  Testcase for large buffer and iovec responses sent with
+ *         #MHD_OPTION_ZEROCOPY_THRESHOLD
+ * @details Several responses are sent over the same keep-alive
+ *          connection.  The data must be received unchanged and all
+ *          responses must be released when the daemon is stopped.
+ */
+
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <microhttpd.h>
+#include <curl/curl.h>
+
+/**
+ * The size of the response body.
+ */
+#define BODY_SIZE (16 * 1024 * 1024)
+
+/**
+ * The number of the iov elements of the iovec response.
+ */
+#define BODY_IOVCNT 64
+
+/**
+ * The number of requests sent over the same connection.
+ */
+#define NUM_REQUESTS 4
+
+static char body_data[BODY_SIZE];
+
+/**
+ * The number of released buffer responses.
+ */
+static volatile unsigned int num_freed;
+
+struct CBC
+{
+  char *buf;
+  size_t pos;
+  size_t size;
+};
+
+
+static void
+free_cb (void *cls)
+{
+  (void) cls;  /* Unused. Silent compiler warning. */
+  num_freed++;
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_IoVec iov[BODY_IOVCNT];
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  unsigned int i;
+  (void) cls; (void) method; (void) version;
+  (void) upload_data; (void) upload_data_size;
+
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  if (0 == strcmp (url, "/iovec"))
+  {
+    for (i = 0; i < BODY_IOVCNT; i++)
+    {
+      iov[i].iov_base = body_data + i * (BODY_SIZE / BODY_IOVCNT);
+      iov[i].iov_len = BODY_SIZE / BODY_IOVCNT;
+    }
+    response = MHD_create_response_from_iovec (iov, BODY_IOVCNT,
+                                               NULL, NULL);
+  }
+  else
+    response =
+      MHD_create_response_from_buffer_with_free_callback (BODY_SIZE,
+                                                          body_data,
+                                                          &free_cb);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static size_t
+copy_buffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct CBC *cbc = ctx;
+
+  if (cbc->pos + size * nmemb > cbc->size)
+    return 0;                   /* overflow */
+  memcpy (&cbc->buf[cbc->pos], ptr, size * nmemb);
+  cbc->pos += size * nmemb;
+  return size * nmemb;
+}
+
+
+/**
+ * Send the requests over the same connection and check the replies.
+ *
+ * @param flags the flags for the daemon
+ * @return 0 on success, error code otherwise
+ */
+static unsigned int
+test_zerocopy (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  struct CBC cbc;
+  char url[64];
+  CURL *c;
+  unsigned int i;
+  unsigned int ret;
+
+  num_freed = 0;
+  d = MHD_start_daemon (flags | MHD_USE_INTERNAL_POLLING_THREAD
+                        | MHD_USE_ERROR_LOG,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_ZEROCOPY_THRESHOLD,
+                        (size_t) (256 * 1024),
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, "Daemon cannot be started!\n");
+    return 16;
+  }
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+  {
+    MHD_stop_daemon (d);
+    return 32;
+  }
+  cbc.size = BODY_SIZE + 1;
+  cbc.buf = malloc (cbc.size);
+  c = curl_easy_init ();
+  if ((NULL == cbc.buf) || (NULL == c))
+  {
+    free (cbc.buf);
+    MHD_stop_daemon (d);
+    return 64;
+  }
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copy_buffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &cbc);
+  curl_easy_setopt (c, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 30L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  ret = 0;
+  for (i = 0; i < NUM_REQUESTS && 0 == ret; i++)
+  {
+    snprintf (url, sizeof (url), "http://127.0.0.1:%u%s",
+              (unsigned int) dinfo->port,
+              (0 == i % 2) ? "/" : "/iovec");
+    curl_easy_setopt (c, CURLOPT_URL, url);
+    cbc.pos = 0;
+    if (CURLE_OK != curl_easy_perform (c))
+    {
+      fprintf (stderr, "curl_easy_perform() failed.\n");
+      ret = 1;
+    }
+    else if ( (BODY_SIZE != cbc.pos) ||
+              (0 != memcmp (cbc.buf, body_data, BODY_SIZE)) )
+    {
+      fprintf (stderr, "Wrong reply body for '%s'.\n", url);
+      ret = 2;
+    }
+  }
+  curl_easy_cleanup (c);
+  free (cbc.buf);
+
+  /* The counters of the connections with own threads are added to
+   * the daemon counters when the connection is cleaned up */
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_STATS);
+  if ( (0 == ret) && (NULL != dinfo) &&
+       (0 == (flags & MHD_USE_THREAD_PER_CONNECTION)) )
+  {
+    if (0 == dinfo->stats->zerocopy_calls
+        + dinfo->stats->zerocopy_fallbacks)
+    {
+      fprintf (stderr, "The zerocopy sending has not been tried.\n");
+      ret = 4;
+    }
+    else
+      printf ("Zerocopy sends: %u (copied by kernel: %u), "
+              "fallbacks: %u.\n",
+              (unsigned int) dinfo->stats->zerocopy_calls,
+              (unsigned int) dinfo->stats->zerocopy_copied,
+              (unsigned int) dinfo->stats->zerocopy_fallbacks);
+  }
+  MHD_stop_daemon (d);
+  if ( (0 == ret) &&
+       ((NUM_REQUESTS + 1) / 2 != num_freed) )
+  {
+    fprintf (stderr, "Wrong number of released responses: %u.\n",
+             num_freed);
+    ret = 8;
+  }
+  return ret;
+}
+
+
+int
+main (void)
+{
+  unsigned int errorCount = 0;
+  size_t i;
+
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 99;
+  for (i = 0; i < BODY_SIZE; i++)
+    body_data[i] = (char) ('a' + (i * 7 + i / 4096) % 26);
+  errorCount += test_zerocopy (0);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += test_zerocopy (MHD_USE_POLL);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += test_zerocopy (MHD_USE_EPOLL);
+  errorCount += test_zerocopy (MHD_USE_THREAD_PER_CONNECTION);
+  if (0 != errorCount)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;
+}
@@ -109,8 +109,44 @@ ahc_echo (void *cls,
 }
 
 
+/**
+ * Check the performance counters of the daemon after three rounds
+ * of two served requests and one rejected connection.
+ */
 static int
-testMultithreadedGet ()
+checkStats (struct MHD_Daemon *d)
+{
+  const union MHD_DaemonInfo *dinfo;
+  const struct MHD_DaemonStats *st;
+
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_STATS);
+  if ((NULL == dinfo) || (NULL == dinfo->stats))
+    return 1024;
+  st = dinfo->stats;
+  if ( (9 != st->connections_accepted) ||
+       (3 != st->connections_rejected) ||
+       (6 != st->requests_parsed) ||
+       (0 == st->bytes_received) ||
+       (0 == st->bytes_sent) ||
+       (6 > st->send_calls + st->iovec_calls) )
+  {
+    fprintf (stderr,
+             "Unexpected statistics: accepted %u, rejected %u, "
+             "requests %u, received %u, sent %u, sends %u\n",
+             (unsigned int) st->connections_accepted,
+             (unsigned int) st->connections_rejected,
+             (unsigned int) st->requests_parsed,
+             (unsigned int) st->bytes_received,
+             (unsigned int) st->bytes_sent,
+             (unsigned int) (st->send_calls + st->iovec_calls));
+    return 1024;
+  }
+  return 0;
+}
+
+
+static int
+testMultithreadedGet (unsigned int poll_flag)
 {
   struct MHD_Daemon *d;
   char buf[2048];
@@ -126,16 +162,20 @@ testMultithreadedGet ()
     port = 1260;
     if (oneone)
       port += 5;
+    if (0 != poll_flag)
+      port += 10;
   }
 
   /* Test only valid for HTTP/1.1 (uses persistent connections) */
   if (! oneone)
     return 0;
 
-  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG,
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG
+                        | poll_flag,
                         port, NULL, NULL,
                         &ahc_echo, "GET",
                         MHD_OPTION_PER_IP_CONNECTION_LIMIT, (unsigned int) 2,
+                        MHD_OPTION_ACCEPT_BATCH_SIZE, (unsigned int) 2,
                         MHD_OPTION_END);
   if (d == NULL)
     return 16;
@@ -219,8 +259,26 @@ testMultithreadedGet ()
       }
     }
   }
+  if (0 != (poll_flag & MHD_USE_EPOLL))
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_ACCEPT_WAKEUPS);
+    if ((NULL == dinfo) || (0 == dinfo->num_wakeups) )
+    {
+      MHD_stop_daemon (d);
+      return 256;
+    }
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_ACCEPT_BATCH_MAX);
+    if ((NULL == dinfo) || (0 == dinfo->max_accept_batch) ||
+        (2 < dinfo->max_accept_batch))
+    {
+      MHD_stop_daemon (d);
+      return 512;
+    }
+  }
+  k = checkStats (d);
   MHD_stop_daemon (d);
-  return 0;
+  return k;
 }
 
 
@@ -338,8 +396,9 @@ testMultithreadedPoolGet ()
 
 
   }
+  k = checkStats (d);
   MHD_stop_daemon (d);
-  return 0;
+  return k;
 }
 
 
@@ -354,7 +413,9 @@ main (int argc, char *const *argv)
   oneone = has_in_name (argv[0], "11");
   if (0 != curl_global_init (CURL_GLOBAL_WIN32))
     return 2;
-  errorCount |= testMultithreadedGet ();
+  errorCount |= testMultithreadedGet (0);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount |= testMultithreadedGet (MHD_USE_EPOLL);
   errorCount |= testMultithreadedPoolGet ();
   if (errorCount != 0)
     fprintf (stderr, "Error (code: %u)\n", errorCount);
@@ -0,0 +1,186 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 agent
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_listen_per_worker.c
+ * @brief  Testcase for separate listen sockets of thread pool workers
+ */
+
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <microhttpd.h>
+#include <curl/curl.h>
+
+/**
+ * The number of worker threads.
+ */
+#define NUM_WORKERS 4
+
+/**
+ * The number of sequential requests, each one in a new connection.
+ */
+#define NUM_REQUESTS 32
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) method; (void) version;
+  (void) upload_data; (void) upload_data_size;
+
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  response =
+    MHD_create_response_from_buffer_static (strlen ("Response"), "Response");
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static size_t
+write_data (void *ptr, size_t size, size_t nmemb, void *stream)
+{
+  (void) ptr; (void) stream;       /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+int
+main (void)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  struct curl_slist *hdrs;
+  char url[64];
+  CURL *c;
+  unsigned int i;
+  unsigned int used_workers;
+  uint64_t total;
+  int ret;
+
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 99;
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_AUTO
+                        | MHD_USE_ERROR_LOG,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_THREAD_POOL_SIZE,
+                        (unsigned int) NUM_WORKERS,
+                        MHD_OPTION_LISTEN_SOCKET_PER_WORKER,
+                        (unsigned int) 1,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, "Daemon cannot be started!\n");
+    return 77;
+  }
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+  {
+    MHD_stop_daemon (d);
+    return 99;
+  }
+  snprintf (url, sizeof (url), "http://127.0.0.1:%u",
+            (unsigned int) dinfo->port);
+
+  hdrs = curl_slist_append (NULL, "Connection: close");
+  ret = 0;
+  for (i = 0; i < NUM_REQUESTS && 0 == ret; i++)
+  {
+    c = curl_easy_init ();
+    if (NULL == c)
+    {
+      ret = 99;
+      break;
+    }
+    curl_easy_setopt (c, CURLOPT_URL, url);
+    curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &write_data);
+    curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+    curl_easy_setopt (c, CURLOPT_FORBID_REUSE, 1L);
+    curl_easy_setopt (c, CURLOPT_TIMEOUT, 10L);
+    if (CURLE_OK != curl_easy_perform (c))
+    {
+      fprintf (stderr, "curl_easy_perform() failed.\n");
+      ret = 1;
+    }
+    curl_easy_cleanup (c);
+  }
+  curl_slist_free_all (hdrs);
+
+  if (0 == ret)
+  {
+    total = 0;
+    used_workers = 0;
+    for (i = 0; i < NUM_WORKERS; i++)
+    {
+      dinfo = MHD_get_daemon_info (d,
+                                   MHD_DAEMON_INFO_WORKER_CONNECTIONS_ACCEPTED,
+                                   i);
+      if (NULL == dinfo)
+      {
+        fprintf (stderr, "MHD_get_daemon_info() failed for worker %u.\n", i);
+        ret = 99;
+        break;
+      }
+      total += dinfo->num_accepted;
+      if (0 != dinfo->num_accepted)
+        used_workers++;
+    }
+  }
+  if (0 == ret)
+  {
+    if (NULL != MHD_get_daemon_info (d,
+                                     MHD_DAEMON_INFO_WORKER_CONNECTIONS_ACCEPTED,
+                                     (unsigned int) NUM_WORKERS))
+    {
+      fprintf (stderr, "Information returned for the wrong worker.\n");
+      ret = 2;
+    }
+    else if (NUM_REQUESTS != total)
+    {
+      fprintf (stderr, "Wrong number of accepted connections: %u.\n",
+               (unsigned int) total);
+      ret = 4;
+    }
+    else if (2 > used_workers)
+    {
+      fprintf (stderr, "Connections were not distributed between "
+               "workers.\n");
+      ret = 8;
+    }
+  }
+  MHD_stop_daemon (d);
+  curl_global_cleanup ();
+  return ret;
+}
@@ -0,0 +1,320 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 agent
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_offload.c
+ * @brief  Testcase for the blocking tasks processed by the offload pool
+ * @details Several requests are sent in parallel to the daemon with
+ *          the single internal thread (or with the small worker pool).  The task of every request
+ *          blocks until the tasks of all requests are started, which
+ *          is possible only if the daemon's thread is not blocked by
+ *          the tasks.  The reply is created from the result of the task.
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+/**
+ * The number of parallel requests and the size of the offload pool.
+ */
+#define NUM_REQUESTS 4
+
+/**
+ * The maximum time in seconds to wait for all tasks.
+ */
+#define TASKS_TIMEOUT 10
+
+/**
+ * The context of the request.
+ */
+struct Request
+{
+  /**
+   * Set to non-zero when the task is queued.
+   */
+  int offloaded;
+
+  /**
+   * Set to non-zero when the task is finished.
+   */
+  int done;
+
+  /**
+   * The result of the task.
+   */
+  char result[64];
+};
+
+struct CBC
+{
+  char buf[64];
+  size_t pos;
+};
+
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The number of started tasks.
+ */
+static unsigned int tasks_started;
+
+/**
+ * The number of tasks that have not seen all other tasks started.
+ */
+static unsigned int tasks_timed_out;
+
+static uint16_t port;
+
+
+static void
+blocking_task (void *cls,
+               struct MHD_Connection *connection)
+{
+  struct Request *r = cls;
+  time_t start;
+  (void) connection; /* Unused. Silent compiler warning. */
+
+  pthread_mutex_lock (&tasks_lock);
+  tasks_started++;
+  pthread_mutex_unlock (&tasks_lock);
+  start = time (NULL);
+  /* Block like a slow database query until all tasks are started */
+  while (1)
+  {
+    pthread_mutex_lock (&tasks_lock);
+    if (NUM_REQUESTS <= tasks_started)
+    {
+      pthread_mutex_unlock (&tasks_lock);
+      break;
+    }
+    if (time (NULL) - start > TASKS_TIMEOUT)
+    {
+      tasks_timed_out++;
+      pthread_mutex_unlock (&tasks_lock);
+      break;
+    }
+    pthread_mutex_unlock (&tasks_lock);
+    usleep (1000);
+  }
+  snprintf (r->result, sizeof (r->result), "result of task");
+  r->done = 1;
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  struct Request *r = *req_cls;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) method; (void) version;
+  (void) upload_data; (void) upload_data_size;
+
+  if (NULL == r)
+  {
+    r = calloc (1, sizeof (struct Request));
+    if (NULL == r)
+      return MHD_NO;
+    *req_cls = r;
+    return MHD_YES;
+  }
+  if (! r->offloaded)
+  {
+    r->offloaded = 1;
+    return MHD_offload_connection (connection,
+                                   &blocking_task,
+                                   r);
+  }
+  if (! r->done)
+  {
+    fprintf (stderr, "The connection is resumed before the task "
+             "is finished.\n");
+    return MHD_NO;
+  }
+  response = MHD_create_response_from_buffer_copy (strlen (r->result),
+                                                   r->result);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static void
+request_completed (void *cls,
+                   struct MHD_Connection *connection,
+                   void **req_cls,
+                   enum MHD_RequestTerminationCode toe)
+{
+  (void) cls; (void) connection; (void) toe;
+  free (*req_cls);
+  *req_cls = NULL;
+}
+
+
+static size_t
+copy_buffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct CBC *cbc = ctx;
+
+  if (cbc->pos + size * nmemb > sizeof (cbc->buf))
+    return 0;                   /* overflow */
+  memcpy (&cbc->buf[cbc->pos], ptr, size * nmemb);
+  cbc->pos += size * nmemb;
+  return size * nmemb;
+}
+
+
+static void *
+client_thread (void *arg)
+{
+  CURL *c;
+  struct CBC cbc;
+  char url[64];
+  const char *expected = "result of task";
+  uintptr_t ret = 0;
+  (void) arg; /* Unused. Silent compiler warning. */
+
+  cbc.pos = 0;
+  snprintf (url, sizeof (url), "http://127.0.0.1:%u/",
+            (unsigned int) port);
+  c = curl_easy_init ();
+  if (NULL == c)
+    return (void *) (uintptr_t) 1;
+  curl_easy_setopt (c, CURLOPT_URL, url);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copy_buffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &cbc);
+  curl_easy_setopt (c, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 30L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  if (CURLE_OK != curl_easy_perform (c))
+  {
+    fprintf (stderr, "curl_easy_perform() failed.\n");
+    ret = 2;
+  }
+  else if ( (strlen (expected) != cbc.pos) ||
+            (0 != memcmp (expected, cbc.buf, cbc.pos)) )
+  {
+    fprintf (stderr, "Wrong reply body.\n");
+    ret = 4;
+  }
+  curl_easy_cleanup (c);
+  return (void *) ret;
+}
+
+
+static unsigned int
+test_offload (unsigned int flags,
+              unsigned int num_workers)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  pthread_t clients[NUM_REQUESTS];
+  unsigned int i;
+  unsigned int ret = 0;
+
+  tasks_started = 0;
+  tasks_timed_out = 0;
+  d = MHD_start_daemon (flags | MHD_USE_INTERNAL_POLLING_THREAD
+                        | MHD_USE_ERROR_LOG,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_NOTIFY_COMPLETED, &request_completed, NULL,
+                        MHD_OPTION_OFFLOAD_POOL_SIZE,
+                        (unsigned int) NUM_REQUESTS,
+                        (0 != num_workers) ?
+                        MHD_OPTION_THREAD_POOL_SIZE : MHD_OPTION_END,
+                        num_workers,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, "Daemon cannot be started!\n");
+    return 16;
+  }
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+  {
+    MHD_stop_daemon (d);
+    return 32;
+  }
+  port = dinfo->port;
+  for (i = 0; i < NUM_REQUESTS; i++)
+  {
+    if (0 != pthread_create (&clients[i], NULL, &client_thread, NULL))
+    {
+      fprintf (stderr, "Failed to create the thread.\n");
+      abort ();
+    }
+  }
+  for (i = 0; i < NUM_REQUESTS; i++)
+  {
+    void *res;
+
+    if (0 != pthread_join (clients[i], &res))
+      abort ();
+    ret |= (unsigned int) (uintptr_t) res;
+  }
+  MHD_stop_daemon (d);
+  if (0 != tasks_timed_out)
+  {
+    fprintf (stderr, "The tasks are not processed in parallel.\n");
+    ret |= 8;
+  }
+  return ret;
+}
+
+
+int
+main (void)
+{
+  unsigned int errorCount = 0;
+
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 99;
+  errorCount += test_offload (0, 0);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += test_offload (MHD_USE_POLL, 0);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += test_offload (MHD_USE_EPOLL, 0);
+  /* The pool is shared by the worker daemons */
+  errorCount += test_offload (0, 2);
+  if (0 != errorCount)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;
+}
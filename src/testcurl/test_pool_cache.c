@@ -0,0 +1,257 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 agent
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_pool_cache.c
+ * @brief  Testcase for reusing of connections' memory pools
+ */
+
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <microhttpd.h>
+#include <curl/curl.h>
+
+/**
+ * The number of sequential requests, each one in a new connection.
+ */
+#define NUM_REQUESTS 5
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) method; (void) version;
+  (void) upload_data; (void) upload_data_size;
+
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  response =
+    MHD_create_response_from_buffer_static (strlen ("Response"), "Response");
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static size_t
+write_data (void *ptr, size_t size, size_t nmemb, void *stream)
+{
+  (void) ptr; (void) stream;       /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+static uint64_t
+get_cache_stat (struct MHD_Daemon *d,
+                enum MHD_DaemonInfoType type)
+{
+  const union MHD_DaemonInfo *dinfo;
+
+  dinfo = MHD_get_daemon_info (d, type);
+  if (NULL == dinfo)
+  {
+    fprintf (stderr, "MHD_get_daemon_info() failed.\n");
+    exit (99);
+  }
+  return dinfo->num_pools;
+}
+
+
+/**
+ * Perform the requests.
+ *
+ * @param d the daemon to use
+ * @param keep_alive if non-zero, all requests use the same connection,
+ *                   otherwise each request uses a new connection
+ * @return zero on success
+ */
+static int
+perform_requests (struct MHD_Daemon *d,
+                  int keep_alive)
+{
+  const union MHD_DaemonInfo *dinfo;
+  struct curl_slist *hdrs;
+  char url[64];
+  CURL *c;
+  unsigned int i;
+  int ret;
+
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+    return 99;
+  snprintf (url, sizeof (url), "http://127.0.0.1:%u",
+            (unsigned int) dinfo->port);
+
+  hdrs = keep_alive ? NULL : curl_slist_append (NULL, "Connection: close");
+  c = NULL;
+  ret = 0;
+  for (i = 0; i < NUM_REQUESTS && 0 == ret; i++)
+  {
+    if (NULL == c)
+      c = curl_easy_init ();
+    if (NULL == c)
+    {
+      ret = 99;
+      break;
+    }
+    curl_easy_setopt (c, CURLOPT_URL, url);
+    curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &write_data);
+    curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+    curl_easy_setopt (c, CURLOPT_FORBID_REUSE, keep_alive ? 0L : 1L);
+    curl_easy_setopt (c, CURLOPT_TIMEOUT, 10L);
+    if (CURLE_OK != curl_easy_perform (c))
+    {
+      fprintf (stderr, "curl_easy_perform() failed.\n");
+      ret = 1;
+    }
+    if (! keep_alive)
+    {
+      curl_easy_cleanup (c);
+      c = NULL;
+    }
+  }
+  if (NULL != c)
+    curl_easy_cleanup (c);
+  curl_slist_free_all (hdrs);
+  return ret;
+}
+
+
+/**
+ * Test reusing of the pools of the closed connections.
+ */
+static int
+test_closed_connections (void)
+{
+  struct MHD_Daemon *d;
+  uint64_t hits;
+  uint64_t misses;
+  int ret;
+
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_AUTO
+                        | MHD_USE_ERROR_LOG,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE,
+                        (unsigned int) 4,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, "Daemon cannot be started!\n");
+    return 77;
+  }
+  ret = perform_requests (d, 0);
+  if (0 == ret)
+  {
+    hits = get_cache_stat (d, MHD_DAEMON_INFO_POOL_CACHE_HITS);
+    misses = get_cache_stat (d, MHD_DAEMON_INFO_POOL_CACHE_MISSES);
+    if (NUM_REQUESTS != hits + misses)
+    {
+      fprintf (stderr, "Wrong number of allocated pools: %u hits, "
+               "%u misses.\n", (unsigned int) hits, (unsigned int) misses);
+      ret = 2;
+    }
+    else if ((0 == misses) || (0 == hits))
+    {
+      fprintf (stderr, "Pools were not reused: %u hits, %u misses.\n",
+               (unsigned int) hits, (unsigned int) misses);
+      ret = 4;
+    }
+  }
+  MHD_stop_daemon (d);
+  return ret;
+}
+
+
+/**
+ * Test releasing of the pools of the idle keep-alive connections.
+ */
+static int
+test_idle_connections (void)
+{
+  struct MHD_Daemon *d;
+  uint64_t hits;
+  uint64_t misses;
+  int ret;
+
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_AUTO
+                        | MHD_USE_ERROR_LOG,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_CONNECTION_MEMORY_POOL_CACHE,
+                        (unsigned int) 4,
+                        MHD_OPTION_CONNECTION_MEMORY_RELEASE_IDLE,
+                        (int) 1,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, "Daemon cannot be started!\n");
+    return 77;
+  }
+  ret = perform_requests (d, 1);
+  if (0 == ret)
+  {
+    hits = get_cache_stat (d, MHD_DAEMON_INFO_POOL_CACHE_HITS);
+    misses = get_cache_stat (d, MHD_DAEMON_INFO_POOL_CACHE_MISSES);
+    /* The pool is not released if the next request is received
+       together with the end of the previous one.  The pool is
+       re-allocated also to detect the closure of the connection. */
+    if ((1 != misses) || (NUM_REQUESTS < hits))
+    {
+      fprintf (stderr, "Wrong number of allocated pools: %u hits, "
+               "%u misses.\n", (unsigned int) hits, (unsigned int) misses);
+      ret = 8;
+    }
+    else if (0 == hits)
+    {
+      fprintf (stderr, "Pools of idle connections were not released.\n");
+      ret = 16;
+    }
+  }
+  MHD_stop_daemon (d);
+  return ret;
+}
+
+
+int
+main (void)
+{
+  int ret;
+
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 99;
+  ret = test_closed_connections ();
+  if (0 == ret)
+    ret = test_idle_connections ();
+  curl_global_cleanup ();
+  return ret;
+}
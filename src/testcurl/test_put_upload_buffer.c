@@ -0,0 +1,310 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 agent
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_put_upload_buffer.c
+ * @brief  Testcase for PUT requests with the body received directly to
+ *         the buffer of the application
+ * @author agent
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/**
+ * The size of the uploaded body.
+ */
+#define PUT_SIZE (1024 * 1024 + 37)
+
+/**
+ * The number of requests sent over the same connection.
+ */
+#define NUM_REQUESTS 3
+
+/**
+ * The body of the request.
+ */
+static char *put_buffer;
+
+/**
+ * The context of the request.
+ */
+struct Request
+{
+  /**
+   * The buffer for the body.
+   */
+  char *buf;
+
+  /**
+   * The number of bytes of the body checked already.
+   */
+  size_t done;
+
+  /**
+   * The number of calls of the handler with the body data.
+   */
+  unsigned int num_calls;
+
+  /**
+   * Non-zero if the body is wrong.
+   */
+  int error;
+};
+
+/**
+ * The size of the buffer of the application.
+ */
+static size_t upload_buf_size;
+
+/**
+ * The number of the requests with the correct body.
+ */
+static unsigned int num_correct;
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  struct Request *r = *req_cls;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) version;
+
+  if (0 != strcmp (MHD_HTTP_METHOD_PUT, method))
+    return MHD_NO;
+  if (NULL == r)
+  {
+    r = calloc (1, sizeof (struct Request));
+    if (NULL == r)
+      return MHD_NO;
+    r->buf = malloc (upload_buf_size);
+    if (NULL == r->buf)
+    {
+      free (r);
+      return MHD_NO;
+    }
+    *req_cls = r;
+    if (MHD_YES != MHD_set_connection_upload_buffer (connection,
+                                                     r->buf,
+                                                     upload_buf_size))
+    {
+      fprintf (stderr, "MHD_set_connection_upload_buffer() failed.\n");
+      r->error = 1;
+    }
+    return MHD_YES;
+  }
+  if (0 != *upload_data_size)
+  {
+    r->num_calls++;
+    if (upload_data != r->buf)
+    {
+      fprintf (stderr, "The data is not in the buffer of "
+               "the application.\n");
+      r->error = 1;
+    }
+    if ( (r->done + *upload_data_size > PUT_SIZE) ||
+         (0 != memcmp (put_buffer + r->done, upload_data,
+                       *upload_data_size)) )
+    {
+      fprintf (stderr, "Wrong body data at position %u.\n",
+               (unsigned int) r->done);
+      r->error = 1;
+    }
+    else
+      r->done += *upload_data_size;
+    *upload_data_size = 0;
+    return MHD_YES;
+  }
+  if ( (PUT_SIZE == r->done) &&
+       (! r->error) &&
+       ((PUT_SIZE + upload_buf_size - 1) / upload_buf_size ==
+        r->num_calls) )
+    num_correct++;
+  else if (! r->error)
+    fprintf (stderr, "Wrong body: %u bytes in %u calls.\n",
+             (unsigned int) r->done, r->num_calls);
+  response =
+    MHD_create_response_from_buffer_static (strlen ("Done"), "Done");
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static void
+request_completed (void *cls,
+                   struct MHD_Connection *connection,
+                   void **req_cls,
+                   enum MHD_RequestTerminationCode toe)
+{
+  struct Request *r = *req_cls;
+  (void) cls; (void) connection; (void) toe;
+
+  if (NULL == r)
+    return;
+  free (r->buf);
+  free (r);
+  *req_cls = NULL;
+}
+
+
+static size_t
+put_data (void *stream, size_t size, size_t nmemb, void *ptr)
+{
+  size_t *pos = ptr;
+  size_t wrt;
+
+  wrt = size * nmemb;
+  if (wrt > PUT_SIZE - *pos)
+    wrt = PUT_SIZE - *pos;
+  memcpy (stream, put_buffer + *pos, wrt);
+  *pos += wrt;
+  return wrt;
+}
+
+
+static size_t
+write_data (void *ptr, size_t size, size_t nmemb, void *stream)
+{
+  (void) ptr; (void) stream;       /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+static unsigned int
+test_upload (unsigned int flags,
+             size_t buf_size)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  struct curl_slist *hdrs;
+  CURL *c;
+  char url[64];
+  size_t pos;
+  unsigned int i;
+  unsigned int ret;
+
+  upload_buf_size = buf_size;
+  num_correct = 0;
+  d = MHD_start_daemon (flags | MHD_USE_INTERNAL_POLLING_THREAD
+                        | MHD_USE_ERROR_LOG,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_NOTIFY_COMPLETED, &request_completed, NULL,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    fprintf (stderr, "Daemon cannot be started!\n");
+    return 16;
+  }
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+  {
+    MHD_stop_daemon (d);
+    return 32;
+  }
+  snprintf (url, sizeof (url), "http://127.0.0.1:%u/upload",
+            (unsigned int) dinfo->port);
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 64;
+  }
+  /* Do not wait for "100 Continue" */
+  hdrs = curl_slist_append (NULL, "Expect:");
+  ret = 0;
+  for (i = 0; i < NUM_REQUESTS; i++)
+  {
+    pos = 0;
+    curl_easy_setopt (c, CURLOPT_URL, url);
+    curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &write_data);
+    curl_easy_setopt (c, CURLOPT_READFUNCTION, &put_data);
+    curl_easy_setopt (c, CURLOPT_READDATA, &pos);
+    curl_easy_setopt (c, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt (c, CURLOPT_INFILESIZE, (long) PUT_SIZE);
+    curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+    curl_easy_setopt (c, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt (c, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+    if (CURLE_OK != curl_easy_perform (c))
+    {
+      fprintf (stderr, "curl_easy_perform() failed.\n");
+      ret |= 1;
+      break;
+    }
+  }
+  curl_easy_cleanup (c);
+  curl_slist_free_all (hdrs);
+  MHD_stop_daemon (d);
+  if ((0 == ret) && (NUM_REQUESTS != num_correct))
+  {
+    fprintf (stderr, "Only %u requests of %u have correct body.\n",
+             num_correct, (unsigned int) NUM_REQUESTS);
+    ret |= 2;
+  }
+  return ret;
+}
+
+
+int
+main (void)
+{
+  unsigned int errorCount = 0;
+  size_t i;
+
+  put_buffer = malloc (PUT_SIZE);
+  if (NULL == put_buffer)
+    return 99;
+  for (i = 0; i < PUT_SIZE; i++)
+    put_buffer[i] = (char) ('0' + (i % 73));
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+  {
+    free (put_buffer);
+    return 99;
+  }
+  /* The whole body in one call */
+  errorCount += test_upload (0, PUT_SIZE);
+  /* Several calls, the last one is partial */
+  errorCount += test_upload (0, 100000);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += test_upload (MHD_USE_POLL, 100000);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += test_upload (MHD_USE_EPOLL, 100000);
+  errorCount += test_upload (MHD_USE_THREAD_PER_CONNECTION, 100000);
+  if (0 != errorCount)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  free (put_buffer);
+  return (0 == errorCount) ? 0 : 1;
+}